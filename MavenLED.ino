@@ -12,7 +12,17 @@
 #include "src/config/Settings.h"
 #include "src/printer/PrinterState.h"
 #include "src/led/LEDAnimations.h"
+#include "src/led/LEDOutput.h"
+#include "src/led/EffectVM.h"
+#include "src/led/LEDTransition.h"
+#include "src/led/LEDLayout.h"
+#include "src/led/FrameRecorder.h"
+#include "src/led/FrameScheduler.h"
+#include "src/led/LEDCommands.h"
+#include "src/diagnostics/Profiler.h"
 #include "src/network/NetworkManager.h"
+#include "src/network/UDPInput.h"
+#include "src/network/UDPOutput.h"
 #include "src/web/WebHandlers.h"
 #include "src/web/webpage.h"
 
@@ -33,6 +43,8 @@ void setup() {
   // Print initial heap status
   Serial.printf(" Initial Free Heap: %d bytes\n", ESP.getFreeHeap());
   
+  profilerBegin();
+  
   // Initialize SPIFFS for token and settings storage
   if (!SPIFFS.begin(true)) {
     Serial.println(" SPIFFS initialization failed!");
@@ -42,13 +54,12 @@ void setup() {
   
   // Load settings from SPIFFS
   loadSettings();
+  udpOutputConfigure(settings.udp_output_protocol, settings.udp_output_host, 
+                     settings.udp_output_port, settings.udp_output_universe);
+  udpInputConfigure(settings.realtime_enabled, settings.realtime_timeout_ms, settings.realtime_universe);
   
   Serial.printf(" Free Heap after settings load: %d bytes\n", ESP.getFreeHeap());
   
-  // Initialize LED strip with saved pin from settings
-  reinitializeStripPin(settings.led_pin);
-  Serial.printf(" Using GPIO %d for LED data pin\n", settings.led_pin);
-  
   // Initialize or validate RTC persistent state
   if (rtc_state.magic_number != 0xDEADBEEF) {
     rtc_state.printing_active = false;
@@ -68,10 +79,23 @@ void setup() {
   saved_rainbow_time = 0;
   Serial.println(" Animation continuity system initialized (including rainbow)");
   
-  // Initialize NeoPixel strip with dynamic count
+  // Initialize render canvas with dynamic count
   strip.updateLength(settings.led_count);
   strip.begin();
-  strip.show();
+  
+  // Initialize LED output channels with saved pins from settings
+  ledOutputBegin(settings.led_channels, settings.led_channel_count, settings.led_count);
+  Serial.printf(" Using GPIO %d for LED data pin (%d channel(s))\n", settings.led_pin, settings.led_channel_count);
+  
+  // Preallocate the state transition buffer
+  transitionBegin(settings.led_count);
+  
+  // Build the layout coordinate and remap tables
+  loadLayoutMap();
+  layoutBegin(settings.led_count);
+  
+  // Keep the last few seconds of output frames for /api/frames/dump
+  frameRecorderBegin(FRAME_RECORDER_BYTES);
   
   startupAnimation();    
   setup_wifi();
@@ -92,6 +116,12 @@ void setup() {
   // Create mutex for cross-core communication
   printerStateMutex = xSemaphoreCreateMutex();
   
+  // Compile user effects (needs the mutex, must run before the LED task starts)
+  loadEffects();
+  
+  // Command bus for settings changes applied by the LED task
+  ledCommandsBegin();
+  
   // Create LED task on Core 1 (dedicated to LED animations)
   xTaskCreatePinnedToCore(
     LEDTaskCode,   // Task function
@@ -115,6 +145,16 @@ void setup() {
   Serial.println(" LED task created on Core 1 (Priority 2)");
   Serial.println(" Network task created on Core 0 (Priority 1)");
   
+  // Realtime pixel input listener (idle until enabled in settings)
+  udpInputBegin();
+  
+  // Tasks whose stack high-water marks /api/profile reports
+  profilerRegisterTask(PROFILE_TASK_LED, LEDTask);
+  profilerRegisterTask(PROFILE_TASK_LED_OUTPUT, LEDOutputTask);
+  profilerRegisterTask(PROFILE_TASK_NETWORK, NetworkTask);
+  profilerRegisterTask(PROFILE_TASK_UDP_INPUT, UDPInputTask);
+  profilerRegisterTask(PROFILE_TASK_LOOP, xTaskGetCurrentTaskHandle());
+  
   // Initialize MQTT buffer size for large messages
   client.setBufferSize(16384); // 16KB for large JSON messages
   Serial.println(" MQTT buffer size set to 16KB for large JSON messages");
@@ -130,12 +170,9 @@ void setup() {
                   settings.remote_mqtt_server, settings.remote_mqtt_port);
   }
   
-  // IMPORTANT: Do NOT start MQTT here - defer it for system stability
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println(" WiFi connected - scheduling delayed MQTT startup...");
-  } else {
-    Serial.println(" WiFi not connected - MQTT service will start when WiFi is available");
-  }
+  // IMPORTANT: Do NOT start MQTT here - defer it for system stability.
+  // The network task starts it once the WiFi connection is up.
+  Serial.println(" MQTT service will start when WiFi is available");
   
   // Mark system startup time
   system_startup_time = millis();
@@ -146,12 +183,14 @@ void setup() {
   // Initialize connection state properly
   printer_state.is_connected = false;
   printer_state.status = "initializing";
+  markPrinterStatusChanged();
   printer_state.last_temp_change_time = millis();
   lastMQTTupdate = millis();
   lastMQTTProcessTime = 0;
 }
 
 void loop() {
+  PROFILE_TASK(PROFILE_TASK_LOOP);
   unsigned long currentTime = millis();
   
   system_fully_initialized = true;
@@ -161,14 +200,12 @@ void loop() {
   
   // Handle remote control MQTT (only after system is fully initialized)
   if (settings.remote_control_enabled && system_fully_initialized) {
-    if (!remoteControlClient.connected()) {
-      static unsigned long lastRemoteReconnectAttempt = 0;
-      if (millis() - lastRemoteReconnectAttempt > 30000) {
-        Serial.println(" Remote MQTT disconnected, attempting reconnect...");
-        reconnectRemoteControl();
-        lastRemoteReconnectAttempt = millis();
-      }
-    } else {
+    // Never blocks; the web server keeps running while the broker connects
+    if (WiFi.status() == WL_CONNECTED) {
+      serviceRemoteControl();
+    }
+    
+    if (remoteControlClient.connected()) {
       remoteControlClient.loop();
       
       // Publish periodic status updates (every 30 seconds)
@@ -201,46 +238,26 @@ void loop() {
 // LED Task - runs on Core 1 for smooth animations
 void LEDTaskCode(void * pvParameters) {
   Serial.println(" LED Task started on Core 1");
+  frameSchedulerBegin(LED_FRAME_PERIOD_MS);
   for(;;) {
-    if (xSemaphoreTake(printerStateMutex, 10 / portTICK_PERIOD_MS) == pdTRUE) {
-      bool timeoutTriggered = false;
-      
-      // Check finish animation timeout
-      if (printer_state.finish_animation_active) {
-        unsigned long finishDuration = millis() - printer_state.finish_animation_start;
-        if (finishDuration >= 120000) {
-          printer_state.finish_animation_active = false;
-          printer_state.state_override_active = true;
-          printer_state.state_override_start = millis();
-          printer_state.override_reason = "finish timeout";
-          printer_state.status = "idle";
-          Serial.println("️ Finish animation timeout - forcing idle state");
-          timeoutTriggered = true;
-        }
-      }
-      
-      // Check error recovery timeout
-      if (printer_state.error_recovery_active) {
-        unsigned long errorDuration = millis() - printer_state.error_recovery_start;
-        if (errorDuration >= 120000) {
-          printer_state.error_recovery_active = false;
-          printer_state.state_override_active = true;
-          printer_state.state_override_start = millis();
-          printer_state.override_reason = "error timeout";
-          printer_state.status = "idle";
-          Serial.println("️ Error recovery timeout - forcing idle state");
-          timeoutTriggered = true;
-        }
-      }
-      
-      if (!timeoutTriggered) {
-        determinePrinterStatus();
-      }
+    frameSchedulerWait();
+    PROFILE_TASK(PROFILE_TASK_LED);
+    
+    unsigned long lockStart = micros();
+    if (xSemaphoreTake(printerStateMutex, frameSchedulerPeriodTicks()) == pdTRUE) {
+      unsigned long renderStart = micros();
+      histogramRecord(frame_timing.lock_wait, renderStart - lockStart);
       
+      // Status is already determined on the network task; only render here.
+      // Queued settings changes land between frames, never mid-frame.
+      applyLEDCommands();
       updateLEDDisplay();
       xSemaphoreGive(printerStateMutex);
+      histogramRecord(frame_timing.render, micros() - renderStart);
+    } else {
+      frame_timing.lock_timeouts++;
     }
-    vTaskDelay(10 / portTICK_PERIOD_MS);
+    frameSchedulerEndFrame();
   }
 }
 
@@ -248,64 +265,62 @@ void LEDTaskCode(void * pvParameters) {
 void NetworkTaskCode(void * pvParameters) {
   Serial.println(" Network Task started on Core 0");
   for(;;) {
-    // WiFi connection check
-    if (WiFi.status() != WL_CONNECTED) {
-      if (client.connected()) {
-        Serial.println(" WiFi disconnected - stopping MQTT service");
-        stopMQTTService();
-      }
-      
-      unsigned long currentTime = millis();
-      if (currentTime - last_wifi_attempt > WIFI_RETRY_INTERVAL || last_wifi_attempt == 0) {
-        last_wifi_attempt = currentTime;
+    uint64_t busyStart = profilerMicros();
+    
+    // WiFi connection manager; never blocks, retries with backoff
+    switch (serviceWiFi()) {
+      case WIFI_EVENT_LOST:
+        if (client.connected()) {
+          Serial.println(" WiFi disconnected - stopping MQTT service");
+          stopMQTTService();
+        }
+        break;
         
-        Serial.printf(" WiFi disconnected! Failure count: %d/%d\n", wifi_failure_count, MAX_WIFI_FAILURES);
+      case WIFI_EVENT_CONNECTED:
+        mqtt_restart_pending = true;
+        mqtt_restart_time = millis() + MQTT_RESTART_DELAY;
+        Serial.printf(" WiFi connected - MQTT restart scheduled in %d seconds\n", MQTT_RESTART_DELAY / 1000);
+        break;
         
-        if (wifi_failure_count >= MAX_WIFI_FAILURES) {
-          bool deferRestart = false;
-          if (xSemaphoreTake(printerStateMutex, 10 / portTICK_PERIOD_MS) == pdTRUE) {
-            if (printer_state.status == "printing" || (printer_state.progress > 0 && printer_state.progress < 100)) {
-              deferRestart = true;
-            }
-            xSemaphoreGive(printerStateMutex);
-          }
-          
-          if (!deferRestart && rtc_state.printing_active && rtc_state.magic_number == 0xDEADBEEF) {
-            unsigned long timeSinceLastUpdate = millis() - rtc_state.last_update_time;
-            if (timeSinceLastUpdate < 600000) {
-              deferRestart = true;
-              Serial.println("️ RTC indicates printing was active - deferring restart");
-            }
-          }
-
-          if (deferRestart) {
-            Serial.println("️ WiFi failures reached but print job active; deferring restart");
-            last_wifi_attempt = currentTime;
-          } else {
-            Serial.println(" Maximum WiFi failures reached - RESTARTING DEVICE!");
-            delay(2000);
-            ESP.restart();
+      case WIFI_EVENT_ATTEMPT_FAILED: {
+        if (xSemaphoreTake(printerStateMutex, 10 / portTICK_PERIOD_MS) == pdTRUE) {
+          printer_state.is_connected = false;
+          printer_state.status = "unknown";
+          printer_state.raw_gcode_state = "unknown";
+          markPrinterStatusChanged();
+          xSemaphoreGive(printerStateMutex);
+        }
+        
+        if (wifi_failure_count < MAX_WIFI_FAILURES) break;
+        
+        bool deferRestart = false;
+        if (xSemaphoreTake(printerStateMutex, 10 / portTICK_PERIOD_MS) == pdTRUE) {
+          if (printer_state.status == "printing" || (printer_state.progress > 0 && printer_state.progress < 100)) {
+            deferRestart = true;
           }
+          xSemaphoreGive(printerStateMutex);
         }
         
-        if(!inAP){
-          if (!connectToWiFi()) {
-            Serial.printf(" WiFi connection failed (%d/%d). Next retry in 1 minute.\n", 
-                          wifi_failure_count, MAX_WIFI_FAILURES);
-            
-            if (xSemaphoreTake(printerStateMutex, 10 / portTICK_PERIOD_MS) == pdTRUE) {
-              printer_state.is_connected = false;
-              printer_state.status = "unknown";
-              printer_state.raw_gcode_state = "unknown";
-              xSemaphoreGive(printerStateMutex);
-            }
-          } else {
-            mqtt_restart_pending = true;
-            mqtt_restart_time = millis() + MQTT_RESTART_DELAY;
-            Serial.printf(" WiFi reconnected - MQTT restart scheduled in %d seconds\n", MQTT_RESTART_DELAY / 1000);
+        if (!deferRestart && rtc_state.printing_active && rtc_state.magic_number == 0xDEADBEEF) {
+          unsigned long timeSinceLastUpdate = millis() - rtc_state.last_update_time;
+          if (timeSinceLastUpdate < 600000) {
+            deferRestart = true;
+            Serial.println("️ RTC indicates printing was active - deferring restart");
           }
         }
+
+        if (deferRestart) {
+          Serial.println("️ WiFi failures reached but print job active; deferring restart");
+        } else {
+          Serial.println(" Maximum WiFi failures reached - RESTARTING DEVICE!");
+          delay(2000);
+          ESP.restart();
+        }
+        break;
       }
+        
+      default:
+        break;
     }
     
     // Handle MQTT restart after WiFi reconnection
@@ -315,24 +330,9 @@ void NetworkTaskCode(void * pvParameters) {
       startMQTTService();
     }
     
-    // Handle MQTT connection
-    if (system_fully_initialized && WiFi.status() == WL_CONNECTED && !mqtt_restart_pending && !client.connected()) {
-      unsigned long currentTime = millis();
-      
-      if (currentTime - lastMQTTReconnectAttempt >= 10000) {
-        lastMQTTReconnectAttempt = currentTime;
-        
-        Serial.println(" MQTT disconnected. Attempting to reconnect...");
-        
-        if (isGlobalMode()) {
-          Serial.println(" Global mode: Freeing memory before reconnect...");
-          client.disconnect();
-          delay(500);
-          Serial.printf(" Free heap before reconnect: %d bytes\n", ESP.getFreeHeap());
-        }
-        
-        startMQTTService();
-      }
+    // Printer MQTT connection: resumable connect steps, retried with backoff
+    if (system_fully_initialized && WiFi.status() == WL_CONNECTED && !mqtt_restart_pending) {
+      serviceMQTT();
     }
     
     // Process MQTT messages
@@ -342,9 +342,15 @@ void NetworkTaskCode(void * pvParameters) {
       }
     }
     
+    // Resolve the UDP output target; the output task only sends
+    udpOutputService();
+    
     // Check connection timeout
     checkConnectionTimeout();
     
+    // Re-run the state machine if something asked for it or a timer expired
+    serviceStatusEvaluation();
+    
     // Network heartbeat
     static unsigned long lastHeartbeat = 0;
     if (millis() - lastHeartbeat > 30000) {
@@ -360,6 +366,7 @@ void NetworkTaskCode(void * pvParameters) {
       lastHeartbeat = millis();
     }
     
+    profileTaskBusy(PROFILE_TASK_NETWORK, profilerMicros() - busyStart);
     yield();
     vTaskDelay(10 / portTICK_PERIOD_MS);
   }
@@ -1,16 +1,28 @@
 #include "Settings.h"
+#include "../diagnostics/Profiler.h"
 #include <SPIFFS.h>
 #include <ArduinoJson.h>
 
 LEDSettings settings;
 
 void saveSettings() {
-  DynamicJsonDocument doc(2048);
+  PROFILE_SCOPE(PROFILE_SAVE_SETTINGS);
+  DynamicJsonDocument doc(8192);
   
   // Hardware settings
   doc["led_count"] = settings.led_count;
   doc["led_pin"] = settings.led_pin;
   
+  // Output channels
+  doc["led_channel_count"] = settings.led_channel_count;
+  JsonArray channels = doc.createNestedArray("led_channels");
+  for (int i = 0; i < settings.led_channel_count; i++) {
+    JsonObject channel = channels.createNestedObject();
+    channel["pin"] = settings.led_channels[i].pin;
+    channel["count"] = settings.led_channels[i].count;
+    channel["offset"] = settings.led_channels[i].offset;
+  }
+  
   // Colors
   JsonArray colors = doc.createNestedArray("colors");
   for (int i = 0; i < 8; i++) {
@@ -20,6 +32,60 @@ void saveSettings() {
     color["b"] = settings.colors[i].b;
   }
   
+  // Palettes, as [pos, r, g, b] stops
+  JsonArray palettes = doc.createNestedArray("palettes");
+  for (int i = 0; i < 8; i++) {
+    JsonArray stops = palettes.createNestedArray();
+    for (int s = 0; s < settings.palettes[i].stop_count; s++) {
+      const PaletteStop& stop = settings.palettes[i].stops[s];
+      JsonArray entry = stops.createNestedArray();
+      entry.add(stop.pos);
+      entry.add(stop.r);
+      entry.add(stop.g);
+      entry.add(stop.b);
+    }
+  }
+  
+  // Layout
+  JsonObject layout = doc.createNestedObject("layout");
+  layout["type"] = settings.layout.type;
+  layout["width"] = settings.layout.width;
+  layout["height"] = settings.layout.height;
+  layout["serpentine"] = settings.layout.serpentine;
+  layout["reverse"] = settings.layout.reverse;
+  JsonArray rings = layout.createNestedArray("rings");
+  for (int i = 0; i < settings.layout.ring_count; i++) {
+    rings.add(settings.layout.ring_sizes[i]);
+  }
+  
+  // Network pixel output
+  doc["udp_output_protocol"] = settings.udp_output_protocol;
+  doc["udp_output_host"] = settings.udp_output_host;
+  doc["udp_output_port"] = settings.udp_output_port;
+  doc["udp_output_universe"] = settings.udp_output_universe;
+  
+  // Realtime pixel input
+  doc["realtime_enabled"] = settings.realtime_enabled;
+  doc["realtime_timeout_ms"] = settings.realtime_timeout_ms;
+  doc["realtime_universe"] = settings.realtime_universe;
+  
+  // Power budget
+  doc["power_limit_ma"] = settings.power_limit_ma;
+  doc["led_channel_ma"] = settings.led_channel_ma;
+  
+  // Effect assignments
+  JsonArray effectSlots = doc.createNestedArray("effect_slots");
+  for (int i = 0; i < 8; i++) {
+    effectSlots.add(settings.effect_slots[i]);
+  }
+  
+  // Printing visualization
+  doc["print_mode"] = settings.print_mode;
+  
+  // Transitions
+  doc["transition_mode"] = settings.transition_mode;
+  doc["transition_ms"] = settings.transition_ms;
+  
   // Directions
   doc["rainbow_direction"] = settings.rainbow_direction;
   doc["idle_direction"] = settings.idle_direction;
@@ -92,7 +158,7 @@ void loadSettings() {
     return;
   }
   
-  DynamicJsonDocument doc(2048);
+  DynamicJsonDocument doc(8192);
   DeserializationError error = deserializeJson(doc, file);
   file.close();
   
@@ -107,6 +173,16 @@ void loadSettings() {
   settings.led_count = doc["led_count"] | 60;
   settings.led_pin = doc["led_pin"] | 17;
   
+  // Output channels
+  settings.led_channel_count = constrain((int)(doc["led_channel_count"] | 1), 1, MAX_LED_CHANNELS);
+  JsonArray channels = doc["led_channels"];
+  for (int i = 0; i < settings.led_channel_count && i < (int)channels.size(); i++) {
+    settings.led_channels[i].pin = channels[i]["pin"] | settings.led_pin;
+    settings.led_channels[i].count = channels[i]["count"] | 0;
+    settings.led_channels[i].offset = channels[i]["offset"] | 0;
+  }
+  syncLEDChannels();
+  
   // Colors
   JsonArray colors = doc["colors"];
   if (colors.size() == 8) {
@@ -117,6 +193,62 @@ void loadSettings() {
     }
   }
   
+  // Palettes
+  JsonArray palettes = doc["palettes"];
+  for (int i = 0; i < 8; i++) {
+    JsonArray stops = palettes[i];
+    int stopCount = min((int)stops.size(), MAX_PALETTE_STOPS);
+    settings.palettes[i].stop_count = (stopCount >= 2) ? stopCount : 0;
+    for (int s = 0; s < settings.palettes[i].stop_count; s++) {
+      settings.palettes[i].stops[s].pos = stops[s][0];
+      settings.palettes[i].stops[s].r = stops[s][1];
+      settings.palettes[i].stops[s].g = stops[s][2];
+      settings.palettes[i].stops[s].b = stops[s][3];
+    }
+  }
+  
+  // Layout
+  JsonObject layout = doc["layout"];
+  settings.layout.type = constrain((int)(layout["type"] | 0), 0, 3);
+  settings.layout.width = constrain((int)(layout["width"] | 8), 1, MAX_LED_COUNT);
+  settings.layout.height = constrain((int)(layout["height"] | 32), 1, MAX_LED_COUNT);
+  settings.layout.serpentine = layout["serpentine"] | true;
+  settings.layout.reverse = layout["reverse"] | false;
+  JsonArray rings = layout["rings"];
+  settings.layout.ring_count = rings.isNull() ? 1 : constrain((int)rings.size(), 1, MAX_LAYOUT_RINGS);
+  for (int i = 0; i < MAX_LAYOUT_RINGS; i++) {
+    settings.layout.ring_sizes[i] = (i < (int)rings.size()) ? constrain((int)rings[i], 0, MAX_LED_COUNT) : 0;
+  }
+  if (rings.isNull()) settings.layout.ring_sizes[0] = settings.led_count;
+  
+  // Network pixel output
+  settings.udp_output_protocol = constrain((int)(doc["udp_output_protocol"] | 0), 0, 2);
+  strlcpy(settings.udp_output_host, doc["udp_output_host"] | "", sizeof(settings.udp_output_host));
+  settings.udp_output_port = constrain((int)(doc["udp_output_port"] | 0), 0, 65535);
+  settings.udp_output_universe = constrain((int)(doc["udp_output_universe"] | 1), 1, 63999);
+  
+  // Realtime pixel input
+  settings.realtime_enabled = doc["realtime_enabled"] | false;
+  settings.realtime_timeout_ms = constrain((int)(doc["realtime_timeout_ms"] | 2500), 100, 600000);
+  settings.realtime_universe = constrain((int)(doc["realtime_universe"] | 1), 1, 63999);
+  
+  // Power budget
+  settings.power_limit_ma = constrain((int)(doc["power_limit_ma"] | 0), 0, 100000);
+  settings.led_channel_ma = constrain((int)(doc["led_channel_ma"] | 20), 1, 100);
+  
+  // Effect assignments
+  JsonArray effectSlots = doc["effect_slots"];
+  for (int i = 0; i < 8; i++) {
+    settings.effect_slots[i] = (i < (int)effectSlots.size()) ? (effectSlots[i] | -1) : -1;
+  }
+  
+  // Printing visualization
+  settings.print_mode = constrain((int)(doc["print_mode"] | 0), 0, 1);
+  
+  // Transitions
+  settings.transition_mode = constrain((int)(doc["transition_mode"] | 1), 0, 2);
+  settings.transition_ms = constrain((int)(doc["transition_ms"] | 800), 0, 5000);
+  
   // Directions
   settings.rainbow_direction = doc["rainbow_direction"] | 1;
   settings.idle_direction = doc["idle_direction"] | 1;
@@ -169,6 +301,30 @@ void loadSettings() {
   Serial.printf("   Serial: %s\n", settings.device_serial);
 }
 
+// Keep led_pin/led_count and the channel table consistent. A single channel
+// follows led_pin/led_count; with several channels the framebuffer length is
+// the furthest channel end and led_pin reports channel 0.
+void syncLEDChannels() {
+  if (settings.led_channel_count <= 1) {
+    settings.led_channel_count = 1;
+    settings.led_count = constrain(settings.led_count, 1, MAX_LED_COUNT);
+    settings.led_channels[0].pin = settings.led_pin;
+    settings.led_channels[0].count = settings.led_count;
+    settings.led_channels[0].offset = 0;
+    return;
+  }
+  
+  int extent = 1;
+  for (int i = 0; i < settings.led_channel_count; i++) {
+    LEDChannelSettings& channel = settings.led_channels[i];
+    channel.offset = constrain(channel.offset, 0, MAX_LED_COUNT - 1);
+    channel.count = constrain(channel.count, 1, MAX_LED_COUNT - channel.offset);
+    extent = max(extent, channel.offset + channel.count);
+  }
+  settings.led_count = extent;
+  settings.led_pin = settings.led_channels[0].pin;
+}
+
 // Token storage functions
 bool saveTokenToSPIFFS(const char* filename, const String& token) {
   File file = SPIFFS.open(filename, "w");
@@ -3,12 +3,97 @@
 
 #include <Arduino.h>
 
+// Output channel limits
+#define MAX_LED_CHANNELS 4
+#define MAX_LED_COUNT 2000
+
+// One physical strip: its data pin, length and offset into the logical framebuffer
+struct LEDChannelSettings {
+  int pin = 17;
+  int count = 60;
+  int offset = 0;
+};
+
+// Gradient palettes
+#define MAX_PALETTE_STOPS 8
+
+struct PaletteStop {
+  uint8_t pos;   // Position along the palette (0-255)
+  uint8_t r, g, b;
+};
+
+// Gradient for one state. With no stops the palette is derived from the
+// state color.
+struct StatePalette {
+  int stop_count = 0;
+  PaletteStop stops[MAX_PALETTE_STOPS];
+};
+
+// Physical LED layouts
+#define MAX_LAYOUT_RINGS 4
+
+enum LayoutType {
+  LAYOUT_LINEAR = 0,
+  LAYOUT_MATRIX = 1,  // width x height, wired row by row from the top left
+  LAYOUT_RING = 2,    // Concentric rings, outermost first, each wired from the top
+  LAYOUT_CUSTOM = 3   // Per-LED x, y map uploaded through /api/layout
+};
+
+struct LayoutSettings {
+  int type = LAYOUT_LINEAR;
+  int width = 8;
+  int height = 32;
+  bool serpentine = true;   // Matrix rows alternate direction
+  int ring_count = 1;
+  int ring_sizes[MAX_LAYOUT_RINGS] = {60, 0, 0, 0};
+  bool reverse = false;     // Rings wired counter-clockwise
+};
+
+// The strip's hardware and layout fields, taken as one value so a change can
+// be applied to settings with the LED task parked (see reinitializeLEDStrip)
+struct LEDStripSettings {
+  int led_count;
+  int led_pin;
+  int led_channel_count;
+  LEDChannelSettings led_channels[MAX_LED_CHANNELS];
+  LayoutSettings layout;
+};
+
+// Printing visualization modes
+enum PrintMode {
+  PRINT_MODE_PROGRESS = 0,  // Progress bar with moving head
+  PRINT_MODE_LAYERS = 1     // Strip divided by layers, current layer pulsing
+};
+
 // Settings structure (stored in SPIFFS as JSON)
 struct LEDSettings {
   // Hardware settings
   int led_count = 60;     // Number of LEDs in the strip (default 60)
   int led_pin = 17;       // GPIO pin for LED data (default 17)
   
+  // Output channels (channel 0 mirrors led_pin/led_count in single-strip mode)
+  int led_channel_count = 1;
+  LEDChannelSettings led_channels[MAX_LED_CHANNELS];
+  
+  // Power budget for the LEDs in mA (0 = unlimited) and the draw of one
+  // fully lit color channel, used to estimate each frame's current
+  int power_limit_ma = 0;
+  int led_channel_ma = 20;
+  
+  // Physical arrangement of the LEDs
+  LayoutSettings layout;
+  
+  // Network pixel output (0 = off, 1 = DDP, 2 = E1.31); port 0 = protocol default
+  int udp_output_protocol = 0;
+  char udp_output_host[64] = "";
+  int udp_output_port = 0;
+  int udp_output_universe = 1;
+  
+  // Realtime pixel input (DDP, E1.31, WLED realtime UDP)
+  bool realtime_enabled = false;
+  int realtime_timeout_ms = 2500;
+  int realtime_universe = 1;  // First E1.31 universe to listen for
+  
   // Custom colors (RGB values 0-255)
   struct {
     uint8_t r, g, b;
@@ -23,6 +108,19 @@ struct LEDSettings {
     {0, 255, 0}     // finished
   };
   
+  // Per-state gradient palettes (same order as colors)
+  StatePalette palettes[8];
+  
+  // User effect assigned to each state slot (index into /api/effects, -1 = built-in animation)
+  int effect_slots[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
+  
+  // Printing visualization
+  int print_mode = PRINT_MODE_PROGRESS;
+  
+  // State change transition (0 = cut, 1 = crossfade, 2 = wipe)
+  int transition_mode = 1;
+  int transition_ms = 800;
+  
   // Animation directions (1 = normal, -1 = reversed)
   int rainbow_direction = 1;
   int idle_direction = 1;
@@ -80,6 +178,7 @@ extern LEDSettings settings;
 // Settings management functions
 void saveSettings();
 void loadSettings();
+void syncLEDChannels();
 
 // Token management functions
 bool saveTokenToSPIFFS(const char* filename, const String& token);
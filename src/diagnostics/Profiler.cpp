@@ -0,0 +1,122 @@
+#include "Profiler.h"
+
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <mutex>
+#endif
+
+static TimingHistogram zone_histograms[PROFILE_ZONE_COUNT];
+static ProfileTaskStats task_stats[PROFILE_TASK_COUNT];
+static uint64_t window_start_us = 0;
+
+// Zones such as saveSettings() are hit from several tasks on both cores;
+// the lock only covers a few integer updates
+#ifdef ARDUINO
+static portMUX_TYPE profile_mux = portMUX_INITIALIZER_UNLOCKED;
+#define PROFILE_LOCK() portENTER_CRITICAL(&profile_mux)
+#define PROFILE_UNLOCK() portEXIT_CRITICAL(&profile_mux)
+#else
+static std::mutex profile_mutex;
+#define PROFILE_LOCK() profile_mutex.lock()
+#define PROFILE_UNLOCK() profile_mutex.unlock()
+#endif
+
+static const char* const zone_names[PROFILE_ZONE_COUNT] = {
+	"mqtt_callback",
+	"update_printer_state",
+	"status_evaluation",
+	"save_settings",
+	"web_handler",
+	"led_transmit",
+	"effect_rainbow",
+	"effect_auto_off",
+	"effect_download",
+	"effect_printing",
+	"effect_paused",
+	"effect_recoverable_error",
+	"effect_error",
+	"effect_heating",
+	"effect_cooling",
+	"effect_finished",
+	"effect_idle",
+	"effect_realtime",
+	"effect_user",
+	"effect_lights"
+};
+
+static const char* const task_names[PROFILE_TASK_COUNT] = {
+	"led",
+	"led_output",
+	"network",
+	"udp_input",
+	"loop"
+};
+
+void profilerBegin() {
+	profilerReset();
+}
+
+void profilerRegisterTask(ProfileTask task, void* handle) {
+	if (task < 0 || task >= PROFILE_TASK_COUNT) return;
+	task_stats[task].handle = handle;
+}
+
+void profileRecord(ProfileZone zone, uint32_t us) {
+	if (zone < 0 || zone >= PROFILE_ZONE_COUNT) return;
+	PROFILE_LOCK();
+	histogramRecord(zone_histograms[zone], us);
+	PROFILE_UNLOCK();
+}
+
+void profileTaskBusy(ProfileTask task, uint32_t us) {
+	if (task < 0 || task >= PROFILE_TASK_COUNT) return;
+	PROFILE_LOCK();
+	task_stats[task].busy_us += us;
+	task_stats[task].iterations++;
+	PROFILE_UNLOCK();
+}
+
+void profilerReset() {
+	PROFILE_LOCK();
+	for (int i = 0; i < PROFILE_ZONE_COUNT; i++) histogramReset(zone_histograms[i]);
+	for (int i = 0; i < PROFILE_TASK_COUNT; i++) {
+		task_stats[i].busy_us = 0;
+		task_stats[i].iterations = 0;
+	}
+	window_start_us = profilerMicros();
+	PROFILE_UNLOCK();
+}
+
+const char* profileZoneName(ProfileZone zone) {
+	return (zone >= 0 && zone < PROFILE_ZONE_COUNT) ? zone_names[zone] : "?";
+}
+
+const char* profileTaskName(ProfileTask task) {
+	return (task >= 0 && task < PROFILE_TASK_COUNT) ? task_names[task] : "?";
+}
+
+const TimingHistogram& profileZoneHistogram(ProfileZone zone) {
+	return zone_histograms[zone];
+}
+
+const ProfileTaskStats& profileTaskStats(ProfileTask task) {
+	return task_stats[task];
+}
+
+// Smallest amount of stack the task has had free, in bytes (0 = unknown)
+uint32_t profileTaskStackFree(ProfileTask task) {
+#ifdef ARDUINO
+	if (task < 0 || task >= PROFILE_TASK_COUNT || task_stats[task].handle == nullptr) return 0;
+	return uxTaskGetStackHighWaterMark((TaskHandle_t)task_stats[task].handle);
+#else
+	(void)task;
+	return 0;
+#endif
+}
+
+// Time covered by the busy counters, for turning them into CPU usage
+uint64_t profilerWindowUs() {
+	return profilerMicros() - window_start_us;
+}
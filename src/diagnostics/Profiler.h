@@ -0,0 +1,112 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include "TimingHistogram.h"
+
+// Built-in profiler: named zones record their duration into fixed-size
+// histograms, and each task's loop records how long it was busy, giving
+// per-task CPU usage without FreeRTOS run-time stats. All storage is
+// static; nothing grows at run time. Set MAVENLED_PROFILING to 0 to
+// compile the instrumentation out.
+#ifndef MAVENLED_PROFILING
+#define MAVENLED_PROFILING 1
+#endif
+
+enum ProfileZone {
+  PROFILE_MQTT_CALLBACK,
+  PROFILE_UPDATE_PRINTER_STATE,
+  PROFILE_STATUS_EVALUATION,  // Status state machine, state mutex held
+  PROFILE_SAVE_SETTINGS,
+  PROFILE_WEB_HANDLER,
+  PROFILE_LED_TRANSMIT,       // Driver transmit of one frame (strip.show)
+  PROFILE_EFFECT_RAINBOW,
+  PROFILE_EFFECT_AUTO_OFF,
+  PROFILE_EFFECT_DOWNLOAD,
+  PROFILE_EFFECT_PRINTING,
+  PROFILE_EFFECT_PAUSED,
+  PROFILE_EFFECT_RECOVERABLE_ERROR,
+  PROFILE_EFFECT_ERROR,
+  PROFILE_EFFECT_HEATING,
+  PROFILE_EFFECT_COOLING,
+  PROFILE_EFFECT_FINISHED,
+  PROFILE_EFFECT_IDLE,
+  PROFILE_EFFECT_REALTIME,
+  PROFILE_EFFECT_USER,        // Compiled user effect assigned to a state
+  PROFILE_EFFECT_LIGHTS,      // Lights on/off animation
+  PROFILE_ZONE_COUNT
+};
+
+enum ProfileTask {
+  PROFILE_TASK_LED,
+  PROFILE_TASK_LED_OUTPUT,
+  PROFILE_TASK_NETWORK,
+  PROFILE_TASK_UDP_INPUT,
+  PROFILE_TASK_LOOP,
+  PROFILE_TASK_COUNT
+};
+
+// 64-bit time source: esp_timer on the device, std::chrono on a host build
+#ifdef ARDUINO
+#include <esp_timer.h>
+inline uint64_t profilerMicros() { return esp_timer_get_time(); }
+#else
+#include <chrono>
+inline uint64_t profilerMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+struct ProfileTaskStats {
+  void* handle = nullptr;      // TaskHandle_t, for the stack high-water mark
+  uint64_t busy_us = 0;
+  uint32_t iterations = 0;
+};
+
+// Profiler functions
+void profilerBegin();
+void profilerRegisterTask(ProfileTask task, void* handle);
+void profileRecord(ProfileZone zone, uint32_t us);
+void profileTaskBusy(ProfileTask task, uint32_t us);
+void profilerReset();
+const char* profileZoneName(ProfileZone zone);
+const char* profileTaskName(ProfileTask task);
+const TimingHistogram& profileZoneHistogram(ProfileZone zone);
+const ProfileTaskStats& profileTaskStats(ProfileTask task);
+uint32_t profileTaskStackFree(ProfileTask task);
+uint64_t profilerWindowUs();
+
+// Times the enclosing scope into a zone or a task's busy time
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfileZone zone) : zone(zone), start(profilerMicros()) {}
+  ~ProfileScope() { profileRecord(zone, (uint32_t)(profilerMicros() - start)); }
+
+private:
+  ProfileZone zone;
+  uint64_t start;
+};
+
+class ProfileTaskScope {
+public:
+  explicit ProfileTaskScope(ProfileTask task) : task(task), start(profilerMicros()) {}
+  ~ProfileTaskScope() { profileTaskBusy(task, (uint32_t)(profilerMicros() - start)); }
+
+private:
+  ProfileTask task;
+  uint64_t start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if MAVENLED_PROFILING
+#define PROFILE_SCOPE(zone) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(zone)
+#define PROFILE_TASK(task) ProfileTaskScope PROFILE_CONCAT(profile_task_, __LINE__)(task)
+#else
+#define PROFILE_SCOPE(zone) do {} while (0)
+#define PROFILE_TASK(task) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,63 @@
+#include "TimingHistogram.h"
+#include <string.h>
+
+static int bucketIndex(uint32_t us) {
+	if (us < TIMING_HISTOGRAM_SUB_BUCKETS) return us;
+
+	int octave = 31 - __builtin_clz(us);
+	if (octave > TIMING_HISTOGRAM_MAX_OCTAVE) return TIMING_HISTOGRAM_BUCKETS - 1;
+
+	// The three bits below the leading one pick the sub-bucket
+	int sub = (us >> (octave - 3)) & (TIMING_HISTOGRAM_SUB_BUCKETS - 1);
+	return (octave - 2) * TIMING_HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+// Smallest value that lands in the bucket
+uint32_t histogramBucketLow(int index) {
+	if (index < TIMING_HISTOGRAM_SUB_BUCKETS) return index;
+
+	int octave = index / TIMING_HISTOGRAM_SUB_BUCKETS + 2;
+	int sub = index % TIMING_HISTOGRAM_SUB_BUCKETS;
+	return (uint32_t)(TIMING_HISTOGRAM_SUB_BUCKETS + sub) << (octave - 3);
+}
+
+void histogramReset(TimingHistogram& histogram) {
+	memset(histogram.buckets, 0, sizeof(histogram.buckets));
+	histogram.count = 0;
+	histogram.min_us = 0;
+	histogram.max_us = 0;
+	histogram.total_us = 0;
+}
+
+void histogramRecord(TimingHistogram& histogram, uint32_t us) {
+	histogram.buckets[bucketIndex(us)]++;
+	if (histogram.count == 0 || us < histogram.min_us) histogram.min_us = us;
+	if (us > histogram.max_us) histogram.max_us = us;
+	histogram.total_us += us;
+	histogram.count++;
+}
+
+uint32_t histogramMean(const TimingHistogram& histogram) {
+	if (histogram.count == 0) return 0;
+	return histogram.total_us / histogram.count;
+}
+
+// Upper edge of the bucket holding the percentile, capped at the largest
+// value seen so a narrow distribution does not report a wide bucket
+uint32_t histogramPercentile(const TimingHistogram& histogram, int percent) {
+	if (histogram.count == 0) return 0;
+
+	uint64_t rank = ((uint64_t)histogram.count * percent + 99) / 100;
+	if (rank == 0) rank = 1;
+
+	uint64_t seen = 0;
+	for (int i = 0; i < TIMING_HISTOGRAM_BUCKETS; i++) {
+		seen += histogram.buckets[i];
+		if (seen >= rank) {
+			if (i == TIMING_HISTOGRAM_BUCKETS - 1) return histogram.max_us;
+			uint32_t high = histogramBucketLow(i + 1) - 1;
+			return (high < histogram.max_us) ? high : histogram.max_us;
+		}
+	}
+	return histogram.max_us;
+}
@@ -0,0 +1,31 @@
+#ifndef TIMING_HISTOGRAM_H
+#define TIMING_HISTOGRAM_H
+
+#include <stdint.h>
+
+// Fixed-size latency histogram in microseconds. Buckets are log-linear:
+// exact below 8 us, then 8 buckets per power of two (12.5% resolution) up
+// to about one second; larger values land in the last bucket. Recording is
+// a few integer operations and never allocates. Counters are only written
+// by one task; readers may see a sample half-recorded, which is harmless
+// for diagnostics.
+#define TIMING_HISTOGRAM_SUB_BUCKETS 8
+#define TIMING_HISTOGRAM_MAX_OCTAVE 20
+#define TIMING_HISTOGRAM_BUCKETS ((TIMING_HISTOGRAM_MAX_OCTAVE - 1) * TIMING_HISTOGRAM_SUB_BUCKETS)
+
+struct TimingHistogram {
+  uint32_t buckets[TIMING_HISTOGRAM_BUCKETS] = {0};
+  uint32_t count = 0;
+  uint32_t min_us = 0;
+  uint32_t max_us = 0;
+  uint64_t total_us = 0;
+};
+
+// Histogram functions
+void histogramReset(TimingHistogram& histogram);
+void histogramRecord(TimingHistogram& histogram, uint32_t us);
+uint32_t histogramMean(const TimingHistogram& histogram);
+uint32_t histogramPercentile(const TimingHistogram& histogram, int percent);
+uint32_t histogramBucketLow(int index);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef ANIMATION_PHASE_H
+#define ANIMATION_PHASE_H
+
+#include <Arduino.h>
+#include "LEDAnimations.h"
+
+// Time-based animation phase. One full cycle is 2^32, so wraparound is
+// exact and the phase never loses precision however long it runs. The
+// phase advances by elapsed time, not by call count, so motion speed does
+// not depend on frame rate or dropped frames.
+struct AnimationPhase {
+  uint32_t phase = 0;
+  unsigned long last_ms = 0;
+  bool running = false;
+  uint32_t epoch = 0;  // animation_epoch the phase was started in
+};
+
+// Phase increment per millisecond for a speed in cycles or radians per second
+#define PHASE_RATE(cyclesPerSecond) ((uint32_t)((cyclesPerSecond) * 4294967296.0 / 1000.0))
+#define PHASE_RATE_RAD(radiansPerSecond) PHASE_RATE((radiansPerSecond) / 6.283185307179586)
+
+// Stalls longer than this are treated as a pause (e.g. lights off), not as
+// dropped frames, so the animation resumes where it stopped
+#define PHASE_MAX_STEP_MS 1000
+
+// Advance by the time since the last call; direction < 0 runs backwards
+inline uint32_t advancePhase(AnimationPhase& p, uint32_t ratePerMs, int direction = 1) {
+  unsigned long now = animationMillis();
+  if (p.epoch != animation_epoch) {
+    p.phase = 0;
+    p.running = false;
+    p.epoch = animation_epoch;
+  }
+  if (p.running) {
+    unsigned long elapsed = now - p.last_ms;
+    if (elapsed > PHASE_MAX_STEP_MS) elapsed = 0;
+    uint32_t step = (uint32_t)elapsed * ratePerMs;
+    p.phase += (direction < 0) ? -step : step;
+  }
+  p.last_ms = now;
+  p.running = true;
+  return p.phase;
+}
+
+inline float phaseRadians(uint32_t phase) {
+  return phase * (6.283185307179586f / 4294967296.0f);
+}
+
+#endif
@@ -0,0 +1,164 @@
+#include "ColorPalette.h"
+
+// Baked tables and the settings each was baked from
+struct PaletteCache {
+	bool valid = false;
+	uint8_t brightness = 0;
+	uint8_t color[3] = {0, 0, 0};
+	StatePalette source;
+	uint8_t lut[PALETTE_SIZE * 3];
+};
+
+static PaletteCache palette_cache[8];
+
+// Color conversion functions
+static float srgbToLinear(uint8_t value) {
+	float c = value / 255.0f;
+	return (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static uint8_t linearToSRGB(float c) {
+	if (c <= 0) return 0;
+	if (c >= 1) return 255;
+	c = (c <= 0.0031308f) ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+	return (uint8_t)(c * 255.0f + 0.5f);
+}
+
+struct OKLab {
+	float L, a, b;
+};
+
+static OKLab rgbToOKLab(uint8_t r, uint8_t g, uint8_t b) {
+	float lr = srgbToLinear(r);
+	float lg = srgbToLinear(g);
+	float lb = srgbToLinear(b);
+
+	float l = cbrtf(0.4122214708f * lr + 0.5363325363f * lg + 0.0514459929f * lb);
+	float m = cbrtf(0.2119034982f * lr + 0.6806995451f * lg + 0.1073969566f * lb);
+	float s = cbrtf(0.0883024619f * lr + 0.2817188376f * lg + 0.6299787005f * lb);
+
+	OKLab lab;
+	lab.L = 0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s;
+	lab.a = 1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s;
+	lab.b = 0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s;
+	return lab;
+}
+
+static void oklabToRGB(const OKLab& lab, uint8_t* rgb) {
+	float l = lab.L + 0.3963377774f * lab.a + 0.2158037573f * lab.b;
+	float m = lab.L - 0.1055613458f * lab.a - 0.0638541728f * lab.b;
+	float s = lab.L - 0.0894841775f * lab.a - 1.2914855480f * lab.b;
+	l = l * l * l;
+	m = m * m * m;
+	s = s * s * s;
+
+	rgb[0] = linearToSRGB(4.0767416621f * l - 3.3077115913f * m + 0.2309699292f * s);
+	rgb[1] = linearToSRGB(-1.2684380046f * l + 2.6097574011f * m - 0.3413193965f * s);
+	rgb[2] = linearToSRGB(-0.0041960863f * l - 0.7034186147f * m + 1.7076147010f * s);
+}
+
+// Interpolate stops (sorted by position) into a 256-entry packed RGB table
+void bakePalette(const PaletteStop* stops, int stopCount, uint8_t brightness, uint8_t* lut) {
+	if (stopCount <= 0) {
+		memset(lut, 0, PALETTE_SIZE * 3);
+		return;
+	}
+
+	OKLab labs[MAX_PALETTE_STOPS];
+	for (int s = 0; s < stopCount; s++) {
+		labs[s] = rgbToOKLab(stops[s].r, stops[s].g, stops[s].b);
+	}
+
+	int segment = 0;
+	for (int k = 0; k < PALETTE_SIZE; k++) {
+		while (segment < stopCount - 1 && k > stops[segment + 1].pos) segment++;
+
+		uint8_t* entry = lut + k * 3;
+		const PaletteStop& from = stops[segment];
+		if (k <= from.pos || segment == stopCount - 1) {
+			entry[0] = from.r;
+			entry[1] = from.g;
+			entry[2] = from.b;
+		} else {
+			const PaletteStop& to = stops[segment + 1];
+			float t = (float)(k - from.pos) / (to.pos - from.pos);
+			OKLab lab;
+			lab.L = labs[segment].L + (labs[segment + 1].L - labs[segment].L) * t;
+			lab.a = labs[segment].a + (labs[segment + 1].a - labs[segment].a) * t;
+			lab.b = labs[segment].b + (labs[segment + 1].b - labs[segment].b) * t;
+			oklabToRGB(lab, entry);
+		}
+
+		if (brightness != 255) {
+			entry[0] = entry[0] * brightness / 255;
+			entry[1] = entry[1] * brightness / 255;
+			entry[2] = entry[2] * brightness / 255;
+		}
+	}
+}
+
+// Stops for a state without a custom palette. Heating and cooling keep the
+// green shift along the strip they have always had; other states are flat.
+static int defaultStops(int stateIndex, PaletteStop* stops) {
+	auto& color = settings.colors[stateIndex];
+	stops[0] = {0, color.r, color.g, color.b};
+	stops[1] = {255, color.r, color.g, color.b};
+
+	if (stateIndex == 5) stops[1].g = color.g * 7 / 10;
+	if (stateIndex == 6) stops[0].g = color.g * 7 / 10;
+	return 2;
+}
+
+static void sortStops(PaletteStop* stops, int count) {
+	for (int i = 1; i < count; i++) {
+		PaletteStop stop = stops[i];
+		int j = i - 1;
+		while (j >= 0 && stops[j].pos > stop.pos) {
+			stops[j + 1] = stops[j];
+			j--;
+		}
+		stops[j + 1] = stop;
+	}
+}
+
+// Baked table for a state: 256 packed RGB entries with brightness applied.
+// Rebuilt lazily when the inputs changed, so callers never see a stale table.
+const uint8_t* getStatePalette(int stateIndex) {
+	stateIndex = constrain(stateIndex, 0, 7);
+	PaletteCache& cache = palette_cache[stateIndex];
+
+	uint8_t brightness = settings.night_mode_enabled ? settings.night_mode_brightness : settings.global_brightness;
+	auto& color = settings.colors[stateIndex];
+	const StatePalette& source = settings.palettes[stateIndex];
+
+	bool changed = !cache.valid || cache.brightness != brightness ||
+	  cache.color[0] != color.r || cache.color[1] != color.g || cache.color[2] != color.b ||
+	  cache.source.stop_count != source.stop_count ||
+	  memcmp(cache.source.stops, source.stops, source.stop_count * sizeof(PaletteStop)) != 0;
+
+	if (changed) {
+		PaletteStop stops[MAX_PALETTE_STOPS];
+		int stopCount = min(source.stop_count, MAX_PALETTE_STOPS);
+		if (stopCount >= 2) {
+			memcpy(stops, source.stops, stopCount * sizeof(PaletteStop));
+		} else {
+			stopCount = defaultStops(stateIndex, stops);
+		}
+		sortStops(stops, stopCount);
+		bakePalette(stops, stopCount, brightness, cache.lut);
+
+		cache.valid = true;
+		cache.brightness = brightness;
+		cache.color[0] = color.r;
+		cache.color[1] = color.g;
+		cache.color[2] = color.b;
+		cache.source = source;
+	}
+
+	return cache.lut;
+}
+
+uint32_t samplePalette(int stateIndex, uint8_t position) {
+	const uint8_t* entry = getStatePalette(stateIndex) + position * 3;
+	return ((uint32_t)entry[0] << 16) | ((uint32_t)entry[1] << 8) | entry[2];
+}
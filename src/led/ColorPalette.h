@@ -0,0 +1,19 @@
+#ifndef COLOR_PALETTE_H
+#define COLOR_PALETTE_H
+
+#include <Arduino.h>
+#include "../config/Settings.h"
+
+// Entries per baked palette
+#define PALETTE_SIZE 256
+
+// State palettes are interpolated in OKLab and baked into 256-entry packed
+// RGB tables with the current brightness applied. A table is rebuilt only
+// when its state's color, stops or the brightness change.
+
+// Palette functions
+const uint8_t* getStatePalette(int stateIndex);
+uint32_t samplePalette(int stateIndex, uint8_t position);
+void bakePalette(const PaletteStop* stops, int stopCount, uint8_t brightness, uint8_t* lut);
+
+#endif
@@ -0,0 +1,583 @@
+#include "EffectVM.h"
+#include "ColorPalette.h"
+#include "LEDAnimations.h"
+#include "LEDLayout.h"
+#include "../config/Settings.h"
+#include "../diagnostics/Profiler.h"
+#include "../printer/PrinterState.h"
+#include <cmath>
+
+// Persistence needs ArduinoJson and SPIFFS, which only the device build has
+#ifdef ARDUINO
+#include <ArduinoJson.h>
+#include <SPIFFS.h>
+#endif
+
+// Effect Global Variables
+EffectSlot effects[MAX_EFFECTS];
+unsigned long effect_last_run_us = 0;
+unsigned long effect_max_run_us = 0;
+
+struct EffectFunction {
+	const char* name;
+	uint8_t op;
+	uint8_t args;
+};
+
+static const EffectFunction effect_functions[] = {
+	{"sin", OP_SIN, 1},
+	{"cos", OP_COS, 1},
+	{"abs", OP_ABS, 1},
+	{"floor", OP_FLOOR, 1},
+	{"fract", OP_FRACT, 1},
+	{"min", OP_MIN, 2},
+	{"max", OP_MAX, 2},
+	{"clamp", OP_CLAMP, 1},
+	{"mix", OP_MIX, 3},
+	{"wave", OP_WAVE, 1},
+	{"noise", OP_NOISE, 1},
+	{"rgb", OP_RGB, 3},
+	{"hsv", OP_HSV, 3},
+	{"palette", OP_PALETTE, 1}
+};
+
+static const char* const effect_variables[EFFECT_VAR_COUNT] = {
+	"i", "n", "x", "t", "p", "nozzle", "bed", "u", "v", "angle", "radius"
+};
+
+// Limits parser recursion so a run of parentheses cannot exhaust the web server stack
+#define MAX_EFFECT_NESTING 16
+
+// Compiler functions
+struct EffectCompiler {
+	const char* source;
+	int pos;
+	int depth;
+	int nesting;
+	EffectProgram* program;
+	EffectError* error;
+};
+
+static bool compileFail(EffectCompiler& c, const char* message) {
+	if (c.error->message == nullptr) {
+		c.error->message = message;
+		c.error->position = c.pos;
+	}
+	return false;
+}
+
+static void skipSpace(EffectCompiler& c) {
+	while (isspace((unsigned char)c.source[c.pos])) c.pos++;
+}
+
+static bool emit(EffectCompiler& c, uint8_t op, uint8_t arg, int stackEffect) {
+	EffectProgram& program = *c.program;
+	if (program.code_length >= MAX_EFFECT_CODE) return compileFail(c, "Program too long");
+
+	program.code[program.code_length].op = op;
+	program.code[program.code_length].arg = arg;
+	program.code_length++;
+
+	c.depth += stackEffect;
+	if (c.depth > EFFECT_STACK_DEPTH) return compileFail(c, "Expression too deep");
+	if (c.depth > program.stack_depth) program.stack_depth = c.depth;
+	return true;
+}
+
+static bool emitConst(EffectCompiler& c, float value) {
+	EffectProgram& program = *c.program;
+	int index = -1;
+	for (int k = 0; k < program.constant_count; k++) {
+		if (program.constants[k] == value) {
+			index = k;
+			break;
+		}
+	}
+	if (index < 0) {
+		if (program.constant_count >= MAX_EFFECT_CONSTANTS) return compileFail(c, "Too many constants");
+		index = program.constant_count++;
+		program.constants[index] = value;
+	}
+	return emit(c, OP_CONST, index, 1);
+}
+
+// Index of the constant pushed by the instruction at pc, or -1
+static int constAt(EffectCompiler& c, int pc) {
+	if (pc < 0) return -1;
+	const EffectInstr& instr = c.program->code[pc];
+	return (instr.op == OP_CONST) ? instr.arg : -1;
+}
+
+// Emit a binary operator, folding it when both operands are constants
+static bool emitBinary(EffectCompiler& c, uint8_t op) {
+	EffectProgram& program = *c.program;
+	int lhs = constAt(c, program.code_length - 2);
+	int rhs = constAt(c, program.code_length - 1);
+
+	if (lhs >= 0 && rhs >= 0) {
+		float a = program.constants[lhs];
+		float b = program.constants[rhs];
+		float result;
+		switch (op) {
+			case OP_ADD: result = a + b; break;
+			case OP_SUB: result = a - b; break;
+			case OP_MUL: result = a * b; break;
+			case OP_DIV: result = (b != 0) ? a / b : 0; break;
+			case OP_MOD: result = (b != 0) ? fmodf(a, b) : 0; break;
+			case OP_LT: result = (a < b) ? 1 : 0; break;
+			default: result = (a > b) ? 1 : 0; break;
+		}
+		program.code_length -= 2;
+		c.depth -= 2;
+		return emitConst(c, result);
+	}
+	return emit(c, op, 0, -1);
+}
+
+static const EffectFunction* findFunction(const char* name, int length) {
+	for (const EffectFunction& fn : effect_functions) {
+		if ((int)strlen(fn.name) == length && strncmp(fn.name, name, length) == 0) return &fn;
+	}
+	return nullptr;
+}
+
+static int findVariable(const char* name, int length) {
+	for (int v = 0; v < EFFECT_VAR_COUNT; v++) {
+		if ((int)strlen(effect_variables[v]) == length && strncmp(effect_variables[v], name, length) == 0) return v;
+	}
+	return -1;
+}
+
+static bool parseExpression(EffectCompiler& c);
+
+static bool parsePrimary(EffectCompiler& c) {
+	skipSpace(c);
+	char ch = c.source[c.pos];
+
+	if (isdigit((unsigned char)ch) || ch == '.') {
+		char* end;
+		float value = strtof(c.source + c.pos, &end);
+		if (end == c.source + c.pos) return compileFail(c, "Invalid number");
+		c.pos = end - c.source;
+		return emitConst(c, value);
+	}
+
+	if (isalpha((unsigned char)ch) || ch == '_') {
+		int start = c.pos;
+		while (isalnum((unsigned char)c.source[c.pos]) || c.source[c.pos] == '_') c.pos++;
+		int length = c.pos - start;
+		skipSpace(c);
+
+		if (c.source[c.pos] == '(') {
+			const EffectFunction* fn = findFunction(c.source + start, length);
+			if (fn == nullptr) {
+				c.pos = start;
+				return compileFail(c, "Unknown function");
+			}
+			c.pos++;
+
+			int args = 0;
+			skipSpace(c);
+			if (c.source[c.pos] != ')') {
+				while (true) {
+					if (!parseExpression(c)) return false;
+					args++;
+					skipSpace(c);
+					if (c.source[c.pos] != ',') break;
+					c.pos++;
+				}
+			}
+			if (c.source[c.pos] != ')') return compileFail(c, "Expected ')'");
+			if (args != fn->args) return compileFail(c, "Wrong number of arguments");
+			c.pos++;
+			return emit(c, fn->op, 0, 1 - args);
+		}
+
+		int var = findVariable(c.source + start, length);
+		if (var < 0) {
+			c.pos = start;
+			return compileFail(c, "Unknown variable");
+		}
+		return emit(c, OP_VAR, var, 1);
+	}
+
+	if (ch == '(') {
+		c.pos++;
+		if (!parseExpression(c)) return false;
+		skipSpace(c);
+		if (c.source[c.pos] != ')') return compileFail(c, "Expected ')'");
+		c.pos++;
+		return true;
+	}
+
+	return compileFail(c, ch == '\0' ? "Unexpected end of expression" : "Unexpected character");
+}
+
+static bool parseUnary(EffectCompiler& c) {
+	skipSpace(c);
+	if (c.source[c.pos] == '+') {
+		c.pos++;
+		return parseUnary(c);
+	}
+	if (c.source[c.pos] == '-') {
+		c.pos++;
+		if (!parseUnary(c)) return false;
+
+		EffectProgram& program = *c.program;
+		int operand = constAt(c, program.code_length - 1);
+		if (operand >= 0) {
+			float value = -program.constants[operand];
+			program.code_length--;
+			c.depth--;
+			return emitConst(c, value);
+		}
+		return emit(c, OP_NEG, 0, 0);
+	}
+	return parsePrimary(c);
+}
+
+static bool parseTerm(EffectCompiler& c) {
+	if (!parseUnary(c)) return false;
+	while (true) {
+		skipSpace(c);
+		char ch = c.source[c.pos];
+		uint8_t op;
+		if (ch == '*') op = OP_MUL;
+		else if (ch == '/') op = OP_DIV;
+		else if (ch == '%') op = OP_MOD;
+		else return true;
+		c.pos++;
+		if (!parseUnary(c) || !emitBinary(c, op)) return false;
+	}
+}
+
+static bool parseSum(EffectCompiler& c) {
+	if (!parseTerm(c)) return false;
+	while (true) {
+		skipSpace(c);
+		char ch = c.source[c.pos];
+		uint8_t op;
+		if (ch == '+') op = OP_ADD;
+		else if (ch == '-') op = OP_SUB;
+		else return true;
+		c.pos++;
+		if (!parseTerm(c) || !emitBinary(c, op)) return false;
+	}
+}
+
+static bool parseExpression(EffectCompiler& c) {
+	if (++c.nesting > MAX_EFFECT_NESTING) return compileFail(c, "Expression too deep");
+
+	if (!parseSum(c)) return false;
+	while (true) {
+		skipSpace(c);
+		char ch = c.source[c.pos];
+		uint8_t op;
+		if (ch == '<') op = OP_LT;
+		else if (ch == '>') op = OP_GT;
+		else break;
+		c.pos++;
+		if (!parseSum(c) || !emitBinary(c, op)) return false;
+	}
+
+	c.nesting--;
+	return true;
+}
+
+// Compile an expression into bytecode. On failure error holds the message
+// and the character position it refers to.
+bool compileEffect(const char* source, EffectProgram& program, EffectError& error) {
+	program = EffectProgram();
+	error = EffectError();
+
+	EffectCompiler c = {source, 0, 0, 0, &program, &error};
+
+	if (strlen(source) >= MAX_EFFECT_SOURCE) return compileFail(c, "Program too long");
+	if (!parseExpression(c)) return false;
+
+	skipSpace(c);
+	if (source[c.pos] != '\0') return compileFail(c, "Unexpected character");
+	return true;
+}
+
+// Interpreter functions
+
+// Expressions can overflow to inf or NaN (1e30 * 1e30, inf - inf); those
+// count as 0 here, since converting them to an integer is undefined
+static inline float clamp01(float value) {
+	if (!std::isfinite(value)) return 0;
+	return value < 0 ? 0 : (value > 1 ? 1 : value);
+}
+
+static inline float hashNoise(int32_t n) {
+	uint32_t h = (uint32_t)n * 0x9E3779B1u;
+	h ^= h >> 15;
+	h *= 0x85EBCA77u;
+	h ^= h >> 13;
+	return (h & 0xFFFF) / 65535.0f;
+}
+
+// Smooth 1D value noise in 0-1
+static inline float valueNoise(float x) {
+	if (!(fabsf(x) < 1e9f)) return 0;  // Past int32 cells, inf and NaN
+	float cell = floorf(x);
+	float f = x - cell;
+	f = f * f * (3 - 2 * f);
+	float a = hashNoise((int32_t)cell);
+	float b = hashNoise((int32_t)cell + 1);
+	return a + (b - a) * f;
+}
+
+static inline void hsvColor(float h, float s, float v, float scale, float& r, float& g, float& b) {
+	if (!std::isfinite(h)) h = 0;
+	h = (h - floorf(h)) * 6;
+	s = clamp01(s);
+	v = clamp01(v) * scale;
+	int sector = (int)h;
+	float f = h - sector;
+	float p = v * (1 - s);
+	float q = v * (1 - s * f);
+	float u = v * (1 - s * (1 - f));
+	switch (sector) {
+		case 0: r = v; g = u; b = p; break;
+		case 1: r = q; g = v; b = p; break;
+		case 2: r = p; g = v; b = u; break;
+		case 3: r = p; g = q; b = v; break;
+		case 4: r = u; g = p; b = v; break;
+		default: r = v; g = p; b = q; break;
+	}
+}
+
+// Evaluate the program once per pixel and write packed RGB to rgb.
+// baseColor is the state color and palette the state's baked palette (both
+// with brightness already applied); brightness scales rgb() and hsv().
+void runEffect(const EffectProgram& program, uint32_t baseColor, const uint8_t* palette, uint8_t brightness, uint8_t* rgb, int count) {
+	if (program.code_length == 0 || count <= 0) return;
+
+	float vars[EFFECT_VAR_COUNT];
+	vars[VAR_N] = count;
+	vars[VAR_T] = (animationMillis() % 3600000UL) / 1000.0f; // Wraps hourly to keep float precision
+	int progress = (printer_state.status == "downloading") ? printer_state.download_progress : printer_state.progress;
+	vars[VAR_P] = clamp01(progress / 100.0f);
+	vars[VAR_NOZZLE] = printer_state.nozzle_temp;
+	vars[VAR_BED] = printer_state.bed_temp;
+
+	const float baseR = (baseColor >> 16) & 0xFF;
+	const float baseG = (baseColor >> 8) & 0xFF;
+	const float baseB = baseColor & 0xFF;
+	const float scale = brightness;
+	const float invCount = 1.0f / count;
+
+	// Layout coordinates are precomputed, so u/v/angle/radius cost one load each
+	const LayoutCoord* coords = layoutCoords();
+	const float coordScale = 1.0f / 255;
+
+	const EffectInstr* code = program.code;
+	const EffectInstr* end = code + program.code_length;
+	const float* constants = program.constants;
+	float stack[EFFECT_STACK_DEPTH];
+
+	for (int i = 0; i < count; i++) {
+		vars[VAR_I] = i;
+		vars[VAR_X] = i * invCount;
+		if (coords != nullptr) {
+			vars[VAR_U] = coords[i].x * coordScale;
+			vars[VAR_V] = coords[i].y * coordScale;
+			vars[VAR_ANGLE] = coords[i].angle * (1.0f / 256);
+			vars[VAR_RADIUS] = coords[i].radius * coordScale;
+		} else {
+			vars[VAR_U] = vars[VAR_X];
+			vars[VAR_V] = 0;
+			vars[VAR_ANGLE] = vars[VAR_X];
+			vars[VAR_RADIUS] = 1;
+		}
+
+		float r = baseR, g = baseG, b = baseB;
+		float* sp = stack;
+
+		for (const EffectInstr* ip = code; ip < end; ip++) {
+			switch (ip->op) {
+				case OP_CONST: *sp++ = constants[ip->arg]; break;
+				case OP_VAR: *sp++ = vars[ip->arg]; break;
+				case OP_ADD: sp--; sp[-1] += sp[0]; break;
+				case OP_SUB: sp--; sp[-1] -= sp[0]; break;
+				case OP_MUL: sp--; sp[-1] *= sp[0]; break;
+				case OP_DIV: sp--; sp[-1] = (sp[0] != 0) ? sp[-1] / sp[0] : 0; break;
+				case OP_MOD: sp--; sp[-1] = (sp[0] != 0) ? fmodf(sp[-1], sp[0]) : 0; break;
+				case OP_NEG: sp[-1] = -sp[-1]; break;
+				case OP_LT: sp--; sp[-1] = (sp[-1] < sp[0]) ? 1 : 0; break;
+				case OP_GT: sp--; sp[-1] = (sp[-1] > sp[0]) ? 1 : 0; break;
+				case OP_SIN: sp[-1] = sinf(sp[-1]); break;
+				case OP_COS: sp[-1] = cosf(sp[-1]); break;
+				case OP_ABS: sp[-1] = fabsf(sp[-1]); break;
+				case OP_FLOOR: sp[-1] = floorf(sp[-1]); break;
+				case OP_FRACT: sp[-1] -= floorf(sp[-1]); break;
+				case OP_MIN: sp--; sp[-1] = fminf(sp[-1], sp[0]); break;
+				case OP_MAX: sp--; sp[-1] = fmaxf(sp[-1], sp[0]); break;
+				case OP_CLAMP: sp[-1] = clamp01(sp[-1]); break;
+				case OP_MIX: sp -= 2; sp[-1] += (sp[0] - sp[-1]) * sp[1]; break;
+				case OP_WAVE: {
+					float f = sp[-1] - floorf(sp[-1]);
+					sp[-1] = 1 - fabsf(2 * f - 1);
+					break;
+				}
+				case OP_NOISE: sp[-1] = valueNoise(sp[-1]); break;
+				case OP_RGB:
+					sp -= 2;
+					r = clamp01(sp[-1]) * scale;
+					g = clamp01(sp[0]) * scale;
+					b = clamp01(sp[1]) * scale;
+					sp[-1] = 1;
+					break;
+				case OP_HSV:
+					sp -= 2;
+					hsvColor(sp[-1], sp[0], sp[1], scale, r, g, b);
+					sp[-1] = 1;
+					break;
+				case OP_PALETTE: {
+					const uint8_t* entry = palette + (int)(clamp01(sp[-1]) * (PALETTE_SIZE - 1)) * 3;
+					r = entry[0];
+					g = entry[1];
+					b = entry[2];
+					sp[-1] = 1;
+					break;
+				}
+			}
+		}
+
+		float intensity = clamp01(stack[0]);
+		rgb[i * 3] = r * intensity;
+		rgb[i * 3 + 1] = g * intensity;
+		rgb[i * 3 + 2] = b * intensity;
+	}
+}
+
+// Render the effect assigned to a state slot into the canvas.
+// Returns false if the slot uses the built-in animation.
+bool renderAssignedEffect(int stateIndex) {
+	if (stateIndex < 0 || stateIndex >= 8) return false;
+
+	int id = settings.effect_slots[stateIndex];
+	if (id < 0 || id >= MAX_EFFECTS || !effects[id].used) return false;
+
+	uint8_t* out = strip.getPixels();
+	if (out == nullptr) return false;
+
+	uint8_t brightness = settings.night_mode_enabled ? settings.night_mode_brightness : settings.global_brightness;
+	int count = min(settings.led_count, (int)strip.numPixels());
+
+	PROFILE_SCOPE(PROFILE_EFFECT_USER);
+	unsigned long start = micros();
+	runEffect(effects[id].program, getStateColor(stateIndex), getStatePalette(stateIndex), brightness, out, count);
+	effect_last_run_us = micros() - start;
+	if (effect_last_run_us > effect_max_run_us) effect_max_run_us = effect_last_run_us;
+	return true;
+}
+
+// Effect management functions
+
+// Compile and store an effect. id < 0 picks a free slot. Returns the slot
+// id, or -1 with error set. The LED task may be running the old program,
+// so the swap happens under the printer state mutex it renders under.
+int installEffect(int id, const char* name, const char* source, EffectError& error) {
+	EffectProgram program;
+	if (!compileEffect(source, program, error)) return -1;
+
+	if (id < 0) {
+		for (int k = 0; k < MAX_EFFECTS; k++) {
+			if (!effects[k].used) {
+				id = k;
+				break;
+			}
+		}
+	}
+	if (id < 0 || id >= MAX_EFFECTS) {
+		error.message = "No free effect slots";
+		error.position = 0;
+		return -1;
+	}
+
+	xSemaphoreTake(printerStateMutex, portMAX_DELAY);
+	EffectSlot& slot = effects[id];
+	slot.used = true;
+	strlcpy(slot.name, name, sizeof(slot.name));
+	strlcpy(slot.source, source, sizeof(slot.source));
+	slot.program = program;
+	xSemaphoreGive(printerStateMutex);
+
+	Serial.printf(" Effect %d '%s' compiled: %d ops, %d constants, stack %d\n",
+	  id, slot.name, program.code_length, program.constant_count, program.stack_depth);
+	return id;
+}
+
+// Delete an effect and unassign it from every state slot
+bool removeEffect(int id) {
+	if (id < 0 || id >= MAX_EFFECTS || !effects[id].used) return false;
+
+	xSemaphoreTake(printerStateMutex, portMAX_DELAY);
+	effects[id].used = false;
+	for (int i = 0; i < 8; i++) {
+		if (settings.effect_slots[i] == id) settings.effect_slots[i] = -1;
+	}
+	xSemaphoreGive(printerStateMutex);
+	return true;
+}
+
+#ifdef ARDUINO
+void saveEffects() {
+	DynamicJsonDocument doc(4096);
+	JsonArray list = doc.createNestedArray("effects");
+	for (int id = 0; id < MAX_EFFECTS; id++) {
+		if (!effects[id].used) continue;
+		JsonObject effect = list.createNestedObject();
+		effect["id"] = id;
+		effect["name"] = effects[id].name;
+		effect["source"] = effects[id].source;
+	}
+
+	File file = SPIFFS.open("/effects.json", "w");
+	if (!file) {
+		Serial.println(" Failed to open effects file for writing");
+		return;
+	}
+
+	serializeJson(doc, file);
+	file.close();
+	Serial.println(" Effects saved to SPIFFS");
+}
+
+void loadEffects() {
+	if (!SPIFFS.exists("/effects.json")) return;
+
+	File file = SPIFFS.open("/effects.json", "r");
+	if (!file) {
+		Serial.println(" Failed to open effects file");
+		return;
+	}
+
+	DynamicJsonDocument doc(4096);
+	DeserializationError jsonError = deserializeJson(doc, file);
+	file.close();
+
+	if (jsonError) {
+		Serial.printf(" Failed to parse effects: %s\n", jsonError.c_str());
+		return;
+	}
+
+	for (JsonObject effect : doc["effects"].as<JsonArray>()) {
+		int id = effect["id"] | -1;
+		if (id < 0 || id >= MAX_EFFECTS) continue;
+
+		EffectError error;
+		if (installEffect(id, effect["name"] | "", effect["source"] | "", error) < 0) {
+			Serial.printf(" Effect %d failed to compile: %s at %d\n", id, error.message, error.position);
+		}
+	}
+
+	// Drop assignments to effects that did not load
+	for (int i = 0; i < 8; i++) {
+		int id = settings.effect_slots[i];
+		if (id >= 0 && (id >= MAX_EFFECTS || !effects[id].used)) settings.effect_slots[i] = -1;
+	}
+}
+#endif
@@ -0,0 +1,109 @@
+#ifndef EFFECT_VM_H
+#define EFFECT_VM_H
+
+#include <Arduino.h>
+
+// User effect limits
+#define MAX_EFFECTS 8
+#define MAX_EFFECT_NAME 24
+#define MAX_EFFECT_SOURCE 256
+#define MAX_EFFECT_CODE 96
+#define MAX_EFFECT_CONSTANTS 24
+#define EFFECT_STACK_DEPTH 16
+
+// Effect programs are single expressions evaluated once per pixel, e.g.
+//   wave(x * 3 - t * 0.5) * (0.3 + 0.7 * p)
+//   hsv(x + t * 0.1, 1, 1) * (x < p)
+// Variables: i (pixel index), n (pixel count), x (i / n), t (seconds),
+//            p (print or download progress, 0-1), nozzle, bed (degrees C),
+//            u, v, angle, radius (pixel position in the LED layout, 0-1)
+// Functions: sin cos abs floor fract min max clamp mix wave noise
+//            rgb(r, g, b) hsv(h, s, v) palette(x)
+// The result is the pixel intensity (0-1) applied to the state color. The
+// color functions replace the state color for that pixel and evaluate to 1;
+// palette(x) samples the state's gradient palette at x (0-1).
+
+enum EffectOp : uint8_t {
+  OP_CONST,
+  OP_VAR,
+  OP_ADD,
+  OP_SUB,
+  OP_MUL,
+  OP_DIV,
+  OP_MOD,
+  OP_NEG,
+  OP_LT,
+  OP_GT,
+  OP_SIN,
+  OP_COS,
+  OP_ABS,
+  OP_FLOOR,
+  OP_FRACT,
+  OP_MIN,
+  OP_MAX,
+  OP_CLAMP,
+  OP_MIX,
+  OP_WAVE,
+  OP_NOISE,
+  OP_RGB,
+  OP_HSV,
+  OP_PALETTE
+};
+
+enum EffectVar : uint8_t {
+  VAR_I,
+  VAR_N,
+  VAR_X,
+  VAR_T,
+  VAR_P,
+  VAR_NOZZLE,
+  VAR_BED,
+  VAR_U,
+  VAR_V,
+  VAR_ANGLE,
+  VAR_RADIUS,
+  EFFECT_VAR_COUNT
+};
+
+// One instruction: opcode plus constant or variable index
+struct EffectInstr {
+  uint8_t op;
+  uint8_t arg;
+};
+
+// Compiled program. Stack depth is checked at compile time, so the
+// interpreter runs without bounds checks.
+struct EffectProgram {
+  EffectInstr code[MAX_EFFECT_CODE];
+  float constants[MAX_EFFECT_CONSTANTS];
+  uint8_t code_length = 0;
+  uint8_t constant_count = 0;
+  uint8_t stack_depth = 0;
+};
+
+struct EffectSlot {
+  bool used = false;
+  char name[MAX_EFFECT_NAME] = "";
+  char source[MAX_EFFECT_SOURCE] = "";
+  EffectProgram program;
+};
+
+struct EffectError {
+  const char* message = nullptr;
+  int position = 0;
+};
+
+extern EffectSlot effects[MAX_EFFECTS];
+extern unsigned long effect_last_run_us;
+extern unsigned long effect_max_run_us;
+
+// Effect functions
+bool compileEffect(const char* source, EffectProgram& program, EffectError& error);
+void runEffect(const EffectProgram& program, uint32_t baseColor, const uint8_t* palette, uint8_t brightness, uint8_t* rgb, int count);
+int installEffect(int id, const char* name, const char* source, EffectError& error);
+bool removeEffect(int id);
+bool renderAssignedEffect(int stateIndex);
+void saveEffects();
+void loadEffects();
+
+#endif
@@ -0,0 +1,227 @@
+#include "FrameRecorder.h"
+#include "../printer/PrinterState.h"
+
+#define RECORD_HEADER_BYTES 10
+
+FrameRecorderStats frame_recorder_stats;
+
+// Ring of variable-length records. Records may wrap around the end.
+static uint8_t* ring = nullptr;
+static size_t ring_capacity = 0;
+static size_t ring_head = 0;  // Next write position
+static size_t ring_tail = 0;  // Oldest record
+static size_t ring_used = 0;
+
+// Previous frame for the delta, and scratch space for one encoded record
+static uint8_t* previous_frame = nullptr;
+static uint8_t* scratch = nullptr;
+static int frame_capacity = 0;
+static int previous_count = 0;
+static uint32_t frames_since_keyframe = 0;
+
+// Printer statuses seen so far; records store the index
+static String recorder_tags[FRAME_RECORDER_MAX_TAGS];
+static int recorder_tag_count = 0;
+static int last_tag = -1;
+
+bool frameRecorderBegin(size_t capacity) {
+	free(ring);
+	ring = (uint8_t*)malloc(capacity);
+	ring_capacity = (ring != nullptr) ? capacity : 0;
+	ring_head = ring_tail = ring_used = 0;
+	frame_recorder_stats = FrameRecorderStats();
+
+	if (ring == nullptr) {
+		Serial.println(" Failed to allocate frame recorder");
+		return false;
+	}
+	Serial.printf(" Frame recorder started (%u bytes)\n", (unsigned)capacity);
+	return true;
+}
+
+static void ringWrite(size_t pos, const uint8_t* src, size_t length) {
+	size_t first = min(length, ring_capacity - pos);
+	memcpy(ring + pos, src, first);
+	memcpy(ring, src + first, length - first);
+}
+
+static void ringRead(size_t pos, uint8_t* dst, size_t length) {
+	size_t first = min(length, ring_capacity - pos);
+	memcpy(dst, ring + pos, first);
+	memcpy(dst + first, ring, length - first);
+}
+
+static size_t recordLength(size_t pos) {
+	uint8_t header[RECORD_HEADER_BYTES];
+	ringRead(pos, header, RECORD_HEADER_BYTES);
+	return RECORD_HEADER_BYTES + (header[8] | (header[9] << 8));
+}
+
+static uint32_t recordTime(size_t pos) {
+	uint8_t header[4];
+	ringRead(pos, header, 4);
+	return header[0] | (header[1] << 8) | (header[2] << 16) | ((uint32_t)header[3] << 24);
+}
+
+static uint8_t currentTag() {
+	if (last_tag >= 0 && recorder_tags[last_tag] == printer_state.status) return last_tag;
+
+	for (int i = 0; i < recorder_tag_count; i++) {
+		if (recorder_tags[i] == printer_state.status) return last_tag = i;
+	}
+	if (recorder_tag_count < FRAME_RECORDER_MAX_TAGS) {
+		recorder_tags[recorder_tag_count] = printer_state.status;
+		return last_tag = recorder_tag_count++;
+	}
+	return 0xFF;
+}
+
+static inline uint8_t deltaAt(const uint8_t* frame, const uint8_t* previous, int k) {
+	return (previous != nullptr) ? (frame[k] ^ previous[k]) : frame[k];
+}
+
+// Worst-case encoded size. Only runs of 3 or more are encoded as runs, so
+// a run never costs more than it replaces and pays for the control byte of
+// the literal it interrupts; what is left is one control byte per 128
+// literals. (Breaking literals at runs of 2 let a solid (255, 0, 0) frame
+// grow by a third.)
+#define ENCODED_MAX_BYTES(length) ((length) + (length) / 128 + 2)
+
+// RLE-encode frame XOR previous (previous == nullptr for a keyframe)
+static size_t encodeDelta(const uint8_t* frame, const uint8_t* previous, int length, uint8_t* out) {
+	size_t o = 0;
+	int i = 0;
+
+	while (i < length) {
+		uint8_t value = deltaAt(frame, previous, i);
+		int run = 1;
+		while (i + run < length && run < 129 && deltaAt(frame, previous, i + run) == value) run++;
+
+		if (run >= 3) {
+			out[o++] = 126 + run;
+			out[o++] = value;
+			i += run;
+			continue;
+		}
+
+		// Literal bytes up to the next run of 3
+		size_t control = o++;
+		int literal = 0;
+		while (i < length && literal < 128) {
+			uint8_t next = deltaAt(frame, previous, i);
+			if (i + 2 < length && next == deltaAt(frame, previous, i + 1) && next == deltaAt(frame, previous, i + 2)) break;
+			out[o++] = next;
+			i++;
+			literal++;
+		}
+		out[control] = literal - 1;
+	}
+	return o;
+}
+
+// Record one output frame. Runs on the LED task after the frame is final.
+void recordFrame(const uint8_t* rgb, int count) {
+	if (ring == nullptr || count <= 0) return;
+
+	unsigned long start = micros();
+	int length = count * 3;
+
+	if (count > frame_capacity) {
+		free(previous_frame);
+		free(scratch);
+		previous_frame = (uint8_t*)malloc(length);
+		scratch = (uint8_t*)malloc(RECORD_HEADER_BYTES + ENCODED_MAX_BYTES(length));
+		if (previous_frame == nullptr || scratch == nullptr) {
+			free(previous_frame);
+			free(scratch);
+			previous_frame = scratch = nullptr;
+			frame_capacity = 0;
+			return;
+		}
+		frame_capacity = count;
+		previous_count = 0;
+	}
+
+	bool keyframe = (count != previous_count || frames_since_keyframe >= FRAME_RECORDER_KEYFRAME_INTERVAL);
+	size_t payload = encodeDelta(rgb, keyframe ? nullptr : previous_frame, length, scratch + RECORD_HEADER_BYTES);
+	size_t total = RECORD_HEADER_BYTES + payload;
+
+	memcpy(previous_frame, rgb, length);
+	previous_count = count;
+	frames_since_keyframe = keyframe ? 1 : frames_since_keyframe + 1;
+
+	if (total > ring_capacity || payload > 0xFFFF) {
+		frame_recorder_stats.frames_dropped++;
+		// The next frame must not be a delta against one that was never stored
+		previous_count = 0;
+		return;
+	}
+
+	uint32_t now = millis();
+	scratch[0] = now & 0xFF;
+	scratch[1] = (now >> 8) & 0xFF;
+	scratch[2] = (now >> 16) & 0xFF;
+	scratch[3] = (now >> 24) & 0xFF;
+	scratch[4] = currentTag();
+	scratch[5] = keyframe ? FRAME_RECORD_KEYFRAME : 0;
+	scratch[6] = count & 0xFF;
+	scratch[7] = (count >> 8) & 0xFF;
+	scratch[8] = payload & 0xFF;
+	scratch[9] = (payload >> 8) & 0xFF;
+
+	// Evict the oldest records to make room
+	while (ring_capacity - ring_used < total) {
+		size_t oldest = recordLength(ring_tail);
+		ring_tail = (ring_tail + oldest) % ring_capacity;
+		ring_used -= oldest;
+		frame_recorder_stats.frames_held--;
+	}
+
+	ringWrite(ring_head, scratch, total);
+	ring_head = (ring_head + total) % ring_capacity;
+	ring_used += total;
+
+	frame_recorder_stats.frames_recorded++;
+	frame_recorder_stats.frames_held++;
+	frame_recorder_stats.bytes_held = ring_used;
+	frame_recorder_stats.span_ms = now - recordTime(ring_tail);
+	frame_recorder_stats.last_record_us = micros() - start;
+	if (frame_recorder_stats.last_record_us > frame_recorder_stats.max_record_us) {
+		frame_recorder_stats.max_record_us = frame_recorder_stats.last_record_us;
+	}
+}
+
+size_t frameRecorderDumpSize() {
+	size_t size = 4 + 2 + 8 + ring_used;
+	for (int i = 0; i < recorder_tag_count; i++) {
+		size += 1 + min((int)recorder_tags[i].length(), 255);
+	}
+	return size;
+}
+
+// Serialize the ring, oldest frame first. The caller must keep the LED
+// task from recording meanwhile. Returns the bytes written, 0 if out is
+// too small.
+size_t frameRecorderDump(uint8_t* out, size_t size) {
+	if (size < frameRecorderDumpSize()) return 0;
+
+	size_t o = 0;
+	memcpy(out, "MLFR", 4);
+	o += 4;
+	out[o++] = FRAME_RECORDER_VERSION;
+	out[o++] = recorder_tag_count;
+	for (int i = 0; i < recorder_tag_count; i++) {
+		int length = min((int)recorder_tags[i].length(), 255);
+		out[o++] = length;
+		memcpy(out + o, recorder_tags[i].c_str(), length);
+		o += length;
+	}
+
+	uint32_t frames = frame_recorder_stats.frames_held;
+	uint32_t bytes = ring_used;
+	for (int shift = 0; shift < 32; shift += 8) out[o++] = (frames >> shift) & 0xFF;
+	for (int shift = 0; shift < 32; shift += 8) out[o++] = (bytes >> shift) & 0xFF;
+
+	if (ring_used > 0) ringRead(ring_tail, out + o, ring_used);
+	return o + ring_used;
+}
@@ -0,0 +1,42 @@
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include <Arduino.h>
+
+// Flight recorder: keeps the most recent output frames in a RAM ring so a
+// glitch reported after the fact can be replayed. Each frame is stored as
+// the XOR delta against the previous frame, run-length encoded, and tagged
+// with the printer status that produced it. A keyframe (delta against
+// black) is written periodically so the oldest frames can be evicted.
+#define FRAME_RECORDER_BYTES 16384
+#define FRAME_RECORDER_KEYFRAME_INTERVAL 40
+#define FRAME_RECORDER_MAX_TAGS 16
+
+// Dump format (little endian):
+//   "MLFR" u8 version, u8 tag count, tags as u8 length + chars,
+//   u32 frame count, u32 record bytes, records oldest first.
+// Record: u32 time ms, u8 tag, u8 flags, u16 pixel count, u16 payload
+// length, payload. Payload control byte c < 128 is followed by c + 1
+// literal bytes; c >= 128 repeats the next byte c - 126 times.
+#define FRAME_RECORDER_VERSION 1
+#define FRAME_RECORD_KEYFRAME 0x01
+
+struct FrameRecorderStats {
+  uint32_t frames_recorded = 0;
+  uint32_t frames_dropped = 0;     // Frames too large for the ring
+  uint32_t frames_held = 0;        // Frames currently in the ring
+  uint32_t bytes_held = 0;
+  unsigned long span_ms = 0;       // Time covered by the ring
+  unsigned long last_record_us = 0;
+  unsigned long max_record_us = 0;
+};
+
+extern FrameRecorderStats frame_recorder_stats;
+
+// Recorder functions
+bool frameRecorderBegin(size_t capacity);
+void recordFrame(const uint8_t* rgb, int count);
+size_t frameRecorderDumpSize();
+size_t frameRecorderDump(uint8_t* out, size_t size);
+
+#endif
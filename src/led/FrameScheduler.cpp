@@ -0,0 +1,53 @@
+#include "FrameScheduler.h"
+
+FrameTimingStats frame_timing;
+
+static FrameClock frame_clock;
+static unsigned long last_wake_us = 0;
+static bool first_frame = true;
+
+void frameSchedulerBegin(uint32_t periodMs) {
+	frame_clock.period = max((TickType_t)1, (TickType_t)(periodMs / portTICK_PERIOD_MS));
+	frame_clock.last_wake = xTaskGetTickCount();
+	first_frame = true;
+	Serial.printf(" Frame scheduler started: %u ms period (%u ticks)\n",
+				  (unsigned)periodMs, (unsigned)frame_clock.period);
+}
+
+// Sleep until the next frame slot and record the wake-to-wake interval
+void frameSchedulerWait() {
+	TickType_t wake = frame_clock.last_wake;
+	vTaskDelayUntil(&wake, frame_clock.period);
+	frame_clock.last_wake = wake;
+
+	unsigned long now = micros();
+	if (!first_frame) histogramRecord(frame_timing.interval, now - last_wake_us);
+	last_wake_us = now;
+	first_frame = false;
+	frame_timing.frames++;
+}
+
+// Deadline check at the end of the frame's work
+void frameSchedulerEndFrame() {
+	uint32_t missed = frameClockCheck(frame_clock, xTaskGetTickCount());
+	if (missed > 0) {
+		frame_timing.deadline_misses++;
+		frame_timing.slots_skipped += missed;
+	}
+}
+
+TickType_t frameSchedulerPeriodTicks() {
+	return frame_clock.period;
+}
+
+void frameTimingReset() {
+	frame_timing.frames = 0;
+	frame_timing.deadline_misses = 0;
+	frame_timing.slots_skipped = 0;
+	frame_timing.lock_timeouts = 0;
+	histogramReset(frame_timing.interval);
+	histogramReset(frame_timing.render);
+	histogramReset(frame_timing.lock_wait);
+	histogramReset(frame_timing.show);
+	first_frame = true;
+}
@@ -0,0 +1,53 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <Arduino.h>
+#include "../diagnostics/TimingHistogram.h"
+
+// Fixed-period LED frame scheduler. Frames start on absolute tick
+// boundaries (vTaskDelayUntil), so render time and lock waits do not
+// stretch the period. A frame whose work runs past its slot is a deadline
+// miss; the slots it overran are skipped so the schedule keeps its phase
+// instead of bursting to catch up.
+#define LED_FRAME_PERIOD_MS 10
+
+// Tick arithmetic for the schedule, kept free of RTOS calls so it can be
+// driven by a simulated tick
+struct FrameClock {
+  uint32_t period = 1;     // Ticks per frame
+  uint32_t last_wake = 0;  // Tick the current frame was scheduled for
+};
+
+// Call after a frame's work with the current tick. Returns the number of
+// whole slots the work overran (0 = deadline met) and skips them.
+inline uint32_t frameClockCheck(FrameClock& clock, uint32_t now) {
+  uint32_t elapsed = now - clock.last_wake;
+  if (elapsed < clock.period) return 0;
+
+  uint32_t missed = elapsed / clock.period;
+  clock.last_wake += missed * clock.period;
+  return missed;
+}
+
+struct FrameTimingStats {
+  uint32_t frames = 0;
+  uint32_t deadline_misses = 0;  // Frames whose work overran their slot
+  uint32_t slots_skipped = 0;    // Frame slots dropped to keep the phase
+  uint32_t lock_timeouts = 0;    // Frames skipped waiting for the state mutex
+
+  TimingHistogram interval;      // Wake to wake
+  TimingHistogram render;        // State update and render, mutex held
+  TimingHistogram lock_wait;     // Waiting for printerStateMutex
+  TimingHistogram show;          // Output task transmit
+};
+
+extern FrameTimingStats frame_timing;
+
+// Scheduler functions (LED task only, except frameTimingReset)
+void frameSchedulerBegin(uint32_t periodMs);
+void frameSchedulerWait();
+void frameSchedulerEndFrame();
+TickType_t frameSchedulerPeriodTicks();
+void frameTimingReset();
+
+#endif
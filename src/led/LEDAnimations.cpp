@@ -1,5 +1,15 @@
 #include "LEDAnimations.h"
+#include "AnimationPhase.h"
+#include "ColorPalette.h"
+#include "EffectVM.h"
+#include "LEDCompositor.h"
+#include "LEDLayout.h"
+#include "LEDOutput.h"
+#include "LEDTransition.h"
+#include "PixelKernels.h"
 #include "../config/Settings.h"
+#include "../diagnostics/Profiler.h"
+#include "../network/UDPInput.h"
 #include "../printer/PrinterState.h"
 
 // Animation timing constants
@@ -8,14 +18,30 @@ const unsigned long RAINBOW_INTERVAL = 20;
 const unsigned long LIGHTS_ANIMATION_DURATION = 1000;
 
 // LED Animation Global Variables
-Adafruit_NeoPixel strip(LED_COUNT, LED_PIN, NEO_GRB + NEO_KHZ800);
+// Render canvas - never shown directly. Stored as NEO_RGB so its raw buffer is
+// packed RGB, which presentFrame() hands to the LED output driver.
+Adafruit_NeoPixel strip(LED_COUNT, -1, NEO_RGB + NEO_KHZ800);
+
+// Animation time source. Effects read time only through animationMillis(),
+// so a replacement clock makes rendering repeatable frame for frame.
+static AnimationClock animation_clock = nullptr;
+uint32_t animation_epoch = 0;
+
+void setAnimationClock(AnimationClock clock) {
+	animation_clock = clock;
+	animation_epoch++;
+}
+
+unsigned long animationMillis() {
+	return (animation_clock != nullptr) ? animation_clock() : millis();
+}
 
 // Function to reinitialize strip with new pin
 void reinitializeStripPin(int pin) {
-  strip.updateType(NEO_GRB + NEO_KHZ800);
-  strip.setPin(pin);
-  strip.begin();
-  strip.show();
+  settings.led_pin = pin;
+  settings.led_channels[0].pin = pin;
+  syncLEDChannels();
+  ledOutputReinitialize(settings.led_channels, settings.led_channel_count, settings.led_count);
   Serial.printf(" LED strip reinitialized on GPIO %d\n", pin);
 }
 unsigned long last_update = 0;
@@ -29,7 +55,9 @@ unsigned long download_head_cycle_start = 0;
 unsigned long printing_head_cycle_start = 0;
 
 // Frame buffer for animation continuity
-uint32_t* saved_frame_buffer = nullptr;
+uint8_t* saved_frame_buffer = nullptr;       // Packed RGB, saved_frame_length pixels
+static uint8_t* lights_current_frame = nullptr;
+static int saved_frame_length = 0;
 bool has_saved_frame = false;
 String saved_animation_state = "";
 int saved_progress = 0;
@@ -46,6 +74,86 @@ bool lights_turning_off = false;
 unsigned long lights_animation_start = 0;
 int lights_animation_progress = 0;
 
+unsigned long last_reconfigure_us = 0;
+
+LEDStripSettings currentStripSettings() {
+	LEDStripSettings config;
+	config.led_count = settings.led_count;
+	config.led_pin = settings.led_pin;
+	config.led_channel_count = settings.led_channel_count;
+	for (int i = 0; i < MAX_LED_CHANNELS; i++) config.led_channels[i] = settings.led_channels[i];
+	config.layout = settings.layout;
+	return config;
+}
+
+static void assignStripSettings(const LEDStripSettings& config) {
+	settings.led_count = config.led_count;
+	settings.led_pin = config.led_pin;
+	settings.led_channel_count = config.led_channel_count;
+	for (int i = 0; i < MAX_LED_CHANNELS; i++) settings.led_channels[i] = config.led_channels[i];
+	settings.layout = config.layout;
+	syncLEDChannels();
+}
+
+// Rebuild every buffer sized by the LED count. False if one could not be
+// allocated; a missing transition buffer only makes state changes cut.
+static bool rebuildStripBuffers() {
+	strip.updateLength(settings.led_count);
+	strip.clear();
+	
+	// The saved frame was captured at the old length - drop it rather than restore garbage
+	free(saved_frame_buffer);
+	free(lights_current_frame);
+	saved_frame_buffer = nullptr;
+	lights_current_frame = nullptr;
+	saved_frame_length = 0;
+	has_saved_frame = false;
+	
+	// Head animations index into the old length
+	download_head_cycle_start = 0;
+	printing_head_cycle_start = 0;
+	last_download_progress = 0;
+	last_print_progress = 0;
+	
+	bool built = (strip.numPixels() == settings.led_count) && (strip.getPixels() != nullptr);
+	built = ledOutputReinitialize(settings.led_channels, settings.led_channel_count, settings.led_count) && built;
+	transitionBegin(settings.led_count);
+	built = layoutBegin(settings.led_count) && built;
+	return built;
+}
+
+// Apply new strip settings without a restart. They are written to settings
+// only while printerStateMutex is held, which parks the LED task between
+// frames, so no frame sees the new count against the old buffers; the
+// output is drained before its buffers and drivers are rebuilt. If the new
+// length cannot be allocated the previous settings are rebuilt and false is
+// returned - callers save settings only after a successful resize.
+// Network connections are not touched.
+bool reinitializeLEDStrip(const LEDStripSettings& config) {
+	unsigned long start = micros();
+	bool locked = (printerStateMutex != NULL) && (xSemaphoreTake(printerStateMutex, portMAX_DELAY) == pdTRUE);
+	
+	LEDStripSettings previous = currentStripSettings();
+	assignStripSettings(config);
+	bool built = rebuildStripBuffers();
+	if (!built) {
+		assignStripSettings(previous);
+		rebuildStripBuffers();
+	}
+	presentFrame();
+	
+	if (locked) xSemaphoreGive(printerStateMutex);
+	
+	last_reconfigure_us = micros() - start;
+	if (built) {
+		Serial.printf(" LED strip reconfigured live: %d LEDs, %d channel(s) in %lu us\n",
+					  settings.led_count, settings.led_channel_count, last_reconfigure_us);
+	} else {
+		Serial.printf(" Failed to allocate the reconfigured LED strip - kept %d LEDs\n", settings.led_count);
+	}
+	return built;
+}
+
 // Get current color for a state (considering custom colors)
 uint32_t getStateColor(int stateIndex) {
 	if (stateIndex < 0 || stateIndex >= 8) return strip.Color(255, 255, 255);
@@ -68,14 +176,110 @@ uint32_t getStateColor(int stateIndex) {
 	return strip.Color(r, g, b);
 }
 
+// Progress rendering. Progress is 16.16 fixed-point percent and bar/head
+// positions are 8.8 fixed-point pixels, so both move smoothly without
+// floating point per pixel.
+
+// Extrapolates progress between reports at the rate the last two reports
+// implied, never running past the next whole percent before it is reported
+struct ProgressGlide {
+	int last_percent = -1;
+	unsigned long last_report_ms = 0;
+	uint32_t base_q16 = 0;
+	uint32_t rate_q16_per_ms = 0;
+	uint32_t value_q16 = 0;
+	uint32_t epoch = 0;
+};
+
+static uint32_t glideProgress(ProgressGlide& glide, int percent) {
+	percent = constrain(percent, 0, 100);
+	unsigned long now = animationMillis();
+	if (glide.epoch != animation_epoch) {
+		glide = ProgressGlide();
+		glide.epoch = animation_epoch;
+	}
+	
+	if (percent != glide.last_percent) {
+		unsigned long interval = now - glide.last_report_ms;
+		if (glide.last_percent >= 0 && percent > glide.last_percent && interval > 0) {
+			glide.rate_q16_per_ms = ((uint32_t)(percent - glide.last_percent) << 16) / interval;
+		} else {
+			// First report or a new job - restart without interpolation
+			glide.rate_q16_per_ms = 0;
+			glide.value_q16 = 0;
+		}
+		glide.last_percent = percent;
+		glide.last_report_ms = now;
+		glide.base_q16 = (uint32_t)percent << 16;
+	}
+	
+	uint64_t estimate = glide.base_q16 + (uint64_t)glide.rate_q16_per_ms * (now - glide.last_report_ms);
+	uint32_t limit = min(glide.base_q16 + 0xFFFF, (uint32_t)100 << 16);
+	uint32_t value = (estimate > limit) ? limit : (uint32_t)estimate;
+	
+	// Never move backwards within a job
+	glide.value_q16 = max(glide.value_q16, value);
+	return glide.value_q16;
+}
+
+// Bar length in 8.8 pixels for a 16.16 percentage
+static uint32_t progressPixelsQ8(uint32_t percentQ16) {
+	return ((uint64_t)percentQ16 * settings.led_count / 100) >> 8;
+}
+
+// Bar from the strip start (or end when reversed); the leading pixel is lit
+// in proportion to the fractional length
+static void addProgressBarLayer(uint32_t lengthQ8, uint32_t color, int direction) {
+	int fullPixels = min((int)(lengthQ8 >> 8), settings.led_count);
+	uint8_t partial = (fullPixels < settings.led_count) ? (lengthQ8 & 0xFF) : 0;
+	int barLength = fullPixels + (partial > 0 ? 1 : 0);
+	int barStart = (direction > 0) ? 0 : settings.led_count - barLength;
+	
+	uint32_t* bar = compositorAddLayer(barStart, barLength, BLEND_ALPHA);
+	if (bar == nullptr) return;
+	
+	uint32_t solid = layerColor(color);
+	for (int i = 0; i < fullPixels; i++) {
+		bar[(direction > 0) ? i : (barLength - 1 - i)] = solid;
+	}
+	if (partial > 0) {
+		bar[(direction > 0) ? fullPixels : 0] = layerColor(color, partial);
+	}
+}
+
+// Head position in 8.8 pixels: sweeps the lit area at headSpeed ms per pixel
+static uint32_t progressHeadQ8(unsigned long timeInCycle, int headSpeed, int litPixels, int direction) {
+	uint32_t travel = ((uint32_t)(timeInCycle << 8) / headSpeed) % ((uint32_t)litPixels << 8);
+	if (direction > 0) return travel;
+	// Mirrored, the last pixel of a full-length sweep runs past pixel 0
+	int32_t position = ((int32_t)(settings.led_count - 1) << 8) - (int32_t)travel;
+	return (uint32_t)max(position, (int32_t)0);
+}
+
+// Head spread over the two pixels it straddles
+static void addProgressHeadLayer(uint32_t positionQ8, uint32_t color) {
+	int pixel = positionQ8 >> 8;
+	uint8_t fraction = positionQ8 & 0xFF;
+	
+	uint32_t* head = compositorAddLayer(pixel, 2, BLEND_ALPHA);
+	if (head == nullptr) return;
+	
+	head[0] = layerColor(color, 255 - fraction);
+	if (pixel + 1 < settings.led_count) {
+		head[1] = layerColor(color, fraction);
+	}
+}
+
 void showDownloadProgress() {
+	static ProgressGlide downloadGlide;
+	uint32_t barLengthQ8 = progressPixelsQ8(glideProgress(downloadGlide, printer_state.download_progress));
+	int progressLEDs = min((int)((barLengthQ8 + 255) >> 8), settings.led_count);
+	
 	// Check if progress has changed and reset head animation if needed
 	if (printer_state.download_progress != last_download_progress) {
-		unsigned long currentTime = millis();
-		int progressLEDs = map(printer_state.download_progress, 0, 100, 0, settings.led_count);
+		unsigned long currentTime = animationMillis();
 		
 		if (progressLEDs > 0) {
-			unsigned long cycleTime = (progressLEDs * 80) + 2500;
 			unsigned long timeInCurrentCycle = 0;
 			
 			if (download_head_cycle_start > 0) {
@@ -92,15 +296,16 @@ void showDownloadProgress() {
 		last_download_progress = printer_state.download_progress;
 	}
 	
-	int progressLEDs = map(printer_state.download_progress, 0, 100, 0, settings.led_count);
 	uint32_t downloadColor = getStateColor(2);
 	int direction = settings.download_direction;
+	uint8_t brightness = settings.night_mode_enabled ? settings.night_mode_brightness : settings.global_brightness;
 	
-	for (int i = 0; i < progressLEDs; i++) {
-		int ledIndex = (direction > 0) ? i : (settings.led_count - 1 - i);
-		strip.setPixelColor(ledIndex, downloadColor);
-	}
+	compositorBegin(settings.led_count);
+	
+	// Progress bar
+	addProgressBarLayer(barLengthQ8, downloadColor, direction);
 	
+	// Moving head
 	if (progressLEDs > 0) {
 		int headSpeed = 80 - (progressLEDs * 1);
 		if (headSpeed < 30) headSpeed = 30;
@@ -109,50 +314,43 @@ void showDownloadProgress() {
 		unsigned long cycleTime = (progressLEDs * headSpeed) + 2500;
 		unsigned long timeInCycle = 0;
 		if (download_head_cycle_start > 0) {
-			timeInCycle = (millis() - download_head_cycle_start) % cycleTime;
+			timeInCycle = (animationMillis() - download_head_cycle_start) % cycleTime;
 		}
 		
 		unsigned long movementTime = progressLEDs * headSpeed;
 		
 		if (timeInCycle < movementTime) {
-			int headPos = (timeInCycle / headSpeed) % progressLEDs;
-			int ledIndex;
-			if (direction > 0) {
-				ledIndex = headPos;
-			} else {
-				int reversedProgressStart = settings.led_count - progressLEDs;
-				ledIndex = reversedProgressStart + (progressLEDs - 1 - headPos);
-			}
-			
-			uint8_t brightness = settings.night_mode_enabled ? settings.night_mode_brightness : settings.global_brightness;
-			uint8_t headBrightness = brightness;
-			strip.setPixelColor(ledIndex, strip.Color(headBrightness, headBrightness, headBrightness));
+			uint32_t headQ8 = progressHeadQ8(timeInCycle, headSpeed, progressLEDs, direction);
+			addProgressHeadLayer(headQ8, strip.Color(brightness, brightness, brightness));
 		}
 	}
 	
+	// Sparkles
 	if (progressLEDs > 5) {
-		uint8_t brightness = settings.night_mode_enabled ? settings.night_mode_brightness : settings.global_brightness;
-		int sparkle1 = (millis() / 200) % progressLEDs;
-		int sparkle2 = (millis() / 300 + 10) % progressLEDs;
+		int sparkle1 = (animationMillis() / 200) % progressLEDs;
+		int sparkle2 = (animationMillis() / 300 + 10) % progressLEDs;
 		
 		uint8_t sparkle1Brightness = (150 * brightness) / 255;
 		uint8_t sparkle2Brightness = (100 * brightness) / 255;
 		
-		strip.setPixelColor(sparkle1, strip.Color(sparkle1Brightness, sparkle1Brightness, 255 * brightness / 255));
-		strip.setPixelColor(sparkle2, strip.Color(sparkle2Brightness, sparkle2Brightness, 255 * brightness / 255));
+		compositorAddFill(sparkle1, 1, strip.Color(sparkle1Brightness, sparkle1Brightness, brightness), BLEND_ALPHA);
+		compositorAddFill(sparkle2, 1, strip.Color(sparkle2Brightness, sparkle2Brightness, brightness), BLEND_ALPHA);
 	}
+	
+	compositorRender();
 }
 
 void showPrintingProgress() {
+	static ProgressGlide printGlide;
+	uint32_t barLengthQ8 = progressPixelsQ8(glideProgress(printGlide, printer_state.progress));
+	int fullLEDs = min((int)(barLengthQ8 >> 8), settings.led_count);
+	// The head sweeps the leading pixel once it is more than half lit
+	int totalLitArea = min(fullLEDs + ((barLengthQ8 & 0xFF) > 0x80 ? 1 : 0), settings.led_count);
+	
 	if (printer_state.progress != last_print_progress) {
-		unsigned long currentTime = millis();
-		float exactProgress = (float)printer_state.progress / 100.0 * settings.led_count;
-		int fullLEDs = (int)exactProgress;
-		float partialBrightness = exactProgress - fullLEDs;
-		int totalLitArea = fullLEDs + (partialBrightness > 0.5 ? 1 : 0);
+		unsigned long currentTime = animationMillis();
 		
 		if (totalLitArea > 0) {
-			unsigned long cycleTime = (totalLitArea * 80) + 2500;
 			unsigned long timeInCurrentCycle = 0;
 			
 			if (printing_head_cycle_start > 0) {
@@ -169,31 +367,16 @@ void showPrintingProgress() {
 		last_print_progress = printer_state.progress;
 	}
 	
-	float exactProgress = (float)printer_state.progress / 100.0 * settings.led_count;
-	int fullLEDs = (int)exactProgress;
-	float partialBrightness = exactProgress - fullLEDs;
 	int direction = settings.printing_direction;
-	
 	uint32_t printingColor = getStateColor(1);
 	
-	for (int i = 0; i < settings.led_count; i++) {
-		int ledIndex = (direction > 0) ? i : (settings.led_count - 1 - i);
-		
-		if (i < fullLEDs) {
-			strip.setPixelColor(ledIndex, printingColor);
-		} else if (i == fullLEDs && partialBrightness > 0) {
-			uint8_t r = ((printingColor >> 16) & 0xFF) * partialBrightness;
-			uint8_t g = ((printingColor >> 8) & 0xFF) * partialBrightness;
-			uint8_t b = (printingColor & 0xFF) * partialBrightness;
-			strip.setPixelColor(ledIndex, strip.Color(r, g, b));
-		} else {
-			strip.setPixelColor(ledIndex, strip.Color(0, 0, 0));
-		}
-	}
+	compositorBegin(settings.led_count);
+	
+	// Progress bar with an anti-aliased leading edge
+	addProgressBarLayer(barLengthQ8, printingColor, direction);
 	
+	// Moving head
 	if (fullLEDs > 0) {
-		int totalLitArea = fullLEDs + (partialBrightness > 0.5 ? 1 : 0);
-		
 		int headSpeed = 80 - (totalLitArea * 1);
 		if (headSpeed < 30) headSpeed = 30;
 		if (headSpeed > 80) headSpeed = 80;
@@ -201,30 +384,135 @@ void showPrintingProgress() {
 		unsigned long cycleTime = (totalLitArea * headSpeed) + 2500;
 		unsigned long timeInCycle = 0;
 		if (printing_head_cycle_start > 0) {
-			timeInCycle = (millis() - printing_head_cycle_start) % cycleTime;
+			timeInCycle = (animationMillis() - printing_head_cycle_start) % cycleTime;
 		}
 		
 		unsigned long movementTime = totalLitArea * headSpeed;
 		
 		if (timeInCycle < movementTime) {
-			int headPos = (timeInCycle / headSpeed) % totalLitArea;
-			int ledIndex;
-			if (direction > 0) {
-				ledIndex = headPos;
-			} else {
-				int reversedProgressStart = settings.led_count - totalLitArea;
-				ledIndex = reversedProgressStart + (totalLitArea - 1 - headPos);
-			}
-			
 			uint8_t brightness = settings.night_mode_enabled ? settings.night_mode_brightness : settings.global_brightness;
-			strip.setPixelColor(ledIndex, strip.Color(brightness, brightness, brightness));
+			uint32_t headQ8 = progressHeadQ8(timeInCycle, headSpeed, totalLitArea, direction);
+			addProgressHeadLayer(headQ8, strip.Color(brightness, brightness, brightness));
+		}
+	}
+	
+	compositorRender();
+}
+
+// Layer mode keeps a base frame of completed and remaining pixels and only
+// repaints the pixels whose state changed since the last layer report
+struct LayerFrame {
+	uint8_t* base = nullptr;  // Packed RGB
+	int capacity = 0;
+	int count = 0;
+	int current_start = 0;    // Pixels covering the current layer (logical order)
+	int current_end = 0;
+	uint32_t done_color = 0;
+	int direction = 0;
+	bool valid = false;
+};
+
+static LayerFrame layer_frame;
+static AnimationPhase layer_pulse;
+
+// Remaining layers are drawn at 1/8 of the state color
+#define LAYER_REMAINING_SHIFT 3
+
+// Pixels overlapping the current layer. Pixel i spans [i, i + 1) / count and
+// layer L spans [L, L + 1) / total, so with more layers than pixels each
+// pixel becomes a bucket of layers, and with fewer a layer spans pixels.
+static void layerSpan(int layer, int total, int count, int& start, int& end) {
+	start = (int)((int64_t)layer * count / total);
+	end = (int)(((int64_t)(layer + 1) * count + total - 1) / total);
+	start = constrain(start, 0, count);
+	end = constrain(end, start, count);
+}
+
+static void paintLayerBase(int from, int to) {
+	uint32_t done = layer_frame.done_color;
+	uint8_t remaining[3] = {
+		(uint8_t)(((done >> 16) & 0xFF) >> LAYER_REMAINING_SHIFT),
+		(uint8_t)(((done >> 8) & 0xFF) >> LAYER_REMAINING_SHIFT),
+		(uint8_t)((done & 0xFF) >> LAYER_REMAINING_SHIFT)
+	};
+	
+	for (int p = from; p < to; p++) {
+		int i = (layer_frame.direction < 0) ? layer_frame.count - 1 - p : p;
+		uint8_t* pixel = layer_frame.base + i * 3;
+		if (p < layer_frame.current_start) {
+			pixel[0] = (done >> 16) & 0xFF;
+			pixel[1] = (done >> 8) & 0xFF;
+			pixel[2] = done & 0xFF;
+		} else {
+			// The current layer is drawn over this every frame
+			memcpy(pixel, remaining, 3);
 		}
 	}
 }
 
+void showLayerProgress() {
+	int total = printer_state.total_layers;
+	int count = min(settings.led_count, (int)strip.numPixels());
+	uint8_t* canvas = strip.getPixels();
+	
+	if (total <= 0 || count <= 0 || canvas == nullptr) {
+		showPrintingProgress();
+		return;
+	}
+	
+	if (count > layer_frame.capacity) {
+		uint8_t* grown = (uint8_t*)realloc(layer_frame.base, count * 3);
+		if (grown == nullptr) {
+			showPrintingProgress();
+			return;
+		}
+		layer_frame.base = grown;
+		layer_frame.capacity = count;
+		layer_frame.valid = false;
+	}
+	
+	// current_layer is 1-based; layers below it are complete
+	int layer = constrain(printer_state.current_layer - 1, 0, total - 1);
+	int start, end;
+	layerSpan(layer, total, count, start, end);
+	
+	uint32_t doneColor = getStateColor(1);
+	int direction = settings.printing_direction;
+	
+	if (!layer_frame.valid || layer_frame.count != count || layer_frame.done_color != doneColor ||
+		layer_frame.direction != direction) {
+		layer_frame.count = count;
+		layer_frame.done_color = doneColor;
+		layer_frame.direction = direction;
+		layer_frame.current_start = start;
+		layer_frame.current_end = end;
+		paintLayerBase(0, count);
+		layer_frame.valid = true;
+	} else if (start != layer_frame.current_start || end != layer_frame.current_end) {
+		int from = min(start, layer_frame.current_start);
+		int to = max(end, layer_frame.current_end);
+		layer_frame.current_start = start;
+		layer_frame.current_end = end;
+		paintLayerBase(from, to);
+	}
+	
+	memcpy(canvas, layer_frame.base, count * 3);
+	
+	// Current layer pulses between 25% and full state color
+	float wave = sin(phaseRadians(advancePhase(layer_pulse, PHASE_RATE(0.8))));
+	uint16_t level = 64 + (uint16_t)((wave + 1) * 96);
+	for (int p = start; p < end; p++) {
+		int i = (direction < 0) ? count - 1 - p : p;
+		uint8_t* pixel = canvas + i * 3;
+		pixel[0] = (((doneColor >> 16) & 0xFF) * level) >> 8;
+		pixel[1] = (((doneColor >> 8) & 0xFF) * level) >> 8;
+		pixel[2] = ((doneColor & 0xFF) * level) >> 8;
+	}
+}
+
 void showPausedState() {
 	uint32_t pausedColor = getStateColor(3);
-	uint8_t brightness = (sin(millis() / 500.0) + 1) * 127;
+	uint8_t brightness = (sin(animationMillis() / 500.0) + 1) * 127;
 	
 	uint8_t r = ((pausedColor >> 16) & 0xFF) * brightness / 255;
 	uint8_t g = ((pausedColor >> 8) & 0xFF) * brightness / 255;
@@ -237,7 +525,7 @@ void showPausedState() {
 }
 
 void showErrorState() {
-	bool on = (millis() / 250) % 2;
+	bool on = (animationMillis() / 250) % 2;
 	uint32_t color = on ? getStateColor(4) : strip.Color(0, 0, 0);
 	
 	for (int i = 0; i < settings.led_count; i++) {
@@ -247,7 +535,7 @@ void showErrorState() {
 
 void showRecoverableErrorState() {
 	unsigned long cycleTime = 1000;
-	unsigned long timeInCycle = millis() % cycleTime;
+	unsigned long timeInCycle = animationMillis() % cycleTime;
 	
 	uint32_t color;
 	if (timeInCycle < 500) {
@@ -262,16 +550,15 @@ void showRecoverableErrorState() {
 }
 
 void showHeatingState() {
-	uint32_t heatingBaseColor = getStateColor(5);
+	const uint8_t* palette = getStatePalette(5);
+	uint8_t* canvas = strip.getPixels();
+	if (canvas == nullptr) return;
 	
-	uint8_t baseR = (heatingBaseColor >> 16) & 0xFF;
-	uint8_t baseG = (heatingBaseColor >> 8) & 0xFF;
-	uint8_t baseB = heatingBaseColor & 0xFF;
-	
-	float timeOffset = millis() / 1000.0;
+	int count = min(settings.led_count, (int)strip.numPixels());
+	float timeOffset = animationMillis() / 1000.0;
 	float moveOffset = timeOffset * 2.0;
 	
-	for (int i = 0; i < settings.led_count; i++) {
+	for (int i = 0; i < count; i++) {
 		float wave1 = sin((i * 0.35 - moveOffset * 3.0)) * 0.5 + 0.5;
 		float wave2 = sin((i * 0.5 - moveOffset * 4.5)) * 0.3 + 0.4;
 		float heatBuildup = sin((i * 0.2 - moveOffset * 2.0)) * 0.2 + 0.8;
@@ -279,26 +566,26 @@ void showHeatingState() {
 		float combined = (wave1 * 0.5 + wave2 * 0.4 + heatBuildup * 0.1);
 		uint8_t brightness = combined * 255;
 		
-		float positionFactor = (float)i / settings.led_count;
-		uint8_t red = (baseR * brightness / 255);
-		uint8_t green = (baseG * brightness / 255) * (1.0 - 0.3 * positionFactor);
-		uint8_t blue = (baseB * brightness / 255);
-		
-		strip.setPixelColor(i, strip.Color(red, green, blue));
+		// Palette runs along the strip; the waves modulate its brightness
+		const uint8_t* entry = palette + (i * PALETTE_SIZE / count) * 3;
+		uint8_t* pixel = canvas + i * 3;
+		pixel[0] = entry[0] * brightness / 255;
+		pixel[1] = entry[1] * brightness / 255;
+		pixel[2] = entry[2] * brightness / 255;
 	}
 }
 
 void showCoolingState() {
 	int direction = -1;
-	uint32_t coolingBaseColor = getStateColor(6);
+	const uint8_t* palette = getStatePalette(6);
+	uint8_t* canvas = strip.getPixels();
+	if (canvas == nullptr) return;
 	
-	uint8_t baseR = (coolingBaseColor >> 16) & 0xFF;
-	uint8_t baseG = (coolingBaseColor >> 8) & 0xFF;
-	uint8_t baseB = coolingBaseColor & 0xFF;
+	int count = min(settings.led_count, (int)strip.numPixels());
+	float timeOffset = animationMillis() / 1000.0;
 	
-	for (int i = 0; i < settings.led_count; i++) {
-		int effectivePos = (direction > 0) ? i : (settings.led_count - 1 - i);
-		float timeOffset = millis() / 1000.0;
+	for (int i = 0; i < count; i++) {
+		int effectivePos = (direction > 0) ? i : (count - 1 - i);
 		
 		float wave1 = sin((effectivePos * 0.25 + timeOffset * direction * 2.5)) * 0.5 + 0.5;
 		float wave2 = sin((effectivePos * 0.4 + timeOffset * direction * 3.5)) * 0.3 + 0.3;
@@ -307,65 +594,68 @@ void showCoolingState() {
 		float combined = (wave1 * 0.6 + wave2 * 0.3 + tempDrop * 0.1);
 		uint8_t brightness = combined * 255;
 		
-		float positionFactor = (float)i / settings.led_count;
-		uint8_t red = (baseR * brightness / 255);
-		uint8_t green = (baseG * brightness / 255) * (0.7 + 0.3 * positionFactor);
-		uint8_t blue = (baseB * brightness / 255);
-		
-		strip.setPixelColor(i, strip.Color(red, green, blue));
+		const uint8_t* entry = palette + (i * PALETTE_SIZE / count) * 3;
+		uint8_t* pixel = canvas + i * 3;
+		pixel[0] = entry[0] * brightness / 255;
+		pixel[1] = entry[1] * brightness / 255;
+		pixel[2] = entry[2] * brightness / 255;
 	}
 }
 
 void showFinishedState() {
 	uint32_t finishedColor = getStateColor(7);
-	uint8_t brightness = (sin(millis() / 1000.0) + 1) * 127;
+	uint8_t brightness = (sin(animationMillis() / 1000.0) + 1) * 127;
 	
 	uint8_t r = ((finishedColor >> 16) & 0xFF) * brightness / 255;
 	uint8_t g = ((finishedColor >> 8) & 0xFF) * brightness / 255;
 	uint8_t b = (finishedColor & 0xFF) * brightness / 255;
-	uint32_t color = strip.Color(r, g, b);
 	
-	for (int i = 0; i < settings.led_count; i++) {
-		strip.setPixelColor(i, color);
-	}
+	compositorBegin(settings.led_count);
+	compositorAddFill(0, settings.led_count, strip.Color(r, g, b), BLEND_ALPHA);
 	
-	if ((millis() / 100) % 10 == 0) {
+	if ((animationMillis() / 100) % 10 == 0) {
 		int sparklePos = random(settings.led_count);
 		uint8_t sparkleBrightness = settings.night_mode_enabled ? settings.night_mode_brightness : settings.global_brightness;
-		strip.setPixelColor(sparklePos, strip.Color(sparkleBrightness, sparkleBrightness, sparkleBrightness));
+		compositorAddFill(sparklePos, 1, strip.Color(sparkleBrightness, sparkleBrightness, sparkleBrightness), BLEND_ALPHA);
 	}
+	
+	compositorRender();
 }
 
 void showIdleState() {
 	if (!printer_state.is_heating && !printer_state.is_cooling) {
 		uint32_t idleColor = getStateColor(0);
-		unsigned long currentTime = millis();
+		unsigned long currentTime = animationMillis();
 		int direction = settings.idle_direction;
 		
 		uint8_t baseR = (idleColor >> 16) & 0xFF;
 		uint8_t baseG = (idleColor >> 8) & 0xFF;
 		uint8_t baseB = idleColor & 0xFF;
 		
-		static float wavePhase = 0;
-		static float breathPhase = 0;
-		static float sparklePhase = 0;
+		// Speeds match the old per-frame steps at the 50 ms frame interval
+		static AnimationPhase wavePhase;
+		static AnimationPhase wave2Phase;
+		static AnimationPhase breathPhase;
+		static AnimationPhase sparklePhase;
 		
-		wavePhase += 0.08 * direction;
-		breathPhase += 0.02;
-		sparklePhase += 0.05;
+		float wave1Offset = phaseRadians(advancePhase(wavePhase, PHASE_RATE_RAD(1.6), direction));
+		float wave2Offset = phaseRadians(advancePhase(wave2Phase, PHASE_RATE_RAD(1.6 * 1.3), direction));
+		float breath = phaseRadians(advancePhase(breathPhase, PHASE_RATE_RAD(0.4)));
+		float wave3Offset = phaseRadians(advancePhase(sparklePhase, PHASE_RATE_RAD(1.0)) * 2);
 		
-		float globalBreath = sin(breathPhase) * 0.15 + 0.85;
+		float globalBreath = sin(breath) * 0.15 + 0.85;
 		
-		for (int i = 0; i < settings.led_count; i++) {
-			strip.setPixelColor(i, strip.Color(0, 0, 0));
-		}
+		compositorBegin(settings.led_count);
+		
+		// Base wave
+		uint32_t* wave = compositorAddLayer(0, settings.led_count, BLEND_ALPHA);
 		
-		for (int i = 0; i < settings.led_count; i++) {
+		for (int i = 0; wave != nullptr && i < settings.led_count; i++) {
 			float ledPosition = (float)i / settings.led_count;
 			
-			float wave1 = sin((ledPosition * 6.28) + wavePhase) * 0.5 + 0.5;
-			float wave2 = sin((ledPosition * 12.56) + (wavePhase * 1.3)) * 0.3 + 0.3;
-			float wave3 = sin((ledPosition * 18.84) + (sparklePhase * 2)) * 0.2 + 0.2;
+			float wave1 = sin((ledPosition * 6.28) + wave1Offset) * 0.5 + 0.5;
+			float wave2 = sin((ledPosition * 12.56) + wave2Offset) * 0.3 + 0.3;
+			float wave3 = sin((ledPosition * 18.84) + wave3Offset) * 0.2 + 0.2;
 			
 			float combinedIntensity = (wave1 * 0.6) + (wave2 * 0.3) + (wave3 * 0.1);
 			combinedIntensity *= globalBreath;
@@ -383,18 +673,24 @@ void showIdleState() {
 				b = min(255, b + (int)(highlight * 40));
 			}
 			
-			strip.setPixelColor(i, strip.Color(r, g, b));
+			wave[i] = layerColor(strip.Color(r, g, b));
 		}
 		
 		static unsigned long lastSparkleTime = 0;
+		static unsigned long sparkleInterval = 0;
 		static float sparklePosition = 0;
 		static bool sparkleActive = false;
 		static unsigned long sparkleStartTime = 0;
 		
-		if (currentTime - lastSparkleTime > random(3000, 5000)) {
-			lastSparkleTime = currentTime;
+		// The interval is drawn once per sparkle, and the sparkle starts when
+		// it was due rather than on the frame that noticed, so neither how
+		// often nor where sparkles run depends on the frame rate
+		if (currentTime - lastSparkleTime >= sparkleInterval) {
+			unsigned long due = lastSparkleTime + sparkleInterval;
+			lastSparkleTime = (currentTime - due < 2000) ? due : currentTime;
+			sparkleInterval = random(3000, 5000);
 			sparkleActive = true;
-			sparkleStartTime = currentTime;
+			sparkleStartTime = lastSparkleTime;
 			sparklePosition = (direction > 0) ? 0 : settings.led_count - 1;
 		}
 		
@@ -419,30 +715,22 @@ void showIdleState() {
 					uint8_t sparkleR = min(255, baseR + sparkleBoost);
 					uint8_t sparkleG = min(255, baseG + sparkleBoost);
 					uint8_t sparkleB = min(255, baseB + sparkleBoost);
-					strip.setPixelColor(centerPos, strip.Color(sparkleR, sparkleG, sparkleB));
+					compositorAddFill(centerPos, 1, strip.Color(sparkleR, sparkleG, sparkleB), BLEND_ALPHA);
 				}
 				
+				// Trail brightens whatever is underneath it
 				for (int trail = 1; trail <= 3; trail++) {
 					int trailPos = centerPos - (trail * direction);
-					if (trailPos >= 0 && trailPos < settings.led_count) {
-						float trailIntensity = sparkleIntensity / (trail + 1);
-						uint8_t currentR, currentG, currentB;
-						uint32_t currentColor = strip.getPixelColor(trailPos);
-						currentR = (currentColor >> 16) & 0xFF;
-						currentG = (currentColor >> 8) & 0xFF;
-						currentB = currentColor & 0xFF;
-						
-						uint8_t trailBoost = (int)(trailIntensity * 50 * brightnessFactor);
-						uint8_t trailR = min(255, currentR + trailBoost);
-						uint8_t trailG = min(255, currentG + trailBoost);
-						uint8_t trailB = min(255, currentB + trailBoost);
-						strip.setPixelColor(trailPos, strip.Color(trailR, trailG, trailB));
-					}
+					float trailIntensity = sparkleIntensity / (trail + 1);
+					uint8_t trailBoost = (int)(trailIntensity * 50 * brightnessFactor);
+					compositorAddFill(trailPos, 1, strip.Color(trailBoost, trailBoost, trailBoost), BLEND_ADD);
 				}
 			} else {
 				sparkleActive = false;
 			}
 		}
+		
+		compositorRender();
 	}
 	else return;
 }
@@ -452,37 +740,61 @@ void showAutoOffState() {
 	strip.clear();
 }
 
-void rainbowAnimation() {
-	if (millis() - last_rainbow < RAINBOW_INTERVAL)
-		return;
-	last_rainbow = millis();
-	
+// Rainbow palette: wheel colors with brightness and direction baked in,
+// stored twice in a row so any 256-pixel window is one contiguous copy
+#define RAINBOW_PALETTE_SIZE 256
+static uint8_t rainbow_palette_rgb[RAINBOW_PALETTE_SIZE * 2 * 3];
+static int rainbow_palette_brightness = -1;
+static int rainbow_palette_direction = 0;
+
+// Rebuild the palette only when brightness or direction has changed
+static void updateRainbowPalette() {
 	int direction = settings.rainbow_direction;
+	uint8_t brightness = settings.night_mode_enabled ? settings.night_mode_brightness : settings.global_brightness;
+	if (brightness == rainbow_palette_brightness && direction == rainbow_palette_direction) return;
 	
-	for (int i = 0; i < settings.led_count; i++) {
-		int pos = (i * direction + rainbow_offset * direction) & 255;
-		if (pos < 0) pos += 256;
-		
-		uint32_t wheelColor = wheel(pos);
+	for (int k = 0; k < RAINBOW_PALETTE_SIZE; k++) {
+		// Pixel i at offset o shows wheel((i + o) * direction)
+		uint32_t wheelColor = wheel((k * direction) & 255);
+		uint8_t r = ((wheelColor >> 16) & 0xFF) * brightness / 255;
+		uint8_t g = ((wheelColor >> 8) & 0xFF) * brightness / 255;
+		uint8_t b = (wheelColor & 0xFF) * brightness / 255;
 		
-		uint8_t brightness = settings.night_mode_enabled ? settings.night_mode_brightness : settings.global_brightness;
-		if (brightness != 255) {
-			uint8_t r = ((wheelColor >> 16) & 0xFF) * brightness / 255;
-			uint8_t g = ((wheelColor >> 8) & 0xFF) * brightness / 255;
-			uint8_t b = (wheelColor & 0xFF) * brightness / 255;
-			wheelColor = strip.Color(r, g, b);
+		for (int copy = 0; copy < 2; copy++) {
+			uint8_t* entry = rainbow_palette_rgb + (copy * RAINBOW_PALETTE_SIZE + k) * 3;
+			entry[0] = r;
+			entry[1] = g;
+			entry[2] = b;
 		}
-		
-		strip.setPixelColor(i, wheelColor);
 	}
-	strip.show();
 	
-	rainbow_offset += direction;
-	if (rainbow_offset >= 256 || rainbow_offset < 0) {
-		rainbow_offset = direction > 0 ? 0 : 255;
+	rainbow_palette_brightness = brightness;
+	rainbow_palette_direction = direction;
+}
+
+// Write the rainbow at the given offset into a packed RGB buffer
+void renderRainbow(uint8_t* rgb, int count, int offset) {
+	if (rgb == nullptr) return;
+	updateRainbowPalette();
+	
+	const uint8_t* window = rainbow_palette_rgb + (offset & 255) * 3;
+	for (int done = 0; done < count; done += RAINBOW_PALETTE_SIZE) {
+		int length = min(count - done, RAINBOW_PALETTE_SIZE);
+		memcpy(rgb + done * 3, window, length * 3);
 	}
 }
 
+// Move the rainbow by elapsed time: one palette step per RAINBOW_INTERVAL.
+// rainbow_offset is the whole-step part of the phase; writes to it (e.g. when
+// the lights animation restores a saved offset) are picked up here.
+void advanceRainbow() {
+	static AnimationPhase rainbowPhase;
+	
+	rainbowPhase.phase = ((uint32_t)(rainbow_offset & 255) << 24) | (rainbowPhase.phase & 0xFFFFFF);
+	advancePhase(rainbowPhase, PHASE_RATE(1000.0 / RAINBOW_INTERVAL / 256.0), settings.rainbow_direction);
+	rainbow_offset = rainbowPhase.phase >> 24;
+}
+
 uint32_t wheel(byte wheelPos) {
 	wheelPos = 255 - wheelPos;
 	if (wheelPos < 85) {
@@ -499,7 +811,7 @@ uint32_t wheel(byte wheelPos) {
 void startupAnimation() {
 	for (int i = 0; i < settings.led_count; i++) {
 		strip.setPixelColor(i, strip.Color(0, 0, 255));
-		strip.show();
+		presentFrame();
 		delay(30);
 	}
 	
@@ -507,36 +819,42 @@ void startupAnimation() {
 	
 	for (int i = 0; i < settings.led_count; i++) {
 		strip.setPixelColor(i, 0);
-		strip.show();
+		presentFrame();
 		delay(20);
 	}
 }
 
 void captureCurrentFrame() {
-	if (settings.led_count <= 0 || settings.led_count > 1000) {
+	if (settings.led_count <= 0 || settings.led_count > MAX_LED_COUNT) {
 		Serial.println(" Invalid LED count for frame capture");
 		return;
 	}
 	
-	if (saved_frame_buffer == nullptr) {
-		saved_frame_buffer = (uint32_t*)malloc(settings.led_count * sizeof(uint32_t));
-		if (saved_frame_buffer == nullptr) {
+	if (saved_frame_buffer == nullptr || saved_frame_length != settings.led_count) {
+		free(saved_frame_buffer);
+		free(lights_current_frame);
+		// The lights-on blend renders into lights_current_frame, so both are sized together
+		saved_frame_buffer = (uint8_t*)malloc(settings.led_count * 3);
+		lights_current_frame = (uint8_t*)malloc(settings.led_count * 3);
+		if (saved_frame_buffer == nullptr || lights_current_frame == nullptr) {
+			free(saved_frame_buffer);
+			free(lights_current_frame);
+			saved_frame_buffer = nullptr;
+			lights_current_frame = nullptr;
+			saved_frame_length = 0;
 			Serial.println(" Failed to allocate frame buffer");
 			return;
 		}
+		saved_frame_length = settings.led_count;
 	}
 	
-	if (saved_frame_buffer != nullptr) {
-		for (int i = 0; i < settings.led_count; i++) {
-			if (i >= 0 && i < settings.led_count) {
-				saved_frame_buffer[i] = strip.getPixelColor(i);
-			}
-		}
+	if (saved_frame_buffer != nullptr && strip.getPixels() != nullptr) {
+		memcpy(saved_frame_buffer, strip.getPixels(), min(settings.led_count, (int)strip.numPixels()) * 3);
 		
 		saved_animation_state = printer_state.status;
 		saved_progress = (printer_state.status == "printing") ? printer_state.progress : 
 						 (printer_state.status == "downloading") ? printer_state.download_progress : 0;
-		saved_animation_time = millis();
+		saved_animation_time = animationMillis();
 		
 		if (!printer_state.is_connected || printer_state.status == "unknown") {
 			saved_rainbow_offset = rainbow_offset;
@@ -556,12 +874,9 @@ void captureCurrentFrame() {
 }
 
 void restoreSavedFrame() {
-	if (saved_frame_buffer != nullptr && has_saved_frame && settings.led_count > 0) {
-		for (int i = 0; i < settings.led_count; i++) {
-			if (i >= 0 && i < settings.led_count) {
-				strip.setPixelColor(i, saved_frame_buffer[i]);
-			}
-		}
+	if (saved_frame_buffer != nullptr && has_saved_frame && settings.led_count > 0 && strip.getPixels() != nullptr) {
+		int length = min(min(settings.led_count, saved_frame_length), (int)strip.numPixels());
+		memcpy(strip.getPixels(), saved_frame_buffer, length * 3);
 		Serial.printf(" Frame restored: State=%s, Progress=%d%%\n", 
 					  saved_animation_state.c_str(), saved_progress);
 	} else {
@@ -601,66 +916,33 @@ bool shouldResumeAnimation() {
 	return false;
 }
 
-void generateRainbowFrame(uint32_t* frameBuffer, int offset) {
-	int direction = settings.rainbow_direction;
-	
-	for (int i = 0; i < settings.led_count; i++) {
-		int pos = (i * direction + offset * direction) & 255;
-		if (pos < 0) pos += 256;
-		
-		uint32_t wheelColor = wheel(pos);
-		
-		uint8_t brightness = settings.night_mode_enabled ? settings.night_mode_brightness : settings.global_brightness;
-		if (brightness != 255) {
-			uint8_t r = ((wheelColor >> 16) & 0xFF) * brightness / 255;
-			uint8_t g = ((wheelColor >> 8) & 0xFF) * brightness / 255;
-			uint8_t b = (wheelColor & 0xFF) * brightness / 255;
-			wheelColor = strip.Color(r, g, b);
-		}
-		
-		frameBuffer[i] = wheelColor;
-	}
-}
-
-void generateCurrentAnimationFrame(uint32_t* frameBuffer) {
-	for (int i = 0; i < settings.led_count; i++) {
-		frameBuffer[i] = strip.Color(0, 0, 0);
-	}
+// Simplified frame for the current state, used as the lights-on blend target.
+// rgb is lights_current_frame, sized with the saved frame.
+void generateCurrentAnimationFrame(uint8_t* rgb) {
+	int count = min(min(settings.led_count, saved_frame_length), (int)strip.numPixels());
+	if (rgb == nullptr || count <= 0) return;
+	memset(rgb, 0, count * 3);
 	
 	if (!printer_state.is_connected || printer_state.status == "unknown") {
-		generateRainbowFrame(frameBuffer, rainbow_offset);
+		renderRainbow(rgb, count, rainbow_offset);
 		return;
 	}
 	
 	if (printer_state.status == "printing") {
-		int progressLEDs = map(printer_state.progress, 0, 100, 0, settings.led_count);
-		uint32_t printColor = getStateColor(1);
-		
-		for (int i = 0; i < progressLEDs && i < settings.led_count; i++) {
-			int ledIndex = (settings.printing_direction > 0) ? i : (settings.led_count - 1 - i);
-			frameBuffer[ledIndex] = printColor;
-		}
+		int progressLEDs = constrain(map(printer_state.progress, 0, 100, 0, count), 0, count);
+		int start = (settings.printing_direction > 0) ? 0 : count - progressLEDs;
+		fillRGB(rgb + start * 3, progressLEDs, getStateColor(1));
 	}
 	else if (printer_state.status == "downloading") {
-		int progressLEDs = map(printer_state.download_progress, 0, 100, 0, settings.led_count);
-		uint32_t downloadColor = getStateColor(2);
-		
-		for (int i = 0; i < progressLEDs && i < settings.led_count; i++) {
-			int ledIndex = (settings.download_direction > 0) ? i : (settings.led_count - 1 - i);
-			frameBuffer[ledIndex] = downloadColor;
-		}
+		int progressLEDs = constrain(map(printer_state.download_progress, 0, 100, 0, count), 0, count);
+		int start = (settings.download_direction > 0) ? 0 : count - progressLEDs;
+		fillRGB(rgb + start * 3, progressLEDs, getStateColor(2));
 	}
 	else if (printer_state.status == "heating") {
-		uint32_t heatColor = getStateColor(5);
-		for (int i = 0; i < settings.led_count; i++) {
-			frameBuffer[i] = heatColor;
-		}
+		fillRGB(rgb, count, getStateColor(5));
 	}
 	else if (printer_state.status == "cooling") {
-		uint32_t coolColor = getStateColor(6);
-		for (int i = 0; i < settings.led_count; i++) {
-			frameBuffer[i] = coolColor;
-		}
+		fillRGB(rgb, count, getStateColor(6));
 	}
 	else {
 		uint32_t stateColor = getStateColor(0);
@@ -669,14 +951,13 @@ void generateCurrentAnimationFrame(uint32_t* frameBuffer) {
 		else if (printer_state.status == "finished") stateColor = getStateColor(7);
 		else if (printer_state.status == "idle") stateColor = getStateColor(0);
 		
-		for (int i = 0; i < settings.led_count; i++) {
-			frameBuffer[i] = stateColor;
-		}
+		fillRGB(rgb, count, stateColor);
 	}
 }
 
 void showLightsAnimation() {
-	unsigned long elapsed = millis() - lights_animation_start;
+	PROFILE_SCOPE(PROFILE_EFFECT_LIGHTS);
+	unsigned long elapsed = animationMillis() - lights_animation_start;
 	float progress = (float)elapsed / LIGHTS_ANIMATION_DURATION;
 	
 	if (progress >= 1.0f) {
@@ -699,9 +980,11 @@ void showLightsAnimation() {
 	
 	float easedProgress = 1 - pow(1 - progress, 3);
 	
-	int totalLEDs = settings.led_count;
+	int totalLEDs = min(settings.led_count, (int)strip.numPixels());
 	int middle = totalLEDs / 2;
 	int maskRadius = (int)(easedProgress * (totalLEDs / 2.0f));
+	uint8_t* canvas = strip.getPixels();
+	if (canvas == nullptr) return;
 	
 	if (lights_turning_off) {
 		if (saved_frame_buffer != nullptr && has_saved_frame) {
@@ -714,23 +997,15 @@ void showLightsAnimation() {
 				else if (printer_state.status == "printing") stateColor = getStateColor(1);
 				else if (printer_state.status == "downloading") stateColor = getStateColor(2);
 				
-				for (int i = 0; i < totalLEDs; i++) {
-					strip.setPixelColor(i, stateColor);
-				}
+				fillRGB(canvas, totalLEDs, stateColor);
 			}
 		}
 		
-		for (int i = 0; i < maskRadius; i++) {
-			int leftLED = i;
-			int rightLED = totalLEDs - 1 - i;
-			
-			if (leftLED < middle) {
-				strip.setPixelColor(leftLED, strip.Color(0, 0, 0));
-			}
-			if (rightLED >= middle) {
-				strip.setPixelColor(rightLED, strip.Color(0, 0, 0));
-			}
-		}
+		// Dark from both ends towards the middle
+		int leftDark = min(maskRadius, middle);
+		int rightDark = max(totalLEDs - maskRadius, middle);
+		memset(canvas, 0, leftDark * 3);
+		memset(canvas + rightDark * 3, 0, (totalLEDs - rightDark) * 3);
 	} 
 	else if (lights_turning_on) {
 		strip.clear();
@@ -743,48 +1018,16 @@ void showLightsAnimation() {
 				Serial.printf(" Rainbow state restored: offset=%d\n", rainbow_offset);
 			}
 			
-			uint32_t* currentFrame = (uint32_t*)malloc(settings.led_count * sizeof(uint32_t));
-			if (currentFrame == nullptr) {
-				Serial.println(" Failed to allocate current frame buffer");
-				return;
-			}
-			
-			strip.clear();
-			generateCurrentAnimationFrame(currentFrame);
-			
-			for (int i = 0; i < totalLEDs && i < settings.led_count; i++) {
-				uint32_t savedColor = saved_frame_buffer[i];
-				uint32_t currentColor = currentFrame[i];
-				
-				uint8_t savedR = (savedColor >> 16) & 0xFF;
-				uint8_t savedG = (savedColor >> 8) & 0xFF;
-				uint8_t savedB = savedColor & 0xFF;
-				
-				uint8_t currentR = (currentColor >> 16) & 0xFF;
-				uint8_t currentG = (currentColor >> 8) & 0xFF;
-				uint8_t currentB = currentColor & 0xFF;
-				
-				uint8_t blendedR = savedR + (currentR - savedR) * easedProgress;
-				uint8_t blendedG = savedG + (currentG - savedG) * easedProgress;
-				uint8_t blendedB = savedB + (currentB - savedB) * easedProgress;
-				
-				strip.setPixelColor(i, strip.Color(blendedR, blendedG, blendedB));
-			}
+			int frameLength = min(totalLEDs, saved_frame_length);
+			generateCurrentAnimationFrame(lights_current_frame);
 			
-			free(currentFrame);
-			currentFrame = nullptr;
+			lerpBytes(canvas, saved_frame_buffer, lights_current_frame, frameLength * 3, easedProgress * 256);
 			
-			for (int i = maskRadius; i < totalLEDs / 2; i++) {
-				int leftLED = middle - i - 1;
-				int rightLED = middle + i;
-				
-				if (leftLED >= 0) {
-					strip.setPixelColor(leftLED, strip.Color(0, 0, 0));
-				}
-				if (rightLED < totalLEDs) {
-					strip.setPixelColor(rightLED, strip.Color(0, 0, 0));
-				}
-			}
+			// Lit from the middle outwards
+			int leftLit = max(middle - maskRadius, 0);
+			int rightLit = min(middle + maskRadius, middle + totalLEDs / 2);
+			memset(canvas, 0, leftLit * 3);
+			memset(canvas + rightLit * 3, 0, (middle + totalLEDs / 2 - rightLit) * 3);
 		} 
 		else {
 			uint32_t animationColor = strip.Color(255, 255, 255);
@@ -813,61 +1056,199 @@ void showLightsAnimation() {
 		}
 	}
 	
-	strip.show();
+	presentFrame();
+}
+
+// Effect shown for the current printer state. A change starts a transition.
+enum StateEffect {
+	EFFECT_NONE,
+	EFFECT_RAINBOW,
+	EFFECT_AUTO_OFF,
+	EFFECT_DOWNLOAD,
+	EFFECT_PRINTING,
+	EFFECT_PAUSED,
+	EFFECT_RECOVERABLE_ERROR,
+	EFFECT_ERROR,
+	EFFECT_HEATING,
+	EFFECT_COOLING,
+	EFFECT_FINISHED,
+	EFFECT_IDLE,
+	EFFECT_REALTIME
+};
+
+static StateEffect current_effect = EFFECT_NONE;
+static StateEffect outgoing_effect = EFFECT_NONE;
+
+// Effect for the last status the LED task saw; re-selected only when the
+// status version or the connection flag changes
+static StateEffect status_effect = EFFECT_NONE;
+static uint32_t status_effect_version = 0;
+static bool status_effect_connected = false;
+
+static StateEffect effectForStatus() {
+	const String& status = printer_state.status;
+	
+	if (!printer_state.is_connected) return EFFECT_RAINBOW;
+	if (status == "unknown" || status.length() == 0) return EFFECT_RAINBOW;
+	
+	if (status == "auto_off") return EFFECT_AUTO_OFF;
+	if (status == "downloading") return EFFECT_DOWNLOAD;
+	if (status == "printing" || status == "RUNNING") return EFFECT_PRINTING;
+	if (status == "paused" || status == "PAUSE") return EFFECT_PAUSED;
+	if (status == "recoverable_error") return EFFECT_RECOVERABLE_ERROR;
+	if (status == "error" || status == "FAILED") return EFFECT_ERROR;
+	if (status == "heating") return EFFECT_HEATING;
+	if (status == "cooling") return EFFECT_COOLING;
+	if (status == "finished" || status == "FINISH") return EFFECT_FINISHED;
+	if (status == "idle" || status == "IDLE") return EFFECT_IDLE;
+	return EFFECT_RAINBOW;
+}
+
+static StateEffect selectStateEffect() {
+	// Streamed frames replace the status effects until the stream times out
+	if (realtimeInputActive()) return EFFECT_REALTIME;
+	
+	if (status_effect == EFFECT_NONE || status_effect_version != printer_status_version ||
+		status_effect_connected != printer_state.is_connected) {
+		status_effect_version = printer_status_version;
+		status_effect_connected = printer_state.is_connected;
+		status_effect = effectForStatus();
+	}
+	return status_effect;
+}
+
+// Color/effect slot for a state effect (-1 if it has none)
+static int stateEffectSlot(StateEffect effect) {
+	switch (effect) {
+		case EFFECT_IDLE: return 0;
+		case EFFECT_PRINTING: return 1;
+		case EFFECT_DOWNLOAD: return 2;
+		case EFFECT_PAUSED: return 3;
+		case EFFECT_RECOVERABLE_ERROR:
+		case EFFECT_ERROR: return 4;
+		case EFFECT_HEATING: return 5;
+		case EFFECT_COOLING: return 6;
+		case EFFECT_FINISHED: return 7;
+		default: return -1;
+	}
+}
+
+static ProfileZone stateEffectProfileZone(StateEffect effect) {
+	switch (effect) {
+		case EFFECT_AUTO_OFF: return PROFILE_EFFECT_AUTO_OFF;
+		case EFFECT_DOWNLOAD: return PROFILE_EFFECT_DOWNLOAD;
+		case EFFECT_PRINTING: return PROFILE_EFFECT_PRINTING;
+		case EFFECT_PAUSED: return PROFILE_EFFECT_PAUSED;
+		case EFFECT_RECOVERABLE_ERROR: return PROFILE_EFFECT_RECOVERABLE_ERROR;
+		case EFFECT_ERROR: return PROFILE_EFFECT_ERROR;
+		case EFFECT_HEATING: return PROFILE_EFFECT_HEATING;
+		case EFFECT_COOLING: return PROFILE_EFFECT_COOLING;
+		case EFFECT_FINISHED: return PROFILE_EFFECT_FINISHED;
+		case EFFECT_IDLE: return PROFILE_EFFECT_IDLE;
+		case EFFECT_REALTIME: return PROFILE_EFFECT_REALTIME;
+		default: return PROFILE_EFFECT_RAINBOW;
+	}
+}
+
+// Draw one state effect into the canvas without presenting it
+static void renderStateEffect(StateEffect effect) {
+	strip.clear();
+	
+	// User effect assigned to this state replaces the built-in animation
+	if (renderAssignedEffect(stateEffectSlot(effect))) return;
+	
+	PROFILE_SCOPE(stateEffectProfileZone(effect));
+	switch (effect) {
+		case EFFECT_RAINBOW:
+			renderRainbow(strip.getPixels(), min(settings.led_count, (int)strip.numPixels()), rainbow_offset);
+			break;
+		case EFFECT_AUTO_OFF: showAutoOffState(); break;
+		case EFFECT_DOWNLOAD: showDownloadProgress(); break;
+		case EFFECT_PRINTING:
+			if (settings.print_mode == PRINT_MODE_LAYERS) showLayerProgress();
+			else showPrintingProgress();
+			break;
+		case EFFECT_PAUSED: showPausedState(); break;
+		case EFFECT_RECOVERABLE_ERROR: showRecoverableErrorState(); break;
+		case EFFECT_ERROR: showErrorState(); break;
+		case EFFECT_HEATING: showHeatingState(); break;
+		case EFFECT_COOLING: showCoolingState(); break;
+		case EFFECT_FINISHED: showFinishedState(); break;
+		case EFFECT_IDLE: showIdleState(); break;
+		case EFFECT_REALTIME:
+			realtimeCopyFrame(strip.getPixels(), min(settings.led_count, (int)strip.numPixels()));
+			break;
+		default: break;
+	}
 }
 
 void updateLEDDisplay() {
 	if (lights_turning_on || lights_turning_off) {
+		// The lights animation blends on its own; start the next state fresh
+		current_effect = EFFECT_NONE;
+		transitionCancel();
 		showLightsAnimation();
 		return;
 	}
 	
 	if (settings.lights_off_override) {
+		current_effect = EFFECT_NONE;
 		strip.clear();
-		strip.show();
+		presentFrame();
 		return;
 	}
 	
-	if (!printer_state.is_connected) {
-		rainbowAnimation();
-		return;
+	StateEffect effect = selectStateEffect();
+	
+	if (effect == EFFECT_REALTIME) {
+		// Present each streamed frame as soon as it arrives
+		if (!realtimeFramePending() && current_effect == EFFECT_REALTIME && !transitionActive())
+			return;
+	} else if (effect == EFFECT_RAINBOW) {
+		if (animationMillis() - last_rainbow < RAINBOW_INTERVAL)
+			return;
+		last_rainbow = animationMillis();
+	} else {
+		if (animationMillis() - last_update < ANIMATION_INTERVAL)
+			return;
+		last_update = animationMillis();
 	}
 	
-	if (printer_state.status == "unknown" || printer_state.status.length() == 0) {
-		rainbowAnimation();
-		return;
+	if (effect != current_effect) {
+		if (current_effect != EFFECT_NONE) {
+			outgoing_effect = current_effect;
+			transitionStart(settings.transition_mode, settings.transition_ms);
+		}
+		current_effect = effect;
 	}
 	
-	if (millis() - last_update < ANIMATION_INTERVAL)
-		return;
-	last_update = millis();
+	uint8_t* canvas = strip.getPixels();
+	if (canvas == nullptr) return;
+	int count = min(settings.led_count, (int)strip.numPixels());
 	
-	strip.clear();
+	bool transitioning = transitionActive();
+	if (transitioning) {
+		renderStateEffect(outgoing_effect);
+		transitionCaptureOutgoing(canvas, count);
+	}
+	renderStateEffect(effect);
+	transitionApply(canvas, count);
 	
-	if (printer_state.status == "auto_off") {
-		showAutoOffState();
-	} else if (printer_state.status == "downloading") {
-		showDownloadProgress();
-	} else if (printer_state.status == "printing" || printer_state.status == "RUNNING") {
-		showPrintingProgress();
-	} else if (printer_state.status == "paused" || printer_state.status == "PAUSE") {
-		showPausedState();
-	} else if (printer_state.status == "recoverable_error") {
-		showRecoverableErrorState();
-	} else if (printer_state.status == "error" || printer_state.status == "FAILED") {
-		showErrorState();
-	} else if (printer_state.status == "heating") {
-		showHeatingState();
-	} else if (printer_state.status == "cooling") {
-		showCoolingState();
-	} else if (printer_state.status == "finished" || printer_state.status == "FINISH") {
-		showFinishedState();
-	} else if (printer_state.status == "idle" || printer_state.status == "IDLE") {
-		showIdleState();
-	} else {
-		rainbowAnimation();
-		return;
+	presentFrame();
+	
+	if (effect == EFFECT_RAINBOW || (transitioning && outgoing_effect == EFFECT_RAINBOW)) {
+		advanceRainbow();
 	}
+}
+
+// Render the effect for the current state into a packed RGB buffer without
+// presenting it or advancing the rainbow. Returns the number of pixels written.
+int renderStateFrame(uint8_t* rgb, int count) {
+	uint8_t* canvas = strip.getPixels();
+	if (canvas == nullptr || rgb == nullptr) return 0;
+	count = min(count, min(settings.led_count, (int)strip.numPixels()));
 	
-	strip.show();
+	renderStateEffect(selectStateEffect());
+	memcpy(rgb, canvas, count * 3);
+	return count;
 }
@@ -3,6 +3,7 @@
 
 #include <Adafruit_NeoPixel.h>
 #include <Arduino.h>
+#include "../config/Settings.h"
 
 // Hardware definitions
 #define LED_PIN 17
@@ -16,6 +17,13 @@ extern const unsigned long LIGHTS_ANIMATION_DURATION;
 // LED strip object
 extern Adafruit_NeoPixel strip;
 
+// Animation time source (defaults to millis())
+typedef unsigned long (*AnimationClock)();
+
+// Bumped whenever the clock source changes; phases and progress glides
+// from an older epoch restart instead of stepping across the two clocks
+extern uint32_t animation_epoch;
+
 // Animation state
 extern unsigned long last_update;
 extern unsigned long last_rainbow;
@@ -32,7 +40,7 @@ extern unsigned long lights_animation_start;
 extern int lights_animation_progress;
 
 // Frame buffer for lights animation
-extern uint32_t* saved_frame_buffer;
+extern uint8_t* saved_frame_buffer;
 extern String saved_animation_state;
 extern int saved_progress;
 extern unsigned long saved_animation_time;
@@ -41,14 +49,22 @@ extern int saved_rainbow_offset;
 extern unsigned long saved_rainbow_time;
 extern bool rainbow_paused;
 
+// Last live reconfiguration latency (microseconds)
+extern unsigned long last_reconfigure_us;
+
 // LED functions
-void reinitializeLEDStrip();
+void setAnimationClock(AnimationClock clock);
+unsigned long animationMillis();
+int renderStateFrame(uint8_t* rgb, int count);
+LEDStripSettings currentStripSettings();
+bool reinitializeLEDStrip(const LEDStripSettings& config);
 void reinitializeStripPin(int pin);
 uint32_t getStateColor(int stateIndex);
 void startupAnimation();
 void updateLEDDisplay();
 void showDownloadProgress();
 void showPrintingProgress();
+void showLayerProgress();
 void showPausedState();
 void showErrorState();
 void showRecoverableErrorState();
@@ -57,13 +73,13 @@ void showCoolingState();
 void showFinishedState();
 void showIdleState();
 void showAutoOffState();
-void rainbowAnimation();
+void advanceRainbow();
+void renderRainbow(uint8_t* rgb, int count, int offset);
 uint32_t wheel(byte wheelPos);
 void captureCurrentFrame();
 void restoreSavedFrame();
 bool shouldResumeAnimation();
-void generateRainbowFrame(uint32_t* frameBuffer, int offset);
-void generateCurrentAnimationFrame(uint32_t* frameBuffer);
+void generateCurrentAnimationFrame(uint8_t* rgb);
 void showLightsAnimation();
 
 #endif
@@ -0,0 +1,207 @@
+#include "LEDCommands.h"
+#include "LEDAnimations.h"
+#include "FrameScheduler.h"
+#include <freertos/queue.h>
+
+LEDCommandStats led_command_stats;
+
+static QueueHandle_t command_queue = NULL;
+
+// Held by a producer while it queues a batch and by the LED task while it
+// drains, so a batch is never split across frames
+static SemaphoreHandle_t submitMutex = NULL;
+
+// Batches are numbered so a producer can wait until its own batch is applied
+static volatile uint32_t submitted_sequence = 0;
+static volatile uint32_t applied_sequence = 0;
+
+bool LEDCommandBatch::add(LEDCommandType type, int32_t value, uint8_t index) {
+	if (count >= LED_COMMAND_BATCH_MAX) return false;
+	LEDCommand& command = commands[count++];
+	command.type = type;
+	command.index = index;
+	command.r = command.g = command.b = 0;
+	command.value = value;
+	command.palette = StatePalette();
+	command.batch = 0;
+	return true;
+}
+
+bool LEDCommandBatch::addColor(uint8_t index, uint8_t r, uint8_t g, uint8_t b) {
+	if (!add(LED_CMD_COLOR, 0, index)) return false;
+	LEDCommand& command = commands[count - 1];
+	command.r = r;
+	command.g = g;
+	command.b = b;
+	return true;
+}
+
+bool LEDCommandBatch::addPalette(uint8_t index, const StatePalette& palette) {
+	if (!add(LED_CMD_PALETTE, 0, index)) return false;
+	commands[count - 1].palette = palette;
+	return true;
+}
+
+void ledCommandsBegin() {
+	if (command_queue == NULL) command_queue = xQueueCreate(LED_COMMAND_QUEUE_LENGTH, sizeof(LEDCommand));
+	if (submitMutex == NULL) submitMutex = xSemaphoreCreateMutex();
+}
+
+// Lights on/off starts the same animation the toggle always used
+static void applyLights(bool enabled) {
+	if (enabled && settings.lights_off_override) {
+		lights_turning_on = true;
+		lights_turning_off = false;
+		lights_animation_start = animationMillis();
+		lights_animation_progress = 0;
+		Serial.println(" Starting lights ON animation (middle to ends)");
+	} else if (!enabled && !settings.lights_off_override) {
+		captureCurrentFrame();
+		lights_turning_off = true;
+		lights_turning_on = false;
+		lights_animation_start = animationMillis();
+		lights_animation_progress = 0;
+		Serial.println(" Starting lights OFF animation (ends to middle)");
+	}
+}
+
+static void applyCommand(const LEDCommand& command) {
+	switch (command.type) {
+		case LED_CMD_COLOR:
+			if (command.index < 8) {
+				settings.colors[command.index].r = command.r;
+				settings.colors[command.index].g = command.g;
+				settings.colors[command.index].b = command.b;
+			}
+			break;
+		case LED_CMD_PALETTE:
+			if (command.index < 8) settings.palettes[command.index] = command.palette;
+			break;
+		case LED_CMD_BRIGHTNESS:
+			settings.global_brightness = constrain(command.value, 1, 255);
+			break;
+		case LED_CMD_NIGHT_BRIGHTNESS:
+			settings.night_mode_brightness = constrain(command.value, 1, 255);
+			break;
+		case LED_CMD_NIGHT_MODE:
+			settings.night_mode_enabled = command.value != 0;
+			break;
+		case LED_CMD_DIRECTION:
+			switch (command.index) {
+				case LED_DIRECTION_RAINBOW: settings.rainbow_direction = command.value; break;
+				case LED_DIRECTION_IDLE: settings.idle_direction = command.value; break;
+				case LED_DIRECTION_PRINTING: settings.printing_direction = command.value; break;
+				case LED_DIRECTION_DOWNLOAD: settings.download_direction = command.value; break;
+			}
+			break;
+		case LED_CMD_PRINT_MODE:
+			settings.print_mode = constrain(command.value, 0, 1);
+			break;
+		case LED_CMD_TRANSITION_MODE:
+			settings.transition_mode = constrain(command.value, 0, 2);
+			break;
+		case LED_CMD_TRANSITION_MS:
+			settings.transition_ms = constrain(command.value, 0, 5000);
+			break;
+		case LED_CMD_POWER_LIMIT:
+			settings.power_limit_ma = constrain(command.value, 0, 100000);
+			break;
+		case LED_CMD_CHANNEL_MA:
+			settings.led_channel_ma = constrain(command.value, 1, 100);
+			break;
+		case LED_CMD_LIGHTS:
+			applyLights(command.value != 0);
+			break;
+		case LED_CMD_EFFECT_SLOT:
+			if (command.index < 8) settings.effect_slots[command.index] = max((int)command.value, -1);
+			break;
+	}
+}
+
+// Remove a batch that is still queued, keeping the order of the others.
+// Caller holds submitMutex, so the LED task cannot be draining.
+static void withdrawBatch(uint32_t sequence) {
+	LEDCommand command;
+	UBaseType_t waiting = uxQueueMessagesWaiting(command_queue);
+	for (UBaseType_t i = 0; i < waiting; i++) {
+		if (xQueueReceive(command_queue, &command, 0) != pdTRUE) break;
+		if (command.batch != sequence) xQueueSendToBack(command_queue, &command, 0);
+	}
+}
+
+// Queue a batch and wait until the LED task has applied it, so the caller
+// can save settings and answer with the new values. Returns false if the
+// queue had no room, or if the LED task did not apply the batch in time;
+// the batch is then withdrawn and nothing of it is applied.
+bool submitLEDCommands(const LEDCommandBatch& batch) {
+	if (batch.count == 0) return true;
+	if (command_queue == NULL || submitMutex == NULL) return false;
+
+	// The LED task drains every frame; give it a few frames to make room
+	uint32_t sequence = 0;
+	for (int attempt = 0; attempt < 10 && sequence == 0; attempt++) {
+		xSemaphoreTake(submitMutex, portMAX_DELAY);
+		if (uxQueueSpacesAvailable(command_queue) >= (UBaseType_t)batch.count) {
+			sequence = ++submitted_sequence;
+			for (int i = 0; i < batch.count; i++) {
+				LEDCommand command = batch.commands[i];
+				command.batch = sequence;
+				xQueueSendToBack(command_queue, &command, 0);
+			}
+		}
+		xSemaphoreGive(submitMutex);
+		if (sequence == 0) vTaskDelay(frameSchedulerPeriodTicks());
+	}
+	if (sequence == 0) {
+		led_command_stats.submit_failures++;
+		Serial.println(" LED command queue full - change dropped");
+		return false;
+	}
+
+	unsigned long start = millis();
+	while ((int32_t)(applied_sequence - sequence) < 0) {
+		if (millis() - start >= LED_COMMAND_APPLY_TIMEOUT_MS) break;
+		vTaskDelay(1);
+	}
+	if ((int32_t)(applied_sequence - sequence) >= 0) return true;
+
+	// Applied between the last check and now, or still queued and withdrawn
+	xSemaphoreTake(submitMutex, portMAX_DELAY);
+	bool applied = (int32_t)(applied_sequence - sequence) >= 0;
+	if (!applied) {
+		withdrawBatch(sequence);
+		led_command_stats.apply_timeouts++;
+		Serial.println(" LED task did not apply the change in time - withdrawn");
+	}
+	xSemaphoreGive(submitMutex);
+	return applied;
+}
+
+// Apply everything pending. Runs on the LED task at the start of a frame,
+// with printerStateMutex held.
+void applyLEDCommands() {
+	if (command_queue == NULL || uxQueueMessagesWaiting(command_queue) == 0) return;
+
+	// A producer is mid-batch; pick the whole batch up next frame
+	if (xSemaphoreTake(submitMutex, 0) != pdTRUE) return;
+
+	LEDCommand command;
+	uint32_t applied = 0;
+	uint32_t lastBatch = 0;
+	while (xQueueReceive(command_queue, &command, 0) == pdTRUE) {
+		applyCommand(command);
+		applied++;
+		if (command.batch != lastBatch) {
+			led_command_stats.batches_applied++;
+			lastBatch = command.batch;
+		}
+	}
+	applied_sequence = submitted_sequence;
+	xSemaphoreGive(submitMutex);
+
+	led_command_stats.commands_applied += applied;
+	led_command_stats.frames_with_commands++;
+	if (applied > led_command_stats.max_commands_per_frame) {
+		led_command_stats.max_commands_per_frame = applied;
+	}
+}
@@ -0,0 +1,78 @@
+#ifndef LED_COMMANDS_H
+#define LED_COMMANDS_H
+
+#include <Arduino.h>
+#include "../config/Settings.h"
+
+// Command bus for changes that the LED task reads while rendering. Web
+// handlers and remote commands do not write those settings or the lights
+// animation state directly. They queue typed commands, and the LED task
+// applies every pending command at the start of a frame, so a frame never
+// sees half of an update. A batch is queued under one lock and is always
+// applied as a whole.
+#define LED_COMMAND_QUEUE_LENGTH 32
+#define LED_COMMAND_BATCH_MAX 24
+
+// How long a producer waits for its batch to be applied. A batch still
+// queued after this is withdrawn, so it is either applied or not at all.
+#define LED_COMMAND_APPLY_TIMEOUT_MS 500
+
+enum LEDCommandType : uint8_t {
+  LED_CMD_COLOR,             // index = state, r/g/b
+  LED_CMD_PALETTE,           // index = state, palette (no stops = default)
+  LED_CMD_BRIGHTNESS,        // value 1-255
+  LED_CMD_NIGHT_BRIGHTNESS,  // value 1-255
+  LED_CMD_NIGHT_MODE,        // value 0/1
+  LED_CMD_DIRECTION,         // index = LEDDirection, value 1/-1
+  LED_CMD_PRINT_MODE,        // value = PrintMode
+  LED_CMD_TRANSITION_MODE,   // value 0-2
+  LED_CMD_TRANSITION_MS,     // value 0-5000
+  LED_CMD_POWER_LIMIT,       // value mA, 0 = unlimited
+  LED_CMD_CHANNEL_MA,        // value mA per fully lit channel
+  LED_CMD_LIGHTS,            // value 0/1, starts the lights on/off animation
+  LED_CMD_EFFECT_SLOT        // index = state, value = effect id, -1 = built-in
+};
+
+enum LEDDirection {
+  LED_DIRECTION_RAINBOW = 0,
+  LED_DIRECTION_IDLE = 1,
+  LED_DIRECTION_PRINTING = 2,
+  LED_DIRECTION_DOWNLOAD = 3
+};
+
+struct LEDCommand {
+  LEDCommandType type;
+  uint8_t index;
+  uint8_t r, g, b;
+  int32_t value;
+  StatePalette palette;
+  uint32_t batch;            // Set on submit; identifies the batch in the queue
+};
+
+// Commands collected by one handler, submitted together
+struct LEDCommandBatch {
+  LEDCommand commands[LED_COMMAND_BATCH_MAX];
+  int count = 0;
+
+  bool add(LEDCommandType type, int32_t value, uint8_t index = 0);
+  bool addColor(uint8_t index, uint8_t r, uint8_t g, uint8_t b);
+  bool addPalette(uint8_t index, const StatePalette& palette);
+};
+
+struct LEDCommandStats {
+  uint32_t commands_applied = 0;
+  uint32_t batches_applied = 0;
+  uint32_t frames_with_commands = 0;
+  uint32_t max_commands_per_frame = 0;
+  uint32_t submit_failures = 0;      // Queue stayed full
+  uint32_t apply_timeouts = 0;       // Batch withdrawn, the LED task did not get to it
+};
+
+extern LEDCommandStats led_command_stats;
+
+// Command bus functions
+void ledCommandsBegin();
+bool submitLEDCommands(const LEDCommandBatch& batch);
+void applyLEDCommands();
+
+#endif
@@ -0,0 +1,144 @@
+#include "LEDCompositor.h"
+#include "LEDAnimations.h"
+
+// A layer is a span of ARGB pixels covering [start, start + length)
+struct LEDLayer {
+	uint32_t* span;
+	int start;
+	int length;
+	LayerBlendMode blend;
+	uint8_t opacity;
+};
+
+static LEDLayer layers[MAX_LED_LAYERS];
+static int layer_count = 0;
+static int composite_count = 0;
+
+// Layer spans are carved out of one arena per frame, so adding a layer never
+// allocates once the arena has grown to the strip length
+static uint32_t* layer_arena = nullptr;
+static int arena_capacity = 0;
+static int arena_used = 0;
+
+static inline uint8_t scaleChannel(uint8_t value, uint8_t amount) {
+	return (value * (amount + 1)) >> 8;
+}
+
+static inline uint8_t lerpChannel(uint8_t from, uint8_t to, uint8_t amount) {
+	return (to * (amount + 1) + from * (255 - amount)) >> 8;
+}
+
+// Start a new frame covering ledCount pixels. Drops all layers.
+void compositorBegin(int ledCount) {
+	int needed = ledCount * LAYER_ARENA_STRIPS;
+	if (needed > arena_capacity) {
+		free(layer_arena);
+		layer_arena = (uint32_t*)malloc(needed * sizeof(uint32_t));
+		arena_capacity = (layer_arena != nullptr) ? needed : 0;
+		if (layer_arena == nullptr) {
+			Serial.println(" Failed to allocate compositor layer arena");
+		}
+	}
+
+	composite_count = ledCount;
+	layer_count = 0;
+	arena_used = 0;
+}
+
+// Add a layer on top of the stack and return its span for the caller to fill.
+// The span is clipped to the strip; returns nullptr if nothing is left to draw
+// or the layer/arena limit is reached.
+uint32_t* compositorAddLayer(int start, int length, LayerBlendMode blend, uint8_t opacity) {
+	if (start < 0) {
+		length += start;
+		start = 0;
+	}
+	if (start + length > composite_count) {
+		length = composite_count - start;
+	}
+	if (length <= 0 || layer_count >= MAX_LED_LAYERS || arena_used + length > arena_capacity) {
+		return nullptr;
+	}
+
+	LEDLayer& layer = layers[layer_count++];
+	layer.span = layer_arena + arena_used;
+	layer.start = start;
+	layer.length = length;
+	layer.blend = blend;
+	layer.opacity = opacity;
+	arena_used += length;
+
+	memset(layer.span, 0, length * sizeof(uint32_t));
+	return layer.span;
+}
+
+uint32_t* compositorAddFill(int start, int length, uint32_t rgb, LayerBlendMode blend, uint8_t opacity) {
+	uint32_t* span = compositorAddLayer(start, length, blend, opacity);
+	if (span == nullptr) return nullptr;
+
+	int clipped = layers[layer_count - 1].length;
+	uint32_t color = layerColor(rgb);
+	for (int i = 0; i < clipped; i++) {
+		span[i] = color;
+	}
+	return span;
+}
+
+// Composite every layer into the canvas in one pass over the pixels.
+// Pixels not covered by any layer come out black.
+void compositorRender() {
+	uint8_t* out = strip.getPixels();
+	if (out == nullptr) return;
+
+	int count = min(composite_count, (int)strip.numPixels());
+
+	for (int i = 0; i < count; i++) {
+		uint8_t r = 0, g = 0, b = 0;
+
+		for (int l = 0; l < layer_count; l++) {
+			const LEDLayer& layer = layers[l];
+			unsigned int offset = i - layer.start;
+			if (offset >= (unsigned int)layer.length) continue;
+
+			uint32_t src = layer.span[offset];
+			uint8_t alpha = scaleChannel(src >> 24, layer.opacity);
+			if (alpha == 0) continue;
+
+			uint8_t sr = (src >> 16) & 0xFF;
+			uint8_t sg = (src >> 8) & 0xFF;
+			uint8_t sb = src & 0xFF;
+
+			switch (layer.blend) {
+				case BLEND_ALPHA:
+					r = lerpChannel(r, sr, alpha);
+					g = lerpChannel(g, sg, alpha);
+					b = lerpChannel(b, sb, alpha);
+					break;
+				case BLEND_ADD:
+					r = min(255, r + scaleChannel(sr, alpha));
+					g = min(255, g + scaleChannel(sg, alpha));
+					b = min(255, b + scaleChannel(sb, alpha));
+					break;
+				case BLEND_MAX:
+					r = max(r, scaleChannel(sr, alpha));
+					g = max(g, scaleChannel(sg, alpha));
+					b = max(b, scaleChannel(sb, alpha));
+					break;
+				case BLEND_MULTIPLY:
+					r = lerpChannel(r, (r * sr) / 255, alpha);
+					g = lerpChannel(g, (g * sg) / 255, alpha);
+					b = lerpChannel(b, (b * sb) / 255, alpha);
+					break;
+			}
+		}
+
+		// The canvas strip is NEO_RGB, so raw pixels are packed RGB
+		out[i * 3] = r;
+		out[i * 3 + 1] = g;
+		out[i * 3 + 2] = b;
+	}
+}
+
+int compositorLayerCount() {
+	return layer_count;
+}
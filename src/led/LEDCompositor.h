@@ -0,0 +1,32 @@
+#ifndef LED_COMPOSITOR_H
+#define LED_COMPOSITOR_H
+
+#include <Arduino.h>
+
+// Maximum layers per frame
+#define MAX_LED_LAYERS 8
+
+// Layer spans share one arena sized to this many full-strip layers
+#define LAYER_ARENA_STRIPS 4
+
+// How a layer combines with the layers below it
+enum LayerBlendMode {
+  BLEND_ALPHA,     // Cover by source alpha (alpha 255 replaces)
+  BLEND_ADD,       // Saturating add
+  BLEND_MAX,       // Per-channel maximum
+  BLEND_MULTIPLY   // Darken by source color
+};
+
+// Layer pixels are ARGB: alpha in the top byte, RGB as strip.Color()
+inline uint32_t layerColor(uint32_t rgb, uint8_t alpha = 255) {
+  return ((uint32_t)alpha << 24) | (rgb & 0xFFFFFF);
+}
+
+// Compositor functions
+void compositorBegin(int ledCount);
+uint32_t* compositorAddLayer(int start, int length, LayerBlendMode blend, uint8_t opacity = 255);
+uint32_t* compositorAddFill(int start, int length, uint32_t rgb, LayerBlendMode blend, uint8_t opacity = 255);
+void compositorRender();
+int compositorLayerCount();
+
+#endif
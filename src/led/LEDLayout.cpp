@@ -0,0 +1,343 @@
+#include "LEDLayout.h"
+#include <SPIFFS.h>
+
+// Layout tables, rebuilt by layoutBegin() when the layout or LED count changes
+static LayoutCoord* layout_coords = nullptr;  // Per canvas pixel
+static uint16_t* layout_remap = nullptr;      // Wiring index -> canvas index, nullptr = identity
+static int layout_count = 0;
+
+// Custom map: x, y pairs (0-255) in wiring order, stored in /layout.bin
+static uint8_t* custom_map = nullptr;
+static int custom_map_count = 0;
+
+static uint8_t normalizedPosition(int value, int span) {
+	return (span > 1) ? value * 255 / (span - 1) : 0;
+}
+
+// Polar coordinates from x, y. Angle 0 is at the top (y = 0) and runs
+// clockwise; radius is scaled so the farthest pixel from the center is 255.
+static void buildPolar(int count) {
+	float maxDistance = 0;
+	for (int i = 0; i < count; i++) {
+		float dx = layout_coords[i].x - 127.5f;
+		float dy = layout_coords[i].y - 127.5f;
+		maxDistance = max(maxDistance, sqrtf(dx * dx + dy * dy));
+	}
+
+	for (int i = 0; i < count; i++) {
+		LayoutCoord& coord = layout_coords[i];
+		float dx = coord.x - 127.5f;
+		float dy = coord.y - 127.5f;
+		float turns = atan2f(dx, -dy) / (2 * PI);
+		coord.angle = (uint8_t)((int)lroundf(turns * 256) & 0xFF);
+		coord.radius = (maxDistance > 0) ? (uint8_t)lroundf(sqrtf(dx * dx + dy * dy) * 255 / maxDistance) : 0;
+	}
+}
+
+// Linear strips are treated as one ring for the polar coordinates
+static void buildLinear(int count) {
+	for (int i = 0; i < count; i++) {
+		layout_coords[i].x = normalizedPosition(i, count);
+		layout_coords[i].y = 0;
+		layout_coords[i].angle = i * 256 / count;
+		layout_coords[i].radius = 255;
+	}
+}
+
+// Canvas is row-major from the top left; serpentine wiring reverses odd rows
+static void buildMatrix(int count) {
+	int width = settings.layout.width;
+	int height = settings.layout.height;
+
+	for (int i = 0; i < count; i++) {
+		int row = i / width;
+		int column = i % width;
+		layout_coords[i].x = normalizedPosition(column, width);
+		layout_coords[i].y = normalizedPosition(min(row, height - 1), height);
+
+		if (settings.layout.serpentine && (row & 1) && row < height) {
+			int source = row * width + (width - 1 - column);
+			if (source < count) layout_remap[i] = source;
+		}
+	}
+	buildPolar(count);
+}
+
+// Concentric rings, outermost first, each wired from the top
+static void buildRings(int count) {
+	int ringCount = constrain(settings.layout.ring_count, 1, MAX_LAYOUT_RINGS);
+	int base = 0;
+
+	for (int ring = 0; ring < ringCount && base < count; ring++) {
+		int size = min(settings.layout.ring_sizes[ring], count - base);
+		if (size <= 0) continue;
+
+		float radius = (ringCount > 1) ? 1.0f - (float)ring / ringCount : 1.0f;
+		for (int q = 0; q < size; q++) {
+			LayoutCoord& coord = layout_coords[base + q];
+			float turns = (float)q / size;
+			coord.angle = q * 256 / size;
+			coord.radius = (uint8_t)lroundf(radius * 255);
+			coord.x = (uint8_t)lroundf(127.5f + sinf(turns * 2 * PI) * 127.5f * radius);
+			coord.y = (uint8_t)lroundf(127.5f - cosf(turns * 2 * PI) * 127.5f * radius);
+
+			// Reversed rings keep pixel 0 at the top and run the other way
+			if (settings.layout.reverse && q > 0) layout_remap[base + q] = base + size - q;
+		}
+		base += size;
+	}
+
+	// LEDs past the last ring continue the outer ring's angle sweep
+	for (int i = base; i < count; i++) {
+		layout_coords[i].x = normalizedPosition(i, count);
+		layout_coords[i].y = 0;
+		layout_coords[i].angle = i * 256 / count;
+		layout_coords[i].radius = 255;
+	}
+}
+
+static void buildCustom(int count) {
+	for (int i = 0; i < count; i++) {
+		if (i < custom_map_count) {
+			layout_coords[i].x = custom_map[i * 2];
+			layout_coords[i].y = custom_map[i * 2 + 1];
+		} else {
+			layout_coords[i].x = normalizedPosition(i, count);
+			layout_coords[i].y = 0;
+		}
+	}
+	buildPolar(count);
+}
+
+// Rebuild the coordinate and remap tables for settings.layout. Must not run
+// while the LED task renders (callers hold printerStateMutex or run before
+// the task starts).
+bool layoutBegin(int ledCount) {
+	free(layout_coords);
+	free(layout_remap);
+	layout_coords = nullptr;
+	layout_remap = nullptr;
+	layout_count = 0;
+
+	if (ledCount <= 0) return false;
+
+	layout_coords = (LayoutCoord*)calloc(ledCount, sizeof(LayoutCoord));
+	layout_remap = (uint16_t*)malloc(ledCount * sizeof(uint16_t));
+	if (layout_coords == nullptr || layout_remap == nullptr) {
+		free(layout_coords);
+		free(layout_remap);
+		layout_coords = nullptr;
+		layout_remap = nullptr;
+		Serial.println(" Failed to allocate LED layout tables");
+		return false;
+	}
+
+	for (int i = 0; i < ledCount; i++) layout_remap[i] = i;
+
+	switch (settings.layout.type) {
+		case LAYOUT_MATRIX:
+			if (settings.layout.width > 0 && settings.layout.height > 0) buildMatrix(ledCount);
+			else buildLinear(ledCount);
+			break;
+		case LAYOUT_RING: buildRings(ledCount); break;
+		case LAYOUT_CUSTOM: buildCustom(ledCount); break;
+		default: buildLinear(ledCount); break;
+	}
+	layout_count = ledCount;
+
+	// Layouts wired in canvas order skip the gather entirely
+	bool identity = true;
+	for (int i = 0; i < ledCount && identity; i++) {
+		identity = (layout_remap[i] == i);
+	}
+	if (identity) {
+		free(layout_remap);
+		layout_remap = nullptr;
+	}
+
+	Serial.printf(" LED layout %d built for %d LEDs%s\n", settings.layout.type, ledCount,
+				  identity ? "" : " (remapped)");
+	return true;
+}
+
+const LayoutCoord* layoutCoords() {
+	return layout_coords;
+}
+
+bool layoutIsIdentity() {
+	return layout_remap == nullptr;
+}
+
+// Gather the canvas (layout order) into dst (wiring order)
+void layoutRemap(uint8_t* dst, const uint8_t* canvas, int count) {
+	if (layout_remap == nullptr) {
+		memcpy(dst, canvas, count * 3);
+		return;
+	}
+
+	int mapped = min(count, layout_count);
+	for (int i = 0; i < mapped; i++) {
+		int source = layout_remap[i];
+		if (source >= count) source = i;
+		const uint8_t* pixel = canvas + source * 3;
+		dst[i * 3] = pixel[0];
+		dst[i * 3 + 1] = pixel[1];
+		dst[i * 3 + 2] = pixel[2];
+	}
+	if (count > mapped) {
+		memcpy(dst + mapped * 3, canvas + mapped * 3, (count - mapped) * 3);
+	}
+}
+
+// Custom map functions
+
+int getLayoutMapCount() {
+	return custom_map_count;
+}
+
+const uint8_t* getLayoutMap() {
+	return custom_map;
+}
+
+// Replace the custom map (count x, y pairs). Takes effect on the next layoutBegin().
+bool setLayoutMap(const uint8_t* xy, int count) {
+	uint8_t* map = nullptr;
+	if (count > 0) {
+		map = (uint8_t*)malloc(count * 2);
+		if (map == nullptr) return false;
+		memcpy(map, xy, count * 2);
+	}
+
+	free(custom_map);
+	custom_map = map;
+	custom_map_count = count;
+	return true;
+}
+
+// Custom map JSON scanning. A 2000-LED map is ~20 KB of text and would
+// need ~100 KB as a JSON document, so the pairs are read straight from the
+// body into 2 bytes per LED instead.
+
+struct JsonScan {
+	const char* p;
+	const char* end;
+};
+
+static void skipSpace(JsonScan& scan) {
+	while (scan.p < scan.end && isspace((unsigned char)*scan.p)) scan.p++;
+}
+
+static bool scanChar(JsonScan& scan, char c) {
+	skipSpace(scan);
+	if (scan.p >= scan.end || *scan.p != c) return false;
+	scan.p++;
+	return true;
+}
+
+// Integer part of a JSON number; any fraction or exponent is dropped
+static bool scanInt(JsonScan& scan, int& value) {
+	skipSpace(scan);
+	bool negative = (scan.p < scan.end && *scan.p == '-');
+	if (negative) scan.p++;
+	if (scan.p >= scan.end || !isdigit((unsigned char)*scan.p)) return false;
+
+	value = 0;
+	while (scan.p < scan.end && isdigit((unsigned char)*scan.p)) {
+		if (value < 100000) value = value * 10 + (*scan.p - '0');
+		scan.p++;
+	}
+	while (scan.p < scan.end && (isdigit((unsigned char)*scan.p) || strchr(".eE+-", *scan.p) != nullptr)) scan.p++;
+	if (negative) value = -value;
+	return true;
+}
+
+// Value of a key in the outermost object, skipping strings and nested values
+static const char* findTopLevelKey(const char* p, const char* end, const char* key) {
+	size_t keyLength = strlen(key);
+	int depth = 0;
+
+	while (p < end) {
+		char c = *p;
+		if (c == '"') {
+			const char* start = ++p;
+			while (p < end && *p != '"') p += (*p == '\\') ? 2 : 1;
+			if (p >= end) return nullptr;
+			size_t length = p - start;
+			p++;
+
+			JsonScan scan = {p, end};
+			if (depth == 1 && length == keyLength && memcmp(start, key, length) == 0 && scanChar(scan, ':')) {
+				return scan.p;
+			}
+			continue;
+		}
+		if (c == '{' || c == '[') depth++;
+		else if (c == '}' || c == ']') depth--;
+		p++;
+	}
+	return nullptr;
+}
+
+// Read "map": [[x, y], ...] into xy (values clamped to 0-255)
+LayoutMapParse parseLayoutMapJson(const char* json, size_t length, uint8_t* xy, int maxCount, int& count) {
+	count = 0;
+	const char* value = findTopLevelKey(json, json + length, "map");
+	if (value == nullptr) return LAYOUT_MAP_ABSENT;
+
+	JsonScan scan = {value, json + length};
+	if (!scanChar(scan, '[')) return LAYOUT_MAP_INVALID;
+	if (scanChar(scan, ']')) return LAYOUT_MAP_PARSED;
+
+	do {
+		int x, y;
+		if (!scanChar(scan, '[') || !scanInt(scan, x) || !scanChar(scan, ',') ||
+			!scanInt(scan, y) || !scanChar(scan, ']')) {
+			return LAYOUT_MAP_INVALID;
+		}
+		if (count >= maxCount) return LAYOUT_MAP_TOO_LARGE;
+		xy[count * 2] = constrain(x, 0, 255);
+		xy[count * 2 + 1] = constrain(y, 0, 255);
+		count++;
+	} while (scanChar(scan, ','));
+
+	return scanChar(scan, ']') ? LAYOUT_MAP_PARSED : LAYOUT_MAP_INVALID;
+}
+
+void saveLayoutMap() {
+	if (custom_map_count == 0) {
+		SPIFFS.remove("/layout.bin");
+		return;
+	}
+
+	File file = SPIFFS.open("/layout.bin", "w");
+	if (!file) {
+		Serial.println(" Failed to open layout map for writing");
+		return;
+	}
+
+	file.write(custom_map, custom_map_count * 2);
+	file.close();
+	Serial.printf(" Layout map saved (%d LEDs)\n", custom_map_count);
+}
+
+void loadLayoutMap() {
+	if (!SPIFFS.exists("/layout.bin")) return;
+
+	File file = SPIFFS.open("/layout.bin", "r");
+	if (!file) {
+		Serial.println(" Failed to open layout map");
+		return;
+	}
+
+	int count = min((int)file.size() / 2, MAX_LED_COUNT);
+	uint8_t* map = (count > 0) ? (uint8_t*)malloc(count * 2) : nullptr;
+	if (map != nullptr && file.read(map, count * 2) == (size_t)(count * 2)) {
+		free(custom_map);
+		custom_map = map;
+		custom_map_count = count;
+	} else {
+		free(map);
+		Serial.println(" Failed to read layout map");
+	}
+	file.close();
+}
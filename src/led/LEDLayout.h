@@ -0,0 +1,40 @@
+#ifndef LED_LAYOUT_H
+#define LED_LAYOUT_H
+
+#include <Arduino.h>
+#include "../config/Settings.h"
+
+// Physical layouts. Effects render into the canvas in layout order (row by
+// row for a matrix, ring by ring for rings); presentFrame() gathers the
+// canvas into wiring order through a precomputed remap table. Each canvas
+// pixel also has precomputed coordinates, so effects can work in layout
+// space without per-frame trigonometry.
+
+// Canvas pixel position, all normalized to 0-255
+struct LayoutCoord {
+  uint8_t x, y;      // Cartesian position (y = 0 for a linear strip)
+  uint8_t angle;     // Angle around the layout center, one turn = 256
+  uint8_t radius;    // Distance from the center, 255 = outermost
+};
+
+// Result of scanning a custom map out of a JSON body
+enum LayoutMapParse {
+  LAYOUT_MAP_ABSENT,     // No top-level "map" key
+  LAYOUT_MAP_PARSED,
+  LAYOUT_MAP_INVALID,    // Not an array of [x, y] pairs
+  LAYOUT_MAP_TOO_LARGE   // More pairs than the buffer holds
+};
+
+// Layout functions
+bool layoutBegin(int ledCount);
+const LayoutCoord* layoutCoords();
+void layoutRemap(uint8_t* dst, const uint8_t* canvas, int count);
+bool layoutIsIdentity();
+int getLayoutMapCount();
+const uint8_t* getLayoutMap();
+bool setLayoutMap(const uint8_t* xy, int count);
+LayoutMapParse parseLayoutMapJson(const char* json, size_t length, uint8_t* xy, int maxCount, int& count);
+void saveLayoutMap();
+void loadLayoutMap();
+
+#endif
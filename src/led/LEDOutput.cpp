@@ -0,0 +1,473 @@
+#include "LEDOutput.h"
+#include "FrameRecorder.h"
+#include "FrameScheduler.h"
+#include "LEDAnimations.h"
+#include "LEDLayout.h"
+#include "PixelKernels.h"
+#include "../diagnostics/Profiler.h"
+#include "../network/UDPOutput.h"
+
+#if LED_RMT_PARALLEL
+#include <driver/gpio.h>
+#include <driver/rmt.h>
+#endif
+
+// Output task runs on the LED core at a higher priority than the LED task so
+// a presented frame starts transmitting immediately. Drivers block on the RMT
+// peripheral while sending, which lets the LED task render the next frame.
+static const int LED_OUTPUT_TASK_PRIORITY = 3;
+static const int LED_OUTPUT_TASK_CORE = 1;
+
+static NeoPixelDriver neopixel_drivers[MAX_LED_CHANNELS];
+#if LED_RMT_PARALLEL
+static RMTDriver rmt_drivers[MAX_LED_CHANNELS] = {
+	RMTDriver(0), RMTDriver(1), RMTDriver(2), RMTDriver(3)
+};
+#endif
+
+// Per-channel driver selection. A driver set through setLEDChannelDriver()
+// overrides the default for that channel.
+static LEDOutputDriver* custom_drivers[MAX_LED_CHANNELS] = {nullptr};
+static LEDOutputDriver* channel_drivers[MAX_LED_CHANNELS] = {nullptr};
+static LEDChannelSettings output_channels[MAX_LED_CHANNELS];
+static int output_channel_count = 0;
+
+LEDOutputStats led_output_stats;
+TaskHandle_t LEDOutputTask = NULL;
+
+// Double buffer: the LED task fills the back buffer, the output task swaps it
+// to the front and transmits from there.
+static uint8_t* front_buffer = nullptr;
+static uint8_t* back_buffer = nullptr;
+static int output_count = 0;
+static bool frame_pending = false;
+static uint32_t pending_frame_number = 0;
+
+// bufferMutex guards the buffer pointers and is only held for copies/swaps.
+// driverMutex is held by the output task for the whole transmission.
+static SemaphoreHandle_t bufferMutex = NULL;
+static SemaphoreHandle_t driverMutex = NULL;
+static LEDFrameCallback frame_callback = nullptr;
+
+// Quiescent draw of a WS2812B with all channels off, in microamps
+static const uint32_t LED_IDLE_UA = 1000;
+
+// Limiter release: the scale climbs back 1/8 of the way per frame, so a
+// frame that drops under budget fades back up instead of jumping
+static const int POWER_RELEASE_SHIFT = 3;
+
+bool NeoPixelDriver::begin(int pin, int count) {
+	output.updateType(NEO_GRB + NEO_KHZ800);
+	output.updateLength(count);
+	output.setPin(pin);
+	output.begin();
+	output.show();
+	output_pin = pin;
+	return output.numPixels() == count;
+}
+
+void NeoPixelDriver::end() {
+	// Stop driving the data line and free the pixel buffer
+	if (output_pin >= 0) pinMode(output_pin, INPUT);
+	output.updateLength(0);
+	output_pin = -1;
+}
+
+void NeoPixelDriver::transmit(const uint8_t* rgb, int count) {
+	uint8_t* pixels = output.getPixels();
+	if (pixels == nullptr) return;
+
+	if (count > output.numPixels()) count = output.numPixels();
+
+	// Reorder RGB -> GRB for WS2812B
+	for (int i = 0; i < count; i++) {
+		pixels[i * 3] = rgb[i * 3 + 1];
+		pixels[i * 3 + 1] = rgb[i * 3];
+		pixels[i * 3 + 2] = rgb[i * 3 + 2];
+	}
+	output.show();
+}
+
+#if LED_RMT_PARALLEL
+// WS2812B bit timings at 40 MHz RMT clock (clk_div 2, 25 ns per tick)
+static const uint16_t WS2812_T0H_TICKS = 16;
+static const uint16_t WS2812_T0L_TICKS = 34;
+static const uint16_t WS2812_T1H_TICKS = 32;
+static const uint16_t WS2812_T1L_TICKS = 18;
+
+// Converts wire bytes to RMT items on demand from the RMT ISR
+static void IRAM_ATTR ws2812RMTTranslate(const void* src, rmt_item32_t* dest, size_t src_size,
+										 size_t wanted_num, size_t* translated_size, size_t* item_num) {
+	if (src == NULL || dest == NULL) {
+		*translated_size = 0;
+		*item_num = 0;
+		return;
+	}
+
+	rmt_item32_t bit0;
+	bit0.level0 = 1;
+	bit0.duration0 = WS2812_T0H_TICKS;
+	bit0.level1 = 0;
+	bit0.duration1 = WS2812_T0L_TICKS;
+	rmt_item32_t bit1;
+	bit1.level0 = 1;
+	bit1.duration0 = WS2812_T1H_TICKS;
+	bit1.level1 = 0;
+	bit1.duration1 = WS2812_T1L_TICKS;
+
+	const uint8_t* psrc = (const uint8_t*)src;
+	size_t size = 0;
+	size_t num = 0;
+	while (size < src_size && num + 8 <= wanted_num) {
+		uint8_t value = *psrc++;
+		for (int bit = 7; bit >= 0; bit--) {
+			dest->val = (value & (1 << bit)) ? bit1.val : bit0.val;
+			dest++;
+		}
+		num += 8;
+		size++;
+	}
+	*translated_size = size;
+	*item_num = num;
+}
+
+bool RMTDriver::begin(int pin, int count) {
+	end();
+
+	wire_buffer = (uint8_t*)calloc(count, 3);
+	wire_count = (wire_buffer != nullptr) ? count : 0;
+	if (wire_buffer == nullptr || pin < 0) return false;
+
+	rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pin, (rmt_channel_t)rmt_channel);
+	config.clk_div = 2;
+
+	if (rmt_config(&config) != ESP_OK ||
+		rmt_driver_install(config.channel, 0, 0) != ESP_OK) {
+		Serial.printf(" RMT channel %d init failed on GPIO %d\n", rmt_channel, pin);
+		return false;
+	}
+	rmt_translator_init(config.channel, ws2812RMTTranslate);
+	installed = true;
+	rmt_pin = pin;
+	return true;
+}
+
+void RMTDriver::end() {
+	waitDone();
+	if (installed) {
+		rmt_driver_uninstall((rmt_channel_t)rmt_channel);
+		installed = false;
+	}
+	// Detach the GPIO from the RMT peripheral so another channel can use it
+	if (rmt_pin >= 0) gpio_reset_pin((gpio_num_t)rmt_pin);
+	rmt_pin = -1;
+
+	free(wire_buffer);
+	wire_buffer = nullptr;
+	wire_count = 0;
+}
+
+void RMTDriver::transmit(const uint8_t* rgb, int count) {
+	if (!installed || wire_buffer == nullptr) return;
+
+	if (count > wire_count) count = wire_count;
+
+	// Reorder RGB -> GRB for WS2812B. The buffer must stay untouched until
+	// waitDone() because the translator reads it during transmission.
+	for (int i = 0; i < count; i++) {
+		wire_buffer[i * 3] = rgb[i * 3 + 1];
+		wire_buffer[i * 3 + 1] = rgb[i * 3];
+		wire_buffer[i * 3 + 2] = rgb[i * 3 + 2];
+	}
+	in_flight = (rmt_write_sample((rmt_channel_t)rmt_channel, wire_buffer, count * 3, false) == ESP_OK);
+}
+
+void RMTDriver::waitDone() {
+	if (!installed || !in_flight) return;
+	rmt_wait_tx_done((rmt_channel_t)rmt_channel, portMAX_DELAY);
+	in_flight = false;
+}
+#endif
+
+static LEDOutputDriver* defaultChannelDriver(int channel, int channelCount) {
+	if (custom_drivers[channel] != nullptr) return custom_drivers[channel];
+#if LED_RMT_PARALLEL
+	// A single strip keeps the NeoPixel path; several strips need concurrent RMT
+	if (channelCount > 1) return &rmt_drivers[channel];
+#endif
+	return &neopixel_drivers[channel];
+}
+
+static void beginChannels(const LEDChannelSettings* channels, int channelCount) {
+	int count = constrain(channelCount, 1, MAX_LED_CHANNELS);
+	LEDOutputDriver* selected[MAX_LED_CHANNELS] = {nullptr};
+	for (int i = 0; i < count; i++) {
+		selected[i] = defaultChannelDriver(i, count);
+	}
+
+	// Release drivers that drop out, including channels past the new count,
+	// so their RMT channels and pins are free before the new set starts
+	for (int i = 0; i < output_channel_count; i++) {
+		if (channel_drivers[i] != nullptr && channel_drivers[i] != selected[i]) {
+			channel_drivers[i]->end();
+		}
+		channel_drivers[i] = nullptr;
+	}
+
+	output_channel_count = count;
+	for (int i = 0; i < output_channel_count; i++) {
+		output_channels[i] = channels[i];
+		channel_drivers[i] = selected[i];
+		if (!channel_drivers[i]->begin(channels[i].pin, channels[i].count)) {
+			Serial.printf(" LED channel %d failed to start on GPIO %d\n", i, channels[i].pin);
+		}
+		Serial.printf(" LED channel %d: %s driver, GPIO %d, %d LEDs at offset %d\n",
+					  i, channel_drivers[i]->name(), channels[i].pin, channels[i].count, channels[i].offset);
+	}
+}
+
+static bool allocateOutputBuffers(int count) {
+	free(front_buffer);
+	free(back_buffer);
+	front_buffer = (uint8_t*)calloc(count, 3);
+	back_buffer = (uint8_t*)calloc(count, 3);
+
+	if (front_buffer == nullptr || back_buffer == nullptr) {
+		free(front_buffer);
+		free(back_buffer);
+		front_buffer = nullptr;
+		back_buffer = nullptr;
+		output_count = 0;
+		return false;
+	}
+
+	output_count = count;
+	frame_pending = false;
+	return true;
+}
+
+static void LEDOutputTaskCode(void * pvParameters) {
+	Serial.println(" LED Output Task started on Core 1");
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		PROFILE_TASK(PROFILE_TASK_LED_OUTPUT);
+
+		xSemaphoreTake(driverMutex, portMAX_DELAY);
+
+		uint32_t frameNumber = 0;
+		bool haveFrame = false;
+		bool dirty = true;
+
+		xSemaphoreTake(bufferMutex, portMAX_DELAY);
+		if (frame_pending) {
+			uint8_t* swap = front_buffer;
+			front_buffer = back_buffer;
+			back_buffer = swap;
+			frame_pending = false;
+			frameNumber = pending_frame_number;
+			haveFrame = true;
+			
+			// The back buffer now holds the previously transmitted frame; compare
+			// before the LED task can overwrite it
+			if (udpOutputActive() && front_buffer != nullptr && back_buffer != nullptr) {
+				dirty = memcmp(front_buffer, back_buffer, output_count * 3) != 0;
+			}
+		}
+		xSemaphoreGive(bufferMutex);
+
+		if (haveFrame && front_buffer != nullptr) {
+			unsigned long start = micros();
+
+			// Start every channel, then wait - refresh time follows the longest channel
+			for (int i = 0; i < output_channel_count; i++) {
+				const LEDChannelSettings& channel = output_channels[i];
+				int count = min(channel.count, output_count - channel.offset);
+				if (count > 0) {
+					channel_drivers[i]->transmit(front_buffer + channel.offset * 3, count);
+				}
+			}
+			for (int i = 0; i < output_channel_count; i++) {
+				channel_drivers[i]->waitDone();
+			}
+			unsigned long elapsed = micros() - start;
+
+			led_output_stats.frames_transmitted++;
+			led_output_stats.last_transmit_us = elapsed;
+			if (elapsed > led_output_stats.max_transmit_us) {
+				led_output_stats.max_transmit_us = elapsed;
+			}
+			histogramRecord(frame_timing.show, elapsed);
+			profileRecord(PROFILE_LED_TRANSMIT, elapsed);
+
+			udpOutputFrame(front_buffer, output_count, dirty);
+			
+			if (frame_callback != nullptr) {
+				frame_callback(frameNumber, elapsed);
+			}
+		}
+
+		xSemaphoreGive(driverMutex);
+	}
+}
+
+bool ledOutputBegin(const LEDChannelSettings* channels, int channelCount, int totalCount) {
+	if (bufferMutex == NULL) bufferMutex = xSemaphoreCreateMutex();
+	if (driverMutex == NULL) driverMutex = xSemaphoreCreateMutex();
+
+	if (!allocateOutputBuffers(totalCount)) {
+		Serial.println(" Failed to allocate LED output buffers");
+		return false;
+	}
+
+	beginChannels(channels, channelCount);
+
+	if (LEDOutputTask == NULL) {
+		xTaskCreatePinnedToCore(
+			LEDOutputTaskCode,
+			"LEDOutput",
+			4096,
+			NULL,
+			LED_OUTPUT_TASK_PRIORITY,
+			&LEDOutputTask,
+			LED_OUTPUT_TASK_CORE);
+	}
+
+	Serial.printf(" LED output started: %d channel(s), %d LEDs\n", output_channel_count, totalCount);
+	return true;
+}
+
+// Returns false if the buffers for totalCount could not be allocated
+bool ledOutputReinitialize(const LEDChannelSettings* channels, int channelCount, int totalCount) {
+	if (driverMutex == NULL || bufferMutex == NULL) {
+		return ledOutputBegin(channels, channelCount, totalCount);
+	}
+
+	// Wait for any transmission in flight before touching buffers or hardware
+	xSemaphoreTake(driverMutex, portMAX_DELAY);
+	xSemaphoreTake(bufferMutex, portMAX_DELAY);
+
+	bool allocated = true;
+	if (totalCount != output_count) {
+		allocated = allocateOutputBuffers(totalCount);
+		if (!allocated) {
+			Serial.println(" Failed to reallocate LED output buffers");
+		}
+	}
+	beginChannels(channels, channelCount);
+
+	xSemaphoreGive(bufferMutex);
+	xSemaphoreGive(driverMutex);
+
+	Serial.printf(" LED output reinitialized: %d channel(s), %d LEDs\n", output_channel_count, totalCount);
+	return allocated;
+}
+
+void setLEDChannelDriver(int channel, LEDOutputDriver* driver) {
+	if (channel < 0 || channel >= MAX_LED_CHANNELS) return;
+
+	if (driverMutex != NULL) xSemaphoreTake(driverMutex, portMAX_DELAY);
+	custom_drivers[channel] = driver;
+	if (channel < output_channel_count) {
+		LEDOutputDriver* previous = channel_drivers[channel];
+		channel_drivers[channel] = defaultChannelDriver(channel, output_channel_count);
+		if (previous != nullptr && previous != channel_drivers[channel]) previous->end();
+		channel_drivers[channel]->begin(output_channels[channel].pin, output_channels[channel].count);
+	}
+	if (driverMutex != NULL) xSemaphoreGive(driverMutex);
+
+	Serial.printf(" LED channel %d driver set to %s\n", channel,
+				  driver != nullptr ? driver->name() : "default");
+}
+
+LEDOutputDriver* getLEDChannelDriver(int channel) {
+	if (channel < 0 || channel >= output_channel_count) return nullptr;
+	return channel_drivers[channel];
+}
+
+int getLEDChannelCount() {
+	return output_channel_count;
+}
+
+void setLEDFrameCallback(LEDFrameCallback callback) {
+	frame_callback = callback;
+}
+
+// Estimate the frame's current draw and scale it into the power budget.
+// Over budget the scale drops at once to protect the supply; it recovers
+// gradually so the limiter does not visibly pump.
+static void limitFramePower(uint8_t* rgb, int count) {
+	uint32_t channelSum = sumBytes(rgb, count * 3);
+	uint32_t idleMA = (count * LED_IDLE_UA) / 1000;
+	uint32_t channelMA = (uint64_t)channelSum * settings.led_channel_ma / 255;
+
+	led_output_stats.estimated_ma = idleMA + channelMA;
+
+	uint16_t target = 256;
+	if (settings.power_limit_ma > 0 && channelMA > 0 &&
+		led_output_stats.estimated_ma > (uint32_t)settings.power_limit_ma) {
+		uint32_t available = (settings.power_limit_ma > (int)idleMA) ? settings.power_limit_ma - idleMA : 0;
+		target = (uint64_t)available * 256 / channelMA;
+	}
+
+	uint16_t scale = led_output_stats.power_scale;
+	if (target <= scale) {
+		if (target < 256 && scale == 256) led_output_stats.power_limit_events++;
+		scale = target;
+	} else {
+		scale += max(1, (target - scale) >> POWER_RELEASE_SHIFT);
+	}
+	led_output_stats.power_scale = scale;
+
+	if (scale < 256) {
+		scaleBytes(rgb, rgb, count * 3, scale);
+		led_output_stats.power_limited_frames++;
+		// Scaling truncates every channel, so at low scales the frame draws
+		// noticeably less than channelMA * scale; measure what is sent
+		channelSum = sumBytes(rgb, count * 3);
+		channelMA = (uint64_t)channelSum * settings.led_channel_ma / 255;
+	}
+	led_output_stats.output_ma = idleMA + channelMA;
+}
+
+// Hand the rendered frame to the output task. Only copies the canvas into the
+// back buffer and applies the power limit there, leaving the canvas intact;
+// transmission happens asynchronously.
+void presentFrame() {
+	if (bufferMutex == NULL || LEDOutputTask == NULL) return;
+
+	unsigned long start = micros();
+
+	xSemaphoreTake(bufferMutex, portMAX_DELAY);
+	if (back_buffer != nullptr) {
+		int count = strip.numPixels();
+		if (count > output_count) count = output_count;
+
+		// The canvas strip is NEO_RGB, so its raw buffer is already packed RGB;
+		// it is in layout order and gathered into wiring order here
+		layoutRemap(back_buffer, strip.getPixels(), count);
+		limitFramePower(back_buffer, count);
+		recordFrame(back_buffer, count);
+
+		if (frame_pending) {
+			led_output_stats.frames_coalesced++;
+		}
+		frame_pending = true;
+		pending_frame_number = ++led_output_stats.frames_presented;
+	}
+	xSemaphoreGive(bufferMutex);
+
+	xTaskNotifyGive(LEDOutputTask);
+	led_output_stats.last_present_us = micros() - start;
+}
+
+bool ledOutputBusy() {
+	if (driverMutex == NULL || bufferMutex == NULL) return false;
+	if (xSemaphoreTake(driverMutex, 0) != pdTRUE) return true;
+	xSemaphoreGive(driverMutex);
+
+	// frame_pending is written by both tasks under bufferMutex
+	xSemaphoreTake(bufferMutex, portMAX_DELAY);
+	bool pending = frame_pending;
+	xSemaphoreGive(bufferMutex);
+	return pending;
+}
@@ -0,0 +1,100 @@
+#ifndef LED_OUTPUT_H
+#define LED_OUTPUT_H
+
+#include <Adafruit_NeoPixel.h>
+#include <Arduino.h>
+#include <esp_idf_version.h>
+#include "../config/Settings.h"
+
+// Parallel RMT output uses the legacy ESP-IDF RMT driver (Arduino core 2.x).
+// On newer cores every channel falls back to the NeoPixel adapter.
+#if ESP_IDF_VERSION_MAJOR < 5
+#define LED_RMT_PARALLEL 1
+#else
+#define LED_RMT_PARALLEL 0
+#endif
+
+// Output driver interface. Drivers receive finished frames as packed RGB
+// triplets and convert them to whatever the hardware expects.
+// transmit() may return before the data is on the wire; waitDone() blocks
+// until the previous transmit has completed. end() releases the pin and any
+// peripheral when the channel is no longer driven by this driver.
+class LEDOutputDriver {
+public:
+  virtual ~LEDOutputDriver() {}
+  virtual bool begin(int pin, int count) = 0;
+  virtual void end() {}
+  virtual void transmit(const uint8_t* rgb, int count) = 0;
+  virtual void waitDone() {}
+  virtual const char* name() const = 0;
+};
+
+// Adafruit NeoPixel adapter (WS2812B, GRB wire order, blocking show)
+class NeoPixelDriver : public LEDOutputDriver {
+public:
+  bool begin(int pin, int count) override;
+  void end() override;
+  void transmit(const uint8_t* rgb, int count) override;
+  const char* name() const override { return "neopixel"; }
+
+private:
+  Adafruit_NeoPixel output;
+  int output_pin = -1;
+};
+
+#if LED_RMT_PARALLEL
+// WS2812B over a dedicated RMT channel with non-blocking writes, so several
+// strips transmit at the same time
+class RMTDriver : public LEDOutputDriver {
+public:
+  explicit RMTDriver(int channel) : rmt_channel(channel) {}
+  bool begin(int pin, int count) override;
+  void end() override;
+  void transmit(const uint8_t* rgb, int count) override;
+  void waitDone() override;
+  const char* name() const override { return "rmt"; }
+
+private:
+  int rmt_channel;
+  int rmt_pin = -1;
+  bool installed = false;
+  bool in_flight = false;
+  uint8_t* wire_buffer = nullptr;
+  int wire_count = 0;
+};
+#endif
+
+// Called from the output task after each frame has been transmitted
+typedef void (*LEDFrameCallback)(uint32_t frameNumber, unsigned long transmitMicros);
+
+// Output statistics
+struct LEDOutputStats {
+  uint32_t frames_presented = 0;
+  uint32_t frames_transmitted = 0;
+  uint32_t frames_coalesced = 0;     // Presented while the previous frame was still pending
+  unsigned long last_present_us = 0; // Time the LED task spent handing off the frame
+  unsigned long last_transmit_us = 0;
+  unsigned long max_transmit_us = 0;
+
+  // Power limiter
+  uint32_t estimated_ma = 0;         // Draw of the rendered frame
+  uint32_t output_ma = 0;            // Draw after limiting
+  uint16_t power_scale = 256;        // Applied scale, 256 = unlimited
+  uint32_t power_limited_frames = 0;
+  uint32_t power_limit_events = 0;   // Times the limiter engaged
+};
+
+extern LEDOutputStats led_output_stats;
+extern TaskHandle_t LEDOutputTask;
+
+// Output functions
+bool ledOutputBegin(const LEDChannelSettings* channels, int channelCount, int totalCount);
+bool ledOutputReinitialize(const LEDChannelSettings* channels, int channelCount, int totalCount);
+void setLEDChannelDriver(int channel, LEDOutputDriver* driver);
+LEDOutputDriver* getLEDChannelDriver(int channel);
+int getLEDChannelCount();
+void setLEDFrameCallback(LEDFrameCallback callback);
+void presentFrame();
+bool ledOutputBusy();
+
+#endif
@@ -0,0 +1,83 @@
+#include "LEDTransition.h"
+#include "LEDAnimations.h"
+#include "PixelKernels.h"
+
+// The outgoing effect is rendered here each frame while the incoming one
+// renders into the canvas. Sized once per strip length, never per frame.
+static uint8_t* outgoing_buffer = nullptr;
+static int outgoing_capacity = 0;
+
+static int transition_mode = TRANSITION_CUT;
+static unsigned long transition_start = 0;
+static unsigned long transition_duration = 0;
+static bool transition_running = false;
+
+// Make sure the outgoing buffer covers ledCount pixels. Cancels any running
+// transition, since the old frame no longer matches the strip.
+void transitionBegin(int ledCount) {
+	transition_running = false;
+
+	int needed = ledCount * 3;
+	if (needed <= outgoing_capacity) return;
+
+	free(outgoing_buffer);
+	outgoing_buffer = (uint8_t*)malloc(needed);
+	outgoing_capacity = (outgoing_buffer != nullptr) ? needed : 0;
+	if (outgoing_buffer == nullptr) {
+		Serial.println(" Failed to allocate transition buffer - state changes will cut");
+	}
+}
+
+void transitionStart(int mode, unsigned long durationMs) {
+	if (mode == TRANSITION_CUT || durationMs == 0 || outgoing_buffer == nullptr) {
+		transition_running = false;
+		return;
+	}
+	transition_mode = mode;
+	transition_start = animationMillis();
+	transition_duration = durationMs;
+	transition_running = true;
+}
+
+void transitionCancel() {
+	transition_running = false;
+}
+
+bool transitionActive() {
+	return transition_running;
+}
+
+// Store the outgoing effect's frame for this tick
+void transitionCaptureOutgoing(const uint8_t* rgb, int count) {
+	if (!transition_running) return;
+	memcpy(outgoing_buffer, rgb, min(count * 3, outgoing_capacity));
+}
+
+// Combine the outgoing frame with the incoming frame already in rgb.
+// Ends the transition once its duration has elapsed.
+void transitionApply(uint8_t* rgb, int count) {
+	if (!transition_running) return;
+
+	unsigned long elapsed = animationMillis() - transition_start;
+	if (elapsed >= transition_duration) {
+		transition_running = false;
+		return;
+	}
+
+	count = min(count, outgoing_capacity / 3);
+	uint16_t amount = (elapsed * 256) / transition_duration;
+
+	if (transition_mode == TRANSITION_WIPE) {
+		// Edge position in 8.8 fixed point; the pixel under the edge is blended
+		uint32_t edge = (uint32_t)count * amount;
+		int fullPixels = edge >> 8;
+		if (fullPixels < count) {
+			uint8_t* pixel = rgb + fullPixels * 3;
+			const uint8_t* outgoing = outgoing_buffer + fullPixels * 3;
+			lerpBytes(pixel, outgoing, pixel, 3, edge & 0xFF);
+			memcpy(pixel + 3, outgoing + 3, (count - fullPixels - 1) * 3);
+		}
+	} else {
+		lerpBytes(rgb, outgoing_buffer, rgb, count * 3, amount);
+	}
+}
@@ -0,0 +1,21 @@
+#ifndef LED_TRANSITION_H
+#define LED_TRANSITION_H
+
+#include <Arduino.h>
+
+// How one state effect hands over to the next
+enum TransitionMode {
+  TRANSITION_CUT,    // Hard cut (previous behaviour)
+  TRANSITION_FADE,   // Crossfade between outgoing and incoming effect
+  TRANSITION_WIPE    // Incoming effect sweeps in from the strip start
+};
+
+// Transition functions
+void transitionBegin(int ledCount);
+void transitionStart(int mode, unsigned long durationMs);
+void transitionCancel();
+bool transitionActive();
+void transitionCaptureOutgoing(const uint8_t* rgb, int count);
+void transitionApply(uint8_t* rgb, int count);
+
+#endif
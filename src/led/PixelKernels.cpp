@@ -0,0 +1,83 @@
+#include "PixelKernels.h"
+
+// Even and odd bytes of a word each get a 16-bit lane, which holds a full
+// 8x9-bit product without spilling into the neighbouring lane
+#define SWAR_EVEN 0x00FF00FFu
+
+static inline uint32_t loadWord(const uint8_t* p) {
+	uint32_t word;
+	memcpy(&word, p, sizeof(word));
+	return word;
+}
+
+static inline void storeWord(uint8_t* p, uint32_t word) {
+	memcpy(p, &word, sizeof(word));
+}
+
+void lerpBytes(uint8_t* dst, const uint8_t* from, const uint8_t* to, int length, uint16_t amount) {
+	uint32_t inverse = 256 - amount;
+	int i = 0;
+
+	for (; i + 4 <= length; i += 4) {
+		uint32_t f = loadWord(from + i);
+		uint32_t t = loadWord(to + i);
+		uint32_t even = (((f & SWAR_EVEN) * inverse + (t & SWAR_EVEN) * amount) >> 8) & SWAR_EVEN;
+		uint32_t odd = (((f >> 8) & SWAR_EVEN) * inverse + ((t >> 8) & SWAR_EVEN) * amount) & ~SWAR_EVEN;
+		storeWord(dst + i, even | odd);
+	}
+	for (; i < length; i++) {
+		dst[i] = (from[i] * inverse + to[i] * amount) >> 8;
+	}
+}
+
+void scaleBytes(uint8_t* dst, const uint8_t* src, int length, uint16_t amount) {
+	int i = 0;
+
+	for (; i + 4 <= length; i += 4) {
+		uint32_t s = loadWord(src + i);
+		uint32_t even = (((s & SWAR_EVEN) * amount) >> 8) & SWAR_EVEN;
+		uint32_t odd = (((s >> 8) & SWAR_EVEN) * amount) & ~SWAR_EVEN;
+		storeWord(dst + i, even | odd);
+	}
+	for (; i < length; i++) {
+		dst[i] = (src[i] * amount) >> 8;
+	}
+}
+
+uint32_t sumBytes(const uint8_t* src, int length) {
+	uint32_t total = 0;
+	int i = 0;
+
+	// Two 16-bit lanes each take two bytes per word; 128 words (at most
+	// 256 * 255) fit in a lane, so flush to the total every 128 words
+	while (i + 4 <= length) {
+		uint32_t lanes = 0;
+		int end = min(length - 3, i + 128 * 4);
+		for (; i < end; i += 4) {
+			uint32_t s = loadWord(src + i);
+			lanes += (s & SWAR_EVEN) + ((s >> 8) & SWAR_EVEN);
+		}
+		total += (lanes & 0xFFFF) + (lanes >> 16);
+	}
+	for (; i < length; i++) {
+		total += src[i];
+	}
+	return total;
+}
+
+void fillRGB(uint8_t* rgb, int count, uint32_t color) {
+	if (count <= 0) return;
+
+	rgb[0] = (color >> 16) & 0xFF;
+	rgb[1] = (color >> 8) & 0xFF;
+	rgb[2] = color & 0xFF;
+
+	// Double the filled prefix until the buffer is full
+	int filled = 3;
+	int total = count * 3;
+	while (filled < total) {
+		int chunk = min(filled, total - filled);
+		memcpy(rgb + filled, rgb, chunk);
+		filled += chunk;
+	}
+}
@@ -0,0 +1,23 @@
+#ifndef PIXEL_KERNELS_H
+#define PIXEL_KERNELS_H
+
+#include <Arduino.h>
+
+// Bulk pixel kernels over runs of 8-bit channel values. They apply the same
+// weight to every byte, so they work on a packed RGB frame (length = pixels * 3)
+// as well as on a single color plane. Four channels are processed per 32-bit
+// word (SWAR); dst may be the same buffer as either source.
+
+// dst = from + (to - from) * amount / 256, amount 0-256
+void lerpBytes(uint8_t* dst, const uint8_t* from, const uint8_t* to, int length, uint16_t amount);
+
+// dst = src * amount / 256, amount 0-256
+void scaleBytes(uint8_t* dst, const uint8_t* src, int length, uint16_t amount);
+
+// Sum of length byte values
+uint32_t sumBytes(const uint8_t* src, int length);
+
+// Fill count packed RGB pixels with one color
+void fillRGB(uint8_t* rgb, int count, uint32_t color);
+
+#endif
@@ -0,0 +1,402 @@
+#include "MQTTConnection.h"
+#include <lwip/dns.h>
+#include <new>
+
+// Longest each step may take before the attempt is abandoned
+static const unsigned long step_timeout_ms[MQTT_STEP_COUNT] = {
+	0,      // Idle
+	10000,  // DNS
+	10000,  // TCP
+	15000,  // TLS
+	10000,  // CONNECT, until CONNACK
+	10000,  // SUBSCRIBE, until SUBACK
+	0,      // Connected
+	0       // Backoff
+};
+
+static const uint16_t SUBSCRIBE_PACKET_ID = 1;
+
+// One lookup in flight; the callback frees it
+struct DNSLookup {
+	MQTTConnection* connection;
+	uint32_t generation;
+};
+
+// Guards the DNS fields between the lwIP task and the connection's task
+static portMUX_TYPE dns_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Runs on the lwIP task when an asynchronous lookup finishes. A lookup that
+// outlived its attempt (step timeout, restart) must not answer the next one.
+static void dnsFound(const char* name, const ip_addr_t* address, void* arg) {
+	DNSLookup* lookup = (DNSLookup*)arg;
+	MQTTConnection* connection = lookup->connection;
+	portENTER_CRITICAL(&dns_mux);
+	if (lookup->generation == connection->dns_generation) {
+		connection->dns_address = (address != nullptr) ? ip_addr_get_ip4_u32(address) : 0;
+		connection->dns_done = true;
+	}
+	portEXIT_CRITICAL(&dns_mux);
+	delete lookup;
+}
+
+// The window doubles with each consecutive failure up to the cap; the wait
+// is drawn from its upper half
+static unsigned long nextBackoff(MQTTConnection& connection) {
+	unsigned long window = MQTT_BACKOFF_MIN_MS;
+	for (uint32_t i = 1; i < connection.stats.failures && window < MQTT_BACKOFF_MAX_MS; i++) {
+		window *= 2;
+	}
+	if (window > MQTT_BACKOFF_MAX_MS) window = MQTT_BACKOFF_MAX_MS;
+	return window / 2 + random(window / 2 + 1);
+}
+
+static void enterStep(MQTTConnection& connection, MQTTConnectStep step) {
+	unsigned long now = millis();
+	connection.stats.step_ms[connection.step] = now - connection.step_started;
+	connection.step = step;
+	connection.step_started = now;
+	connection.reply_length = 0;
+	connection.skip_length = 0;
+}
+
+static MQTTConnectEvent fail(MQTTConnection& connection, const char* error, int code) {
+	connection.stats.failed_step = connection.step;
+	connection.stats.last_error = error;
+	connection.stats.error_code = code;
+	connection.transport->stop();
+	connection.stats.failures++;
+	connection.stats.backoff_ms = nextBackoff(connection);
+	enterStep(connection, MQTT_STEP_BACKOFF);
+	return MQTT_EVENT_FAILED;
+}
+
+static size_t putRemainingLength(uint8_t* packet, size_t length) {
+	size_t pos = 0;
+	do {
+		uint8_t digit = length % 128;
+		length /= 128;
+		packet[pos++] = digit | (length > 0 ? 0x80 : 0);
+	} while (length > 0);
+	return pos;
+}
+
+static void putString(uint8_t* packet, size_t& pos, const String& value) {
+	packet[pos++] = value.length() >> 8;
+	packet[pos++] = value.length() & 0xFF;
+	memcpy(packet + pos, value.c_str(), value.length());
+	pos += value.length();
+}
+
+// Write a packet from a scratch buffer sized for it; tokens make CONNECT
+// too large for a fixed buffer
+static bool sendPacket(MQTTConnection& connection, uint8_t type, size_t remaining,
+					   void (*fill)(MQTTConnection&, uint8_t*, size_t&)) {
+	uint8_t* packet = (uint8_t*)malloc(remaining + 5);
+	if (packet == nullptr) return false;
+
+	size_t pos = 0;
+	packet[pos++] = type;
+	pos += putRemainingLength(packet + pos, remaining);
+	fill(connection, packet, pos);
+
+	bool sent = connection.transport->write(packet, pos) == pos;
+	free(packet);
+	return sent;
+}
+
+// MQTT 3.1.1 CONNECT with a clean session, matching what PubSubClient sends
+static void fillConnect(MQTTConnection& connection, uint8_t* packet, size_t& pos) {
+	const MQTTEndpoint& endpoint = connection.endpoint;
+	putString(packet, pos, "MQTT");
+	packet[pos++] = 4;
+	packet[pos++] = 0x02 | (endpoint.username.length() > 0 ? 0xC0 : 0);
+	packet[pos++] = endpoint.keepalive >> 8;
+	packet[pos++] = endpoint.keepalive & 0xFF;
+	putString(packet, pos, endpoint.client_id);
+	if (endpoint.username.length() > 0) {
+		putString(packet, pos, endpoint.username);
+		putString(packet, pos, endpoint.password);
+	}
+}
+
+static bool sendConnect(MQTTConnection& connection) {
+	const MQTTEndpoint& endpoint = connection.endpoint;
+	size_t remaining = 10 + 2 + endpoint.client_id.length();
+	if (endpoint.username.length() > 0) {
+		remaining += 2 + endpoint.username.length() + 2 + endpoint.password.length();
+	}
+	return sendPacket(connection, 0x10, remaining, fillConnect);
+}
+
+static void fillSubscribe(MQTTConnection& connection, uint8_t* packet, size_t& pos) {
+	packet[pos++] = SUBSCRIBE_PACKET_ID >> 8;
+	packet[pos++] = SUBSCRIBE_PACKET_ID & 0xFF;
+	putString(packet, pos, connection.endpoint.topic);
+	packet[pos++] = 0;  // QoS 0
+}
+
+static bool sendSubscribe(MQTTConnection& connection) {
+	return sendPacket(connection, 0x82, 2 + 2 + connection.endpoint.topic.length() + 1, fillSubscribe);
+}
+
+// 1 once expected bytes are in, 0 while waiting, -1 if the broker closed
+static int readReply(MQTTConnection& connection, size_t expected) {
+	int received = connection.transport->readAvailable(connection.reply + connection.reply_length,
+													   expected - connection.reply_length);
+	if (received < 0) return -1;
+	connection.reply_length += received;
+	return connection.reply_length == expected ? 1 : 0;
+}
+
+// Fixed header of the next packet into reply: type byte and the remaining
+// length. 1 once complete, 0 while waiting, -1 if the broker closed, -2 if
+// the length runs past four bytes.
+static int readHeader(MQTTConnection& connection) {
+	while (connection.reply_length < 2 || (connection.reply[connection.reply_length - 1] & 0x80)) {
+		if (connection.reply_length == sizeof(connection.reply)) return -2;
+		int received = connection.transport->readAvailable(connection.reply + connection.reply_length, 1);
+		if (received < 0) return -1;
+		if (received == 0) return 0;
+		connection.reply_length++;
+	}
+	return 1;
+}
+
+static uint32_t headerRemainingLength(const MQTTConnection& connection) {
+	uint32_t length = 0;
+	for (size_t i = connection.reply_length - 1; i >= 1; i--) {
+		length = (length << 7) | (connection.reply[i] & 0x7F);
+	}
+	return length;
+}
+
+// Hand the open connection to PubSubClient. It sends its own CONNECT, which
+// the transport swallows, and reads back the CONNACK we already received.
+static MQTTConnectEvent handOver(MQTTConnection& connection) {
+	const MQTTEndpoint& endpoint = connection.endpoint;
+	connection.transport->replayConnect(connection.connack, sizeof(connection.connack));
+	connection.client->setKeepAlive(endpoint.keepalive);
+
+	bool connected = (endpoint.username.length() > 0)
+		? connection.client->connect(endpoint.client_id.c_str(), endpoint.username.c_str(), endpoint.password.c_str())
+		: connection.client->connect(endpoint.client_id.c_str());
+	if (!connected) return fail(connection, "client did not accept CONNACK", connection.client->state());
+
+	connection.stats.connects++;
+	connection.stats.failures = 0;
+	connection.stats.backoff_ms = 0;
+	connection.stats.last_connect_ms = millis() - connection.attempt_started;
+	return MQTT_EVENT_CONNECTED;
+}
+
+// Enter a step and kick it off; steps that do not apply are skipped
+static MQTTConnectEvent beginStep(MQTTConnection& connection, MQTTConnectStep step) {
+	if (step == MQTT_STEP_TLS && !connection.transport->usesTLS()) step = MQTT_STEP_CONNECT;
+	if (step == MQTT_STEP_SUBSCRIBE && connection.endpoint.topic.length() == 0) step = MQTT_STEP_CONNECTED;
+	enterStep(connection, step);
+
+	switch (step) {
+		case MQTT_STEP_TCP:
+			if (connection.transport->beginConnect(connection.dns_address, connection.endpoint.port) == TRANSPORT_ERROR) {
+				return fail(connection, "TCP connect failed", connection.transport->lastError());
+			}
+			return MQTT_EVENT_NONE;
+		case MQTT_STEP_TLS:
+			if (connection.transport->beginTLS(connection.endpoint.host.c_str()) == TRANSPORT_ERROR) {
+				return fail(connection, "TLS handshake failed", connection.transport->lastError());
+			}
+			return MQTT_EVENT_NONE;
+		case MQTT_STEP_CONNECT:
+			if (!sendConnect(connection)) return fail(connection, "CONNECT send failed", 0);
+			return MQTT_EVENT_NONE;
+		case MQTT_STEP_SUBSCRIBE:
+			if (!sendSubscribe(connection)) return fail(connection, "SUBSCRIBE send failed", 0);
+			return MQTT_EVENT_NONE;
+		case MQTT_STEP_CONNECTED:
+			return handOver(connection);
+		default:
+			return MQTT_EVENT_NONE;
+	}
+}
+
+static MQTTConnectEvent startAttempt(MQTTConnection& connection) {
+	connection.transport->stop();
+	connection.stats.attempts++;
+	for (int i = 0; i < MQTT_STEP_COUNT; i++) connection.stats.step_ms[i] = 0;
+	connection.attempt_started = millis();
+	enterStep(connection, MQTT_STEP_DNS);
+
+	portENTER_CRITICAL(&dns_mux);
+	connection.dns_generation++;
+	connection.dns_done = false;
+	portEXIT_CRITICAL(&dns_mux);
+
+	if (connection.configure == nullptr || !connection.configure(connection.endpoint)) {
+		return fail(connection, "not configured", 0);
+	}
+
+	// Addresses need no lookup; names resolve in the background
+	IPAddress address;
+	if (address.fromString(connection.endpoint.host.c_str())) {
+		connection.dns_address = (uint32_t)address;
+		connection.dns_done = true;
+		return MQTT_EVENT_NONE;
+	}
+
+	DNSLookup* lookup = new (std::nothrow) DNSLookup{&connection, connection.dns_generation};
+	if (lookup == nullptr) return fail(connection, "DNS lookup failed", 0);
+
+	ip_addr_t resolved;
+	err_t err = dns_gethostbyname(connection.endpoint.host.c_str(), &resolved, dnsFound, lookup);
+	if (err == ERR_INPROGRESS) return MQTT_EVENT_NONE;
+
+	// Answered from the cache or refused: the callback will not run
+	delete lookup;
+	if (err != ERR_OK) return fail(connection, "DNS lookup failed", err);
+	connection.dns_address = ip_addr_get_ip4_u32(&resolved);
+	connection.dns_done = true;
+	return MQTT_EVENT_NONE;
+}
+
+// Read up to the SUBACK. The broker may already be sending on the topic
+// (retained or queued messages); those PUBLISH packets are read past.
+static MQTTConnectEvent readSuback(MQTTConnection& connection) {
+	for (;;) {
+		if (connection.skip_length > 0) {
+			uint8_t discard[64];
+			int received = connection.transport->readAvailable(discard, min((size_t)connection.skip_length, sizeof(discard)));
+			if (received < 0) return fail(connection, "closed before SUBACK", connection.transport->lastError());
+			if (received == 0) return MQTT_EVENT_NONE;
+			connection.skip_length -= received;
+			continue;
+		}
+
+		// Past a complete SUBACK header (always 0x90 0x03) only its body is left
+		bool subackHeader = connection.reply_length >= 2 && connection.reply[0] == 0x90 && connection.reply[1] == 0x03;
+		if (!subackHeader) {
+			int ready = readHeader(connection);
+			if (ready == -1) return fail(connection, "closed before SUBACK", connection.transport->lastError());
+			if (ready == -2) return fail(connection, "bad packet before SUBACK", connection.reply[0]);
+			if (ready == 0) return MQTT_EVENT_NONE;
+
+			if ((connection.reply[0] & 0xF0) == 0x30) {
+				connection.skip_length = headerRemainingLength(connection);
+				connection.reply_length = 0;
+				connection.stats.publishes_skipped++;
+				continue;
+			}
+			if (connection.reply[0] != 0x90 || connection.reply[1] != 0x03) return fail(connection, "bad SUBACK", connection.reply[0]);
+		}
+
+		int ready = readReply(connection, 5);
+		if (ready < 0) return fail(connection, "closed before SUBACK", connection.transport->lastError());
+		if (ready == 0) return MQTT_EVENT_NONE;
+		uint16_t packetId = (connection.reply[2] << 8) | connection.reply[3];
+		if (packetId != SUBSCRIBE_PACKET_ID) return fail(connection, "bad SUBACK", packetId);
+		if (connection.reply[4] & 0x80) return fail(connection, "SUBSCRIBE refused", connection.reply[4]);
+		return beginStep(connection, MQTT_STEP_CONNECTED);
+	}
+}
+
+// Advance the current step if it is ready
+static MQTTConnectEvent serviceStep(MQTTConnection& connection) {
+	unsigned long elapsed = millis() - connection.step_started;
+	unsigned long timeout = step_timeout_ms[connection.step];
+	if (timeout > 0 && elapsed >= timeout) return fail(connection, "timeout", 0);
+
+	switch (connection.step) {
+		case MQTT_STEP_IDLE:
+			return MQTT_EVENT_NONE;
+
+		case MQTT_STEP_BACKOFF:
+			if (elapsed < connection.stats.backoff_ms) return MQTT_EVENT_NONE;
+			return startAttempt(connection);
+
+		case MQTT_STEP_DNS:
+			if (!connection.dns_done) return MQTT_EVENT_NONE;
+			if (connection.dns_address == 0) return fail(connection, "DNS lookup failed", 0);
+			return beginStep(connection, MQTT_STEP_TCP);
+
+		case MQTT_STEP_TCP:
+			switch (connection.transport->pollConnect()) {
+				case TRANSPORT_PENDING: return MQTT_EVENT_NONE;
+				case TRANSPORT_ERROR: return fail(connection, "TCP connect failed", connection.transport->lastError());
+				default: return beginStep(connection, MQTT_STEP_TLS);
+			}
+
+		case MQTT_STEP_TLS:
+			switch (connection.transport->pollTLS()) {
+				case TRANSPORT_PENDING: return MQTT_EVENT_NONE;
+				case TRANSPORT_ERROR: return fail(connection, "TLS handshake failed", connection.transport->lastError());
+				default: return beginStep(connection, MQTT_STEP_CONNECT);
+			}
+
+		case MQTT_STEP_CONNECT: {
+			int ready = readReply(connection, 4);
+			if (ready < 0) return fail(connection, "closed before CONNACK", connection.transport->lastError());
+			if (ready == 0) return MQTT_EVENT_NONE;
+			if (connection.reply[0] != 0x20 || connection.reply[1] != 0x02) return fail(connection, "bad CONNACK", 0);
+			if (connection.reply[3] != 0) return fail(connection, "CONNECT refused", connection.reply[3]);
+			memcpy(connection.connack, connection.reply, sizeof(connection.connack));
+			return beginStep(connection, MQTT_STEP_SUBSCRIBE);
+		}
+
+		case MQTT_STEP_SUBSCRIBE:
+			return readSuback(connection);
+
+		case MQTT_STEP_CONNECTED:
+			if (connection.client->connected()) return MQTT_EVENT_NONE;
+
+			// Dropped after a good connection: retry at once, back off on failures
+			connection.stats.disconnects++;
+			startAttempt(connection);
+			return MQTT_EVENT_LOST;
+
+		default:
+			return MQTT_EVENT_NONE;
+	}
+}
+
+void mqttConnectionStart(MQTTConnection& connection) {
+	mqttConnectionStop(connection);
+	connection.stats.failures = 0;
+	startAttempt(connection);
+}
+
+void mqttConnectionStop(MQTTConnection& connection) {
+	if (connection.step == MQTT_STEP_CONNECTED && connection.client->connected()) {
+		connection.client->disconnect();
+	}
+	connection.transport->stop();
+	enterStep(connection, MQTT_STEP_IDLE);
+}
+
+MQTTConnectEvent mqttConnectionService(MQTTConnection& connection) {
+	unsigned long serviceStart = micros();
+
+	// Run through every step that is ready now, stopping at the first wait
+	MQTTConnectEvent event = MQTT_EVENT_NONE;
+	for (int i = 0; i < MQTT_STEP_COUNT && event == MQTT_EVENT_NONE; i++) {
+		MQTTConnectStep before = connection.step;
+		event = serviceStep(connection);
+		if (connection.step == before) break;
+	}
+
+	unsigned long blocked = micros() - serviceStart;
+	if (blocked > connection.stats.max_service_us) connection.stats.max_service_us = blocked;
+	return event;
+}
+
+const char* mqttConnectStepName(MQTTConnectStep step) {
+	switch (step) {
+		case MQTT_STEP_IDLE: return "idle";
+		case MQTT_STEP_DNS: return "dns";
+		case MQTT_STEP_TCP: return "tcp";
+		case MQTT_STEP_TLS: return "tls";
+		case MQTT_STEP_CONNECT: return "connect";
+		case MQTT_STEP_SUBSCRIBE: return "subscribe";
+		case MQTT_STEP_CONNECTED: return "connected";
+		case MQTT_STEP_BACKOFF: return "backoff";
+		default: return "unknown";
+	}
+}
@@ -0,0 +1,102 @@
+#ifndef MQTT_CONNECTION_H
+#define MQTT_CONNECTION_H
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include "MQTTTransport.h"
+
+// Non-blocking MQTT connect pipeline. A connection attempt runs as
+// resumable steps: DNS, TCP, TLS, CONNECT and SUBSCRIBE. Each
+// mqttConnectionService() call advances whatever step is ready and returns
+// without waiting on the network. Each step has its own timeout. Failed
+// attempts are retried with capped exponential backoff and jitter.
+#define MQTT_BACKOFF_MIN_MS 2000
+#define MQTT_BACKOFF_MAX_MS 60000
+
+enum MQTTConnectStep {
+  MQTT_STEP_IDLE,
+  MQTT_STEP_DNS,
+  MQTT_STEP_TCP,
+  MQTT_STEP_TLS,
+  MQTT_STEP_CONNECT,
+  MQTT_STEP_SUBSCRIBE,
+  MQTT_STEP_CONNECTED,
+  MQTT_STEP_BACKOFF,
+  MQTT_STEP_COUNT
+};
+
+enum MQTTConnectEvent {
+  MQTT_EVENT_NONE,
+  MQTT_EVENT_CONNECTED,
+  MQTT_EVENT_FAILED,
+  MQTT_EVENT_LOST
+};
+
+// Where to connect; rebuilt before every attempt so new credentials and
+// refreshed tokens are picked up
+struct MQTTEndpoint {
+  String host;
+  uint16_t port = 1883;
+  String client_id;
+  String username;   // Empty = no username or password
+  String password;
+  String topic;      // Empty = skip SUBSCRIBE
+  uint16_t keepalive = 60;
+};
+
+// Fills the endpoint; returns false if the connection is not configured
+typedef bool (*MQTTConfigureFn)(MQTTEndpoint& endpoint);
+
+struct MQTTConnectStats {
+  uint32_t attempts = 0;
+  uint32_t connects = 0;
+  uint32_t disconnects = 0;          // Lost after being connected
+  uint32_t failures = 0;             // Consecutive failed attempts
+  unsigned long backoff_ms = 0;
+  unsigned long last_connect_ms = 0; // DNS start to SUBACK
+  unsigned long step_ms[MQTT_STEP_COUNT] = {0};  // Per step, last attempt
+  unsigned long max_service_us = 0;  // Longest single service call
+  uint32_t publishes_skipped = 0;    // Arrived before the SUBACK
+  MQTTConnectStep failed_step = MQTT_STEP_IDLE;
+  const char* last_error = "";
+  int error_code = 0;
+};
+
+struct MQTTConnection {
+  MQTTConnection(const char* name, PubSubClient* client, MQTTTransport* transport, MQTTConfigureFn configure)
+    : name(name), client(client), transport(transport), configure(configure) {}
+
+  const char* name;
+  PubSubClient* client;
+  MQTTTransport* transport;
+  MQTTConfigureFn configure;
+  MQTTEndpoint endpoint;
+
+  MQTTConnectStep step = MQTT_STEP_IDLE;
+  unsigned long step_started = 0;
+  unsigned long attempt_started = 0;
+
+  // Set by the DNS callback on the lwIP task. Each attempt bumps the
+  // generation; answers to an earlier attempt's lookup are dropped.
+  uint32_t dns_generation = 0;
+  volatile bool dns_done = false;
+  volatile uint32_t dns_address = 0;
+
+  // CONNACK, or the packet header and SUBACK being received. PUBLISH
+  // packets that arrive ahead of the SUBACK are skipped.
+  uint8_t reply[5];
+  size_t reply_length = 0;
+  uint32_t skip_length = 0;
+  uint8_t connack[4];
+
+  MQTTConnectStats stats;
+};
+
+// Connection pipeline functions. Each connection must only be used from
+// one task.
+void mqttConnectionStart(MQTTConnection& connection);
+void mqttConnectionStop(MQTTConnection& connection);
+MQTTConnectEvent mqttConnectionService(MQTTConnection& connection);
+const char* mqttConnectStepName(MQTTConnectStep step);
+
+#endif
@@ -0,0 +1,435 @@
+#include "MQTTTransport.h"
+#include <lwip/sockets.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <errno.h>
+#include <new>
+
+// Session fields are private in mbedTLS 3
+#ifndef MBEDTLS_PRIVATE
+#define MBEDTLS_PRIVATE(member) member
+#endif
+
+// PubSubClient expects write() to send everything, so a full socket buffer
+// is waited out, but only for this long
+static const unsigned long WRITE_TIMEOUT_MS = 5000;
+
+static const uint32_t SESSION_CACHE_MAGIC = 0x544C5331;
+
+#if MAVENLED_TLS_SESSION_RTC
+// Not cleared by a software restart; checked by magic, length and host
+RTC_NOINIT_ATTR static TLSSessionCache rtc_session_cache;
+#endif
+
+struct TLSState {
+	mbedtls_ssl_context ssl;
+	mbedtls_ssl_config conf;
+	mbedtls_ctr_drbg_context drbg;
+	mbedtls_entropy_context entropy;
+};
+
+// mbedTLS I/O callbacks on the non-blocking socket
+static int tlsSend(void* context, const unsigned char* buf, size_t length) {
+	int sent = send(*(int*)context, buf, length, MSG_DONTWAIT);
+	if (sent >= 0) return sent;
+	return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+static int tlsRecv(void* context, unsigned char* buf, size_t length) {
+	int received = recv(*(int*)context, buf, length, MSG_DONTWAIT);
+	if (received >= 0) return received;
+	return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+TransportResult MQTTTransport::beginConnect(uint32_t address, uint16_t port) {
+	stop();
+
+	fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (fd < 0) {
+		last_error = errno;
+		return TRANSPORT_ERROR;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	struct sockaddr_in server;
+	memset(&server, 0, sizeof(server));
+	server.sin_family = AF_INET;
+	server.sin_port = htons(port);
+	server.sin_addr.s_addr = address;
+
+	if (::connect(fd, (struct sockaddr*)&server, sizeof(server)) == 0) {
+		socket_open = true;
+		return TRANSPORT_DONE;
+	}
+	if (errno == EINPROGRESS) return TRANSPORT_PENDING;
+
+	last_error = errno;
+	stop();
+	return TRANSPORT_ERROR;
+}
+
+TransportResult MQTTTransport::pollConnect() {
+	if (fd < 0) return TRANSPORT_ERROR;
+	if (socket_open) return TRANSPORT_DONE;
+
+	fd_set writable;
+	FD_ZERO(&writable);
+	FD_SET(fd, &writable);
+	struct timeval timeout = {0, 0};
+	int ready = select(fd + 1, nullptr, &writable, nullptr, &timeout);
+	if (ready == 0) return TRANSPORT_PENDING;
+
+	int error = 0;
+	socklen_t length = sizeof(error);
+	if (ready < 0 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+		last_error = (ready < 0) ? errno : error;
+		stop();
+		return TRANSPORT_ERROR;
+	}
+	socket_open = true;
+	return TRANSPORT_DONE;
+}
+
+static bool sessionValid(const TLSSessionCache* cache, const char* hostname) {
+	return cache != nullptr && cache->magic == SESSION_CACHE_MAGIC &&
+		   cache->length > 0 && cache->length <= TLS_SESSION_CACHE_BYTES &&
+		   strncmp(cache->host, hostname, sizeof(cache->host)) == 0;
+}
+
+// The session for this host from RAM, or from RTC memory after a restart
+const TLSSessionCache* MQTTTransport::cachedSession(const char* hostname) {
+	if (sessionValid(session_cache, hostname)) return session_cache;
+
+#if MAVENLED_TLS_SESSION_RTC
+	if (sessionValid(&rtc_session_cache, hostname)) {
+		if (session_cache == nullptr) session_cache = (TLSSessionCache*)malloc(sizeof(TLSSessionCache));
+		if (session_cache == nullptr) return nullptr;
+		memcpy(session_cache, &rtc_session_cache, sizeof(TLSSessionCache));
+		return session_cache;
+	}
+#endif
+	return nullptr;
+}
+
+// Read-only, so the status page can ask from another task
+bool MQTTTransport::hasCachedSession(const char* hostname) const {
+#if MAVENLED_TLS_SESSION_RTC
+	if (sessionValid(&rtc_session_cache, hostname)) return true;
+#endif
+	return sessionValid(session_cache, hostname);
+}
+
+void MQTTTransport::clearSession() {
+	if (session_cache != nullptr) session_cache->length = 0;
+#if MAVENLED_TLS_SESSION_RTC
+	rtc_session_cache.magic = 0;
+#endif
+}
+
+// Hand the cached session to mbedTLS; it goes into the ClientHello
+bool MQTTTransport::offerSession(const char* hostname) {
+	const TLSSessionCache* cache = cachedSession(hostname);
+	if (cache == nullptr) return false;
+
+	mbedtls_ssl_session session;
+	mbedtls_ssl_session_init(&session);
+	bool offered = mbedtls_ssl_session_load(&session, cache->data, cache->length) == 0 &&
+				   mbedtls_ssl_set_session(&tls->ssl, &session) == 0;
+	if (offered) {
+		memcpy(offered_master, session.MBEDTLS_PRIVATE(master), sizeof(offered_master));
+	} else {
+		clearSession();
+	}
+	mbedtls_ssl_session_free(&session);
+	return offered;
+}
+
+TransportResult MQTTTransport::beginTLS(const char* hostname) {
+	if (!socket_open) return TRANSPORT_ERROR;
+
+	handshake_start = millis();
+	heap_before = ESP.getFreeHeap();
+	heap_lowest = heap_before;
+	strlcpy(tls_host, hostname, sizeof(tls_host));
+
+	tls = new (std::nothrow) TLSState;
+	if (tls == nullptr) {
+		last_error = -1;
+		tls_stats.failures++;
+		return TRANSPORT_ERROR;
+	}
+	mbedtls_ssl_init(&tls->ssl);
+	mbedtls_ssl_config_init(&tls->conf);
+	mbedtls_ctr_drbg_init(&tls->drbg);
+	mbedtls_entropy_init(&tls->entropy);
+
+	static const char personalization[] = "mavenled-mqtt";
+	int ret = mbedtls_ctr_drbg_seed(&tls->drbg, mbedtls_entropy_func, &tls->entropy,
+									(const unsigned char*)personalization, sizeof(personalization) - 1);
+	if (ret == 0) {
+		ret = mbedtls_ssl_config_defaults(&tls->conf, MBEDTLS_SSL_IS_CLIENT,
+										  MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+	}
+	if (ret == 0) {
+		// The printer presents a self-signed certificate; same as setInsecure()
+		mbedtls_ssl_conf_authmode(&tls->conf, MBEDTLS_SSL_VERIFY_NONE);
+		mbedtls_ssl_conf_rng(&tls->conf, mbedtls_ctr_drbg_random, &tls->drbg);
+		mbedtls_ssl_conf_session_tickets(&tls->conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+		ret = mbedtls_ssl_setup(&tls->ssl, &tls->conf);
+	}
+	if (ret == 0) ret = mbedtls_ssl_set_hostname(&tls->ssl, hostname);
+	if (ret != 0) {
+		last_error = ret;
+		tls_stats.failures++;
+		stop();
+		return TRANSPORT_ERROR;
+	}
+
+	session_offered = offerSession(hostname);
+	mbedtls_ssl_set_bio(&tls->ssl, &fd, tlsSend, tlsRecv, nullptr);
+	return pollTLS();
+}
+
+// One handshake step. The crypto itself runs on the calling task; only the
+// waits for the server's flights are turned into PENDING returns.
+TransportResult MQTTTransport::pollTLS() {
+	if (tls == nullptr) return TRANSPORT_ERROR;
+	if (tls_ready) return TRANSPORT_DONE;
+
+	int ret = mbedtls_ssl_handshake(&tls->ssl);
+	uint32_t heap = ESP.getFreeHeap();
+	if (heap < heap_lowest) heap_lowest = heap;
+
+	if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) return TRANSPORT_PENDING;
+	if (ret != 0) {
+		// A server that chokes on the cached session gets a full handshake next time
+		if (session_offered) clearSession();
+		last_error = ret;
+		tls_stats.failures++;
+		stop();
+		return TRANSPORT_ERROR;
+	}
+	tls_ready = true;
+	finishHandshake();
+	return TRANSPORT_DONE;
+}
+
+// Record the handshake and cache the session for the next connect. A
+// resumed session keeps its master secret; a full handshake makes a new one.
+void MQTTTransport::finishHandshake() {
+	unsigned long elapsed = millis() - handshake_start;
+
+	mbedtls_ssl_session session;
+	mbedtls_ssl_session_init(&session);
+	bool haveSession = mbedtls_ssl_get_session(&tls->ssl, &session) == 0;
+	bool resumed = haveSession && session_offered &&
+				   memcmp(session.MBEDTLS_PRIVATE(master), offered_master, sizeof(offered_master)) == 0;
+
+	// Saved even when resumed: the server may have issued a fresh ticket
+	if (haveSession) {
+		if (session_cache == nullptr) session_cache = (TLSSessionCache*)malloc(sizeof(TLSSessionCache));
+		size_t length = 0;
+		if (session_cache != nullptr &&
+			mbedtls_ssl_session_save(&session, session_cache->data, sizeof(session_cache->data), &length) == 0) {
+			session_cache->magic = SESSION_CACHE_MAGIC;
+			session_cache->length = length;
+			strlcpy(session_cache->host, tls_host, sizeof(session_cache->host));
+#if MAVENLED_TLS_SESSION_RTC
+			memcpy(&rtc_session_cache, session_cache, sizeof(TLSSessionCache));
+#endif
+		} else {
+			clearSession();
+		}
+	}
+	mbedtls_ssl_session_free(&session);
+	memset(offered_master, 0, sizeof(offered_master));
+
+	tls_stats.handshakes++;
+	tls_stats.last_resumed = resumed;
+	tls_stats.last_handshake_ms = elapsed;
+	if (resumed) {
+		tls_stats.resumed++;
+		tls_stats.last_resumed_ms = elapsed;
+	} else {
+		if (session_offered) tls_stats.resume_declined++;
+		tls_stats.last_full_ms = elapsed;
+	}
+	tls_stats.last_heap_peak = heap_before - heap_lowest;
+	if (tls_stats.last_heap_peak > tls_stats.max_heap_peak) tls_stats.max_heap_peak = tls_stats.last_heap_peak;
+}
+
+void MQTTTransport::replayConnect(const uint8_t* connack, size_t length) {
+	replay_length = min(length, sizeof(replay));
+	memcpy(replay, connack, replay_length);
+	replay_pos = 0;
+	discard_next_write = true;
+}
+
+// Bytes read, 0 if nothing is waiting, -1 once the connection is closed
+int MQTTTransport::rawRead(uint8_t* buf, size_t size) {
+	if (fd < 0 || !socket_open) return -1;
+
+	if (tls != nullptr) {
+		int ret = mbedtls_ssl_read(&tls->ssl, buf, size);
+		if (ret > 0) return ret;
+		if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) return 0;
+		last_error = ret;
+	} else {
+		int ret = recv(fd, buf, size, MSG_DONTWAIT);
+		if (ret > 0) return ret;
+		if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+		last_error = (ret < 0) ? errno : 0;
+	}
+	socket_open = false;
+	return -1;
+}
+
+// Bytes written, 0 if the socket buffer is full, -1 on error
+int MQTTTransport::rawWrite(const uint8_t* buf, size_t size) {
+	if (fd < 0 || !socket_open) return -1;
+
+	if (tls != nullptr) {
+		int ret = mbedtls_ssl_write(&tls->ssl, buf, size);
+		if (ret >= 0) return ret;
+		if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) return 0;
+		last_error = ret;
+	} else {
+		int ret = send(fd, buf, size, MSG_DONTWAIT);
+		if (ret >= 0) return ret;
+		if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+		last_error = errno;
+	}
+	socket_open = false;
+	return -1;
+}
+
+bool MQTTTransport::waitWritable(unsigned long timeoutMs) {
+	fd_set writable;
+	FD_ZERO(&writable);
+	FD_SET(fd, &writable);
+	struct timeval timeout = {0, (long)(timeoutMs * 1000)};
+	return select(fd + 1, nullptr, &writable, nullptr, &timeout) > 0;
+}
+
+int MQTTTransport::readAvailable(uint8_t* buf, size_t size) {
+	return rawRead(buf, size);
+}
+
+int MQTTTransport::connect(IPAddress ip, uint16_t port) {
+	return 0;
+}
+
+int MQTTTransport::connect(const char* host, uint16_t port) {
+	return 0;
+}
+
+size_t MQTTTransport::write(uint8_t b) {
+	return write(&b, 1);
+}
+
+size_t MQTTTransport::write(const uint8_t* buf, size_t size) {
+	if (discard_next_write) {
+		discard_next_write = false;
+		return size;
+	}
+
+	size_t sent = 0;
+	unsigned long start = millis();
+	while (sent < size) {
+		int written = rawWrite(buf + sent, size - sent);
+		if (written < 0) break;
+		if (written == 0) {
+			if (millis() - start >= WRITE_TIMEOUT_MS) break;
+			waitWritable(10);
+			continue;
+		}
+		sent += written;
+	}
+	return sent;
+}
+
+int MQTTTransport::available() {
+	if (replay_pos < replay_length) return replay_length - replay_pos;
+
+	if (peek_byte < 0) {
+		uint8_t b;
+		if (rawRead(&b, 1) == 1) peek_byte = b;
+	}
+	if (peek_byte < 0) return 0;
+
+	int pending = 1;
+	if (tls != nullptr) {
+		pending += mbedtls_ssl_get_bytes_avail(&tls->ssl);
+	} else {
+		int queued = 0;
+		if (ioctl(fd, FIONREAD, &queued) == 0) pending += queued;
+	}
+	return pending;
+}
+
+int MQTTTransport::read() {
+	uint8_t b;
+	return (read(&b, 1) == 1) ? b : -1;
+}
+
+int MQTTTransport::read(uint8_t* buf, size_t size) {
+	size_t count = 0;
+	while (count < size && replay_pos < replay_length) buf[count++] = replay[replay_pos++];
+	if (count < size && peek_byte >= 0) {
+		buf[count++] = peek_byte;
+		peek_byte = -1;
+	}
+	if (count < size) {
+		int received = rawRead(buf + count, size - count);
+		if (received > 0) count += received;
+	}
+	return (count > 0) ? count : -1;
+}
+
+int MQTTTransport::peek() {
+	if (replay_pos < replay_length) return replay[replay_pos];
+	available();
+	return peek_byte;
+}
+
+void MQTTTransport::stop() {
+	if (tls != nullptr) {
+		if (tls_ready) mbedtls_ssl_close_notify(&tls->ssl);
+		mbedtls_ssl_free(&tls->ssl);
+		mbedtls_ssl_config_free(&tls->conf);
+		mbedtls_ctr_drbg_free(&tls->drbg);
+		mbedtls_entropy_free(&tls->entropy);
+		delete tls;
+		tls = nullptr;
+	}
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+	socket_open = false;
+	tls_ready = false;
+	peek_byte = -1;
+	discard_next_write = false;
+	replay_length = 0;
+	replay_pos = 0;
+}
+
+uint8_t MQTTTransport::connected() {
+	if (fd < 0 || !socket_open || (use_tls && !tls_ready)) return 0;
+	if (replay_pos < replay_length || peek_byte >= 0) return 1;
+	if (tls != nullptr && mbedtls_ssl_get_bytes_avail(&tls->ssl) > 0) return 1;
+
+	// A zero-length peek means the peer closed the connection
+	uint8_t b;
+	int ret = recv(fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+	if (ret == 0 || (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+		last_error = (ret < 0) ? errno : 0;
+		socket_open = false;
+		return 0;
+	}
+	return 1;
+}
@@ -0,0 +1,123 @@
+#ifndef MQTT_TRANSPORT_H
+#define MQTT_TRANSPORT_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+// Socket, optionally wrapped in TLS, that PubSubClient reads and writes
+// through. The connection pipeline opens it one non-blocking step at a time
+// (TCP connect, TLS handshake), so PubSubClient only ever sees an open
+// connection and never blocks in connect().
+enum TransportResult {
+  TRANSPORT_PENDING,
+  TRANSPORT_DONE,
+  TRANSPORT_ERROR
+};
+
+// TLS sessions are cached after each handshake and offered on the next
+// connect, so a reconnect to the same broker can skip the certificate
+// exchange and key agreement. If the server declines, mbedTLS falls back
+// to a full handshake. The cache is copied to RTC memory so it survives a
+// restart; set MAVENLED_TLS_SESSION_RTC to 0 to keep it in RAM only.
+#ifndef MAVENLED_TLS_SESSION_RTC
+#define MAVENLED_TLS_SESSION_RTC 1
+#endif
+
+// Serialized session, including the server certificate
+#define TLS_SESSION_CACHE_BYTES 2048
+
+struct TLSSessionCache {
+  uint32_t magic;
+  uint16_t length;   // 0 = empty
+  char host[64];     // Only offered to the broker it came from
+  uint8_t data[TLS_SESSION_CACHE_BYTES];
+};
+
+struct TLSStats {
+  uint32_t handshakes = 0;
+  uint32_t resumed = 0;             // Server accepted the cached session
+  uint32_t resume_declined = 0;     // Session offered, full handshake done
+  uint32_t failures = 0;
+  bool last_resumed = false;
+  unsigned long last_handshake_ms = 0;
+  unsigned long last_full_ms = 0;
+  unsigned long last_resumed_ms = 0;
+  uint32_t last_heap_peak = 0;      // Heap taken below the pre-handshake level,
+  uint32_t max_heap_peak = 0;       // sampled after each handshake step
+};
+
+// mbedTLS contexts, allocated for the life of one connection
+struct TLSState;
+
+class MQTTTransport : public Client {
+public:
+  explicit MQTTTransport(bool tls) : use_tls(tls) {}
+
+  // Connection steps; each call returns without waiting on the network.
+  // address is an IPv4 address in network byte order.
+  TransportResult beginConnect(uint32_t address, uint16_t port);
+  TransportResult pollConnect();
+  TransportResult beginTLS(const char* hostname);
+  TransportResult pollTLS();
+
+  // Non-blocking read for the pipeline: bytes read, 0 = nothing yet, -1 = closed
+  int readAvailable(uint8_t* buf, size_t size);
+
+  // The pipeline does the MQTT CONNECT exchange itself. PubSubClient's own
+  // CONNECT write is then swallowed and it is handed the CONNACK the broker
+  // already sent, so client.connect() returns at once.
+  void replayConnect(const uint8_t* connack, size_t length);
+
+  bool usesTLS() const { return use_tls; }
+  int lastError() const { return last_error; }
+  bool hasCachedSession(const char* hostname) const;
+  void clearSession();
+
+  TLSStats tls_stats;
+
+  // Client interface. connect() is not used: the pipeline opens the socket.
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(const char* host, uint16_t port) override;
+  size_t write(uint8_t b) override;
+  size_t write(const uint8_t* buf, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buf, size_t size) override;
+  int peek() override;
+  void flush() override {}
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+
+private:
+  int rawRead(uint8_t* buf, size_t size);
+  int rawWrite(const uint8_t* buf, size_t size);
+  bool waitWritable(unsigned long timeoutMs);
+  const TLSSessionCache* cachedSession(const char* hostname);
+  bool offerSession(const char* hostname);
+  void finishHandshake();
+
+  bool use_tls;
+  int fd = -1;
+  bool socket_open = false;   // TCP established and not closed by the peer
+  bool tls_ready = false;
+  int last_error = 0;
+  int peek_byte = -1;
+  TLSState* tls = nullptr;
+
+  // Session cache and the handshake in progress
+  TLSSessionCache* session_cache = nullptr;  // Allocated on first use
+  char tls_host[64] = "";
+  bool session_offered = false;
+  uint8_t offered_master[48];
+  unsigned long handshake_start = 0;
+  uint32_t heap_before = 0;
+  uint32_t heap_lowest = 0;
+
+  bool discard_next_write = false;
+  uint8_t replay[4];
+  size_t replay_length = 0;
+  size_t replay_pos = 0;
+};
+
+#endif
@@ -2,28 +2,34 @@
 #include "../config/Settings.h"
 #include "../printer/PrinterState.h"
 #include "../web/WebHandlers.h"
+#include "../led/LEDCommands.h"
+#include "../diagnostics/Profiler.h"
 #include <ArduinoJson.h>
 #include <ESPmDNS.h>
 
 // Constants
 const char* RELAY_SERVER_URL = "https://maven-led-server.vercel.app";
-const int MAX_WIFI_FAILURES = 5;
-const unsigned long WIFI_RETRY_INTERVAL = 30000;
+const int MAX_WIFI_FAILURES = 10;
 const unsigned long MQTT_RESTART_DELAY = 2000;
 const unsigned long SYSTEM_STABILIZATION_MS = 10000;
 
+static bool configurePrinterEndpoint(MQTTEndpoint& endpoint);
+static bool configureRemoteEndpoint(MQTTEndpoint& endpoint);
+
 // Network Global Variables
-WiFiClientSecure espClient;
-PubSubClient client(espClient);
-WiFiClient remoteClient;
-PubSubClient remoteControlClient(remoteClient);
+MQTTTransport printerTransport(true);
+PubSubClient client(printerTransport);
+MQTTTransport remoteTransport(false);
+PubSubClient remoteControlClient(remoteTransport);
+
+MQTTConnection printer_mqtt("printer", &client, &printerTransport, configurePrinterEndpoint);
+MQTTConnection remote_mqtt("remote", &remoteControlClient, &remoteTransport, configureRemoteEndpoint);
 
 unsigned long lastMQTTupdate = 0;
 unsigned long lastMQTTProcessTime = 0;
-unsigned long lastMQTTReconnectAttempt = 0;
 
 volatile int wifi_failure_count = 0;
-volatile unsigned long last_wifi_attempt = 0;
+volatile int wifi_disconnect_reason = 0;
 volatile bool wifi_just_reconnected = false;
 volatile unsigned long wifi_reconnect_time = 0;
 volatile bool mqtt_restart_pending = false;
@@ -220,6 +226,7 @@ bool useSavedMQTTSettings() {
 }
 
 void callback(char* topic, byte* payload, unsigned int length) {
+	PROFILE_SCOPE(PROFILE_MQTT_CALLBACK);
 	unsigned long currentTime = millis();
 	if (currentTime - lastMQTTProcessTime < 500) {
 		lastMQTTupdate = currentTime;
@@ -236,6 +243,7 @@ void callback(char* topic, byte* payload, unsigned int length) {
 	
 	if (length > 50 && printer_state.status == "initializing") {
 		printer_state.status = "idle";
+		markPrinterStatusChanged();
 		Serial.println(" Printer connected - status changed to idle");
 	}
 	
@@ -271,71 +279,83 @@ void callback(char* topic, byte* payload, unsigned int length) {
 	doc.clear();
 }
 
-bool connectToWiFi() {
-	const char* wifiSSID = settings.wifi_ssid;
-	const char* wifiPassword = settings.wifi_password;
-	
-	if (strlen(wifiSSID) == 0) {
-		Serial.println(" No WiFi credentials available!");
-		return false;
-	}
-	
-	Serial.printf(" Attempting WiFi connection to: %s\n", wifiSSID);
-	
-	WiFi.disconnect(true);
-	WiFi.mode(WIFI_OFF);
-	delay(1000);
-	WiFi.mode(WIFI_STA);
-	delay(1000);
-	
-	WiFi.setAutoReconnect(false);
-	WiFi.setSleep(false);
-	
-	WiFi.begin(wifiSSID, wifiPassword);
-	
-	int attempts = 0;
-	const int maxAttempts = 40;
-	
-	while (WiFi.status() != WL_CONNECTED && attempts < maxAttempts) {
-		delay(500);
-		yield();
-		attempts++;
-		
-		if (attempts % 4 == 0) {
-			Serial.printf("    Attempt %d/%d - Status: %d\n", attempts/4, maxAttempts/4, WiFi.status());
+// The Arduino WiFi class behind the connection manager. The library keeps
+// WiFi.status() current from the driver's events, so reading it is cheap.
+class ArduinoWiFi : public WiFiInterface {
+public:
+	void begin() override {
+		WiFi.mode(WIFI_STA);
+		WiFi.setAutoReconnect(false);
+		WiFi.setSleep(false);
+		WiFi.begin(settings.wifi_ssid, settings.wifi_password);
+	}
+	void disconnect() override {
+		WiFi.disconnect();
+	}
+	WiFiLinkState linkState() override {
+		switch (WiFi.status()) {
+			case WL_CONNECTED: return WIFI_LINK_UP;
+			case WL_CONNECT_FAILED:
+			case WL_NO_SSID_AVAIL: return WIFI_LINK_FAILED;
+			default: return WIFI_LINK_DOWN;
 		}
-		
-		if (WiFi.status() == WL_CONNECT_FAILED) {
-			Serial.println("    Connection failed - wrong credentials?");
+	}
+	void startAccessPoint() override {
+		startAPMode();
+	}
+	unsigned long now() override {
+		return millis();
+	}
+	uint32_t random(uint32_t bound) override {
+		return ::random((long)bound);
+	}
+};
+
+static ArduinoWiFi arduino_wifi;
+
+static void onWiFiDisconnected(WiFiEvent_t event, WiFiEventInfo_t info) {
+	wifi_disconnect_reason = info.wifi_sta_disconnected.reason;
+}
+
+// Run the connection manager and log what it did. Returns the event so the
+// network task can stop or restart MQTT.
+WiFiConnectionEvent serviceWiFi() {
+	WiFiConnectionEvent event = wifiConnectionService(wifi_connection);
+	const WiFiConnectionStats& stats = wifi_connection.stats;
+
+	switch (event) {
+		case WIFI_EVENT_CONNECTED:
+			Serial.printf(" WiFi connected to %s in %lu ms (attempt %u)\n",
+						  settings.wifi_ssid, stats.last_attempt_ms, (unsigned)stats.attempts);
+			Serial.printf("    IP: %s | RSSI: %d dBm | Channel: %d\n",
+						  WiFi.localIP().toString().c_str(),
+						  WiFi.RSSI(),
+						  WiFi.channel());
+			Serial.printf("    Gateway: %s | Subnet: %s\n",
+						  WiFi.gatewayIP().toString().c_str(),
+						  WiFi.subnetMask().toString().c_str());
+			if (stats.disconnects > 0) {
+				Serial.printf("    Recovered %lu ms after the link dropped\n", stats.last_recovery_ms);
+			}
+			wifi_just_reconnected = true;
+			wifi_reconnect_time = millis();
 			break;
-		}
-		if (WiFi.status() == WL_NO_SSID_AVAIL) {
-			Serial.println("    SSID not found - network unavailable?");
+		case WIFI_EVENT_LOST:
+			Serial.printf(" WiFi link lost (reason %d) - reconnecting\n", wifi_disconnect_reason);
+			break;
+		case WIFI_EVENT_ATTEMPT_FAILED:
+			Serial.printf(" WiFi connection failed (status %d, reason %d). Retry in %lu ms (%u/%d)\n",
+						  WiFi.status(), wifi_disconnect_reason, stats.backoff_ms,
+						  (unsigned)stats.failures, MAX_WIFI_FAILURES);
+			break;
+		case WIFI_EVENT_AP_STARTED:
+			Serial.println(" Initial WiFi connection failed! Started AP mode");
+			break;
+		case WIFI_EVENT_NONE:
 			break;
-		}
-	}
-	
-	if (WiFi.status() == WL_CONNECTED) {
-		Serial.println(" WiFi connected successfully!");
-		Serial.printf("    IP: %s (Static) | RSSI: %d dBm | Channel: %d\n", 
-					  WiFi.localIP().toString().c_str(), 
-					  WiFi.RSSI(), 
-					  WiFi.channel());
-		Serial.printf("    Gateway: %s | Subnet: %s\n", 
-					  WiFi.gatewayIP().toString().c_str(),
-					  WiFi.subnetMask().toString().c_str());
-		wifi_failure_count = 0;
-		
-		wifi_just_reconnected = true;
-		wifi_reconnect_time = millis();
-		Serial.println(" WiFi reconnected - MQTT will restart in 2 seconds...");
-		
-		return true;
-	} else {
-		Serial.printf(" WiFi connection failed after %d attempts (Status: %d)\n", attempts, WiFi.status());
-		wifi_failure_count++;
-		return false;
 	}
+	wifi_failure_count = stats.failures;
+	return event;
 }
 
 void startAPMode() {
@@ -358,7 +378,6 @@ void startAPMode() {
 }
 
 void setup_wifi() {
-	delay(10);
 	Serial.println();
 	
 	bool hasSavedCredentials = strlen(settings.wifi_ssid) > 0;
@@ -370,190 +389,109 @@ void setup_wifi() {
 	}
 	
 	wifi_failure_count = 0;
+	WiFi.onEvent(onWiFiDisconnected, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
 	
-	if (!inAP && connectToWiFi()) {
-		Serial.println(" Initial WiFi setup successful!");
-		return;
-	}
-	
-	Serial.println(" All WiFi connections failed! Starting AP mode...");
-	startAPMode();
+	// Returns at once; the network task services the attempt. If the first
+	// attempt fails the setup AP is started as before.
+	Serial.printf(" Connecting to WiFi: %s\n", settings.wifi_ssid);
+	wifiConnectionBegin(wifi_connection, &arduino_wifi, true);
 }
 
-void reconnect() {
-	int reconnectAttempts = 0;
-	const int maxReconnectAttempts = 2;
-	
-	String serverIP, username, password, mqttTopic;
-	
+static bool configurePrinterEndpoint(MQTTEndpoint& endpoint) {
 	if (isGlobalMode()) {
-		serverIP = "us.mqtt.bambulab.com";
-		username = getGlobalMQTTUsername();
-		password = getAccessToken();
-		mqttTopic = "device/" + String(settings.device_serial) + "/report";
+		endpoint.host = "us.mqtt.bambulab.com";
+		endpoint.username = getGlobalMQTTUsername();
+		endpoint.password = getAccessToken();
 		
-		if (username.length() == 0 || password.length() == 0) {
+		if (endpoint.username.length() == 0 || endpoint.password.length() == 0) {
 			Serial.println(" Global mode: Missing username or access token");
-			printer_state.is_connected = false;
-			printer_state.status = "unknown";
-			return;
+			return false;
 		}
-		
 		if (isTokenExpired()) {
 			Serial.println("️ Global mode: Access token has expired");
-			printer_state.is_connected = false;
-			printer_state.status = "unknown";
-			return;
+			return false;
 		}
-		
-		Serial.printf(" Global mode connection to %s with username: %s\n", serverIP.c_str(), username.c_str());
 	} else {
-		serverIP = useSavedMQTTSettings() ? String(settings.mqtt_server) : "";
-		username = "bblp";
-		password = useSavedMQTTSettings() ? String(settings.mqtt_password) : "";
-		mqttTopic = useSavedMQTTSettings() ? getMQTTTopic() : "";
-		
-		Serial.printf(" Local mode connection to %s\n", serverIP.c_str());
-	}
-	
-	while (!client.connected() && reconnectAttempts < maxReconnectAttempts) {
-		reconnectAttempts++;
-		Serial.println();
-		Serial.printf("Attempting MQTT connection #%d to %s:8883 (TLS)...\n", reconnectAttempts, serverIP.c_str());
-		
-		String clientId = "ESP32Client-";
-		clientId += String(random(0xffff), HEX);
-		
-		if (client.connect(clientId.c_str(), username.c_str(), password.c_str())) {
-			Serial.println("connected!");
-			Serial.print("Subscribing to topic: ");
-			Serial.println(mqttTopic);
-			if (client.subscribe(mqttTopic.c_str())) {
-				Serial.println("Successfully subscribed to topic");
-				reconnectAttempts = 0;
-			} else {
-				Serial.println("Failed to subscribe to topic");
-			}
-		} else {
-			Serial.print("failed, rc=");
-			int state = client.state();
-			Serial.print(state);
-			Serial.print(" (");
-			switch(state) {
-				case -4: Serial.print("Connection timeout"); break;
-				case -3: Serial.print("Connection lost"); break;
-				case -2: Serial.print("Connect failed"); break;
-				case -1: Serial.print("Disconnected"); break;
-				case 1: Serial.print("Bad protocol"); break;
-				case 2: Serial.print("Bad client ID"); break;
-				case 3: Serial.print("Unavailable"); break;
-				case 4: Serial.print("Bad credentials"); break;
-				case 5: Serial.print("Unauthorized"); break;
-				default: Serial.print("Unknown error"); break;
-			}
-			Serial.println(") try again in 5 seconds");
-			
-			for (int i = 0; i < 25; i++) {
-				delay(200);
-				yield();
-				vTaskDelay(1 / portTICK_PERIOD_MS);
-			}
+		if (!useSavedMQTTSettings()) {
+			Serial.println(" Local mode: No printer IP or serial configured");
+			return false;
 		}
+		endpoint.host = settings.mqtt_server;
+		endpoint.username = "bblp";
+		endpoint.password = settings.mqtt_password;
 	}
 	
-	if (reconnectAttempts >= maxReconnectAttempts) {
-		Serial.println("Returning to unknown state after max reconnect attempts");
-		printer_state.is_connected = false;
-		printer_state.status = "unknown";
-		printer_state.raw_gcode_state = "unknown";
-		printer_state.last_stable_status = "unknown";
-		printer_state.last_status_change = millis();
-		printer_state.temp_readings_count = 0;
-		printer_state.is_heating = false;
-		printer_state.is_cooling = false;
-		printer_state.heating_exit_timer_started = false;
-		printer_state.cooling_exit_timer_started = false;
-		printer_state.finish_animation_active = false;
-		printer_state.error_recovery_active = false;
-		printer_state.state_override_active = false;
-		lastMQTTupdate = millis();
-	}
+	endpoint.port = 8883;
+	endpoint.client_id = "ESP32Client-" + String(random(0xffff), HEX);
+	endpoint.topic = getMQTTTopic();
+	endpoint.keepalive = 60;
+	return true;
 }
 
+// Starts the connection pipeline and returns at once; the network task
+// drives it through serviceMQTT()
 void startMQTTService(bool isInitialConnection) {
 	Serial.println(" Starting MQTT service...");
 	Serial.printf(" Current MQTT Mode: %s\n", settings.mqtt_mode_global ? "GLOBAL" : "LOCAL");
 	
-	espClient.setInsecure();
-	
-	char serverIP[64];
-	char mqttTopic[128];
-	
-	if (isGlobalMode()) {
-		strcpy(serverIP, "us.mqtt.bambulab.com");
-		snprintf(mqttTopic, sizeof(mqttTopic), "device/%s/report", settings.device_serial);
-		Serial.println(" Configuring for Global MQTT mode");
-	} else {
-		if (useSavedMQTTSettings()) {
-			strcpy(serverIP, settings.mqtt_server);
-			snprintf(mqttTopic, sizeof(mqttTopic), "device/%s/report", settings.device_serial);
-		}
-		Serial.println(" Configuring for Local MQTT mode");
-	}
-	
-	Serial.print(" Setting MQTT server to: ");
-	Serial.print(serverIP);
-	Serial.println(":8883 (TLS)");
-	
-	client.setServer(serverIP, 8883);
 	client.setCallback(callback);
-	client.setKeepAlive(60);
-	client.setSocketTimeout(30);
-	
-	int attempts = 0;
-	const int maxAttempts = 2;
+	mqttConnectionStart(printer_mqtt);
 	
-	String username;
-	String password;
-	String clientId;
-	
-	if (isGlobalMode()) {
-		username = getGlobalMQTTUsername();
-		password = getAccessToken();
-	} else {
-		username = "bblp";
-		password = useSavedMQTTSettings() ? String(settings.mqtt_password) : "";
+	if (printer_mqtt.step != MQTT_STEP_BACKOFF) {
+		Serial.printf(" Connecting to %s:%d (TLS)\n", printer_mqtt.endpoint.host.c_str(), printer_mqtt.endpoint.port);
 	}
-	
-	while (!client.connected() && attempts < maxAttempts) {
-		attempts++;
-		Serial.printf(" MQTT connection attempt %d/%d...\n", attempts, maxAttempts);
-		
-		clientId = "ESP32Client-" + String(random(0xffff), HEX);
-		
-		if (client.connect(clientId.c_str(), username.c_str(), password.c_str())) {
-			Serial.println(" MQTT connected successfully!");
-			
-			if (client.subscribe(mqttTopic)) {
-				Serial.printf(" Subscribed to topic: %s\n", mqttTopic);
-				printer_state.is_connected = true;
-				lastMQTTupdate = millis();
-			} else {
-				Serial.println(" Failed to subscribe to MQTT topic");
-			}
-		} else {
-			Serial.printf(" MQTT connection failed, rc=%d. Retrying in 2 seconds...\n", client.state());
-			for (int i = 0; i < 20; i++) {
-				delay(100);
-				yield();
-			}
-		}
+}
+
+static void logConnectFailure(const MQTTConnection& connection) {
+	const MQTTConnectStats& stats = connection.stats;
+	Serial.printf(" %s MQTT connection failed at %s: %s (%d). Retry in %lu ms\n",
+				  connection.name, mqttConnectStepName(stats.failed_step),
+				  stats.last_error, stats.error_code, stats.backoff_ms);
+}
+
+static void logConnected(const MQTTConnection& connection) {
+	const MQTTConnectStats& stats = connection.stats;
+	Serial.printf(" %s MQTT connected in %lu ms (dns %lu, tcp %lu, tls %lu, connect %lu, subscribe %lu)\n",
+				  connection.name, stats.last_connect_ms,
+				  stats.step_ms[MQTT_STEP_DNS], stats.step_ms[MQTT_STEP_TCP], stats.step_ms[MQTT_STEP_TLS],
+				  stats.step_ms[MQTT_STEP_CONNECT], stats.step_ms[MQTT_STEP_SUBSCRIBE]);
+	if (connection.transport->usesTLS()) {
+		const TLSStats& tls = connection.transport->tls_stats;
+		Serial.printf(" TLS %s handshake, %u bytes heap peak\n",
+					  tls.last_resumed ? "resumed" : "full", tls.last_heap_peak);
 	}
-	
-	if (!client.connected()) {
-		Serial.println(" MQTT connection failed after all attempts");
-		printer_state.is_connected = false;
-		Serial.println(" Reverting to rainbow animation - MQTT connection failed");
+	if (connection.endpoint.topic.length() > 0) {
+		Serial.printf(" Subscribed to topic: %s\n", connection.endpoint.topic.c_str());
+	}
+}
+
+static void setPrinterConnected(bool connected) {
+	if (xSemaphoreTake(printerStateMutex, 10 / portTICK_PERIOD_MS) != pdTRUE) return;
+	if (printer_state.is_connected != connected) {
+		printer_state.is_connected = connected;
+		markPrinterStatusChanged();
+	}
+	xSemaphoreGive(printerStateMutex);
+}
+
+// Advance the printer connection. Runs on the network task.
+void serviceMQTT() {
+	switch (mqttConnectionService(printer_mqtt)) {
+		case MQTT_EVENT_CONNECTED:
+			logConnected(printer_mqtt);
+			lastMQTTupdate = millis();
+			setPrinterConnected(true);
+			break;
+		case MQTT_EVENT_LOST:
+			Serial.println(" MQTT connection lost - reconnecting");
+			setPrinterConnected(false);
+			break;
+		case MQTT_EVENT_FAILED:
+			logConnectFailure(printer_mqtt);
+			setPrinterConnected(false);
+			break;
+		case MQTT_EVENT_NONE:
+			break;
 	}
 }
 
@@ -564,13 +502,13 @@ void stopMQTTService() {
 		String mqttTopic = useSavedMQTTSettings() ? getMQTTTopic() : "";
 		client.unsubscribe(mqttTopic.c_str());
 		Serial.printf(" Unsubscribed from topic: %s\n", mqttTopic.c_str());
-		
-		client.disconnect();
 		Serial.println(" MQTT disconnected");
 	}
+	mqttConnectionStop(printer_mqtt);
 	
 	printer_state.is_connected = false;
 	printer_state.status = "unknown";
+	markPrinterStatusChanged();
 	Serial.println(" MQTT service stopped");
 }
 
@@ -642,10 +580,16 @@ void processRemoteCommand(DynamicJsonDocument& cmd) {
 	if (command == "set_brightness") {
 		if (cmd.containsKey("value")) {
 			int brightness = constrain((int)cmd["value"], 1, 255);
-			settings.global_brightness = brightness;
-			saveSettings();
-			message = "Brightness set to " + String(brightness);
-			Serial.printf(" Brightness set to %d via remote\n", brightness);
+			LEDCommandBatch batch;
+			batch.add(LED_CMD_BRIGHTNESS, brightness);
+			if (submitLEDCommands(batch)) {
+				saveSettings();
+				message = "Brightness set to " + String(brightness);
+				Serial.printf(" Brightness set to %d via remote\n", brightness);
+			} else {
+				success = false;
+				message = "LED task busy";
+			}
 		} else {
 			success = false;
 			message = "Missing brightness value";
@@ -653,13 +597,19 @@ void processRemoteCommand(DynamicJsonDocument& cmd) {
 	}
 	else if (command == "set_night_mode") {
 		if (cmd.containsKey("enabled")) {
-			settings.night_mode_enabled = cmd["enabled"];
+			LEDCommandBatch batch;
+			batch.add(LED_CMD_NIGHT_MODE, cmd["enabled"].as<bool>());
 			if (cmd.containsKey("brightness")) {
-				settings.night_mode_brightness = constrain((int)cmd["brightness"], 1, 255);
+				batch.add(LED_CMD_NIGHT_BRIGHTNESS, cmd["brightness"]);
+			}
+			if (submitLEDCommands(batch)) {
+				saveSettings();
+				message = "Night mode " + String(settings.night_mode_enabled ? "enabled" : "disabled");
+				Serial.printf(" Night mode %s via remote\n", settings.night_mode_enabled ? "enabled" : "disabled");
+			} else {
+				success = false;
+				message = "LED task busy";
 			}
-			saveSettings();
-			message = "Night mode " + String(settings.night_mode_enabled ? "enabled" : "disabled");
-			Serial.printf(" Night mode %s via remote\n", settings.night_mode_enabled ? "enabled" : "disabled");
 		} else {
 			success = false;
 			message = "Missing enabled parameter";
@@ -749,61 +699,48 @@ void publishDeviceStatus() {
 	}
 }
 
+static bool configureRemoteEndpoint(MQTTEndpoint& endpoint) {
+	if (!settings.remote_control_enabled || strlen(settings.remote_mqtt_server) == 0) return false;
+	
+	String chipId = String((uint32_t)ESP.getEfuseMac(), HEX);
+	chipId.toUpperCase();
+	String deviceId = (strlen(settings.device_id) > 0) ? String(settings.device_id) : chipId;
+	
+	endpoint.host = settings.remote_mqtt_server;
+	endpoint.port = settings.remote_mqtt_port;
+	endpoint.client_id = "MavenLED_" + deviceId;
+	endpoint.username = settings.remote_username;
+	endpoint.password = settings.remote_password;
+	endpoint.topic = getRemoteCommandTopic();
+	endpoint.keepalive = 60;
+	return true;
+}
+
+// Starts connecting to the remote broker and returns at once; loop()
+// drives it through serviceRemoteControl()
 void reconnectRemoteControl() {
 	if (!settings.remote_control_enabled) {
 		return;
 	}
 	
-	int attempts = 0;
-	const int maxAttempts = 3;
-	
-	while (!remoteControlClient.connected() && attempts < maxAttempts) {
-		attempts++;
-		Serial.printf(" Connecting to remote MQTT broker %s:%d (attempt %d/%d)...\n", 
-					  settings.remote_mqtt_server, settings.remote_mqtt_port, attempts, maxAttempts);
-		
-		String chipId = String((uint32_t)ESP.getEfuseMac(), HEX);
-		chipId.toUpperCase();
-		String deviceId = (strlen(settings.device_id) > 0) ? String(settings.device_id) : chipId;
-		String clientId = "MavenLED_" + deviceId;
-		
-		bool connected = false;
-		if (strlen(settings.remote_username) > 0) {
-			connected = remoteControlClient.connect(clientId.c_str(), 
-												  settings.remote_username, 
-												  settings.remote_password);
-		} else {
-			connected = remoteControlClient.connect(clientId.c_str());
-		}
-		
-		if (connected) {
-			Serial.println(" Connected to remote MQTT broker!");
-			
-			String chipId = String((uint32_t)ESP.getEfuseMac(), HEX);
-			chipId.toUpperCase();
-			String actualDeviceId = (strlen(settings.device_id) > 0) ? String(settings.device_id) : chipId;
-			Serial.printf(" Using Device ID: %s (Chip ID: %s)\n", actualDeviceId.c_str(), chipId.c_str());
-			
-			String cmdTopic = getRemoteCommandTopic();
-			Serial.printf(" Attempting to subscribe to: %s\n", cmdTopic.c_str());
-			
-			if (remoteControlClient.subscribe(cmdTopic.c_str())) {
-				Serial.printf(" Subscribed to: %s\n", cmdTopic.c_str());
-				publishDeviceStatus();
-				return;
-			} else {
-				Serial.println(" Failed to subscribe to command topic");
-			}
-		} else {
-			Serial.printf(" Remote MQTT connection failed, rc=%d\n", remoteControlClient.state());
-			for (int i = 0; i < 20; i++) {
-				delay(100);
-				yield();
-			}
-		}
-	}
-	
-	if (attempts >= maxAttempts) {
-		Serial.println(" Failed to connect to remote MQTT broker after maximum attempts");
+	Serial.printf(" Connecting to remote MQTT broker %s:%d...\n", 
+				  settings.remote_mqtt_server, settings.remote_mqtt_port);
+	mqttConnectionStart(remote_mqtt);
+}
+
+void serviceRemoteControl() {
+	switch (mqttConnectionService(remote_mqtt)) {
+		case MQTT_EVENT_CONNECTED:
+			logConnected(remote_mqtt);
+			publishDeviceStatus();
+			break;
+		case MQTT_EVENT_LOST:
+			Serial.println(" Remote MQTT disconnected - reconnecting");
+			break;
+		case MQTT_EVENT_FAILED:
+			logConnectFailure(remote_mqtt);
+			break;
+		case MQTT_EVENT_NONE:
+			break;
 	}
 }
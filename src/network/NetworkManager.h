@@ -7,30 +7,32 @@
 #include <HTTPClient.h>
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include "WiFiConnection.h"
+#include "MQTTConnection.h"
 
 // Relay server configuration
 extern const char* RELAY_SERVER_URL;
 
 // Network clients
-extern WiFiClientSecure espClient;
+extern MQTTTransport printerTransport;
 extern PubSubClient client;
-extern WiFiClient remoteClient;
+extern MQTTTransport remoteTransport;
 extern PubSubClient remoteControlClient;
+extern MQTTConnection printer_mqtt;
+extern MQTTConnection remote_mqtt;
 
 // Network state
 extern unsigned long lastMQTTupdate;
 extern unsigned long lastMQTTProcessTime;
-extern unsigned long lastMQTTReconnectAttempt;
 extern unsigned long mqttConnectionTime;
 extern bool inAP;
 
 // WiFi failure tracking
 extern volatile int wifi_failure_count;
-extern volatile unsigned long last_wifi_attempt;
+extern volatile int wifi_disconnect_reason;
 extern volatile bool wifi_just_reconnected;
 extern volatile unsigned long wifi_reconnect_time;
 extern const int MAX_WIFI_FAILURES;
-extern const unsigned long WIFI_RETRY_INTERVAL;
 
 // MQTT restart timing
 extern volatile bool mqtt_restart_pending;
@@ -62,10 +64,10 @@ extern PendingCommand lastCommand;
 // Network functions
 void setup_wifi();
 void startAPMode();
-bool connectToWiFi();
-void reconnect();
+WiFiConnectionEvent serviceWiFi();
 void startMQTTService(bool isInitialConnection = false);
 void stopMQTTService();
+void serviceMQTT();
 void callback(char* topic, byte* payload, unsigned int length);
 void remoteControlCallback(char* topic, byte* payload, unsigned int length);
 void processRemoteCommand(DynamicJsonDocument& cmd);
@@ -73,6 +75,7 @@ void sendCommandAck(String command_id, bool success, String message = "");
 void publishDeviceStatus();
 void publishPrinterStatus();
 void reconnectRemoteControl();
+void serviceRemoteControl();
 
 // Global mode support
 bool isGlobalMode();
@@ -0,0 +1,321 @@
+#include "UDPInput.h"
+#include "UDPOutput.h"
+#include "../config/Settings.h"
+#include "../diagnostics/Profiler.h"
+#include <WiFi.h>
+#include <lwip/sockets.h>
+
+// Receive task runs on the network core; it only blocks in select()
+static const int UDP_INPUT_TASK_PRIORITY = 1;
+static const int UDP_INPUT_TASK_CORE = 0;
+
+#define E131_HEADER_BYTES 126
+#define E131_BYTES_PER_UNIVERSE 510
+
+enum InputSocket {
+	INPUT_DDP,
+	INPUT_E131,
+	INPUT_WLED,
+	INPUT_SOCKET_COUNT
+};
+
+static const uint16_t input_ports[INPUT_SOCKET_COUNT] = {DDP_PORT, E131_PORT, WLED_REALTIME_PORT};
+static int input_sockets[INPUT_SOCKET_COUNT] = {-1, -1, -1};
+
+UDPInputStats udp_input_stats;
+TaskHandle_t UDPInputTask = NULL;
+
+// Datagrams are received into this one buffer; nothing is allocated per packet
+static uint8_t packet_buffer[UDP_INPUT_PACKET_BYTES];
+
+// The receive task assembles frames in the back buffer and swaps it to the
+// front when a frame is complete. frameMutex covers the swap and the LED
+// task's copy, so neither side ever reads a buffer the other is writing.
+static uint8_t* frame_front = nullptr;
+static uint8_t* frame_back = nullptr;
+static int frame_capacity = 0;
+static bool frame_pending = false;
+static unsigned long frame_complete_us = 0;
+static SemaphoreHandle_t frameMutex = NULL;
+
+// Realtime settings as last configured. The receive task and the LED task
+// read these rather than the settings the web server writes.
+static volatile bool input_enabled = false;
+static volatile int input_universe = 1;
+static volatile unsigned long input_timeout_ms = 2500;
+
+// Realtime mode stays on until no frame arrives for the timeout
+static volatile unsigned long last_frame_ms = 0;
+static volatile unsigned long frame_timeout_ms = 0;  // 0 = use settings
+static const unsigned long NO_TIMEOUT = 0xFFFFFFFF;
+
+static uint16_t readBE16(const uint8_t* p) {
+	return (p[0] << 8) | p[1];
+}
+
+static uint32_t readBE32(const uint8_t* p) {
+	return ((uint32_t)readBE16(p) << 16) | readBE16(p + 2);
+}
+
+// Grow the frame buffers for the current LED count. Only allocates when
+// the count grows, never in steady state.
+static bool ensureFrameBuffers(int count) {
+	if (count <= frame_capacity) return true;
+
+	uint8_t* front = (uint8_t*)calloc(count, 3);
+	uint8_t* back = (uint8_t*)calloc(count, 3);
+	if (front == nullptr || back == nullptr) {
+		free(front);
+		free(back);
+		return false;
+	}
+
+	xSemaphoreTake(frameMutex, portMAX_DELAY);
+	free(frame_front);
+	free(frame_back);
+	frame_front = front;
+	frame_back = back;
+	frame_capacity = count;
+	frame_pending = false;
+	xSemaphoreGive(frameMutex);
+	return true;
+}
+
+static void writeBytes(size_t offset, const uint8_t* data, size_t length) {
+	size_t limit = min(settings.led_count, frame_capacity) * 3;
+	if (offset >= limit) return;
+	memcpy(frame_back + offset, data, min(length, limit - offset));
+}
+
+static void completeFrame(const char* protocol) {
+	xSemaphoreTake(frameMutex, portMAX_DELAY);
+	uint8_t* swap = frame_front;
+	frame_front = frame_back;
+	frame_back = swap;
+	// Senders may update only part of the strip; carry the rest forward
+	memcpy(frame_back, frame_front, frame_capacity * 3);
+
+	if (frame_pending) udp_input_stats.frames_dropped++;
+	frame_pending = true;
+	frame_complete_us = micros();
+	xSemaphoreGive(frameMutex);
+
+	last_frame_ms = millis();
+	udp_input_stats.frames++;
+	udp_input_stats.last_protocol = protocol;
+}
+
+static bool handleDDP(const uint8_t* p, int length) {
+	if (length < 10 || (p[0] & 0xC0) != 0x40) return false;
+
+	// Optional timecode extends the header; query and reply packets carry no pixels
+	int header = (p[0] & 0x10) ? 14 : 10;
+	if (p[0] & 0x06) return true;
+
+	uint32_t offset = readBE32(p + 4);
+	uint16_t dataLength = readBE16(p + 8);
+	if (header + dataLength > length) return false;
+
+	writeBytes(offset, p + header, dataLength);
+	if (p[0] & 0x01) {
+		frame_timeout_ms = 0;
+		completeFrame("ddp");
+	}
+	return true;
+}
+
+static bool handleE131(const uint8_t* p, int length) {
+	if (length < E131_HEADER_BYTES || memcmp(p + 4, "ASC-E1.17", 9) != 0) return false;
+	if (readBE32(p + 18) != 0x00000004 || readBE32(p + 40) != 0x00000002) return false;
+	if (p[125] != 0) return true;  // Not DMX level data
+
+	int universe = readBE16(p + 113) - input_universe;
+	if (universe < 0) return true;  // Below our first universe
+	
+	int slots = readBE16(p + 123) - 1;
+	if (slots < 0 || E131_HEADER_BYTES + slots > length) return false;
+
+	writeBytes(universe * E131_BYTES_PER_UNIVERSE, p + E131_HEADER_BYTES, slots);
+
+	// A frame is complete once the universe holding the last LED arrives
+	int lastUniverse = (settings.led_count * 3 - 1) / E131_BYTES_PER_UNIVERSE;
+	if (universe >= lastUniverse) {
+		frame_timeout_ms = 0;
+		completeFrame("e131");
+	}
+	return true;
+}
+
+static bool handleWLED(const uint8_t* p, int length) {
+	if (length < 2) return false;
+
+	// Byte 1 is the sender's timeout in seconds; 255 = stay in realtime mode
+	frame_timeout_ms = (p[1] == 255) ? NO_TIMEOUT : p[1] * 1000UL;
+
+	switch (p[0]) {
+		case 1:  // WARLS: index, r, g, b
+			for (int i = 2; i + 4 <= length; i += 4) {
+				writeBytes(p[i] * 3, p + i + 1, 3);
+			}
+			break;
+		case 2:  // DRGB: r, g, b from pixel 0
+			writeBytes(0, p + 2, length - 2);
+			break;
+		case 3:  // DRGBW: white is added to each channel
+			for (int i = 2, pixel = 0; i + 4 <= length; i += 4, pixel++) {
+				uint8_t rgb[3];
+				for (int c = 0; c < 3; c++) rgb[c] = min(255, p[i + c] + p[i + 3]);
+				writeBytes(pixel * 3, rgb, 3);
+			}
+			break;
+		case 4:  // DNRGB: start index, then r, g, b
+			if (length < 4) return false;
+			writeBytes(readBE16(p + 2) * 3, p + 4, length - 4);
+			break;
+		default:
+			return false;
+	}
+	completeFrame("wled");
+	return true;
+}
+
+static void closeSockets() {
+	for (int i = 0; i < INPUT_SOCKET_COUNT; i++) {
+		if (input_sockets[i] >= 0) {
+			close(input_sockets[i]);
+			input_sockets[i] = -1;
+		}
+	}
+}
+
+// Returns true if at least one port is listening
+static bool openSockets() {
+	bool open = false;
+	for (int i = 0; i < INPUT_SOCKET_COUNT; i++) {
+		if (input_sockets[i] >= 0) {
+			open = true;
+			continue;
+		}
+
+		int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if (fd < 0) continue;
+
+		struct sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(input_ports[i]);
+		address.sin_addr.s_addr = htonl(INADDR_ANY);
+		if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+			Serial.printf(" Realtime input could not bind UDP port %d\n", input_ports[i]);
+			close(fd);
+			continue;
+		}
+		input_sockets[i] = fd;
+		open = true;
+		Serial.printf(" Realtime input listening on UDP port %d\n", input_ports[i]);
+	}
+	return open;
+}
+
+static void UDPInputTaskCode(void * pvParameters) {
+	Serial.println(" Realtime input task started on Core 0");
+	for (;;) {
+		if (!input_enabled || WiFi.status() != WL_CONNECTED) {
+			closeSockets();
+			last_frame_ms = 0;
+			vTaskDelay(500 / portTICK_PERIOD_MS);
+			continue;
+		}
+
+		if (!openSockets()) {
+			vTaskDelay(1000 / portTICK_PERIOD_MS);
+			continue;
+		}
+		if (!ensureFrameBuffers(settings.led_count)) {
+			vTaskDelay(1000 / portTICK_PERIOD_MS);
+			continue;
+		}
+
+		fd_set readable;
+		FD_ZERO(&readable);
+		int maxFd = -1;
+		for (int i = 0; i < INPUT_SOCKET_COUNT; i++) {
+			if (input_sockets[i] < 0) continue;
+			FD_SET(input_sockets[i], &readable);
+			maxFd = max(maxFd, input_sockets[i]);
+		}
+
+		// Wake periodically to notice settings and WiFi changes
+		struct timeval timeout = {0, 100000};
+		if (select(maxFd + 1, &readable, nullptr, nullptr, &timeout) <= 0) continue;
+		PROFILE_TASK(PROFILE_TASK_UDP_INPUT);
+
+		for (int i = 0; i < INPUT_SOCKET_COUNT; i++) {
+			if (input_sockets[i] < 0 || !FD_ISSET(input_sockets[i], &readable)) continue;
+
+			int length = recv(input_sockets[i], packet_buffer, sizeof(packet_buffer), MSG_DONTWAIT);
+			if (length <= 0) continue;
+
+			udp_input_stats.packets++;
+			bool ok = false;
+			switch (i) {
+				case INPUT_DDP: ok = handleDDP(packet_buffer, length); break;
+				case INPUT_E131: ok = handleE131(packet_buffer, length); break;
+				case INPUT_WLED: ok = handleWLED(packet_buffer, length); break;
+			}
+			if (!ok) udp_input_stats.bad_packets++;
+		}
+	}
+}
+
+void udpInputConfigure(bool enabled, int timeoutMs, int universe) {
+	input_universe = constrain(universe, 1, 63999);
+	input_timeout_ms = constrain(timeoutMs, 100, 600000);
+	input_enabled = enabled;
+}
+
+void udpInputBegin() {
+	if (frameMutex == NULL) frameMutex = xSemaphoreCreateMutex();
+	if (UDPInputTask != NULL) return;
+
+	xTaskCreatePinnedToCore(
+		UDPInputTaskCode,
+		"UDPInput",
+		4096,
+		NULL,
+		UDP_INPUT_TASK_PRIORITY,
+		&UDPInputTask,
+		UDP_INPUT_TASK_CORE);
+}
+
+bool realtimeInputActive() {
+	if (!input_enabled || last_frame_ms == 0) return false;
+
+	unsigned long timeout = (frame_timeout_ms > 0) ? frame_timeout_ms : input_timeout_ms;
+	if (timeout == NO_TIMEOUT) return true;
+	return millis() - last_frame_ms < timeout;
+}
+
+bool realtimeFramePending() {
+	return frame_pending;
+}
+
+// Copy the latest complete frame into rgb. Runs on the LED task.
+bool realtimeCopyFrame(uint8_t* rgb, int count) {
+	if (frameMutex == NULL) return false;
+
+	xSemaphoreTake(frameMutex, portMAX_DELAY);
+	bool copied = (frame_front != nullptr);
+	if (copied) {
+		memcpy(rgb, frame_front, min(count, frame_capacity) * 3);
+		if (frame_pending) {
+			udp_input_stats.last_latency_us = micros() - frame_complete_us;
+			if (udp_input_stats.last_latency_us > udp_input_stats.max_latency_us) {
+				udp_input_stats.max_latency_us = udp_input_stats.last_latency_us;
+			}
+			frame_pending = false;
+		}
+	}
+	xSemaphoreGive(frameMutex);
+	return copied;
+}
@@ -0,0 +1,35 @@
+#ifndef UDP_INPUT_H
+#define UDP_INPUT_H
+
+#include <Arduino.h>
+
+// Realtime pixel input: external software (xLights, Hyperion, WLED sync...)
+// can stream frames over DDP, E1.31 or the WLED realtime UDP protocol.
+// While frames keep arriving they replace the printer status effects; after
+// the timeout the strip falls back to the status effects.
+#define WLED_REALTIME_PORT 21324
+
+// Largest datagram accepted (WLED DRGB: 2 + 490 * 3 bytes)
+#define UDP_INPUT_PACKET_BYTES 1500
+
+struct UDPInputStats {
+  uint32_t packets = 0;
+  uint32_t bad_packets = 0;
+  uint32_t frames = 0;
+  uint32_t frames_dropped = 0;       // Replaced before the LED task showed them
+  unsigned long last_latency_us = 0; // Frame complete -> copied into the canvas
+  unsigned long max_latency_us = 0;
+  const char* last_protocol = "none";
+};
+
+extern UDPInputStats udp_input_stats;
+extern TaskHandle_t UDPInputTask;
+
+// Realtime input functions
+void udpInputConfigure(bool enabled, int timeoutMs, int universe);
+void udpInputBegin();
+bool realtimeInputActive();
+bool realtimeFramePending();
+bool realtimeCopyFrame(uint8_t* rgb, int count);
+
+#endif
@@ -0,0 +1,272 @@
+#include "UDPOutput.h"
+#include "../config/Settings.h"
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <lwip/dns.h>
+
+// DDP header: flags, sequence, data type, destination, offset (BE32), length (BE16)
+#define DDP_HEADER_BYTES 10
+#define DDP_MAX_DATA 1440
+#define DDP_FLAG_VERSION_1 0x40
+#define DDP_FLAG_PUSH 0x01
+#define DDP_TYPE_RGB24 0x0B
+#define DDP_ID_DISPLAY 1
+
+// E1.31 data packet: root, framing and DMP layers, then the start code
+#define E131_HEADER_BYTES 126
+#define E131_PIXELS_PER_UNIVERSE 170
+
+UDPOutputStats udp_output_stats;
+
+static int udp_socket = -1;
+static uint8_t udp_sequence = 0;
+static unsigned long last_send_ms = 0;
+
+// Output settings as last configured. The network task resolves the host;
+// the output task only reads the finished address, so it never waits on DNS.
+struct UDPOutputTarget {
+	int protocol = UDP_OUTPUT_OFF;
+	char host[sizeof(settings.udp_output_host)] = "";
+	uint16_t port = 0;
+	int universe = 1;
+	uint32_t address = 0;      // Network byte order, valid once resolved
+	bool resolved = false;
+	uint32_t generation = 0;   // Bumped whenever the settings change
+};
+
+static UDPOutputTarget output_target;
+static portMUX_TYPE target_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Lookup state, owned by the network task
+static volatile uint32_t lookup_generation = 0;
+static volatile bool lookup_pending = false;
+static unsigned long last_resolve_ms = 0;
+static const unsigned long RESOLVE_RETRY_MS = 10000;
+
+static uint8_t e131_header[E131_HEADER_BYTES];
+static bool e131_header_ready = false;
+
+void udpOutputConfigure(int protocol, const char* host, int port, int universe) {
+	portENTER_CRITICAL(&target_mux);
+	bool hostChanged = strcmp(output_target.host, host) != 0;
+	output_target.protocol = protocol;
+	output_target.port = port;
+	output_target.universe = constrain(universe, 1, 63999);
+	if (hostChanged) {
+		strlcpy(output_target.host, host, sizeof(output_target.host));
+		output_target.resolved = false;
+		output_target.address = 0;
+		output_target.generation++;
+	}
+	portEXIT_CRITICAL(&target_mux);
+}
+
+bool udpOutputActive() {
+	portENTER_CRITICAL(&target_mux);
+	bool active = output_target.protocol != UDP_OUTPUT_OFF && output_target.host[0] != '\0';
+	portEXIT_CRITICAL(&target_mux);
+	return active;
+}
+
+// Store a lookup result unless the host changed while it was in flight
+static void storeTarget(uint32_t generation, const char* host, uint32_t address) {
+	portENTER_CRITICAL(&target_mux);
+	bool current = (generation == output_target.generation);
+	if (current) {
+		output_target.address = address;
+		output_target.resolved = (address != 0);
+	}
+	portEXIT_CRITICAL(&target_mux);
+
+	if (!current) return;
+	if (address != 0) {
+		const uint8_t* octets = (const uint8_t*)&address;
+		Serial.printf(" UDP output target %s -> %d.%d.%d.%d\n", host, octets[0], octets[1], octets[2], octets[3]);
+	} else {
+		Serial.printf(" UDP output could not resolve %s\n", host);
+	}
+}
+
+// lwIP calls this on its own thread; the generation travels in the argument
+static void targetFound(const char* name, const ip_addr_t* ipaddr, void* arg) {
+	uint32_t generation = (uint32_t)(uintptr_t)arg;
+	storeTarget(generation, name, ipaddr != nullptr ? ip_addr_get_ip4_u32(ipaddr) : 0);
+	if (generation == lookup_generation) lookup_pending = false;
+}
+
+// Resolve the target host. Runs on the network task; lookups complete in
+// the background and failed ones are retried every RESOLVE_RETRY_MS.
+void udpOutputService() {
+	char host[sizeof(output_target.host)];
+	portENTER_CRITICAL(&target_mux);
+	bool needed = output_target.protocol != UDP_OUTPUT_OFF && output_target.host[0] != '\0' && !output_target.resolved;
+	uint32_t generation = output_target.generation;
+	strlcpy(host, output_target.host, sizeof(host));
+	portEXIT_CRITICAL(&target_mux);
+
+	if (!needed || WiFi.status() != WL_CONNECTED) return;
+	bool retry = (generation != lookup_generation) || (!lookup_pending && millis() - last_resolve_ms >= RESOLVE_RETRY_MS);
+	if (!retry) return;
+
+	lookup_generation = generation;
+	last_resolve_ms = millis();
+
+	ip_addr_t resolved;
+	lookup_pending = true;
+	err_t err = dns_gethostbyname(host, &resolved, targetFound, (void*)(uintptr_t)generation);
+	if (err == ERR_OK) {
+		lookup_pending = false;
+		storeTarget(generation, host, ip_addr_get_ip4_u32(&resolved));
+	} else if (err != ERR_INPROGRESS) {
+		lookup_pending = false;
+		storeTarget(generation, host, 0);
+	}
+}
+
+static void putBE16(uint8_t* p, uint16_t value) {
+	p[0] = value >> 8;
+	p[1] = value & 0xFF;
+}
+
+static void putBE32(uint8_t* p, uint32_t value) {
+	putBE16(p, value >> 16);
+	putBE16(p + 2, value & 0xFFFF);
+}
+
+// Header and pixels go out as one datagram through a two-part iovec, so
+// the pixels are handed to the stack straight from the output buffer.
+// lwIP gathers both parts into the outgoing pbuf; nothing is staged here.
+static bool sendPacket(const struct sockaddr_in& target, const uint8_t* header, size_t headerLength, const uint8_t* data, size_t length) {
+	struct iovec parts[2];
+	parts[0].iov_base = (void*)header;
+	parts[0].iov_len = headerLength;
+	parts[1].iov_base = (void*)data;
+	parts[1].iov_len = length;
+
+	struct msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_name = (void*)&target;
+	message.msg_namelen = sizeof(target);
+	message.msg_iov = parts;
+	message.msg_iovlen = 2;
+
+	if (sendmsg(udp_socket, &message, MSG_DONTWAIT) != (int)(headerLength + length)) return false;
+
+	udp_output_stats.packets_sent++;
+	udp_output_stats.last_frame_bytes += headerLength + length;
+	return true;
+}
+
+static bool sendDDP(const struct sockaddr_in& target, const uint8_t* rgb, int count) {
+	size_t total = count * 3;
+	bool ok = true;
+
+	udp_sequence = (udp_sequence % 15) + 1;  // 1-15; 0 means unused
+	for (size_t offset = 0; offset < total; offset += DDP_MAX_DATA) {
+		size_t length = min((size_t)DDP_MAX_DATA, total - offset);
+		bool last = (offset + length >= total);
+
+		// Only the last packet carries PUSH, so the receiver shows the whole frame at once
+		uint8_t header[DDP_HEADER_BYTES];
+		header[0] = DDP_FLAG_VERSION_1 | (last ? DDP_FLAG_PUSH : 0);
+		header[1] = udp_sequence;
+		header[2] = DDP_TYPE_RGB24;
+		header[3] = DDP_ID_DISPLAY;
+		putBE32(header + 4, offset);
+		putBE16(header + 8, length);
+
+		ok = sendPacket(target, header, sizeof(header), rgb + offset, length) && ok;
+	}
+	return ok;
+}
+
+static void buildE131Header() {
+	memset(e131_header, 0, sizeof(e131_header));
+
+	// Root layer
+	putBE16(e131_header, 0x0010);
+	memcpy(e131_header + 4, "ASC-E1.17\0\0\0", 12);
+	putBE32(e131_header + 18, 0x00000004);
+
+	// Component identifier, unique per device
+	uint64_t mac = ESP.getEfuseMac();
+	memcpy(e131_header + 22, "MavenLED", 8);
+	for (int i = 0; i < 8; i++) e131_header[30 + i] = (mac >> (i * 8)) & 0xFF;
+
+	// Framing layer
+	putBE32(e131_header + 40, 0x00000002);
+	strlcpy((char*)e131_header + 44, "MavenLED", 64);
+	e131_header[108] = 100;  // Priority
+
+	// DMP layer
+	e131_header[117] = 0x02;
+	e131_header[118] = 0xA1;
+	putBE16(e131_header + 121, 0x0001);
+
+	e131_header_ready = true;
+}
+
+static bool sendE131(const struct sockaddr_in& target, int universe, const uint8_t* rgb, int count) {
+	if (!e131_header_ready) buildE131Header();
+	bool ok = true;
+
+	udp_sequence++;
+	for (int first = 0; first < count; first += E131_PIXELS_PER_UNIVERSE, universe++) {
+		int pixels = min(E131_PIXELS_PER_UNIVERSE, count - first);
+		int slots = pixels * 3;
+		int total = E131_HEADER_BYTES + slots;
+
+		putBE16(e131_header + 16, 0x7000 | (total - 16));
+		putBE16(e131_header + 38, 0x7000 | (total - 38));
+		e131_header[111] = udp_sequence;
+		putBE16(e131_header + 113, universe);
+		putBE16(e131_header + 115, 0x7000 | (total - 115));
+		putBE16(e131_header + 123, slots + 1);
+
+		ok = sendPacket(target, e131_header, E131_HEADER_BYTES, rgb + first * 3, slots) && ok;
+	}
+	return ok;
+}
+
+// Send a transmitted frame to the UDP target. Runs on the LED output task;
+// dirty is false when the frame matches the previous one. Nothing is sent
+// until the network task has resolved the target.
+void udpOutputFrame(const uint8_t* rgb, int count, bool dirty) {
+	if (count <= 0 || WiFi.status() != WL_CONNECTED) return;
+
+	portENTER_CRITICAL(&target_mux);
+	UDPOutputTarget target = output_target;
+	portEXIT_CRITICAL(&target_mux);
+	if (target.protocol == UDP_OUTPUT_OFF || !target.resolved) return;
+
+	unsigned long now = millis();
+	if (!dirty && now - last_send_ms < UDP_OUTPUT_KEEPALIVE_MS) {
+		udp_output_stats.frames_skipped++;
+		return;
+	}
+
+	if (udp_socket < 0) {
+		udp_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if (udp_socket < 0) {
+			udp_output_stats.send_errors++;
+			return;
+		}
+	}
+
+	bool e131 = (target.protocol == UDP_OUTPUT_E131);
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(target.port > 0 ? target.port : (e131 ? E131_PORT : DDP_PORT));
+	address.sin_addr.s_addr = target.address;
+
+	unsigned long start = micros();
+	udp_output_stats.last_frame_bytes = 0;
+
+	bool ok = e131 ? sendE131(address, target.universe, rgb, count) : sendDDP(address, rgb, count);
+	if (!ok) udp_output_stats.send_errors++;
+
+	last_send_ms = now;
+	udp_output_stats.frames_sent++;
+	udp_output_stats.last_send_us = micros() - start;
+}
@@ -0,0 +1,39 @@
+#ifndef UDP_OUTPUT_H
+#define UDP_OUTPUT_H
+
+#include <Arduino.h>
+
+// Network pixel output: mirrors each transmitted frame to another
+// controller over UDP. Frames are split into packets straight from the
+// output buffer; unchanged frames are only resent as a keepalive. The
+// target host is resolved on the network task, never on the output task.
+enum UDPOutputProtocol {
+  UDP_OUTPUT_OFF = 0,
+  UDP_OUTPUT_DDP = 1,   // Distributed Display Protocol, 480 pixels per packet
+  UDP_OUTPUT_E131 = 2   // E1.31 / sACN unicast, 170 pixels per universe
+};
+
+#define DDP_PORT 4048
+#define E131_PORT 5568
+
+// Unchanged frames are resent this often so receivers that restart catch up
+#define UDP_OUTPUT_KEEPALIVE_MS 1000
+
+struct UDPOutputStats {
+  uint32_t frames_sent = 0;
+  uint32_t frames_skipped = 0;    // Unchanged since the last send
+  uint32_t packets_sent = 0;
+  uint32_t send_errors = 0;
+  uint32_t last_frame_bytes = 0;  // Payload plus headers
+  unsigned long last_send_us = 0;
+};
+
+extern UDPOutputStats udp_output_stats;
+
+// UDP output functions
+void udpOutputConfigure(int protocol, const char* host, int port, int universe);
+void udpOutputService();  // Network task: resolves the target host
+bool udpOutputActive();
+void udpOutputFrame(const uint8_t* rgb, int count, bool dirty);
+
+#endif
@@ -0,0 +1,106 @@
+#include "WiFiConnection.h"
+
+WiFiConnection wifi_connection;
+
+static void enterState(WiFiConnection& connection, WiFiConnectionState state) {
+	connection.state = state;
+	connection.state_since = connection.wifi->now();
+}
+
+static void startAttempt(WiFiConnection& connection) {
+	connection.stats.attempts++;
+	connection.wifi->begin();
+	enterState(connection, WIFI_STATE_CONNECTING);
+}
+
+// The window doubles with each consecutive failure up to the cap; the wait
+// is drawn from its upper half so retries spread out but never collapse to 0
+static unsigned long nextBackoff(WiFiConnection& connection) {
+	unsigned long window = WIFI_BACKOFF_MIN_MS;
+	for (uint32_t i = 1; i < connection.stats.failures && window < WIFI_BACKOFF_MAX_MS; i++) {
+		window *= 2;
+	}
+	if (window > WIFI_BACKOFF_MAX_MS) window = WIFI_BACKOFF_MAX_MS;
+	return window / 2 + connection.wifi->random(window / 2 + 1);
+}
+
+void wifiConnectionBegin(WiFiConnection& connection, WiFiInterface* wifi, bool apFallback) {
+	connection.wifi = wifi;
+	connection.ap_fallback = apFallback;
+	connection.ever_connected = false;
+	connection.recovering = false;
+	connection.stats = WiFiConnectionStats();
+	startAttempt(connection);
+}
+
+WiFiConnectionEvent wifiConnectionService(WiFiConnection& connection) {
+	if (connection.wifi == nullptr) return WIFI_EVENT_NONE;
+
+	unsigned long now = connection.wifi->now();
+	unsigned long elapsed = now - connection.state_since;
+
+	switch (connection.state) {
+		case WIFI_STATE_IDLE:
+			startAttempt(connection);
+			return WIFI_EVENT_NONE;
+
+		case WIFI_STATE_CONNECTING: {
+			WiFiLinkState link = connection.wifi->linkState();
+			if (link == WIFI_LINK_UP) {
+				connection.stats.connects++;
+				connection.stats.failures = 0;
+				connection.stats.backoff_ms = 0;
+				connection.stats.last_attempt_ms = elapsed;
+				if (connection.recovering) {
+					connection.stats.last_recovery_ms = now - connection.lost_at;
+					connection.recovering = false;
+				}
+				connection.ever_connected = true;
+				enterState(connection, WIFI_STATE_CONNECTED);
+				return WIFI_EVENT_CONNECTED;
+			}
+			if (link != WIFI_LINK_FAILED && elapsed < WIFI_CONNECT_TIMEOUT_MS) return WIFI_EVENT_NONE;
+
+			// Stop the radio retrying on its own; the next attempt is ours to time
+			connection.wifi->disconnect();
+			connection.stats.failures++;
+			if (connection.ap_fallback && !connection.ever_connected) {
+				connection.wifi->startAccessPoint();
+				enterState(connection, WIFI_STATE_AP);
+				return WIFI_EVENT_AP_STARTED;
+			}
+			connection.stats.backoff_ms = nextBackoff(connection);
+			enterState(connection, WIFI_STATE_BACKOFF);
+			return WIFI_EVENT_ATTEMPT_FAILED;
+		}
+
+		case WIFI_STATE_CONNECTED:
+			if (connection.wifi->linkState() == WIFI_LINK_UP) return WIFI_EVENT_NONE;
+
+			// A drop after a good connection retries at once; backoff is for failures
+			connection.stats.disconnects++;
+			connection.recovering = true;
+			connection.lost_at = now;
+			startAttempt(connection);
+			return WIFI_EVENT_LOST;
+
+		case WIFI_STATE_BACKOFF:
+			if (elapsed >= connection.stats.backoff_ms) startAttempt(connection);
+			return WIFI_EVENT_NONE;
+
+		case WIFI_STATE_AP:
+			return WIFI_EVENT_NONE;
+	}
+	return WIFI_EVENT_NONE;
+}
+
+const char* wifiConnectionStateName(WiFiConnectionState state) {
+	switch (state) {
+		case WIFI_STATE_IDLE: return "idle";
+		case WIFI_STATE_CONNECTING: return "connecting";
+		case WIFI_STATE_CONNECTED: return "connected";
+		case WIFI_STATE_BACKOFF: return "backoff";
+		case WIFI_STATE_AP: return "ap";
+	}
+	return "unknown";
+}
@@ -0,0 +1,80 @@
+#ifndef WIFI_CONNECTION_H
+#define WIFI_CONNECTION_H
+
+#include <Arduino.h>
+
+// Non-blocking WiFi connection manager. The network task calls
+// wifiConnectionService() every loop; it starts an attempt, watches the
+// link and returns at once. Failed attempts back off exponentially with
+// jitter so a dead access point is not hammered and several devices do
+// not retry in lockstep.
+#define WIFI_CONNECT_TIMEOUT_MS 20000
+#define WIFI_BACKOFF_MIN_MS 1000
+#define WIFI_BACKOFF_MAX_MS 60000
+
+enum WiFiLinkState {
+  WIFI_LINK_DOWN,     // Not associated (or still associating)
+  WIFI_LINK_UP,       // Associated and has an IP address
+  WIFI_LINK_FAILED    // Attempt rejected: SSID not found, wrong password
+};
+
+// The radio as the manager sees it. The device implementation wraps the
+// Arduino WiFi class; a host simulation can supply its own to inject
+// disconnects and measure recovery time.
+class WiFiInterface {
+public:
+  virtual ~WiFiInterface() {}
+  virtual void begin() = 0;               // Start associating with the saved network
+  virtual void disconnect() = 0;
+  virtual WiFiLinkState linkState() = 0;
+  virtual void startAccessPoint() = 0;    // Setup portal when the boot attempt fails
+  virtual unsigned long now() = 0;        // Milliseconds
+  virtual uint32_t random(uint32_t bound) = 0;  // 0 .. bound - 1
+};
+
+enum WiFiConnectionState {
+  WIFI_STATE_IDLE,
+  WIFI_STATE_CONNECTING,
+  WIFI_STATE_CONNECTED,
+  WIFI_STATE_BACKOFF,
+  WIFI_STATE_AP
+};
+
+// What changed during a service call; the network task acts on these
+enum WiFiConnectionEvent {
+  WIFI_EVENT_NONE,
+  WIFI_EVENT_CONNECTED,
+  WIFI_EVENT_LOST,
+  WIFI_EVENT_ATTEMPT_FAILED,
+  WIFI_EVENT_AP_STARTED
+};
+
+struct WiFiConnectionStats {
+  uint32_t attempts = 0;
+  uint32_t connects = 0;
+  uint32_t disconnects = 0;            // Link lost after being up
+  uint32_t failures = 0;               // Consecutive failed attempts
+  unsigned long backoff_ms = 0;        // Current wait before the next attempt
+  unsigned long last_attempt_ms = 0;   // begin() to link up
+  unsigned long last_recovery_ms = 0;  // Link lost to link up again
+};
+
+struct WiFiConnection {
+  WiFiInterface* wifi = nullptr;
+  WiFiConnectionState state = WIFI_STATE_IDLE;
+  bool ap_fallback = false;            // Start the AP if the first attempt fails
+  bool ever_connected = false;
+  unsigned long state_since = 0;
+  bool recovering = false;             // Reconnecting after the link dropped
+  unsigned long lost_at = 0;
+  WiFiConnectionStats stats;
+};
+
+extern WiFiConnection wifi_connection;
+
+// Connection manager functions (network task only, except the stats)
+void wifiConnectionBegin(WiFiConnection& connection, WiFiInterface* wifi, bool apFallback);
+WiFiConnectionEvent wifiConnectionService(WiFiConnection& connection);
+const char* wifiConnectionStateName(WiFiConnectionState state);
+
+#endif
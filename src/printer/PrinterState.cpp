@@ -1,10 +1,12 @@
 #include "PrinterState.h"
 #include "../config/Settings.h"
 #include "../web/WebHandlers.h"
+#include "../diagnostics/Profiler.h"
 
 PrinterState printer_state;
 SemaphoreHandle_t printerStateMutex = NULL;
 volatile bool printer_state_updated = false;
+volatile uint32_t printer_status_version = 0;
 
 RTC_DATA_ATTR RTCState rtc_state = {false, 0, 0xDEADBEEF};
 
@@ -13,6 +15,7 @@ extern unsigned long lastMQTTupdate;
 extern unsigned long lastMQTTProcessTime;
 
 void updatePrinterState(JsonDocument& doc) {
+  PROFILE_SCOPE(PROFILE_UPDATE_PRINTER_STATE);
   if (xSemaphoreTake(printerStateMutex, portMAX_DELAY) == pdTRUE) {
     bool changed = false;
     String previousStatus = printer_state.status;
@@ -254,7 +257,7 @@ void updatePrinterState(JsonDocument& doc) {
     }
     
     if (changed) {
-      bool statusActuallyChanged = determinePrinterStatus();
+      bool statusActuallyChanged = evaluatePrinterStatus();
       if (statusActuallyChanged) {
         printer_state_updated = true;
         
@@ -270,172 +273,13 @@ void updatePrinterState(JsonDocument& doc) {
   }
 }
 
-bool determinePrinterStatus() {
-  String currentProcessedStatus = printer_state.status;
-  String rawStatus = printer_state.raw_gcode_state;
-  String newStatus = currentProcessedStatus;
-  
-  // Check idle timeout
-  if (settings.idle_timeout_enabled && !printer_state.auto_off_active) {
-    if (currentProcessedStatus == "idle" && printer_state.idle_state_start > 0) {
-      unsigned long idleDuration = millis() - printer_state.idle_state_start;
-      unsigned long timeoutMillis = settings.idle_timeout_minutes * 60000UL;
-      if (idleDuration >= timeoutMillis) {
-        Serial.printf(" Idle timeout reached (%d minutes) - entering auto-off state\n", settings.idle_timeout_minutes);
-        printer_state.auto_off_active = true;
-        newStatus = "auto_off";
-      }
-    }
-  }
-  
-  // Reset auto-off state when printer becomes active
-  if (printer_state.auto_off_active) {
-    if (rawStatus == "RUNNING" || rawStatus == "PREPARE" || rawStatus == "PAUSE" || 
-        rawStatus == "FINISH" || rawStatus == "FAILED" || 
-        printer_state.is_heating || printer_state.is_cooling) {
-      Serial.println(" Printer active - exiting auto-off state");
-      printer_state.auto_off_active = false;
-      printer_state.idle_state_start = 0;
-    } else {
-      // Stay in auto_off state
-      if (printer_state.status != "auto_off") {
-        newStatus = "auto_off";
-      }
-    }
-  }
-  
-  if (settings.state_timeout_reached && (rawStatus == "FINISH" || rawStatus == "FAILED")) {
-    Serial.printf(" Persistent timeout detected - forcing idle mode\n");
-    newStatus = "idle";
-  } else if (!settings.state_timeout_reached) {
-    if (printer_state.finish_animation_active) {
-      unsigned long finishDuration = millis() - printer_state.finish_animation_start;
-      if (finishDuration >= 120000) {
-        printer_state.finish_animation_active = false;
-        printer_state.state_override_active = true;
-        printer_state.state_override_start = millis();
-        printer_state.override_reason = "finish timeout";
-        settings.state_timeout_reached = true;
-        saveSettings();
-        Serial.println("️ Finish animation stopped - forcing idle state");
-        newStatus = "idle";
-      } else if (rawStatus != "FINISH") {
-        printer_state.finish_animation_active = false;
-        Serial.printf("️ Finish animation stopped - status changed\n");
-      } else {
-        newStatus = "finished";
-      }
-    }
-    
-    if (printer_state.error_recovery_active) {
-      unsigned long errorDuration = millis() - printer_state.error_recovery_start;
-      if (errorDuration >= 120000) {
-        printer_state.error_recovery_active = false;
-        printer_state.state_override_active = true;
-        printer_state.state_override_start = millis();
-        printer_state.override_reason = "error timeout";
-        settings.state_timeout_reached = true;
-        saveSettings();
-        Serial.println("️ Error recovery timeout - forcing idle state");
-        newStatus = "idle";
-      } else if (rawStatus != "FAILED" && (!printer_state.has_error || rawStatus == "PAUSE")) {
-        printer_state.error_recovery_active = false;
-        Serial.printf("️ Error recovery stopped\n");
-      } else {
-        newStatus = "error";
-      }
-    }
-    
-    if (printer_state.is_heating && printer_state.temp_readings_count >= 3) {
-        newStatus = "heating";
-    } else if (printer_state.is_cooling && printer_state.temp_readings_count >= 3) {
-      // P1 Series Mode: Skip cooling state during active printing
-      if (settings.p1_series_mode && printer_state.progress > 0 && printer_state.progress < 100) {
-        newStatus = "printing";
-      } else {
-        newStatus = "cooling";
-      }
-    } else if (printer_state.state_override_active && 
-               !printer_state.is_heating && !printer_state.is_cooling) {
-      newStatus = "idle";
-    } else if (!printer_state.finish_animation_active && !printer_state.error_recovery_active && !printer_state.state_override_active) {
-      if (rawStatus == "PREPARE") {
-        newStatus = "downloading";
-      } else if (rawStatus == "RUNNING") {
-        newStatus = "printing";
-      } else if (rawStatus == "PAUSE") {
-        if (printer_state.has_error) {
-          newStatus = "recoverable_error";
-        } else {
-          newStatus = "paused";
-        }
-      } else if (rawStatus == "FINISH") {
-        if (!printer_state.finish_animation_active) {
-          printer_state.finish_animation_active = true;
-          printer_state.finish_animation_start = millis();
-          Serial.println(" Print finished - starting 2-minute celebration animation");
-        }
-        newStatus = "finished";
-      } else if (rawStatus == "FAILED") {
-        if (!printer_state.error_recovery_active) {
-          printer_state.error_recovery_active = true;
-          printer_state.error_recovery_start = millis();
-          Serial.println(" Error detected - starting 2-minute error recovery");
-        }
-        newStatus = "error";
-      } else if (printer_state.has_error && rawStatus != "PAUSE") {
-        if (!printer_state.error_recovery_active) {
-          printer_state.error_recovery_active = true;
-          printer_state.error_recovery_start = millis();
-          Serial.println(" Non-pause error detected - starting 2-minute error recovery");
-        }
-        newStatus = "error";
-      } else if (rawStatus == "IDLE") {
-        newStatus = "idle";
-      } else {
-        if (printer_state.progress > 0) {
-          newStatus = "printing";
-        } else if (currentProcessedStatus == "unknown") {
-          newStatus = "idle";
-          Serial.printf(" Unknown raw status '%s' - defaulting to idle\n", rawStatus.c_str());
-        }
-      }
-    }
-  }
-  
-  if (printer_state.status != newStatus) {
-    Serial.printf(" Status changed from '%s' to '%s'\n", printer_state.status.c_str(), newStatus.c_str());
-    
-    // Track idle state start time for timeout
-    if (newStatus == "idle" && printer_state.status != "idle") {
-      printer_state.idle_state_start = millis();
-      Serial.printf("️ Idle state started - timeout in %d minutes\n", settings.idle_timeout_minutes);
-    } else if (newStatus != "idle" && newStatus != "auto_off") {
-      printer_state.idle_state_start = 0;
-    }
-    
-    if (settings.state_timeout_reached && 
-        newStatus != "finished" && newStatus != "error" && 
-        rawStatus != "FINISH" && rawStatus != "FAILED") {
-      settings.state_timeout_reached = false;
-      saveSettings();
-      Serial.println(" Persistent timeout flag reset");
-    }
-    
-    printer_state.last_stable_status = printer_state.status;
-    printer_state.status = newStatus;
-    printer_state.last_status_change = millis();
-    return true;
-  }
-  return false;
-}
-
 void checkConnectionTimeout() {
   if (printer_state.is_connected && (millis() - lastMQTTupdate > 45000)) {
     Serial.println("️ MQTT connection timeout - marking printer as disconnected");
     printer_state.is_connected = false;
     printer_state.status = "unknown";
     printer_state.raw_gcode_state = "unknown";
+    markPrinterStatusChanged();
     printer_state.temp_readings_count = 0;
     printer_state.is_heating = false;
     printer_state.is_cooling = false;
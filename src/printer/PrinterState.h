@@ -65,6 +65,10 @@ extern PrinterState printer_state;
 extern SemaphoreHandle_t printerStateMutex;
 extern volatile bool printer_state_updated;
 
+// Bumped whenever printer_state.status changes. The LED task re-selects its
+// effect only when this moves; status is evaluated on the network task.
+extern volatile uint32_t printer_status_version;
+
 // RTC memory for persistent state
 typedef struct {
   bool printing_active;
@@ -77,6 +81,10 @@ extern RTC_DATA_ATTR RTCState rtc_state;
 // Printer state functions
 void updatePrinterState(JsonDocument& doc);
 bool determinePrinterStatus();
+bool evaluatePrinterStatus();
+void markPrinterStatusChanged();
+void requestStatusEvaluation();
+void serviceStatusEvaluation();
 void checkConnectionTimeout();
 
 #endif
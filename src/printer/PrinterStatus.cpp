@@ -0,0 +1,231 @@
+#include "PrinterState.h"
+#include "../config/Settings.h"
+#include "../diagnostics/Profiler.h"
+
+// Status is re-evaluated on ingest, on request (settings changes, direct
+// status writes) and when the next timer in the state machine expires
+static volatile bool status_evaluation_requested = false;
+static bool status_deadline_armed = false;
+static unsigned long status_deadline_ms = 0;
+
+// Finish and error states fall back to idle after this long
+static const unsigned long STATE_TIMEOUT_MS = 120000;
+
+bool determinePrinterStatus() {
+  String currentProcessedStatus = printer_state.status;
+  String rawStatus = printer_state.raw_gcode_state;
+  String newStatus = currentProcessedStatus;
+  
+  // Check idle timeout
+  if (settings.idle_timeout_enabled && !printer_state.auto_off_active) {
+    if (currentProcessedStatus == "idle" && printer_state.idle_state_start > 0) {
+      unsigned long idleDuration = millis() - printer_state.idle_state_start;
+      unsigned long timeoutMillis = settings.idle_timeout_minutes * 60000UL;
+      if (idleDuration >= timeoutMillis) {
+        Serial.printf(" Idle timeout reached (%d minutes) - entering auto-off state\n", settings.idle_timeout_minutes);
+        printer_state.auto_off_active = true;
+        newStatus = "auto_off";
+      }
+    }
+  }
+  
+  // Reset auto-off state when printer becomes active
+  if (printer_state.auto_off_active) {
+    if (rawStatus == "RUNNING" || rawStatus == "PREPARE" || rawStatus == "PAUSE" || 
+        rawStatus == "FINISH" || rawStatus == "FAILED" || 
+        printer_state.is_heating || printer_state.is_cooling) {
+      Serial.println(" Printer active - exiting auto-off state");
+      printer_state.auto_off_active = false;
+      printer_state.idle_state_start = 0;
+    } else {
+      // Stay in auto_off state
+      if (printer_state.status != "auto_off") {
+        newStatus = "auto_off";
+      }
+    }
+  }
+  
+  if (printer_state.auto_off_active) {
+    // Auto-off holds until the printer is active again; the raw IDLE
+    // state below would otherwise turn it straight back into idle
+  } else if (settings.state_timeout_reached && (rawStatus == "FINISH" || rawStatus == "FAILED")) {
+    Serial.printf(" Persistent timeout detected - forcing idle mode\n");
+    newStatus = "idle";
+  } else if (!settings.state_timeout_reached) {
+    if (printer_state.finish_animation_active) {
+      unsigned long finishDuration = millis() - printer_state.finish_animation_start;
+      if (finishDuration >= STATE_TIMEOUT_MS) {
+        printer_state.finish_animation_active = false;
+        printer_state.state_override_active = true;
+        printer_state.state_override_start = millis();
+        printer_state.override_reason = "finish timeout";
+        settings.state_timeout_reached = true;
+        saveSettings();
+        Serial.println("️ Finish animation stopped - forcing idle state");
+        newStatus = "idle";
+      } else if (rawStatus != "FINISH") {
+        printer_state.finish_animation_active = false;
+        Serial.printf("️ Finish animation stopped - status changed\n");
+      } else {
+        newStatus = "finished";
+      }
+    }
+    
+    if (printer_state.error_recovery_active) {
+      unsigned long errorDuration = millis() - printer_state.error_recovery_start;
+      if (errorDuration >= STATE_TIMEOUT_MS) {
+        printer_state.error_recovery_active = false;
+        printer_state.state_override_active = true;
+        printer_state.state_override_start = millis();
+        printer_state.override_reason = "error timeout";
+        settings.state_timeout_reached = true;
+        saveSettings();
+        Serial.println("️ Error recovery timeout - forcing idle state");
+        newStatus = "idle";
+      } else if (rawStatus != "FAILED" && (!printer_state.has_error || rawStatus == "PAUSE")) {
+        printer_state.error_recovery_active = false;
+        Serial.printf("️ Error recovery stopped\n");
+      } else {
+        newStatus = "error";
+      }
+    }
+    
+    if (printer_state.is_heating && printer_state.temp_readings_count >= 3) {
+        newStatus = "heating";
+    } else if (printer_state.is_cooling && printer_state.temp_readings_count >= 3) {
+      // P1 Series Mode: Skip cooling state during active printing
+      if (settings.p1_series_mode && printer_state.progress > 0 && printer_state.progress < 100) {
+        newStatus = "printing";
+      } else {
+        newStatus = "cooling";
+      }
+    } else if (printer_state.state_override_active && 
+               !printer_state.is_heating && !printer_state.is_cooling) {
+      newStatus = "idle";
+    } else if (!printer_state.finish_animation_active && !printer_state.error_recovery_active && !printer_state.state_override_active) {
+      if (rawStatus == "PREPARE") {
+        newStatus = "downloading";
+      } else if (rawStatus == "RUNNING") {
+        newStatus = "printing";
+      } else if (rawStatus == "PAUSE") {
+        if (printer_state.has_error) {
+          newStatus = "recoverable_error";
+        } else {
+          newStatus = "paused";
+        }
+      } else if (rawStatus == "FINISH") {
+        if (!printer_state.finish_animation_active) {
+          printer_state.finish_animation_active = true;
+          printer_state.finish_animation_start = millis();
+          Serial.println(" Print finished - starting 2-minute celebration animation");
+        }
+        newStatus = "finished";
+      } else if (rawStatus == "FAILED") {
+        if (!printer_state.error_recovery_active) {
+          printer_state.error_recovery_active = true;
+          printer_state.error_recovery_start = millis();
+          Serial.println(" Error detected - starting 2-minute error recovery");
+        }
+        newStatus = "error";
+      } else if (printer_state.has_error && rawStatus != "PAUSE") {
+        if (!printer_state.error_recovery_active) {
+          printer_state.error_recovery_active = true;
+          printer_state.error_recovery_start = millis();
+          Serial.println(" Non-pause error detected - starting 2-minute error recovery");
+        }
+        newStatus = "error";
+      } else if (rawStatus == "IDLE") {
+        newStatus = "idle";
+      } else {
+        if (printer_state.progress > 0) {
+          newStatus = "printing";
+        } else if (currentProcessedStatus == "unknown") {
+          newStatus = "idle";
+          Serial.printf(" Unknown raw status '%s' - defaulting to idle\n", rawStatus.c_str());
+        }
+      }
+    }
+  }
+  
+  if (printer_state.status != newStatus) {
+    Serial.printf(" Status changed from '%s' to '%s'\n", printer_state.status.c_str(), newStatus.c_str());
+    
+    // Track idle state start time for timeout
+    if (newStatus == "idle" && printer_state.status != "idle") {
+      printer_state.idle_state_start = millis();
+      Serial.printf("️ Idle state started - timeout in %d minutes\n", settings.idle_timeout_minutes);
+    } else if (newStatus != "idle" && newStatus != "auto_off") {
+      printer_state.idle_state_start = 0;
+    }
+    
+    if (settings.state_timeout_reached && 
+        newStatus != "finished" && newStatus != "error" && 
+        rawStatus != "FINISH" && rawStatus != "FAILED") {
+      settings.state_timeout_reached = false;
+      saveSettings();
+      Serial.println(" Persistent timeout flag reset");
+    }
+    
+    printer_state.last_stable_status = printer_state.status;
+    printer_state.status = newStatus;
+    printer_state.last_status_change = millis();
+    printer_status_version++;
+    return true;
+  }
+  return false;
+}
+
+static void considerStatusDeadline(unsigned long deadline) {
+  if (!status_deadline_armed || (long)(deadline - status_deadline_ms) < 0) {
+    status_deadline_ms = deadline;
+    status_deadline_armed = true;
+  }
+}
+
+// Arm the deadline for the earliest timer that can change the status:
+// finish/error fallback to idle and the idle auto-off timeout
+static void armStatusDeadline() {
+  status_deadline_armed = false;
+  
+  if (!settings.state_timeout_reached) {
+    if (printer_state.finish_animation_active) considerStatusDeadline(printer_state.finish_animation_start + STATE_TIMEOUT_MS);
+    if (printer_state.error_recovery_active) considerStatusDeadline(printer_state.error_recovery_start + STATE_TIMEOUT_MS);
+  }
+  if (settings.idle_timeout_enabled && !printer_state.auto_off_active &&
+      printer_state.status == "idle" && printer_state.idle_state_start > 0) {
+    considerStatusDeadline(printer_state.idle_state_start + settings.idle_timeout_minutes * 60000UL);
+  }
+}
+
+// Run the state machine and re-arm its timers. Caller holds printerStateMutex.
+bool evaluatePrinterStatus() {
+  PROFILE_SCOPE(PROFILE_STATUS_EVALUATION);
+  status_evaluation_requested = false;
+  bool statusChanged = determinePrinterStatus();
+  armStatusDeadline();
+  return statusChanged;
+}
+
+// For code that writes printer_state.status directly: let the LED task see
+// the change and run the state machine on top of it
+void markPrinterStatusChanged() {
+  printer_status_version++;
+  status_evaluation_requested = true;
+}
+
+void requestStatusEvaluation() {
+  status_evaluation_requested = true;
+}
+
+// Called from the network task loop. Only takes the mutex when a request is
+// pending or a timer has expired.
+void serviceStatusEvaluation() {
+  bool expired = status_deadline_armed && (long)(millis() - status_deadline_ms) >= 0;
+  if (!status_evaluation_requested && !expired) return;
+  if (printerStateMutex == NULL) return;
+  
+  if (xSemaphoreTake(printerStateMutex, 10 / portTICK_PERIOD_MS) == pdTRUE) {
+    if (evaluatePrinterStatus()) printer_state_updated = true;
+    xSemaphoreGive(printerStateMutex);
+  }
+}
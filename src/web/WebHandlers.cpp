@@ -2,7 +2,16 @@
 #include "../config/Settings.h"
 #include "../printer/PrinterState.h"
 #include "../network/NetworkManager.h"
+#include "../network/UDPInput.h"
+#include "../network/UDPOutput.h"
 #include "../led/LEDAnimations.h"
+#include "../led/LEDOutput.h"
+#include "../led/EffectVM.h"
+#include "../led/LEDLayout.h"
+#include "../led/FrameRecorder.h"
+#include "../led/FrameScheduler.h"
+#include "../led/LEDCommands.h"
+#include "../diagnostics/Profiler.h"
 
 // Web Server Global Variable
 WebServer server(80);
@@ -18,8 +27,47 @@ void handleNotFound() {
 	server.send(404, "text/plain", "Not found");
 }
 
+static void writeConnectStats(JsonObject out, const MQTTConnection& connection) {
+	const MQTTConnectStats& stats = connection.stats;
+	out["step"] = mqttConnectStepName(connection.step);
+	out["attempts"] = stats.attempts;
+	out["connects"] = stats.connects;
+	out["disconnects"] = stats.disconnects;
+	out["failures"] = stats.failures;
+	out["backoff_ms"] = stats.backoff_ms;
+	out["last_connect_ms"] = stats.last_connect_ms;
+	out["max_service_us"] = stats.max_service_us;
+	out["publishes_skipped"] = stats.publishes_skipped;
+	
+	JsonObject steps = out.createNestedObject("step_ms");
+	for (int step = MQTT_STEP_DNS; step <= MQTT_STEP_SUBSCRIBE; step++) {
+		steps[mqttConnectStepName((MQTTConnectStep)step)] = stats.step_ms[step];
+	}
+	if (stats.failed_step != MQTT_STEP_IDLE) {
+		out["failed_step"] = mqttConnectStepName(stats.failed_step);
+		out["error"] = stats.last_error;
+		out["error_code"] = stats.error_code;
+	}
+	
+	if (connection.transport->usesTLS()) {
+		const TLSStats& tls = connection.transport->tls_stats;
+		JsonObject session = out.createNestedObject("tls");
+		session["handshakes"] = tls.handshakes;
+		session["resumed"] = tls.resumed;
+		session["resume_declined"] = tls.resume_declined;
+		session["failures"] = tls.failures;
+		session["last_resumed"] = tls.last_resumed;
+		session["last_handshake_ms"] = tls.last_handshake_ms;
+		session["last_full_ms"] = tls.last_full_ms;
+		session["last_resumed_ms"] = tls.last_resumed_ms;
+		session["last_heap_peak"] = tls.last_heap_peak;
+		session["max_heap_peak"] = tls.max_heap_peak;
+		session["session_cached"] = connection.transport->hasCachedSession(connection.endpoint.host.c_str());
+	}
+}
+
 void handleStatus() {
-	DynamicJsonDocument doc(1024);
+	DynamicJsonDocument doc(4096);
 	
 	doc["printer_status"] = printer_state.status;
 	doc["progress"] = printer_state.progress;
@@ -27,6 +75,23 @@ void handleStatus() {
 	doc["wifi_connected"] = WiFi.status() == WL_CONNECTED;
 	doc["wifi_ssid"] = WiFi.SSID();
 	doc["ip_address"] = WiFi.localIP().toString();
+	
+	JsonObject wifi = doc.createNestedObject("wifi");
+	wifi["state"] = wifiConnectionStateName(wifi_connection.state);
+	wifi["rssi"] = WiFi.RSSI();
+	wifi["attempts"] = wifi_connection.stats.attempts;
+	wifi["connects"] = wifi_connection.stats.connects;
+	wifi["disconnects"] = wifi_connection.stats.disconnects;
+	wifi["failures"] = wifi_connection.stats.failures;
+	wifi["backoff_ms"] = wifi_connection.stats.backoff_ms;
+	wifi["last_attempt_ms"] = wifi_connection.stats.last_attempt_ms;
+	wifi["last_recovery_ms"] = wifi_connection.stats.last_recovery_ms;
+	wifi["disconnect_reason"] = wifi_disconnect_reason;
+	
+	JsonObject mqtt = doc.createNestedObject("mqtt");
+	writeConnectStats(mqtt.createNestedObject("printer"), printer_mqtt);
+	writeConnectStats(mqtt.createNestedObject("remote"), remote_mqtt);
+	
 	doc["night_mode"] = settings.night_mode_enabled;
 	doc["brightness"] = settings.global_brightness;
 	doc["lights_enabled"] = !settings.lights_off_override;
@@ -41,6 +106,59 @@ void handleStatus() {
 	doc["printing_direction"] = settings.printing_direction;
 	doc["download_direction"] = settings.download_direction;
 	
+	JsonObject output = doc.createNestedObject("led_output");
+	output["channels"] = getLEDChannelCount();
+	output["driver"] = getLEDChannelDriver(0) != nullptr ? getLEDChannelDriver(0)->name() : "none";
+	output["frames_presented"] = led_output_stats.frames_presented;
+	output["frames_transmitted"] = led_output_stats.frames_transmitted;
+	output["frames_coalesced"] = led_output_stats.frames_coalesced;
+	output["present_us"] = led_output_stats.last_present_us;
+	output["transmit_us"] = led_output_stats.last_transmit_us;
+	output["max_transmit_us"] = led_output_stats.max_transmit_us;
+	output["reconfigure_us"] = last_reconfigure_us;
+	
+	JsonObject power = output.createNestedObject("power");
+	power["limit_ma"] = settings.power_limit_ma;
+	power["estimated_ma"] = led_output_stats.estimated_ma;
+	power["output_ma"] = led_output_stats.output_ma;
+	power["scale"] = led_output_stats.power_scale;
+	power["limited_frames"] = led_output_stats.power_limited_frames;
+	power["limit_events"] = led_output_stats.power_limit_events;
+	
+	JsonObject udp = output.createNestedObject("udp");
+	udp["protocol"] = settings.udp_output_protocol;
+	udp["frames_sent"] = udp_output_stats.frames_sent;
+	udp["frames_skipped"] = udp_output_stats.frames_skipped;
+	udp["packets_sent"] = udp_output_stats.packets_sent;
+	udp["send_errors"] = udp_output_stats.send_errors;
+	udp["frame_bytes"] = udp_output_stats.last_frame_bytes;
+	udp["send_us"] = udp_output_stats.last_send_us;
+	
+	JsonObject realtime = output.createNestedObject("realtime");
+	realtime["active"] = realtimeInputActive();
+	realtime["protocol"] = udp_input_stats.last_protocol;
+	realtime["packets"] = udp_input_stats.packets;
+	realtime["bad_packets"] = udp_input_stats.bad_packets;
+	realtime["frames"] = udp_input_stats.frames;
+	realtime["frames_dropped"] = udp_input_stats.frames_dropped;
+	realtime["latency_us"] = udp_input_stats.last_latency_us;
+	realtime["max_latency_us"] = udp_input_stats.max_latency_us;
+	
+	JsonObject commands = output.createNestedObject("commands");
+	commands["applied"] = led_command_stats.commands_applied;
+	commands["batches"] = led_command_stats.batches_applied;
+	commands["max_per_frame"] = led_command_stats.max_commands_per_frame;
+	commands["submit_failures"] = led_command_stats.submit_failures;
+	commands["apply_timeouts"] = led_command_stats.apply_timeouts;
+	
+	JsonObject recorder = output.createNestedObject("recorder");
+	recorder["frames"] = frame_recorder_stats.frames_held;
+	recorder["bytes"] = frame_recorder_stats.bytes_held;
+	recorder["span_ms"] = frame_recorder_stats.span_ms;
+	recorder["dropped"] = frame_recorder_stats.frames_dropped;
+	recorder["record_us"] = frame_recorder_stats.last_record_us;
+	recorder["max_record_us"] = frame_recorder_stats.max_record_us;
+	
 	if (isGlobalMode()) {
 		doc["mqtt_mode"] = "global";
 		doc["token_expired"] = isTokenExpired();
@@ -62,7 +180,7 @@ void handleStatus() {
 }
 
 void handleGetSettings() {
-	DynamicJsonDocument doc(2048);
+	DynamicJsonDocument doc(6144);
 	
 	JsonArray colors = doc.createNestedArray("colors");
 	for (int i = 0; i < 8; i++) {
@@ -72,6 +190,19 @@ void handleGetSettings() {
 		color["b"] = settings.colors[i].b;
 	}
 	
+	JsonArray palettes = doc.createNestedArray("palettes");
+	for (int i = 0; i < 8; i++) {
+		JsonArray stops = palettes.createNestedArray();
+		for (int s = 0; s < settings.palettes[i].stop_count; s++) {
+			const PaletteStop& stop = settings.palettes[i].stops[s];
+			JsonObject entry = stops.createNestedObject();
+			entry["pos"] = stop.pos;
+			entry["r"] = stop.r;
+			entry["g"] = stop.g;
+			entry["b"] = stop.b;
+		}
+	}
+	
 	doc["rainbow_direction"] = settings.rainbow_direction;
 	doc["idle_direction"] = settings.idle_direction;
 	doc["printing_direction"] = settings.printing_direction;
@@ -81,6 +212,22 @@ void handleGetSettings() {
 	doc["night_mode_brightness"] = settings.night_mode_brightness;
 	doc["night_mode_enabled"] = settings.night_mode_enabled;
 	
+	doc["print_mode"] = settings.print_mode;
+	doc["transition_mode"] = settings.transition_mode;
+	doc["transition_ms"] = settings.transition_ms;
+	
+	doc["power_limit_ma"] = settings.power_limit_ma;
+	doc["led_channel_ma"] = settings.led_channel_ma;
+	
+	doc["udp_output_protocol"] = settings.udp_output_protocol;
+	doc["udp_output_host"] = settings.udp_output_host;
+	doc["udp_output_port"] = settings.udp_output_port;
+	doc["udp_output_universe"] = settings.udp_output_universe;
+	
+	doc["realtime_enabled"] = settings.realtime_enabled;
+	doc["realtime_timeout_ms"] = settings.realtime_timeout_ms;
+	doc["realtime_universe"] = settings.realtime_universe;
+	
 	String response;
 	serializeJson(doc, response);
 	server.send(200, "application/json", response);
@@ -92,22 +239,45 @@ void handleSetSettings() {
 		DeserializationError error = deserializeJson(doc, server.arg("plain"));
 		
 		if (!error) {
+			// Anything the LED task reads mid-frame goes through the command bus
+			LEDCommandBatch batch;
 			if (doc.containsKey("colors")) {
 				JsonArray colors = doc["colors"];
-				for (int i = 0; i < 9 && i < colors.size(); i++) {
-					if (colors[i].containsKey("r")) settings.colors[i].r = colors[i]["r"];
-					if (colors[i].containsKey("g")) settings.colors[i].g = colors[i]["g"];
-					if (colors[i].containsKey("b")) settings.colors[i].b = colors[i]["b"];
+				for (int i = 0; i < 8 && i < colors.size(); i++) {
+					batch.addColor(i,
+								   colors[i]["r"] | settings.colors[i].r,
+								   colors[i]["g"] | settings.colors[i].g,
+								   colors[i]["b"] | settings.colors[i].b);
 				}
 			}
 			
-			if (doc.containsKey("rainbow_direction")) settings.rainbow_direction = doc["rainbow_direction"];
-			if (doc.containsKey("idle_direction")) settings.idle_direction = doc["idle_direction"];
-			if (doc.containsKey("printing_direction")) settings.printing_direction = doc["printing_direction"];
-			if (doc.containsKey("download_direction")) settings.download_direction = doc["download_direction"];
-			if (doc.containsKey("global_brightness")) settings.global_brightness = doc["global_brightness"];
-			if (doc.containsKey("night_mode_brightness")) settings.night_mode_brightness = doc["night_mode_brightness"];
-			if (doc.containsKey("night_mode_enabled")) settings.night_mode_enabled = doc["night_mode_enabled"];
+			if (doc.containsKey("rainbow_direction")) batch.add(LED_CMD_DIRECTION, doc["rainbow_direction"], LED_DIRECTION_RAINBOW);
+			if (doc.containsKey("idle_direction")) batch.add(LED_CMD_DIRECTION, doc["idle_direction"], LED_DIRECTION_IDLE);
+			if (doc.containsKey("printing_direction")) batch.add(LED_CMD_DIRECTION, doc["printing_direction"], LED_DIRECTION_PRINTING);
+			if (doc.containsKey("download_direction")) batch.add(LED_CMD_DIRECTION, doc["download_direction"], LED_DIRECTION_DOWNLOAD);
+			if (doc.containsKey("global_brightness")) batch.add(LED_CMD_BRIGHTNESS, doc["global_brightness"]);
+			if (doc.containsKey("night_mode_brightness")) batch.add(LED_CMD_NIGHT_BRIGHTNESS, doc["night_mode_brightness"]);
+			if (doc.containsKey("night_mode_enabled")) batch.add(LED_CMD_NIGHT_MODE, doc["night_mode_enabled"].as<bool>());
+			if (doc.containsKey("print_mode")) batch.add(LED_CMD_PRINT_MODE, doc["print_mode"]);
+			if (doc.containsKey("transition_mode")) batch.add(LED_CMD_TRANSITION_MODE, doc["transition_mode"]);
+			if (doc.containsKey("transition_ms")) batch.add(LED_CMD_TRANSITION_MS, doc["transition_ms"]);
+			if (doc.containsKey("power_limit_ma")) batch.add(LED_CMD_POWER_LIMIT, doc["power_limit_ma"]);
+			if (doc.containsKey("led_channel_ma")) batch.add(LED_CMD_CHANNEL_MA, doc["led_channel_ma"]);
+			if (!submitLEDCommands(batch)) {
+				server.send(503, "application/json", "{\"error\":\"LED task busy\"}");
+				return;
+			}
+			
+			// Only the web server reads these; the UDP tasks work from the configured copies
+			if (doc.containsKey("udp_output_protocol")) settings.udp_output_protocol = constrain((int)doc["udp_output_protocol"], 0, 2);
+			if (doc.containsKey("udp_output_host")) strlcpy(settings.udp_output_host, doc["udp_output_host"] | "", sizeof(settings.udp_output_host));
+			if (doc.containsKey("udp_output_port")) settings.udp_output_port = constrain((int)doc["udp_output_port"], 0, 65535);
+			if (doc.containsKey("udp_output_universe")) settings.udp_output_universe = constrain((int)doc["udp_output_universe"], 1, 63999);
+			udpOutputConfigure(settings.udp_output_protocol, settings.udp_output_host, settings.udp_output_port, settings.udp_output_universe);
+			if (doc.containsKey("realtime_enabled")) settings.realtime_enabled = doc["realtime_enabled"];
+			if (doc.containsKey("realtime_timeout_ms")) settings.realtime_timeout_ms = constrain((int)doc["realtime_timeout_ms"], 100, 600000);
+			if (doc.containsKey("realtime_universe")) settings.realtime_universe = constrain((int)doc["realtime_universe"], 1, 63999);
+			udpInputConfigure(settings.realtime_enabled, settings.realtime_timeout_ms, settings.realtime_universe);
 			
 			saveSettings();
 			server.send(200, "application/json", "{\"status\":\"success\"}");
@@ -119,20 +289,67 @@ void handleSetSettings() {
 	}
 }
 
+// Read one palette stop given as {"pos","r","g","b"} or [pos, r, g, b]
+static bool parsePaletteStop(JsonVariant value, PaletteStop& stop) {
+	if (value.is<JsonArray>()) {
+		JsonArray entry = value.as<JsonArray>();
+		if (entry.size() != 4) return false;
+		stop.pos = constrain((int)entry[0], 0, 255);
+		stop.r = constrain((int)entry[1], 0, 255);
+		stop.g = constrain((int)entry[2], 0, 255);
+		stop.b = constrain((int)entry[3], 0, 255);
+		return true;
+	}
+	if (value.containsKey("pos") && value.containsKey("r") && value.containsKey("g") && value.containsKey("b")) {
+		stop.pos = constrain((int)value["pos"], 0, 255);
+		stop.r = constrain((int)value["r"], 0, 255);
+		stop.g = constrain((int)value["g"], 0, 255);
+		stop.b = constrain((int)value["b"], 0, 255);
+		return true;
+	}
+	return false;
+}
+
 void handleSetColors() {
 	if (server.hasArg("plain")) {
-		DynamicJsonDocument doc(1024);
+		DynamicJsonDocument doc(4096);
 		DeserializationError error = deserializeJson(doc, server.arg("plain"));
 		
-		if (!error && doc.containsKey("colors")) {
+		if (!error && (doc.containsKey("colors") || doc.containsKey("palettes"))) {
+			LEDCommandBatch batch;
 			JsonArray colors = doc["colors"];
 			for (int i = 0; i < 8 && i < colors.size(); i++) {
 				if (colors[i].containsKey("r") && colors[i].containsKey("g") && colors[i].containsKey("b")) {
-					settings.colors[i].r = colors[i]["r"];
-					settings.colors[i].g = colors[i]["g"];
-					settings.colors[i].b = colors[i]["b"];
+					batch.addColor(i, colors[i]["r"], colors[i]["g"], colors[i]["b"]);
 				}
 			}
+			
+			// Palettes: one stop list per state; an empty list restores the default.
+			// null leaves that state's palette unchanged.
+			JsonArray palettes = doc["palettes"];
+			for (int i = 0; i < 8 && i < palettes.size(); i++) {
+				if (palettes[i].isNull()) continue;
+				
+				JsonArray stops = palettes[i];
+				if (stops.size() == 1 || stops.size() > MAX_PALETTE_STOPS) {
+					server.send(400, "application/json", "{\"error\":\"Palettes need 2-8 stops\"}");
+					return;
+				}
+				
+				StatePalette palette;
+				for (JsonVariant value : stops) {
+					if (!parsePaletteStop(value, palette.stops[palette.stop_count++])) {
+						server.send(400, "application/json", "{\"error\":\"Invalid palette stop\"}");
+						return;
+					}
+				}
+				batch.addPalette(i, palette);
+			}
+			
+			if (!submitLEDCommands(batch)) {
+				server.send(503, "application/json", "{\"error\":\"LED task busy\"}");
+				return;
+			}
 			saveSettings();
 			server.send(200, "application/json", "{\"status\":\"success\"}");
 		} else {
@@ -149,11 +366,16 @@ void handleSetBrightness() {
 		DeserializationError error = deserializeJson(doc, server.arg("plain"));
 		
 		if (!error) {
+			LEDCommandBatch batch;
 			if (doc.containsKey("brightness")) {
-				settings.global_brightness = constrain((int)doc["brightness"], 1, 255);
+				batch.add(LED_CMD_BRIGHTNESS, doc["brightness"]);
 			}
 			if (doc.containsKey("night_brightness")) {
-				settings.night_mode_brightness = constrain((int)doc["night_brightness"], 1, 255);
+				batch.add(LED_CMD_NIGHT_BRIGHTNESS, doc["night_brightness"]);
+			}
+			if (!submitLEDCommands(batch)) {
+				server.send(503, "application/json", "{\"error\":\"LED task busy\"}");
+				return;
 			}
 			saveSettings();
 			server.send(200, "application/json", "{\"status\":\"success\"}");
@@ -171,11 +393,16 @@ void handleSetDirections() {
 		DeserializationError error = deserializeJson(doc, server.arg("plain"));
 		
 		if (!error) {
-			if (doc.containsKey("rainbow")) settings.rainbow_direction = doc["rainbow"];
-			if (doc.containsKey("idle")) settings.idle_direction = doc["idle"];
-			if (doc.containsKey("printing")) settings.printing_direction = doc["printing"];
-			if (doc.containsKey("download")) settings.download_direction = doc["download"];
+			LEDCommandBatch batch;
+			if (doc.containsKey("rainbow")) batch.add(LED_CMD_DIRECTION, doc["rainbow"], LED_DIRECTION_RAINBOW);
+			if (doc.containsKey("idle")) batch.add(LED_CMD_DIRECTION, doc["idle"], LED_DIRECTION_IDLE);
+			if (doc.containsKey("printing")) batch.add(LED_CMD_DIRECTION, doc["printing"], LED_DIRECTION_PRINTING);
+			if (doc.containsKey("download")) batch.add(LED_CMD_DIRECTION, doc["download"], LED_DIRECTION_DOWNLOAD);
 			
+			if (!submitLEDCommands(batch)) {
+				server.send(503, "application/json", "{\"error\":\"LED task busy\"}");
+				return;
+			}
 			saveSettings();
 			server.send(200, "application/json", "{\"status\":\"success\"}");
 		} else {
@@ -192,7 +419,12 @@ void handleNightMode() {
 		DeserializationError error = deserializeJson(doc, server.arg("plain"));
 		
 		if (!error && doc.containsKey("enabled")) {
-			settings.night_mode_enabled = doc["enabled"];
+			LEDCommandBatch batch;
+			batch.add(LED_CMD_NIGHT_MODE, doc["enabled"].as<bool>());
+			if (!submitLEDCommands(batch)) {
+				server.send(503, "application/json", "{\"error\":\"LED task busy\"}");
+				return;
+			}
 			saveSettings();
 			server.send(200, "application/json", "{\"status\":\"success\"}");
 		} else {
@@ -426,6 +658,32 @@ void handleAuthRenew() {
 	}
 }
 
+// Validate GPIO pin (common usable pins on ESP32)
+static bool isValidLEDPin(int pin) {
+	return pin >= 0 && pin <= 33 && (pin < 6 || pin > 11);
+}
+
+// LED hardware changes are applied live; report how long the LED task was paused
+// Resize the strip with the LED task parked; settings are saved only if the
+// new buffers could be allocated
+static bool applyStripSettings(const LEDStripSettings& config) {
+	if (!reinitializeLEDStrip(config)) {
+		server.send(500, "application/json", "{\"error\":\"Not enough memory for the new LED configuration\"}");
+		return false;
+	}
+	saveSettings();
+	
+	DynamicJsonDocument response(256);
+	response["status"] = "applied";
+	response["led_count"] = settings.led_count;
+	response["reconfigure_us"] = last_reconfigure_us;
+	
+	String responseStr;
+	serializeJson(response, responseStr);
+	server.send(200, "application/json", responseStr);
+	return true;
+}
+
 void handleGetLEDCount() {
 	DynamicJsonDocument doc(256);
 	doc["count"] = settings.led_count;
@@ -452,18 +710,19 @@ void handleSetLEDCount() {
 		if (!error && doc.containsKey("count")) {
 			int newCount = doc["count"];
 			
+			// LED count is derived from the channel table when several strips are used
+			if (settings.led_channel_count > 1) {
+				server.send(400, "application/json", "{\"error\":\"LED count is set per channel - use /api/led/channels\"}");
+				return;
+			}
+			
 			// Validate LED count range
-			if (newCount >= 1 && newCount <= 300) {
-				settings.led_count = newCount;
-				saveSettings();
-				
-				server.send(200, "application/json", "{\"status\":\"saved\"}");
-				
-				// Restart to apply new LED count
-				delay(1000);
-				ESP.restart();
+			if (newCount >= 1 && newCount <= MAX_LED_COUNT) {
+				LEDStripSettings config = currentStripSettings();
+				config.led_count = newCount;
+				applyStripSettings(config);
 			} else {
-				server.send(400, "application/json", "{\"error\":\"LED count must be between 1 and 300\"}");
+				server.send(400, "application/json", "{\"error\":\"LED count must be between 1 and " + String(MAX_LED_COUNT) + "\"}");
 			}
 		} else {
 			server.send(400, "application/json", "{\"error\":\"Invalid data - count required\"}");
@@ -481,17 +740,11 @@ void handleSetLEDPin() {
 		if (!error && doc.containsKey("pin")) {
 			int newPin = doc["pin"];
 			
-			// Validate GPIO pin (common usable pins on ESP32)
-			if (newPin >= 0 && newPin <= 33 && newPin != 6 && newPin != 7 && 
-			    newPin != 8 && newPin != 9 && newPin != 10 && newPin != 11) {
-				settings.led_pin = newPin;
-				saveSettings();
-				
-				server.send(200, "application/json", "{\"status\":\"saved\"}");
-				
-				// Restart to apply new GPIO pin
-				delay(1000);
-				ESP.restart();
+			if (isValidLEDPin(newPin)) {
+				LEDStripSettings config = currentStripSettings();
+				config.led_pin = newPin;
+				config.led_channels[0].pin = newPin;
+				applyStripSettings(config);
 			} else {
 				server.send(400, "application/json", "{\"error\":\"Invalid GPIO pin (use 0-5,12-33, avoid 6-11)\"}");
 			}
@@ -503,6 +756,423 @@ void handleSetLEDPin() {
 	}
 }
 
+void handleGetLEDChannels() {
+	DynamicJsonDocument doc(1024);
+	doc["total_count"] = settings.led_count;
+	doc["max_channels"] = MAX_LED_CHANNELS;
+	doc["max_count"] = MAX_LED_COUNT;
+	
+	JsonArray channels = doc.createNestedArray("channels");
+	for (int i = 0; i < settings.led_channel_count; i++) {
+		JsonObject channel = channels.createNestedObject();
+		channel["pin"] = settings.led_channels[i].pin;
+		channel["count"] = settings.led_channels[i].count;
+		channel["offset"] = settings.led_channels[i].offset;
+	}
+	
+	String response;
+	serializeJson(doc, response);
+	server.send(200, "application/json", response);
+}
+
+void handleSetLEDChannels() {
+	if (server.hasArg("plain")) {
+		DynamicJsonDocument doc(1024);
+		DeserializationError error = deserializeJson(doc, server.arg("plain"));
+		
+		if (!error && doc.containsKey("channels")) {
+			JsonArray channels = doc["channels"];
+			int channelCount = channels.size();
+			
+			if (channelCount < 1 || channelCount > MAX_LED_CHANNELS) {
+				server.send(400, "application/json", "{\"error\":\"Between 1 and " + String(MAX_LED_CHANNELS) + " channels required\"}");
+				return;
+			}
+			
+			LEDChannelSettings newChannels[MAX_LED_CHANNELS];
+			int nextOffset = 0;
+			for (int i = 0; i < channelCount; i++) {
+				newChannels[i].pin = channels[i]["pin"] | -1;
+				newChannels[i].count = channels[i]["count"] | 0;
+				// Channels without an explicit offset are laid end to end
+				newChannels[i].offset = channels[i]["offset"] | nextOffset;
+				
+				if (!isValidLEDPin(newChannels[i].pin)) {
+					server.send(400, "application/json", "{\"error\":\"Invalid GPIO pin for channel " + String(i) + "\"}");
+					return;
+				}
+				for (int j = 0; j < i; j++) {
+					if (newChannels[j].pin == newChannels[i].pin) {
+						server.send(400, "application/json", "{\"error\":\"Each channel needs its own GPIO pin\"}");
+						return;
+					}
+				}
+				if (newChannels[i].count < 1 || newChannels[i].offset < 0 ||
+					newChannels[i].offset + newChannels[i].count > MAX_LED_COUNT) {
+					server.send(400, "application/json", "{\"error\":\"Channel " + String(i) + " exceeds " + String(MAX_LED_COUNT) + " LEDs\"}");
+					return;
+				}
+				nextOffset = newChannels[i].offset + newChannels[i].count;
+			}
+			
+			LEDStripSettings config = currentStripSettings();
+			config.led_channel_count = channelCount;
+			for (int i = 0; i < channelCount; i++) {
+				config.led_channels[i] = newChannels[i];
+			}
+			if (channelCount == 1) {
+				config.led_pin = newChannels[0].pin;
+				config.led_count = newChannels[0].count;
+			}
+			applyStripSettings(config);
+		} else {
+			server.send(400, "application/json", "{\"error\":\"Invalid data - channels required\"}");
+		}
+	} else {
+		server.send(400, "application/json", "{\"error\":\"No data\"}");
+	}
+}
+
+void handleGetLayout() {
+	DynamicJsonDocument doc(512);
+	doc["type"] = settings.layout.type;
+	doc["width"] = settings.layout.width;
+	doc["height"] = settings.layout.height;
+	doc["serpentine"] = settings.layout.serpentine;
+	doc["reverse"] = settings.layout.reverse;
+	JsonArray rings = doc.createNestedArray("rings");
+	for (int i = 0; i < settings.layout.ring_count; i++) {
+		rings.add(settings.layout.ring_sizes[i]);
+	}
+	doc["map_count"] = getLayoutMapCount();
+	doc["remapped"] = !layoutIsIdentity();
+	
+	String response;
+	serializeJson(doc, response);
+	server.send(200, "application/json", response);
+}
+
+void handleSetLayout() {
+	if (server.hasArg("plain")) {
+		// A custom map carries one [x, y] pair per LED, up to ~20 KB of text.
+		// It is scanned straight from the body below, so the document only
+		// holds the layout fields however many LEDs the map covers.
+		const String& body = server.arg("plain");
+		StaticJsonDocument<128> filter;
+		filter["type"] = true;
+		filter["width"] = true;
+		filter["height"] = true;
+		filter["serpentine"] = true;
+		filter["reverse"] = true;
+		filter["rings"] = true;
+		
+		DynamicJsonDocument doc(1024);
+		DeserializationError error = deserializeJson(doc, body, DeserializationOption::Filter(filter));
+		
+		if (doc.capacity() == 0 || error == DeserializationError::NoMemory) {
+			server.send(500, "application/json", "{\"error\":\"Out of memory\"}");
+			return;
+		}
+		if (error) {
+			server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+			return;
+		}
+		
+		LayoutSettings layout = settings.layout;
+		if (doc.containsKey("type")) layout.type = doc["type"];
+		if (doc.containsKey("width")) layout.width = doc["width"];
+		if (doc.containsKey("height")) layout.height = doc["height"];
+		if (doc.containsKey("serpentine")) layout.serpentine = doc["serpentine"];
+		if (doc.containsKey("reverse")) layout.reverse = doc["reverse"];
+		
+		if (layout.type < LAYOUT_LINEAR || layout.type > LAYOUT_CUSTOM) {
+			server.send(400, "application/json", "{\"error\":\"Layout type must be 0-3\"}");
+			return;
+		}
+		if (layout.width < 1 || layout.height < 1 || layout.width * layout.height > MAX_LED_COUNT) {
+			server.send(400, "application/json", "{\"error\":\"Matrix exceeds " + String(MAX_LED_COUNT) + " LEDs\"}");
+			return;
+		}
+		
+		if (doc.containsKey("rings")) {
+			JsonArray rings = doc["rings"];
+			if (rings.size() < 1 || rings.size() > MAX_LAYOUT_RINGS) {
+				server.send(400, "application/json", "{\"error\":\"Between 1 and " + String(MAX_LAYOUT_RINGS) + " rings required\"}");
+				return;
+			}
+			layout.ring_count = rings.size();
+			for (int i = 0; i < MAX_LAYOUT_RINGS; i++) {
+				layout.ring_sizes[i] = (i < layout.ring_count) ? constrain((int)rings[i], 0, MAX_LED_COUNT) : 0;
+			}
+		}
+		
+		uint8_t* xy = (uint8_t*)malloc(MAX_LED_COUNT * 2);
+		if (xy == nullptr) {
+			server.send(500, "application/json", "{\"error\":\"Out of memory\"}");
+			return;
+		}
+		int count = 0;
+		LayoutMapParse parsed = parseLayoutMapJson(body.c_str(), body.length(), xy, MAX_LED_COUNT, count);
+		if (parsed == LAYOUT_MAP_INVALID) {
+			free(xy);
+			server.send(400, "application/json", "{\"error\":\"Map must be an array of [x, y] pairs\"}");
+			return;
+		}
+		if (parsed == LAYOUT_MAP_TOO_LARGE) {
+			free(xy);
+			server.send(400, "application/json", "{\"error\":\"Map exceeds " + String(MAX_LED_COUNT) + " LEDs\"}");
+			return;
+		}
+		if (parsed == LAYOUT_MAP_PARSED) {
+			bool stored = setLayoutMap(xy, count);
+			free(xy);
+			if (!stored) {
+				server.send(500, "application/json", "{\"error\":\"Out of memory\"}");
+				return;
+			}
+		} else {
+			free(xy);
+		}
+		
+		// Tables are rebuilt with the LED task parked, like other hardware changes
+		LEDStripSettings config = currentStripSettings();
+		config.layout = layout;
+		if (applyStripSettings(config)) {
+			if (parsed == LAYOUT_MAP_PARSED) saveLayoutMap();
+		} else if (parsed == LAYOUT_MAP_PARSED) {
+			loadLayoutMap();  // Back to the stored map with the old layout
+		}
+	} else {
+		server.send(400, "application/json", "{\"error\":\"No data\"}");
+	}
+}
+
+void handleGetEffects() {
+	DynamicJsonDocument doc(6144);
+	doc["max_effects"] = MAX_EFFECTS;
+	doc["max_source"] = MAX_EFFECT_SOURCE - 1;
+	doc["run_us"] = effect_last_run_us;
+	doc["max_run_us"] = effect_max_run_us;
+	
+	JsonArray list = doc.createNestedArray("effects");
+	for (int id = 0; id < MAX_EFFECTS; id++) {
+		if (!effects[id].used) continue;
+		JsonObject effect = list.createNestedObject();
+		effect["id"] = id;
+		effect["name"] = effects[id].name;
+		effect["source"] = effects[id].source;
+		effect["ops"] = effects[id].program.code_length;
+		effect["stack"] = effects[id].program.stack_depth;
+	}
+	
+	JsonArray slots = doc.createNestedArray("slots");
+	for (int i = 0; i < 8; i++) {
+		slots.add(settings.effect_slots[i]);
+	}
+	
+	String response;
+	serializeJson(doc, response);
+	server.send(200, "application/json", response);
+}
+
+void handleSetEffect() {
+	if (server.hasArg("plain")) {
+		DynamicJsonDocument doc(1024);
+		DeserializationError error = deserializeJson(doc, server.arg("plain"));
+		
+		if (!error && doc.containsKey("source")) {
+			int id = doc["id"] | -1;
+			if (id >= MAX_EFFECTS) {
+				server.send(400, "application/json", "{\"error\":\"Invalid effect id\"}");
+				return;
+			}
+			
+			EffectError compileError;
+			id = installEffect(id, doc["name"] | "Effect", doc["source"] | "", compileError);
+			if (id < 0) {
+				DynamicJsonDocument response(256);
+				response["error"] = compileError.message;
+				response["position"] = compileError.position;
+				String body;
+				serializeJson(response, body);
+				server.send(400, "application/json", body);
+				return;
+			}
+			saveEffects();
+			
+			DynamicJsonDocument response(256);
+			response["status"] = "success";
+			response["id"] = id;
+			response["ops"] = effects[id].program.code_length;
+			String body;
+			serializeJson(response, body);
+			server.send(200, "application/json", body);
+		} else {
+			server.send(400, "application/json", "{\"error\":\"Invalid data - source required\"}");
+		}
+	} else {
+		server.send(400, "application/json", "{\"error\":\"No data\"}");
+	}
+}
+
+void handleAssignEffect() {
+	if (server.hasArg("plain")) {
+		DynamicJsonDocument doc(256);
+		DeserializationError error = deserializeJson(doc, server.arg("plain"));
+		
+		if (!error && doc.containsKey("state") && doc.containsKey("effect")) {
+			int state = doc["state"];
+			int id = doc["effect"];
+			if (state < 0 || state >= 8) {
+				server.send(400, "application/json", "{\"error\":\"State must be 0-7\"}");
+				return;
+			}
+			if (id >= MAX_EFFECTS || (id >= 0 && !effects[id].used)) {
+				server.send(400, "application/json", "{\"error\":\"Unknown effect\"}");
+				return;
+			}
+			
+			// The LED task reads the slot while rendering
+			LEDCommandBatch batch;
+			batch.add(LED_CMD_EFFECT_SLOT, (id < 0) ? -1 : id, state);
+			if (!submitLEDCommands(batch)) {
+				server.send(503, "application/json", "{\"error\":\"LED task busy\"}");
+				return;
+			}
+			saveSettings();
+			server.send(200, "application/json", "{\"status\":\"success\"}");
+		} else {
+			server.send(400, "application/json", "{\"error\":\"Invalid data - state and effect required\"}");
+		}
+	} else {
+		server.send(400, "application/json", "{\"error\":\"No data\"}");
+	}
+}
+
+void handleDeleteEffect() {
+	if (server.hasArg("plain")) {
+		DynamicJsonDocument doc(256);
+		DeserializationError error = deserializeJson(doc, server.arg("plain"));
+		
+		if (!error && doc.containsKey("id")) {
+			if (!removeEffect(doc["id"])) {
+				server.send(400, "application/json", "{\"error\":\"Unknown effect\"}");
+				return;
+			}
+			saveEffects();
+			saveSettings();
+			server.send(200, "application/json", "{\"status\":\"success\"}");
+		} else {
+			server.send(400, "application/json", "{\"error\":\"Invalid data - id required\"}");
+		}
+	} else {
+		server.send(400, "application/json", "{\"error\":\"No data\"}");
+	}
+}
+
+// Download the flight recorder as a binary file (see FrameRecorder.h for the
+// format, tools/decode_frames.py to replay it)
+void handleFramesDump() {
+	if (printerStateMutex == NULL || xSemaphoreTake(printerStateMutex, 1000 / portTICK_PERIOD_MS) != pdTRUE) {
+		server.send(503, "application/json", "{\"error\":\"LED task busy\"}");
+		return;
+	}
+	
+	// Snapshot with the LED task parked, then stream without holding it
+	size_t size = frameRecorderDumpSize();
+	uint8_t* dump = (uint8_t*)malloc(size);
+	if (dump != nullptr) size = frameRecorderDump(dump, size);
+	xSemaphoreGive(printerStateMutex);
+	
+	if (dump == nullptr) {
+		server.send(500, "application/json", "{\"error\":\"Out of memory\"}");
+		return;
+	}
+	
+	server.sendHeader("Content-Disposition", "attachment; filename=frames.mlfr");
+	server.setContentLength(size);
+	server.send(200, "application/octet-stream", "");
+	server.sendContent((const char*)dump, size);
+	free(dump);
+}
+
+static void writeHistogram(JsonObject out, const TimingHistogram& histogram) {
+	out["count"] = histogram.count;
+	out["min_us"] = histogram.min_us;
+	out["mean_us"] = histogramMean(histogram);
+	out["p50_us"] = histogramPercentile(histogram, 50);
+	out["p90_us"] = histogramPercentile(histogram, 90);
+	out["p99_us"] = histogramPercentile(histogram, 99);
+	out["max_us"] = histogram.max_us;
+	
+	// Non-empty buckets as [lower bound us, count]
+	JsonArray buckets = out.createNestedArray("buckets");
+	for (int i = 0; i < TIMING_HISTOGRAM_BUCKETS; i++) {
+		if (histogram.buckets[i] == 0) continue;
+		JsonArray bucket = buckets.createNestedArray();
+		bucket.add(histogramBucketLow(i));
+		bucket.add(histogram.buckets[i]);
+	}
+}
+
+void handleTiming() {
+	DynamicJsonDocument doc(12288);
+	
+	doc["period_ms"] = LED_FRAME_PERIOD_MS;
+	doc["frames"] = frame_timing.frames;
+	doc["deadline_misses"] = frame_timing.deadline_misses;
+	doc["slots_skipped"] = frame_timing.slots_skipped;
+	doc["lock_timeouts"] = frame_timing.lock_timeouts;
+	
+	writeHistogram(doc.createNestedObject("interval"), frame_timing.interval);
+	writeHistogram(doc.createNestedObject("render"), frame_timing.render);
+	writeHistogram(doc.createNestedObject("lock_wait"), frame_timing.lock_wait);
+	writeHistogram(doc.createNestedObject("show"), frame_timing.show);
+	
+	String response;
+	serializeJson(doc, response);
+	server.send(200, "application/json", response);
+	
+	// ?reset=1 starts a fresh measurement window after this report
+	if (server.hasArg("reset") && server.arg("reset") == "1") {
+		frameTimingReset();
+	}
+}
+
+void handleProfile() {
+	DynamicJsonDocument doc(12288);
+	
+	uint64_t windowUs = profilerWindowUs();
+	doc["window_ms"] = (uint32_t)(windowUs / 1000);
+	doc["free_heap"] = ESP.getFreeHeap();
+	doc["min_free_heap"] = ESP.getMinFreeHeap();
+	
+	// Busy time is measured around each task's loop body
+	JsonObject tasks = doc.createNestedObject("tasks");
+	for (int i = 0; i < PROFILE_TASK_COUNT; i++) {
+		const ProfileTaskStats& stats = profileTaskStats((ProfileTask)i);
+		JsonObject task = tasks.createNestedObject(profileTaskName((ProfileTask)i));
+		task["cpu_percent"] = (windowUs > 0) ? (float)(stats.busy_us * 100.0 / windowUs) : 0.0f;
+		task["busy_ms"] = (uint32_t)(stats.busy_us / 1000);
+		task["iterations"] = stats.iterations;
+		task["stack_free_min"] = profileTaskStackFree((ProfileTask)i);
+	}
+	
+	JsonObject zones = doc.createNestedObject("zones");
+	for (int i = 0; i < PROFILE_ZONE_COUNT; i++) {
+		const TimingHistogram& histogram = profileZoneHistogram((ProfileZone)i);
+		if (histogram.count == 0) continue;
+		writeHistogram(zones.createNestedObject(profileZoneName((ProfileZone)i)), histogram);
+	}
+	
+	String response;
+	serializeJson(doc, response);
+	server.send(200, "application/json", response);
+	
+	if (server.hasArg("reset") && server.arg("reset") == "1") {
+		profilerReset();
+	}
+}
 
 void handleLightsToggle() {
 	if (server.hasArg("plain")) {
@@ -512,19 +1182,12 @@ void handleLightsToggle() {
 		if (!error && doc.containsKey("enabled")) {
 			bool enabled = doc["enabled"];
 			
-			if (enabled && settings.lights_off_override) {
-				lights_turning_on = true;
-				lights_turning_off = false;
-				lights_animation_start = millis();
-				lights_animation_progress = 0;
-				Serial.println(" Starting lights ON animation (middle to ends)");
-			} else if (!enabled && !settings.lights_off_override) {
-				captureCurrentFrame();
-				lights_turning_off = true;
-				lights_turning_on = false;
-				lights_animation_start = millis();
-				lights_animation_progress = 0;
-				Serial.println(" Starting lights OFF animation (ends to middle)");
+			// The LED task starts the on/off animation at its next frame
+			LEDCommandBatch batch;
+			batch.add(LED_CMD_LIGHTS, enabled);
+			if (!submitLEDCommands(batch)) {
+				server.send(503, "application/json", "{\"error\":\"LED task busy\"}");
+				return;
 			}
 			
 			DynamicJsonDocument response(256);
@@ -564,6 +1227,7 @@ void handleSetP1Mode() {
 		if (!error && doc.containsKey("p1_series_mode")) {
 			settings.p1_series_mode = doc["p1_series_mode"];
 			saveSettings();
+			requestStatusEvaluation();
 			
 			DynamicJsonDocument response(256);
 			response["status"] = "success";
@@ -618,6 +1282,7 @@ void handleSetIdleTimeout() {
 			
 			if (updated) {
 				saveSettings();
+				requestStatusEvaluation();
 				
 				DynamicJsonDocument response(256);
 				response["status"] = "success";
@@ -728,7 +1393,7 @@ void handleSetRemoteConfig() {
 					remoteControlClient.setServer(settings.remote_mqtt_server, settings.remote_mqtt_port);
 					reconnectRemoteControl();
 				} else {
-					remoteControlClient.disconnect();
+					mqttConnectionStop(remote_mqtt);
 				}
 			}
 		} else {
@@ -795,34 +1460,53 @@ void publishPrinterStatus() {
 	Serial.printf("️ Published printer status (%d bytes)\n", printerStr.length());
 }
 
+// Time every request handler into the web_handler profile zone
+static WebServer::THandlerFunction profiled(void (*handler)()) {
+	return [handler]() {
+		PROFILE_SCOPE(PROFILE_WEB_HANDLER);
+		handler();
+	};
+}
+
 void setupWebServer() {
-	server.on("/", HTTP_GET, handleRoot);
-	
-	server.on("/api/status", HTTP_GET, handleStatus);
-	server.on("/api/settings", HTTP_GET, handleGetSettings);
-	server.on("/api/settings", HTTP_POST, handleSetSettings);
-	server.on("/api/colors", HTTP_POST, handleSetColors);
-	server.on("/api/brightness", HTTP_POST, handleSetBrightness);
-	server.on("/api/directions", HTTP_POST, handleSetDirections);
-	server.on("/api/wifi/scan", HTTP_GET, handleWiFiScan);
-	server.on("/api/wifi/connect", HTTP_POST, handleWiFiConnect);
-	server.on("/api/nightmode", HTTP_POST, handleNightMode);
-	server.on("/api/mqtt/config", HTTP_GET, handleGetMQTTConfig);
-	server.on("/api/mqtt/config", HTTP_POST, handleSetMQTTConfig);
-	server.on("/api/auth/login", HTTP_POST, handleAuthLogin);
-	server.on("/api/auth/verify", HTTP_POST, handleAuthVerify);
-	server.on("/api/auth/renew", HTTP_POST, handleAuthRenew);
-	server.on("/api/led/count", HTTP_GET, handleGetLEDCount);
-	server.on("/api/led/count", HTTP_POST, handleSetLEDCount);
-	server.on("/api/led/pin", HTTP_GET, handleGetLEDPin);
-	server.on("/api/led/pin", HTTP_POST, handleSetLEDPin);
-	server.on("/api/lights/toggle", HTTP_POST, handleLightsToggle);
-	server.on("/api/p1mode", HTTP_GET, handleGetP1Mode);
-	server.on("/api/p1mode", HTTP_POST, handleSetP1Mode);
-	server.on("/api/idle/timeout", HTTP_GET, handleGetIdleTimeout);
-	server.on("/api/idle/timeout", HTTP_POST, handleSetIdleTimeout);
-	server.on("/api/remote/config", HTTP_GET, handleGetRemoteConfig);
-	server.on("/api/remote/config", HTTP_POST, handleSetRemoteConfig);
+	server.on("/", HTTP_GET, profiled(handleRoot));
+	
+	server.on("/api/status", HTTP_GET, profiled(handleStatus));
+	server.on("/api/settings", HTTP_GET, profiled(handleGetSettings));
+	server.on("/api/settings", HTTP_POST, profiled(handleSetSettings));
+	server.on("/api/colors", HTTP_POST, profiled(handleSetColors));
+	server.on("/api/brightness", HTTP_POST, profiled(handleSetBrightness));
+	server.on("/api/directions", HTTP_POST, profiled(handleSetDirections));
+	server.on("/api/wifi/scan", HTTP_GET, profiled(handleWiFiScan));
+	server.on("/api/wifi/connect", HTTP_POST, profiled(handleWiFiConnect));
+	server.on("/api/nightmode", HTTP_POST, profiled(handleNightMode));
+	server.on("/api/mqtt/config", HTTP_GET, profiled(handleGetMQTTConfig));
+	server.on("/api/mqtt/config", HTTP_POST, profiled(handleSetMQTTConfig));
+	server.on("/api/auth/login", HTTP_POST, profiled(handleAuthLogin));
+	server.on("/api/auth/verify", HTTP_POST, profiled(handleAuthVerify));
+	server.on("/api/auth/renew", HTTP_POST, profiled(handleAuthRenew));
+	server.on("/api/led/count", HTTP_GET, profiled(handleGetLEDCount));
+	server.on("/api/led/count", HTTP_POST, profiled(handleSetLEDCount));
+	server.on("/api/led/pin", HTTP_GET, profiled(handleGetLEDPin));
+	server.on("/api/led/pin", HTTP_POST, profiled(handleSetLEDPin));
+	server.on("/api/led/channels", HTTP_GET, profiled(handleGetLEDChannels));
+	server.on("/api/led/channels", HTTP_POST, profiled(handleSetLEDChannels));
+	server.on("/api/layout", HTTP_GET, profiled(handleGetLayout));
+	server.on("/api/layout", HTTP_POST, profiled(handleSetLayout));
+	server.on("/api/frames/dump", HTTP_GET, profiled(handleFramesDump));
+	server.on("/api/timing", HTTP_GET, profiled(handleTiming));
+	server.on("/api/profile", HTTP_GET, profiled(handleProfile));
+	server.on("/api/effects", HTTP_GET, profiled(handleGetEffects));
+	server.on("/api/effects", HTTP_POST, profiled(handleSetEffect));
+	server.on("/api/effects/assign", HTTP_POST, profiled(handleAssignEffect));
+	server.on("/api/effects/delete", HTTP_POST, profiled(handleDeleteEffect));
+	server.on("/api/lights/toggle", HTTP_POST, profiled(handleLightsToggle));
+	server.on("/api/p1mode", HTTP_GET, profiled(handleGetP1Mode));
+	server.on("/api/p1mode", HTTP_POST, profiled(handleSetP1Mode));
+	server.on("/api/idle/timeout", HTTP_GET, profiled(handleGetIdleTimeout));
+	server.on("/api/idle/timeout", HTTP_POST, profiled(handleSetIdleTimeout));
+	server.on("/api/remote/config", HTTP_GET, profiled(handleGetRemoteConfig));
+	server.on("/api/remote/config", HTTP_POST, profiled(handleSetRemoteConfig));
 	server.on("/deviceid", HTTP_GET, []() {
 		String chipId = String((uint32_t)ESP.getEfuseMac(), HEX);
 		chipId.toUpperCase();
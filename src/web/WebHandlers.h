@@ -29,6 +29,17 @@ void handleGetLEDCount();
 void handleSetLEDCount();
 void handleGetLEDPin();
 void handleSetLEDPin();
+void handleGetLEDChannels();
+void handleSetLEDChannels();
+void handleGetLayout();
+void handleSetLayout();
+void handleGetEffects();
+void handleSetEffect();
+void handleAssignEffect();
+void handleDeleteEffect();
+void handleFramesDump();
+void handleTiming();
+void handleProfile();
 void handleLightsToggle();
 void handleGetP1Mode();
 void handleSetP1Mode();
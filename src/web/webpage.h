@@ -211,7 +211,7 @@ inline const char* webPage = R"delimiter(
                 <h3>LED Strip Configuration</h3>
                 <div class="input-group">
                     <label>Number of LEDs:</label>
-                    <input type="number" id="led-count" min="1" max="300" placeholder="60">
+                    <input type="number" id="led-count" min="1" max="2000" placeholder="60">
                     <small>Current: <span id="current-led-count">60</span> LEDs</small>
                   </div>
                 <button class="btn" onclick="updateLEDCount()">Update LED Count</button>
@@ -239,7 +239,7 @@ inline const char* webPage = R"delimiter(
                     <label>Idle Timeout: <span id="idle-timeout-value">30</span> minutes</label>
                     <input type="range" min="1" max="120" value="30" class="slider" id="idle-timeout-slider" oninput="updateIdleTimeout(this.value)">
                 </div>
-                <p style="margin-top: 10px; font-size: 0.9em; color: #888;">Device will restart after changing LED count or GPIO pin</p>
+                <p style="margin-top: 10px; font-size: 0.9em; color: #888;">LED count and GPIO pin changes apply immediately</p>
             </div>
 
 
@@ -892,8 +892,8 @@ inline const char* webPage = R"delimiter(
         async function updateLEDCount() {
             const ledCount = parseInt(document.getElementById('led-count').value);
             
-            if (!ledCount || ledCount < 1 || ledCount > 300) {
-                alert('Please enter a valid LED count between 1 and 300');
+            if (!ledCount || ledCount < 1 || ledCount > 2000) {
+                alert('Please enter a valid LED count between 1 and 2000');
                 return;
             }
 
@@ -903,7 +903,8 @@ inline const char* webPage = R"delimiter(
                     headers: { 'Content-Type': 'application/json' },
                     body: JSON.stringify({ count: ledCount })
                 });
-                alert('LED count updated! Device will restart to apply changes.');
+                alert('LED count updated and applied.');
+                loadLEDCount();
             } catch (error) {
                 alert('Failed to update LED count: ' + error.message);
             }
@@ -937,7 +938,8 @@ inline const char* webPage = R"delimiter(
                     headers: { 'Content-Type': 'application/json' },
                     body: JSON.stringify({ pin: ledPin })
                 });
-                alert('GPIO pin updated! Device will restart to apply changes.');
+                alert('GPIO pin updated and applied.');
+                loadLEDPin();
             } catch (error) {
                 alert('Failed to update GPIO pin: ' + error.message);
             }
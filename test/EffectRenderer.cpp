@@ -0,0 +1,148 @@
+#include "EffectRenderer.h"
+#include "TestHarness.h"
+#include "../src/config/Settings.h"
+#include "../src/led/EffectVM.h"
+#include "../src/led/LEDAnimations.h"
+#include "../src/led/LEDLayout.h"
+#include "../src/led/LEDTransition.h"
+#include "../src/printer/PrinterState.h"
+
+const RenderScenario render_scenarios[] = {
+  {"disconnected", "unknown", 0, PRINT_MODE_PROGRESS, -1, nullptr},
+  {"idle", "idle", 0, PRINT_MODE_PROGRESS, -1, nullptr},
+  {"printing", "printing", 37, PRINT_MODE_PROGRESS, -1, nullptr},
+  {"printing_full", "printing", 100, PRINT_MODE_PROGRESS, -1, nullptr},
+  {"printing_layers", "printing", 37, PRINT_MODE_LAYERS, -1, nullptr, 37, 100},
+  {"downloading", "downloading", 62, PRINT_MODE_PROGRESS, -1, nullptr},
+  {"paused", "paused", 50, PRINT_MODE_PROGRESS, -1, nullptr},
+  {"error", "error", 0, PRINT_MODE_PROGRESS, -1, nullptr},
+  {"recoverable_error", "recoverable_error", 0, PRINT_MODE_PROGRESS, -1, nullptr},
+  {"heating", "heating", 0, PRINT_MODE_PROGRESS, -1, nullptr},
+  {"cooling", "cooling", 0, PRINT_MODE_PROGRESS, -1, nullptr},
+  {"finished", "finished", 100, PRINT_MODE_PROGRESS, -1, nullptr},
+  {"auto_off", "auto_off", 0, PRINT_MODE_PROGRESS, -1, nullptr},
+  {"user_effect", "idle", 0, PRINT_MODE_PROGRESS, 0, "wave(x * 3 - t * 0.5) * (0.3 + 0.7 * p)"},
+  {"layers_first", "printing", 0, PRINT_MODE_LAYERS, -1, nullptr, 1, 250},
+  {"layers_fine", "printing", 37, PRINT_MODE_LAYERS, -1, nullptr, 370, 1000},
+  {"layers_coarse", "printing", 40, PRINT_MODE_LAYERS, -1, nullptr, 4, 10},
+  {"layers_reversed", "printing", 37, PRINT_MODE_LAYERS, -1, nullptr, 37, 100, -1},
+  {"layers_last", "printing", 100, PRINT_MODE_LAYERS, -1, nullptr, 100, 100},
+  {"printing_reversed", "printing", 37, PRINT_MODE_PROGRESS, -1, nullptr, 0, 0, -1},
+};
+const int render_scenario_count = sizeof(render_scenarios) / sizeof(render_scenarios[0]);
+
+static unsigned long render_clock_ms = 0;
+static unsigned long renderClock() { return render_clock_ms; }
+
+static int scenarioIndex(const RenderScenario& scenario) {
+  return &scenario - render_scenarios;
+}
+
+static void prepareScenario(const RenderScenario& scenario, int ledCount) {
+  setAnimationClock(renderClock);  // Restarts every phase and progress glide
+  randomSeed(1);
+
+  // Start each scenario from the same settings, hours apart on the clock
+  settings = LEDSettings();
+  settings.led_count = ledCount;
+  settings.transition_mode = TRANSITION_CUT;
+  settings.print_mode = scenario.print_mode;
+  settings.rainbow_direction = scenario.direction;
+  settings.idle_direction = scenario.direction;
+  settings.printing_direction = scenario.direction;
+  settings.download_direction = scenario.direction;
+  syncLEDChannels();
+  strip.updateLength(ledCount);
+  transitionBegin(ledCount);
+  layoutBegin(ledCount);
+  render_clock_ms = (unsigned long)(scenarioIndex(scenario) + 1) * 10000000UL;
+  last_update = 0;
+  last_rainbow = 0;
+  rainbow_offset = 0;
+  download_head_cycle_start = 0;
+  printing_head_cycle_start = 0;
+  last_download_progress = 0;
+  last_print_progress = 0;
+
+  if (scenario.user_effect != nullptr) {
+    EffectError error;
+    installEffect(0, scenario.name, scenario.user_effect, error);
+    settings.effect_slots[scenario.user_effect_slot] = 0;
+  }
+
+  printer_state = PrinterState();
+  printer_state.is_connected = strcmp(scenario.status, "unknown") != 0;
+  printer_state.status = scenario.status;
+  printer_state.progress = scenario.progress;
+  printer_state.download_progress = scenario.progress;
+  printer_state.current_layer = scenario.current_layer;
+  printer_state.total_layers = scenario.total_layers;
+  printer_status_version++;
+}
+
+static void finishScenario(const RenderScenario& scenario) {
+  if (scenario.user_effect != nullptr) removeEffect(0);
+  setAnimationClock(nullptr);
+}
+
+void renderScenario(const RenderScenario& scenario, int ledCount, unsigned long durationMs,
+                    unsigned long stepMs, RenderedFrames& out) {
+  prepareScenario(scenario, ledCount);
+  unsigned long start = render_clock_ms;
+
+  out = RenderedFrames();
+  out.led_count = ledCount;
+  for (unsigned long elapsed = 0; elapsed < durationMs; elapsed += stepMs) {
+    render_clock_ms = start + elapsed;
+    updateLEDDisplay();
+    out.times_ms.push_back(elapsed);
+    out.frames.emplace_back(strip.getPixels(), strip.getPixels() + ledCount * 3);
+  }
+  finishScenario(scenario);
+}
+
+void renderScenarioAtRate(const RenderScenario& scenario, int ledCount, int fps,
+                          unsigned long durationMs, std::vector<uint8_t>& lastFrame) {
+  prepareScenario(scenario, ledCount);
+  unsigned long start = render_clock_ms;
+  lastFrame.assign(ledCount * 3, 0);
+
+  for (unsigned long frame = 0;; frame++) {
+    unsigned long elapsed = min(frame * 1000 / fps, durationMs);
+    render_clock_ms = start + elapsed;
+    renderStateFrame(lastFrame.data(), ledCount);
+    if (elapsed == durationMs) break;
+  }
+  finishScenario(scenario);
+}
+
+double benchmarkScenario(const RenderScenario& scenario, int ledCount, int frames) {
+  prepareScenario(scenario, ledCount);
+  std::vector<uint8_t> rgb(ledCount * 3);
+  renderStateFrame(rgb.data(), ledCount);  // Size buffers outside the timing
+
+  double start = benchNow();
+  for (int frame = 0; frame < frames; frame++) {
+    render_clock_ms += 20;
+    renderStateFrame(rgb.data(), ledCount);
+  }
+  double elapsed = benchNow() - start;
+  finishScenario(scenario);
+  return elapsed * 1e9 / ((double)frames * ledCount);
+}
+
+bool writeFramesImage(const char* path, const RenderedFrames& frames, int scale) {
+  FILE* file = fopen(path, "wb");
+  if (file == nullptr) return false;
+
+  int width = frames.led_count * scale;
+  int height = frames.frames.size() * scale;
+  fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+  std::vector<uint8_t> row(width * 3);
+  for (const std::vector<uint8_t>& frame : frames.frames) {
+    for (int x = 0; x < width; x++) memcpy(&row[x * 3], &frame[(x / scale) * 3], 3);
+    for (int y = 0; y < scale; y++) fwrite(row.data(), 1, row.size(), file);
+  }
+  return fclose(file) == 0;
+}
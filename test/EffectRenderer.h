@@ -0,0 +1,49 @@
+#ifndef EFFECT_RENDERER_H
+#define EFFECT_RENDERER_H
+
+// Renders the status effects on the host: LEDAnimations runs unchanged
+// against the stand-in strip with a virtual animation clock, so a given
+// scenario produces the same frames on every run.
+#include <stdint.h>
+#include <vector>
+
+struct RenderScenario {
+  const char* name;
+  const char* status;
+  int progress;           // Print or download progress in percent
+  int print_mode;
+  int user_effect_slot;   // State slot given a user effect, -1 = none
+  const char* user_effect;
+  int current_layer = 0;
+  int total_layers = 0;
+  int direction = 1;      // Every effect's direction setting
+};
+
+extern const RenderScenario render_scenarios[];
+extern const int render_scenario_count;
+
+struct RenderedFrames {
+  int led_count = 0;
+  std::vector<unsigned long> times_ms;      // Relative to the scenario start
+  std::vector<std::vector<uint8_t>> frames; // Packed RGB canvas after each step
+};
+
+// Render the scenario for durationMs, capturing the canvas every stepMs.
+// Each scenario starts at its own fixed point on the virtual clock so the
+// result does not depend on which scenarios ran before it.
+void renderScenario(const RenderScenario& scenario, int ledCount, unsigned long durationMs,
+                    unsigned long stepMs, RenderedFrames& out);
+
+// Render the scenario's effect directly (no 50 ms gate) at the given frame
+// rate for durationMs, ending with a frame at exactly durationMs
+void renderScenarioAtRate(const RenderScenario& scenario, int ledCount, int fps,
+                          unsigned long durationMs, std::vector<uint8_t>& lastFrame);
+
+// Time to render one frame of the scenario's effect, in ns per pixel
+double benchmarkScenario(const RenderScenario& scenario, int ledCount, int frames);
+
+// Write the frames as a binary PPM: one row per frame, one column per LED,
+// each enlarged to a scale x scale block
+bool writeFramesImage(const char* path, const RenderedFrames& frames, int scale);
+
+#endif
@@ -0,0 +1,307 @@
+#include "TestBroker.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <thread>
+
+// One client connection, plain or through TLS
+struct BrokerLink {
+  int fd;
+  SSL* ssl;
+};
+
+static bool readAll(BrokerLink& link, uint8_t* data, size_t length) {
+  while (length > 0) {
+    ssize_t received = link.ssl != nullptr ? SSL_read(link.ssl, data, length) : recv(link.fd, data, length, 0);
+    if (received <= 0) return false;
+    data += received;
+    length -= received;
+  }
+  return true;
+}
+
+static bool writeAll(BrokerLink& link, const std::vector<uint8_t>& packet) {
+  size_t sent = 0;
+  while (sent < packet.size()) {
+    const uint8_t* data = packet.data() + sent;
+    size_t length = packet.size() - sent;
+    ssize_t written = link.ssl != nullptr ? SSL_write(link.ssl, data, length) : send(link.fd, data, length, MSG_NOSIGNAL);
+    if (written <= 0) return false;
+    sent += written;
+  }
+  return true;
+}
+
+static bool readPacket(BrokerLink& link, uint8_t& header, std::vector<uint8_t>& body) {
+  if (!readAll(link, &header, 1)) return false;
+  size_t length = 0;
+  uint8_t digit;
+  int shift = 0;
+  do {
+    if (shift > 21 || !readAll(link, &digit, 1)) return false;
+    length |= (size_t)(digit & 0x7F) << shift;
+    shift += 7;
+  } while (digit & 0x80);
+  body.resize(length);
+  return length == 0 || readAll(link, body.data(), length);
+}
+
+static void putLength(std::vector<uint8_t>& packet, size_t length) {
+  do {
+    uint8_t digit = length % 128;
+    length /= 128;
+    packet.push_back(digit | (length > 0 ? 0x80 : 0));
+  } while (length > 0);
+}
+
+// Length-prefixed string at pos, advancing past it
+static std::string takeString(const std::vector<uint8_t>& body, size_t& pos) {
+  if (pos + 2 > body.size()) return "";
+  size_t length = (body[pos] << 8) | body[pos + 1];
+  pos += 2;
+  if (pos + length > body.size()) length = body.size() - pos;
+  std::string value(body.begin() + pos, body.begin() + pos + length);
+  pos += length;
+  return value;
+}
+
+std::vector<uint8_t> brokerPublishPacket(const std::string& topic, size_t payload) {
+  std::vector<uint8_t> packet = {0x30};
+  putLength(packet, 2 + topic.size() + payload);
+  packet.push_back(topic.size() >> 8);
+  packet.push_back(topic.size() & 0xFF);
+  packet.insert(packet.end(), topic.begin(), topic.end());
+  for (size_t i = 0; i < payload; i++) packet.push_back('a' + i % 26);
+  return packet;
+}
+
+// Listening socket on 127.0.0.1 and a free port
+static int listenLoopback(uint16_t& port) {
+  int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, (struct sockaddr*)&address, sizeof(address));
+  listen(fd, 16);
+  socklen_t length = sizeof(address);
+  getsockname(fd, (struct sockaddr*)&address, &length);
+  port = ntohs(address.sin_port);
+  return fd;
+}
+
+// Answer one client until it disconnects or the script ends the connection
+void serveBrokerClient(BrokerLink& link, const BrokerScript& script, TestBroker* broker) {
+  uint8_t header;
+  std::vector<uint8_t> body;
+  bool open = true;
+  while (open && readPacket(link, header, body)) {
+    switch (header & 0xF0) {
+      case 0x10: {
+        // Protocol name, level, flags, keepalive, then the payload strings
+        size_t pos = 0;
+        takeString(body, pos);
+        uint8_t flags = pos + 1 < body.size() ? body[pos + 1] : 0;
+        pos += 4;
+        std::string id = takeString(body, pos);
+        std::string user = (flags & 0x80) ? takeString(body, pos) : "";
+        if (broker != nullptr) {
+          std::lock_guard<std::mutex> guard(broker->lock);
+          broker->last_client_id = id;
+          broker->last_username = user;
+          broker->connects++;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(script.reply_delay_ms));
+        open = writeAll(link, {0x20, 0x02, 0x00, script.connack_code}) && script.connack_code == 0;
+        break;
+      }
+
+      case 0x80: {
+        size_t pos = 2;
+        uint16_t packetId = body.size() >= 2 ? (body[0] << 8) | body[1] : 0;
+        std::string topic = takeString(body, pos);
+        if (broker != nullptr) {
+          std::lock_guard<std::mutex> guard(broker->lock);
+          broker->last_topic = topic;
+          broker->subscribes++;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(script.reply_delay_ms));
+        for (size_t payload : script.publish_before_suback) open = open && writeAll(link, brokerPublishPacket(topic, payload));
+        if (script.suback_packet_id >= 0) packetId = script.suback_packet_id;
+        open = open && writeAll(link, {0x90, 0x03, (uint8_t)(packetId >> 8), (uint8_t)packetId, script.suback_code});
+        for (size_t payload : script.publish_after_suback) open = open && writeAll(link, brokerPublishPacket(topic, payload));
+        break;
+      }
+
+      case 0xC0:
+        open = writeAll(link, {0xD0, 0x00});
+        break;
+
+      case 0xE0:
+        open = false;
+        break;
+    }
+  }
+}
+
+TestBroker::TestBroker() {
+  listen_fd = listenLoopback(listen_port);
+  std::thread([this]() { acceptLoop(); }).detach();
+}
+
+TestBroker::~TestBroker() {
+  dropClients();
+  shutdown(listen_fd, SHUT_RDWR);
+  close(listen_fd);
+}
+
+void TestBroker::setScript(const BrokerScript& script) {
+  std::lock_guard<std::mutex> guard(lock);
+  current = script;
+}
+
+void TestBroker::dropClients() {
+  std::lock_guard<std::mutex> guard(lock);
+  for (int fd : clients) shutdown(fd, SHUT_RDWR);
+}
+
+std::string TestBroker::client_id() {
+  std::lock_guard<std::mutex> guard(lock);
+  return last_client_id;
+}
+
+std::string TestBroker::username() {
+  std::lock_guard<std::mutex> guard(lock);
+  return last_username;
+}
+
+std::string TestBroker::topic() {
+  std::lock_guard<std::mutex> guard(lock);
+  return last_topic;
+}
+
+void TestBroker::acceptLoop() {
+  for (;;) {
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) return;
+    accepted++;
+    BrokerScript script;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      script = current;
+      clients.push_back(fd);
+    }
+    std::thread([this, fd, script]() {
+      BrokerLink link = {fd, nullptr};
+      serveBrokerClient(link, script, this);
+
+      std::lock_guard<std::mutex> guard(lock);
+      clients.erase(std::remove(clients.begin(), clients.end(), fd), clients.end());
+      close(fd);
+    }).detach();
+  }
+}
+
+// Shared with the child process
+struct TLSTestBroker::Counters {
+  std::atomic<int> handshakes{0};
+  std::atomic<int> resumed{0};
+  std::atomic<bool> forget_sessions{false};
+};
+
+// RSA 2048, like the printers' certificates
+static X509* selfSignedCertificate(EVP_PKEY* key) {
+  X509* certificate = X509_new();
+  X509_set_version(certificate, 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+  X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+  X509_gmtime_adj(X509_getm_notAfter(certificate), 24 * 3600);
+  X509_set_pubkey(certificate, key);
+  X509_NAME* name = X509_get_subject_name(certificate);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"printer.test", -1, -1, 0);
+  X509_set_issuer_name(certificate, name);
+  X509_sign(certificate, key, EVP_sha256());
+  return certificate;
+}
+
+// A fresh context has its own ticket keys and an empty session cache
+static SSL_CTX* serverContext(X509* certificate, EVP_PKEY* key) {
+  SSL_CTX* context = SSL_CTX_new(TLS_server_method());
+  SSL_CTX_set_max_proto_version(context, TLS1_2_VERSION);
+  SSL_CTX_use_certificate(context, certificate);
+  SSL_CTX_use_PrivateKey(context, key);
+  return context;
+}
+
+static void serveTLS(int listenFd, TLSTestBroker::Counters* counters) {
+  EVP_PKEY* key = EVP_RSA_gen(2048);
+  X509* certificate = selfSignedCertificate(key);
+  SSL_CTX* context = serverContext(certificate, key);
+
+  for (;;) {
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) return;
+    if (counters->forget_sessions.exchange(false)) {
+      SSL_CTX_free(context);  // Connections still open hold their own reference
+      context = serverContext(certificate, key);
+    }
+    SSL* ssl = SSL_new(context);
+    SSL_set_fd(ssl, fd);
+    std::thread([fd, ssl, counters]() {
+      if (SSL_accept(ssl) == 1) {
+        counters->handshakes++;
+        if (SSL_session_reused(ssl)) counters->resumed++;
+        BrokerLink link = {fd, ssl};
+        serveBrokerClient(link, BrokerScript(), nullptr);
+        SSL_shutdown(ssl);
+      }
+      SSL_free(ssl);
+      close(fd);
+    }).detach();
+  }
+}
+
+TLSTestBroker::TLSTestBroker() {
+  void* shared = mmap(nullptr, sizeof(Counters), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  counters = new (shared) Counters();
+  int listenFd = listenLoopback(listen_port);
+
+  child = fork();
+  if (child == 0) {
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    serveTLS(listenFd, counters);
+    _exit(0);
+  }
+  close(listenFd);
+}
+
+TLSTestBroker::~TLSTestBroker() {
+  if (child > 0) {
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+  }
+  munmap(counters, sizeof(Counters));
+}
+
+void TLSTestBroker::forgetSessions() {
+  counters->forget_sessions = true;
+}
+
+int TLSTestBroker::handshakes() const {
+  return counters->handshakes;
+}
+
+int TLSTestBroker::resumed() const {
+  return counters->resumed;
+}
@@ -0,0 +1,92 @@
+#ifndef TEST_BROKER_H
+#define TEST_BROKER_H
+
+// Stand-in MQTT broker on 127.0.0.1 for the connection pipeline tests. It
+// answers CONNECT and SUBSCRIBE the way the printer does, after a chosen
+// delay, and can be told to refuse, to send PUBLISH packets ahead of the
+// SUBACK, or to drop its clients. Each client is served on its own thread.
+//
+// TLSTestBroker is the same broker behind TLS 1.2 with a self-signed
+// certificate. It runs in a child process so its OpenSSL allocations stay
+// out of the heap figures the transport takes during a handshake.
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct BrokerLink;
+
+struct BrokerScript {
+  unsigned long reply_delay_ms = 0;        // Before the CONNACK and the SUBACK
+  uint8_t connack_code = 0;                // Non-zero refuses the CONNECT
+  uint8_t suback_code = 0;                 // 0x80 refuses the SUBSCRIBE
+  int suback_packet_id = -1;               // -1 = echo the SUBSCRIBE's
+  std::vector<size_t> publish_before_suback;  // Payload sizes
+  std::vector<size_t> publish_after_suback;
+};
+
+class TestBroker {
+public:
+  TestBroker();
+  ~TestBroker();
+
+  uint16_t port() const { return listen_port; }
+
+  // Used for clients that connect from now on
+  void setScript(const BrokerScript& script);
+
+  // Close every client connection, as a broker restart would
+  void dropClients();
+
+  std::atomic<int> accepted{0};
+  std::atomic<int> connects{0};
+  std::atomic<int> subscribes{0};
+
+  // From the last CONNECT and SUBSCRIBE
+  std::string client_id();
+  std::string username();
+  std::string topic();
+
+private:
+  friend void serveBrokerClient(BrokerLink& link, const BrokerScript& script, TestBroker* broker);
+  void acceptLoop();
+
+  int listen_fd = -1;
+  uint16_t listen_port = 0;
+  std::mutex lock;
+  BrokerScript current;
+  std::vector<int> clients;
+  std::string last_client_id;
+  std::string last_username;
+  std::string last_topic;
+};
+
+class TLSTestBroker {
+public:
+  TLSTestBroker();
+  ~TLSTestBroker();
+
+  uint16_t port() const { return listen_port; }
+
+  // Drop the ticket keys and session cache, as a broker restart would; the
+  // next client has to do a full handshake
+  void forgetSessions();
+
+  // Handshakes completed, and how many of them resumed a session
+  int handshakes() const;
+  int resumed() const;
+
+  struct Counters;
+
+private:
+  uint16_t listen_port = 0;
+  pid_t child = -1;
+  Counters* counters = nullptr;
+};
+
+// MQTT PUBLISH packet with a payload of the given size
+std::vector<uint8_t> brokerPublishPacket(const std::string& topic, size_t payload);
+
+#endif
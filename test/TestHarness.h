@@ -0,0 +1,94 @@
+#ifndef TEST_HARNESS_H
+#define TEST_HARNESS_H
+
+// Minimal test runner for the host tests. TEST() registers a case, the
+// EXPECT_* macros record failures without stopping the case, and BENCH()
+// prints a measurement so ctest logs carry the numbers.
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+
+struct TestCase {
+  const char* name;
+  void (*run)();
+};
+
+inline std::vector<TestCase>& testRegistry() {
+  static std::vector<TestCase> cases;
+  return cases;
+}
+
+inline int& testFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+struct TestRegistrar {
+  TestRegistrar(const char* name, void (*run)()) { testRegistry().push_back({name, run}); }
+};
+
+#define TEST(name) \
+  static void test_##name(); \
+  static TestRegistrar registrar_##name(#name, test_##name); \
+  static void test_##name()
+
+#define EXPECT_TRUE(cond) \
+  do { \
+    if (!(cond)) { \
+      printf("  %s:%d: expected %s\n", __FILE__, __LINE__, #cond); \
+      testFailures()++; \
+    } \
+  } while (0)
+
+#define EXPECT_EQ(a, b) \
+  do { \
+    long long expect_a = (long long)(a); \
+    long long expect_b = (long long)(b); \
+    if (expect_a != expect_b) { \
+      printf("  %s:%d: %s == %s (%lld vs %lld)\n", __FILE__, __LINE__, #a, #b, expect_a, expect_b); \
+      testFailures()++; \
+    } \
+  } while (0)
+
+#define EXPECT_NEAR(a, b, tolerance) \
+  do { \
+    double expect_a = (double)(a); \
+    double expect_b = (double)(b); \
+    if (expect_a - expect_b > (tolerance) || expect_b - expect_a > (tolerance)) { \
+      printf("  %s:%d: %s ~ %s (%g vs %g)\n", __FILE__, __LINE__, #a, #b, expect_a, expect_b); \
+      testFailures()++; \
+    } \
+  } while (0)
+
+#define BENCH(format, ...) printf("  bench: " format "\n", __VA_ARGS__)
+
+inline double benchNow() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs every case, or those named on the command line. Leaves through
+// _exit() because firmware tasks keep running on detached threads.
+inline int runTests(int argc, char** argv) {
+  int ran = 0;
+  for (const TestCase& test : testRegistry()) {
+    bool selected = (argc < 2);
+    for (int i = 1; i < argc; i++) selected |= (strcmp(argv[i], test.name) == 0);
+    if (!selected) continue;
+
+    int before = testFailures();
+    printf("[ RUN  ] %s\n", test.name);
+    test.run();
+    printf("[ %s ] %s\n", testFailures() == before ? " OK " : "FAIL", test.name);
+    ran++;
+  }
+  printf("%d case(s), %d failure(s)\n", ran, testFailures());
+  fflush(stdout);
+  _exit(testFailures() == 0 && ran > 0 ? 0 : 1);
+}
+
+#define TEST_MAIN() \
+  int main(int argc, char** argv) { return runTests(argc, argv); }
+
+#endif
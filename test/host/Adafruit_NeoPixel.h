@@ -0,0 +1,74 @@
+#ifndef HOST_ADAFRUIT_NEOPIXEL_H
+#define HOST_ADAFRUIT_NEOPIXEL_H
+
+// Host stand-in for Adafruit_NeoPixel. Pixels live in a byte buffer in the
+// strip's color order exactly like the library; show() only counts frames
+// and keeps a copy of the buffer as it would have gone on the wire.
+#include <Arduino.h>
+#include <vector>
+
+typedef uint16_t neoPixelType;
+
+#define NEO_RGB ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+
+class Adafruit_NeoPixel {
+public:
+  Adafruit_NeoPixel(uint16_t n, int16_t p = 6, neoPixelType t = NEO_GRB + NEO_KHZ800) : pin(p) {
+    updateType(t);
+    updateLength(n);
+  }
+  Adafruit_NeoPixel() {}
+
+  void begin() { begun = true; }
+  void show() {
+    wire = pixels;
+    shows++;
+  }
+  void setPin(int16_t p) { pin = p; }
+  void updateLength(uint16_t n) { pixels.assign((size_t)n * 3, 0); }
+  void updateType(neoPixelType t) {
+    r_offset = (t >> 4) & 3;
+    g_offset = (t >> 2) & 3;
+    b_offset = t & 3;
+  }
+  void clear() { std::fill(pixels.begin(), pixels.end(), 0); }
+
+  void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+    if (n >= numPixels()) return;
+    uint8_t* p = &pixels[(size_t)n * 3];
+    p[r_offset] = r;
+    p[g_offset] = g;
+    p[b_offset] = b;
+  }
+  void setPixelColor(uint16_t n, uint32_t c) { setPixelColor(n, c >> 16, c >> 8, c); }
+  uint32_t getPixelColor(uint16_t n) const {
+    if (n >= numPixels()) return 0;
+    const uint8_t* p = &pixels[(size_t)n * 3];
+    return Color(p[r_offset], p[g_offset], p[b_offset]);
+  }
+
+  uint8_t* getPixels() { return pixels.empty() ? nullptr : pixels.data(); }
+  uint16_t numPixels() const { return pixels.size() / 3; }
+  int16_t getPin() const { return pin; }
+  bool canShow() const { return true; }
+
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+    return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+  }
+
+  // Host only: what the last show() sent, and how many times it ran
+  const std::vector<uint8_t>& wireBytes() const { return wire; }
+  uint32_t showCount() const { return shows; }
+  bool begun = false;
+
+private:
+  std::vector<uint8_t> pixels;
+  std::vector<uint8_t> wire;
+  uint32_t shows = 0;
+  int16_t pin = -1;
+  uint8_t r_offset = 1, g_offset = 0, b_offset = 2;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#include "AllocationCounter.h"
+
+// glibc's own entry points, so the wrappers below can forward to them
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+extern "C" void __libc_free(void* pointer);
+
+static thread_local bool counting = false;
+static thread_local size_t allocations = 0;
+
+void allocationCountStart() {
+	allocations = 0;
+	counting = true;
+}
+
+size_t allocationCountStop() {
+	counting = false;
+	return allocations;
+}
+
+extern "C" void* malloc(size_t size) {
+	if (counting) allocations++;
+	return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+	if (counting) allocations++;
+	return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+	if (counting) allocations++;
+	return __libc_realloc(pointer, size);
+}
+
+extern "C" void free(void* pointer) {
+	__libc_free(pointer);
+}
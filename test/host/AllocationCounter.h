@@ -0,0 +1,12 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+// Counts heap allocations (malloc, calloc, realloc, new) made by the calling
+// thread between allocationCountStart() and allocationCountStop(). Linked
+// into a test binary it interposes the C allocator for the whole process.
+#include <stddef.h>
+
+void allocationCountStart();
+size_t allocationCountStop();
+
+#endif
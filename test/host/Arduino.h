@@ -0,0 +1,168 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host stand-in for the ESP32 Arduino core: just enough of the API for the
+// firmware modules under test to compile and run on a PC. Time comes from
+// a steady clock, or from hostSetMillis() when a test drives the clock.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HEX 16
+#define DEC 10
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define LOW 0
+#define HIGH 1
+
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+using std::min;
+using std::max;
+
+template <class T, class L, class H>
+inline T constrain(T x, L low, H high) {
+  return x < low ? low : (x > high ? high : x);
+}
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+void pinMode(uint8_t pin, uint8_t mode);
+
+// Pin the clock to a fixed value (virtual time); hostReleaseClock() returns
+// to real time
+void hostSetMillis(unsigned long ms);
+void hostAdvanceMillis(unsigned long ms);
+void hostReleaseClock();
+
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+  size_t length = strlen(src);
+  if (size > 0) {
+    size_t copy = (length < size - 1) ? length : size - 1;
+    memcpy(dst, src, copy);
+    dst[copy] = '\0';
+  }
+  return length;
+}
+
+class String {
+public:
+  String() {}
+  String(const char* c) : s(c ? c : "") {}
+  String(const std::string& value) : s(value) {}
+  String(char c) : s(1, c) {}
+  String(int value) : s(std::to_string(value)) {}
+  String(unsigned int value) : s(std::to_string(value)) {}
+  String(long value) : s(std::to_string(value)) {}
+  String(unsigned long value) : s(std::to_string(value)) {}
+  String(double value, int decimals = 2) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+    s = buffer;
+  }
+
+  const char* c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.size(); }
+  bool isEmpty() const { return s.empty(); }
+  int toInt() const { return atoi(s.c_str()); }
+  float toFloat() const { return atof(s.c_str()); }
+  void reserve(size_t n) { s.reserve(n); }
+  bool startsWith(const String& other) const { return s.rfind(other.s, 0) == 0; }
+  bool endsWith(const String& other) const {
+    return s.size() >= other.s.size() && s.compare(s.size() - other.s.size(), other.s.size(), other.s) == 0;
+  }
+  int indexOf(const String& other) const {
+    size_t p = s.find(other.s);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  String substring(int from, int to = -1) const {
+    return String(s.substr(from, to < 0 ? std::string::npos : to - from));
+  }
+  bool equals(const String& other) const { return s == other.s; }
+  char operator[](int i) const { return s[i]; }
+
+  String& operator+=(const String& other) { s += other.s; return *this; }
+  String& operator+=(const char* other) { s += other; return *this; }
+  String& operator+=(char c) { s += c; return *this; }
+  bool operator==(const String& other) const { return s == other.s; }
+  bool operator!=(const String& other) const { return s != other.s; }
+  bool operator==(const char* other) const { return s == other; }
+  bool operator!=(const char* other) const { return s != other; }
+
+  friend String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+  friend String operator+(const char* a, const String& b) { return String(std::string(a) + b.s); }
+  friend String operator+(const String& a, const char* b) { return String(a.s + b); }
+
+private:
+  std::string s;
+};
+
+// Serial output is dropped unless MAVENLED_HOST_LOG is set in the environment
+class Print {
+public:
+  virtual ~Print() {}
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const char* text);
+  size_t print(const String& text) { return print(text.c_str()); }
+  size_t println(const char* text = "");
+  size_t println(const String& text) { return println(text.c_str()); }
+  virtual size_t write(uint8_t c) { return write(&c, 1); }
+  virtual size_t write(const uint8_t* data, size_t size);
+};
+
+class Stream : public Print {
+public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+  virtual void flush() {}
+};
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+  void restart() { abort(); }
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HOST_ARDUINO_JSON_H
+#define HOST_ARDUINO_JSON_H
+
+// ArduinoJson is not available on the host. Headers that only mention
+// JsonDocument in declarations compile against this forward declaration;
+// sources that use the library stay out of the host build.
+class JsonDocument;
+
+#endif
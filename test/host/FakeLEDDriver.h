@@ -0,0 +1,73 @@
+#ifndef FAKE_LED_DRIVER_H
+#define FAKE_LED_DRIVER_H
+
+// Output driver that stands in for a strip. transmit() keeps a pointer to
+// the frame like the RMT driver does, and waitDone() takes the time the
+// frame would need on the wire (30 us per LED at 800 kHz). If the frame
+// changes while it is "on the wire", the tear is counted.
+#include "../../src/led/LEDOutput.h"
+#include <mutex>
+#include <vector>
+
+class FakeLEDDriver : public LEDOutputDriver {
+public:
+  explicit FakeLEDDriver(unsigned int usPerLED = 30) : us_per_led(usPerLED) {}
+
+  bool begin(int pin, int count) override {
+    std::lock_guard<std::mutex> lock(state);
+    begun_pin = pin;
+    begun_count = count;
+    begins++;
+    active = true;
+    return true;
+  }
+
+  void end() override {
+    std::lock_guard<std::mutex> lock(state);
+    ends++;
+    active = false;
+  }
+
+  void transmit(const uint8_t* rgb, int count) override {
+    std::lock_guard<std::mutex> lock(state);
+    in_flight = rgb;
+    in_flight_count = count;
+    sent.assign(rgb, rgb + count * 3);
+    transmits++;
+  }
+
+  void waitDone() override {
+    if (in_flight == nullptr) return;
+    delayMicroseconds(us_per_led * in_flight_count);
+
+    std::lock_guard<std::mutex> lock(state);
+    if (memcmp(in_flight, sent.data(), sent.size()) != 0) tears++;
+    frames.push_back(sent);
+    in_flight = nullptr;
+  }
+
+  const char* name() const override { return "fake"; }
+
+  std::vector<std::vector<uint8_t>> transmittedFrames() {
+    std::lock_guard<std::mutex> lock(state);
+    return frames;
+  }
+
+  unsigned int us_per_led;
+  int begun_pin = -1;
+  int begun_count = 0;
+  int begins = 0;
+  int ends = 0;
+  int transmits = 0;
+  int tears = 0;
+  bool active = false;
+
+private:
+  std::mutex state;
+  const uint8_t* in_flight = nullptr;
+  int in_flight_count = 0;
+  std::vector<uint8_t> sent;
+  std::vector<std::vector<uint8_t>> frames;
+};
+
+#endif
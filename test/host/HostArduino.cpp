@@ -0,0 +1,119 @@
+#include <Arduino.h>
+#include <stdarg.h>
+#include <malloc.h>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static const auto clock_start = std::chrono::steady_clock::now();
+static std::atomic<bool> clock_pinned(false);
+static std::atomic<unsigned long> pinned_ms(0);
+static std::mt19937 random_engine(1);
+
+static uint64_t realMicros() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - clock_start).count();
+}
+
+unsigned long millis() {
+	return clock_pinned ? pinned_ms.load() : (unsigned long)(realMicros() / 1000);
+}
+
+unsigned long micros() {
+	return clock_pinned ? pinned_ms.load() * 1000 : (unsigned long)realMicros();
+}
+
+void hostSetMillis(unsigned long ms) {
+	pinned_ms = ms;
+	clock_pinned = true;
+}
+
+void hostAdvanceMillis(unsigned long ms) {
+	pinned_ms += ms;
+	clock_pinned = true;
+}
+
+void hostReleaseClock() {
+	clock_pinned = false;
+}
+
+void delay(unsigned long ms) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+	std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+	std::this_thread::yield();
+}
+
+long random(long howbig) {
+	if (howbig <= 0) return 0;
+	return random_engine() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+	if (howsmall >= howbig) return howsmall;
+	return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+	random_engine.seed(seed);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	(void)pin;
+	(void)mode;
+}
+
+static bool logEnabled() {
+	static const bool enabled = getenv("MAVENLED_HOST_LOG") != nullptr;
+	return enabled;
+}
+
+size_t Print::printf(const char* format, ...) {
+	char buffer[512];
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	if (length < 0) return 0;
+	return write((const uint8_t*)buffer, min((size_t)length, sizeof(buffer) - 1));
+}
+
+size_t Print::print(const char* text) {
+	return write((const uint8_t*)text, strlen(text));
+}
+
+size_t Print::println(const char* text) {
+	return print(text) + print("\n");
+}
+
+size_t Print::write(const uint8_t* data, size_t size) {
+	if (logEnabled()) fwrite(data, 1, size, stderr);
+	return size;
+}
+
+// The heap figures follow the process heap, measured from a nominal 16 MB:
+// OpenSSL alone holds more than an ESP32's 320 KB once loaded, and a free
+// figure stuck at zero would hide every peak
+static const uint32_t HOST_HEAP_BYTES = 16 * 1024 * 1024;
+
+uint32_t EspClass::getFreeHeap() {
+	struct mallinfo2 info = mallinfo2();
+	return (info.uordblks < HOST_HEAP_BYTES) ? HOST_HEAP_BYTES - info.uordblks : 0;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+	return getFreeHeap();
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+	return getFreeHeap();
+}
@@ -0,0 +1,60 @@
+#include <driver/gpio.h>
+#include <driver/rmt.h>
+#include <string.h>
+
+static HostRMTChannel rmt_channels[RMT_CHANNEL_MAX];
+static int configured_gpio[RMT_CHANNEL_MAX];
+static int reset_pins[64];
+
+esp_err_t rmt_config(const rmt_config_t* config) {
+	if (config->channel < 0 || config->channel >= RMT_CHANNEL_MAX) return ESP_FAIL;
+	configured_gpio[config->channel] = config->gpio_num;
+	return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags) {
+	(void)rx_buf_size;
+	(void)intr_alloc_flags;
+	if (rmt_channels[channel].installed) return ESP_ERR_INVALID_STATE;
+	rmt_channels[channel].installed = true;
+	rmt_channels[channel].gpio = configured_gpio[channel];
+	return ESP_OK;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel) {
+	if (!rmt_channels[channel].installed) return ESP_ERR_INVALID_STATE;
+	rmt_channels[channel].installed = false;
+	return ESP_OK;
+}
+
+esp_err_t rmt_translator_init(rmt_channel_t channel, sample_to_rmt_t fn) {
+	(void)fn;
+	return rmt_channels[channel].installed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t rmt_write_sample(rmt_channel_t channel, const uint8_t* src, size_t src_size, bool wait_tx_done) {
+	(void)src;
+	(void)wait_tx_done;
+	if (!rmt_channels[channel].installed) return ESP_ERR_INVALID_STATE;
+	rmt_channels[channel].writes++;
+	rmt_channels[channel].last_bytes = src_size;
+	return ESP_OK;
+}
+
+esp_err_t rmt_wait_tx_done(rmt_channel_t channel, uint32_t wait_time) {
+	(void)wait_time;
+	return rmt_channels[channel].installed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num) {
+	if (gpio_num >= 0 && gpio_num < 64) reset_pins[gpio_num]++;
+	return ESP_OK;
+}
+
+const HostRMTChannel& hostRMTChannel(int channel) {
+	return rmt_channels[channel];
+}
+
+int hostResetPinCount(int gpio) {
+	return (gpio >= 0 && gpio < 64) ? reset_pins[gpio] : 0;
+}
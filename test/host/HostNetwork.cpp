@@ -0,0 +1,64 @@
+#include <WiFi.h>
+#include <lwip/dns.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+WiFiClass WiFi;
+
+static std::atomic<unsigned long> dns_delay_ms(0);
+static std::mutex dns_lock;
+static std::map<std::string, uint32_t> dns_answers;
+
+void hostDNSDelay(unsigned long ms) {
+	dns_delay_ms = ms;
+}
+
+void hostDNSAnswer(const char* name, uint32_t addr) {
+	std::lock_guard<std::mutex> lock(dns_lock);
+	dns_answers[name] = addr;
+}
+
+static bool lookup(const std::string& name, uint32_t* addr) {
+	{
+		std::lock_guard<std::mutex> lock(dns_lock);
+		auto found = dns_answers.find(name);
+		if (found != dns_answers.end()) {
+			*addr = found->second;
+			return true;
+		}
+	}
+
+	struct addrinfo hints = {};
+	hints.ai_family = AF_INET;
+	struct addrinfo* result = nullptr;
+	if (getaddrinfo(name.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) return false;
+	*addr = ((struct sockaddr_in*)result->ai_addr)->sin_addr.s_addr;
+	freeaddrinfo(result);
+	return true;
+}
+
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callback_arg) {
+	if (hostname == nullptr || addr == nullptr) return ERR_ARG;
+
+	struct in_addr literal;
+	if (inet_aton(hostname, &literal)) {
+		addr->addr = literal.s_addr;
+		return ERR_OK;
+	}
+
+	std::string name(hostname);
+	unsigned long delayMs = dns_delay_ms;
+	std::thread([name, found, callback_arg, delayMs]() {
+		if (delayMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+		ip_addr_t result;
+		bool ok = lookup(name, &result.addr);
+		found(name.c_str(), ok ? &result : nullptr, callback_arg);
+	}).detach();
+	return ERR_INPROGRESS;
+}
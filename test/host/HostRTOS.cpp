@@ -0,0 +1,181 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <freertos/queue.h>
+#include <Arduino.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tasks run on detached threads and are never destroyed; test binaries
+// leave through _exit() so no thread outlives the statics it uses.
+struct HostTask {
+	std::mutex lock;
+	std::condition_variable wake;
+	uint32_t notifications = 0;
+};
+
+struct HostSemaphore {
+	std::mutex lock;
+	std::condition_variable wake;
+	int count = 0;
+};
+
+struct HostQueue {
+	std::mutex lock;
+	std::condition_variable wake;
+	std::deque<std::vector<uint8_t>> items;
+	UBaseType_t length = 0;
+	UBaseType_t item_size = 0;
+};
+
+static thread_local HostTask* current_task = nullptr;
+static std::recursive_mutex critical_lock;
+
+// Wait on cv until ready() or the tick timeout; portMAX_DELAY waits forever
+template <class Ready>
+static bool waitTicks(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, TickType_t ticks, Ready ready) {
+	if (ticks == portMAX_DELAY) {
+		cv.wait(lock, ready);
+		return true;
+	}
+	return cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+}
+
+void hostEnterCritical(portMUX_TYPE* mux) {
+	(void)mux;
+	critical_lock.lock();
+}
+
+void hostExitCritical(portMUX_TYPE* mux) {
+	(void)mux;
+	critical_lock.unlock();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stackDepth,
+								   void* parameters, UBaseType_t priority, TaskHandle_t* handle,
+								   BaseType_t core) {
+	(void)name;
+	(void)stackDepth;
+	(void)priority;
+	(void)core;
+
+	HostTask* task = new HostTask();
+	if (handle != nullptr) *handle = task;
+	std::thread([code, parameters, task]() {
+		current_task = task;
+		code(parameters);
+	}).detach();
+	return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t period) {
+	*previousWake += period;
+	TickType_t now = xTaskGetTickCount();
+	if ((int32_t)(*previousWake - now) > 0) vTaskDelay(*previousWake - now);
+}
+
+TickType_t xTaskGetTickCount() {
+	return millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+	return current_task;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+	(void)task;
+	return 0;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+	HostTask* task = current_task;
+	if (task == nullptr) return 0;
+
+	std::unique_lock<std::mutex> lock(task->lock);
+	if (!waitTicks(task->wake, lock, ticks, [task] { return task->notifications > 0; })) return 0;
+	uint32_t value = task->notifications;
+	task->notifications = clearOnExit ? 0 : value - 1;
+	return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+	if (task == nullptr) return pdFAIL;
+	{
+		std::lock_guard<std::mutex> lock(task->lock);
+		task->notifications++;
+	}
+	task->wake.notify_all();
+	return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+	HostSemaphore* semaphore = new HostSemaphore();
+	semaphore->count = 1;
+	return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+	return new HostSemaphore();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+	std::unique_lock<std::mutex> lock(semaphore->lock);
+	if (!waitTicks(semaphore->wake, lock, ticks, [semaphore] { return semaphore->count > 0; })) return pdFALSE;
+	semaphore->count--;
+	return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+	{
+		std::lock_guard<std::mutex> lock(semaphore->lock);
+		if (semaphore->count > 0) return pdFALSE;
+		semaphore->count++;
+	}
+	semaphore->wake.notify_one();
+	return pdTRUE;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+	HostQueue* queue = new HostQueue();
+	queue->length = length;
+	queue->item_size = itemSize;
+	return queue;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks) {
+	std::unique_lock<std::mutex> lock(queue->lock);
+	if (!waitTicks(queue->wake, lock, ticks, [queue] { return queue->items.size() < queue->length; })) return pdFALSE;
+	const uint8_t* bytes = (const uint8_t*)item;
+	queue->items.emplace_back(bytes, bytes + queue->item_size);
+	lock.unlock();
+	queue->wake.notify_all();
+	return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+	std::unique_lock<std::mutex> lock(queue->lock);
+	if (!waitTicks(queue->wake, lock, ticks, [queue] { return !queue->items.empty(); })) return pdFALSE;
+	memcpy(item, queue->items.front().data(), queue->item_size);
+	queue->items.pop_front();
+	lock.unlock();
+	queue->wake.notify_all();
+	return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+	std::lock_guard<std::mutex> lock(queue->lock);
+	return queue->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+	std::lock_guard<std::mutex> lock(queue->lock);
+	return queue->length - queue->items.size();
+}
@@ -0,0 +1,36 @@
+#include <SPIFFS.h>
+
+SPIFFSFS SPIFFS;
+
+File SPIFFSFS::open(const char* path, const char* mode) {
+	bool writing = mode[0] == 'w';
+	if (writing) return File(path, true, std::vector<uint8_t>());
+
+	auto found = files.find(path);
+	if (found == files.end()) return File();
+	return File(path, false, found->second);
+}
+
+size_t File::read(uint8_t* buffer, size_t length) {
+	if (!data || writing) return 0;
+	size_t count = min(length, data->size() - position);
+	memcpy(buffer, data->data() + position, count);
+	position += count;
+	return count;
+}
+
+int File::read() {
+	uint8_t c;
+	return read(&c, 1) == 1 ? c : -1;
+}
+
+size_t File::write(const uint8_t* buffer, size_t length) {
+	if (!data || !writing) return 0;
+	data->insert(data->end(), buffer, buffer + length);
+	return length;
+}
+
+void File::close() {
+	if (data && writing) SPIFFS.files[path] = *data;
+	data.reset();
+}
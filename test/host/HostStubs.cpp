@@ -0,0 +1,43 @@
+// Device-side globals whose owning sources need ArduinoJson or the web
+// stack, so they are not part of the host build
+#include "HostStubs.h"
+#include "../../src/config/Settings.h"
+#include "../../src/printer/PrinterState.h"
+
+LEDSettings settings;
+int host_settings_saves = 0;
+
+PrinterState printer_state;
+SemaphoreHandle_t printerStateMutex = xSemaphoreCreateMutex();
+volatile bool printer_state_updated = false;
+volatile uint32_t printer_status_version = 0;
+RTC_DATA_ATTR RTCState rtc_state = {false, 0, 0xDEADBEEF};
+
+void saveSettings() {
+	host_settings_saves++;
+}
+
+void loadSettings() {
+}
+
+// Same normalization as Settings.cpp
+void syncLEDChannels() {
+	if (settings.led_channel_count <= 1) {
+		settings.led_channel_count = 1;
+		settings.led_count = constrain(settings.led_count, 1, MAX_LED_COUNT);
+		settings.led_channels[0].pin = settings.led_pin;
+		settings.led_channels[0].count = settings.led_count;
+		settings.led_channels[0].offset = 0;
+		return;
+	}
+
+	int extent = 1;
+	for (int i = 0; i < settings.led_channel_count; i++) {
+		LEDChannelSettings& channel = settings.led_channels[i];
+		channel.offset = constrain(channel.offset, 0, MAX_LED_COUNT - 1);
+		channel.count = constrain(channel.count, 1, MAX_LED_COUNT - channel.offset);
+		extent = max(extent, channel.offset + channel.count);
+	}
+	settings.led_count = extent;
+	settings.led_pin = settings.led_channels[0].pin;
+}
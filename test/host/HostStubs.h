@@ -0,0 +1,7 @@
+#ifndef HOST_STUBS_H
+#define HOST_STUBS_H
+
+// Number of saveSettings() calls since start
+extern int host_settings_saves;
+
+#endif
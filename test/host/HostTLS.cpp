@@ -0,0 +1,235 @@
+#include <mbedtls/ssl.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <openssl/ssl.h>
+#include <openssl/rand.h>
+#include <string.h>
+
+// The transport's send and receive callbacks, wrapped as an OpenSSL BIO
+static int bioWrite(BIO* bio, const char* data, int length) {
+	mbedtls_ssl_context* ssl = (mbedtls_ssl_context*)BIO_get_data(bio);
+	BIO_clear_retry_flags(bio);
+	int ret = ssl->f_send(ssl->p_bio, (const unsigned char*)data, length);
+	if (ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+		BIO_set_retry_write(bio);
+		return -1;
+	}
+	if (ret < 0) ssl->bio_error = ret;
+	return ret;
+}
+
+static int bioRead(BIO* bio, char* data, int length) {
+	mbedtls_ssl_context* ssl = (mbedtls_ssl_context*)BIO_get_data(bio);
+	BIO_clear_retry_flags(bio);
+	int ret = ssl->f_recv(ssl->p_bio, (unsigned char*)data, length);
+	if (ret == MBEDTLS_ERR_SSL_WANT_READ) {
+		BIO_set_retry_read(bio);
+		return -1;
+	}
+	if (ret < 0) ssl->bio_error = ret;
+	return ret;
+}
+
+static long bioCtrl(BIO* bio, int command, long number, void* pointer) {
+	return command == BIO_CTRL_FLUSH ? 1 : 0;
+}
+
+static int bioCreate(BIO* bio) {
+	BIO_set_init(bio, 1);
+	return 1;
+}
+
+static BIO_METHOD* bioMethod() {
+	static BIO_METHOD* method = nullptr;
+	if (method == nullptr) {
+		method = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK, "mbedtls callbacks");
+		BIO_meth_set_write(method, bioWrite);
+		BIO_meth_set_read(method, bioRead);
+		BIO_meth_set_ctrl(method, bioCtrl);
+		BIO_meth_set_create(method, bioCreate);
+	}
+	return method;
+}
+
+// OpenSSL's outcome as the mbedTLS error the transport expects
+static int translate(mbedtls_ssl_context* ssl, int ret) {
+	switch (SSL_get_error(ssl->ssl, ret)) {
+		case SSL_ERROR_WANT_READ: return MBEDTLS_ERR_SSL_WANT_READ;
+		case SSL_ERROR_WANT_WRITE: return MBEDTLS_ERR_SSL_WANT_WRITE;
+		case SSL_ERROR_ZERO_RETURN: return MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY;
+		default: break;
+	}
+	if (ssl->bio_error != 0) return ssl->bio_error;
+	return ret == 0 ? MBEDTLS_ERR_SSL_CONN_EOF : MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+}
+
+void mbedtls_ssl_init(mbedtls_ssl_context* ssl) {
+	memset(ssl, 0, sizeof(*ssl));
+}
+
+void mbedtls_ssl_free(mbedtls_ssl_context* ssl) {
+	if (ssl->ssl != nullptr) SSL_free(ssl->ssl);
+	memset(ssl, 0, sizeof(*ssl));
+}
+
+void mbedtls_ssl_config_init(mbedtls_ssl_config* conf) {
+	memset(conf, 0, sizeof(*conf));
+}
+
+void mbedtls_ssl_config_free(mbedtls_ssl_config* conf) {
+	if (conf->ctx != nullptr) SSL_CTX_free(conf->ctx);
+	memset(conf, 0, sizeof(*conf));
+}
+
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config* conf, int endpoint, int transport, int preset) {
+	if (endpoint != MBEDTLS_SSL_IS_CLIENT) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+	conf->ctx = SSL_CTX_new(TLS_client_method());
+	if (conf->ctx == nullptr) return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+	SSL_CTX_set_min_proto_version(conf->ctx, TLS1_2_VERSION);
+	SSL_CTX_set_max_proto_version(conf->ctx, TLS1_2_VERSION);
+	SSL_CTX_set_session_cache_mode(conf->ctx, SSL_SESS_CACHE_OFF);
+	conf->authmode = MBEDTLS_SSL_VERIFY_REQUIRED;
+	conf->session_tickets = MBEDTLS_SSL_SESSION_TICKETS_ENABLED;
+	return 0;
+}
+
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config* conf, int authmode) {
+	conf->authmode = authmode;
+}
+
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config* conf, int (*f_rng)(void*, unsigned char*, size_t), void* p_rng) {
+}
+
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config* conf, int use_tickets) {
+	conf->session_tickets = use_tickets;
+}
+
+int mbedtls_ssl_setup(mbedtls_ssl_context* ssl, const mbedtls_ssl_config* conf) {
+	if (conf->ctx == nullptr) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+	ssl->ssl = SSL_new(conf->ctx);
+	if (ssl->ssl == nullptr) return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+	SSL_set_verify(ssl->ssl, conf->authmode == MBEDTLS_SSL_VERIFY_NONE ? SSL_VERIFY_NONE : SSL_VERIFY_PEER, nullptr);
+	if (conf->session_tickets != MBEDTLS_SSL_SESSION_TICKETS_ENABLED) SSL_set_options(ssl->ssl, SSL_OP_NO_TICKET);
+
+	BIO* bio = BIO_new(bioMethod());
+	if (bio == nullptr) return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+	BIO_set_data(bio, ssl);
+	SSL_set_bio(ssl->ssl, bio, bio);
+	SSL_set_connect_state(ssl->ssl);
+	return 0;
+}
+
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context* ssl, const char* hostname) {
+	return SSL_set_tlsext_host_name(ssl->ssl, hostname) == 1 ? 0 : MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+}
+
+void mbedtls_ssl_set_bio(mbedtls_ssl_context* ssl, void* p_bio, mbedtls_ssl_send_t* f_send,
+						 mbedtls_ssl_recv_t* f_recv, mbedtls_ssl_recv_timeout_t* f_recv_timeout) {
+	ssl->p_bio = p_bio;
+	ssl->f_send = f_send;
+	ssl->f_recv = f_recv;
+}
+
+int mbedtls_ssl_handshake(mbedtls_ssl_context* ssl) {
+	ssl->bio_error = 0;
+	int ret = SSL_do_handshake(ssl->ssl);
+	return ret == 1 ? 0 : translate(ssl, ret);
+}
+
+int mbedtls_ssl_read(mbedtls_ssl_context* ssl, unsigned char* buf, size_t len) {
+	ssl->bio_error = 0;
+	int ret = SSL_read(ssl->ssl, buf, (int)len);
+	return ret > 0 ? ret : translate(ssl, ret);
+}
+
+int mbedtls_ssl_write(mbedtls_ssl_context* ssl, const unsigned char* buf, size_t len) {
+	ssl->bio_error = 0;
+	int ret = SSL_write(ssl->ssl, buf, (int)len);
+	return ret > 0 ? ret : translate(ssl, ret);
+}
+
+size_t mbedtls_ssl_get_bytes_avail(const mbedtls_ssl_context* ssl) {
+	return ssl->ssl != nullptr ? SSL_pending(ssl->ssl) : 0;
+}
+
+int mbedtls_ssl_close_notify(mbedtls_ssl_context* ssl) {
+	SSL_shutdown(ssl->ssl);
+	return 0;
+}
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session* session) {
+	memset(session, 0, sizeof(*session));
+}
+
+void mbedtls_ssl_session_free(mbedtls_ssl_session* session) {
+	if (session->session != nullptr) SSL_SESSION_free(session->session);
+	memset(session, 0, sizeof(*session));
+}
+
+static void takeSession(mbedtls_ssl_session* session, SSL_SESSION* openssl) {
+	if (session->session != nullptr) SSL_SESSION_free(session->session);
+	session->session = openssl;
+	memset(session->master, 0, sizeof(session->master));
+	SSL_SESSION_get_master_key(openssl, session->master, sizeof(session->master));
+}
+
+int mbedtls_ssl_get_session(const mbedtls_ssl_context* ssl, mbedtls_ssl_session* session) {
+	SSL_SESSION* openssl = SSL_get1_session(ssl->ssl);
+	if (openssl == nullptr) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+	takeSession(session, openssl);
+	return 0;
+}
+
+int mbedtls_ssl_set_session(mbedtls_ssl_context* ssl, const mbedtls_ssl_session* session) {
+	if (session->session == nullptr) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+	return SSL_set_session(ssl->ssl, session->session) == 1 ? 0 : MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+}
+
+int mbedtls_ssl_session_save(const mbedtls_ssl_session* session, unsigned char* buf, size_t buf_len, size_t* olen) {
+	if (session->session == nullptr) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+	int length = i2d_SSL_SESSION(session->session, nullptr);
+	if (length <= 0) return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+	*olen = length;
+	if ((size_t)length > buf_len) return MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+	unsigned char* out = buf;
+	i2d_SSL_SESSION(session->session, &out);
+	return 0;
+}
+
+int mbedtls_ssl_session_load(mbedtls_ssl_session* session, const unsigned char* buf, size_t len) {
+	const unsigned char* in = buf;
+	SSL_SESSION* openssl = d2i_SSL_SESSION(nullptr, &in, (long)len);
+	if (openssl == nullptr) return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+	takeSession(session, openssl);
+	return 0;
+}
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context* ctx) {
+	ctx->seeded = 0;
+}
+
+void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context* ctx) {
+	ctx->seeded = 0;
+}
+
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context* ctx, int (*f_entropy)(void*, unsigned char*, size_t),
+						  void* p_entropy, const unsigned char* custom, size_t len) {
+	ctx->seeded = 1;
+	return 0;
+}
+
+int mbedtls_ctr_drbg_random(void* p_rng, unsigned char* output, size_t output_len) {
+	return RAND_bytes(output, (int)output_len) == 1 ? 0 : -0x0034;
+}
+
+void mbedtls_entropy_init(mbedtls_entropy_context* ctx) {
+	ctx->sources = 0;
+}
+
+void mbedtls_entropy_free(mbedtls_entropy_context* ctx) {
+	ctx->sources = 0;
+}
+
+int mbedtls_entropy_func(void* data, unsigned char* output, size_t len) {
+	return RAND_bytes(output, (int)len) == 1 ? 0 : -0x003C;
+}
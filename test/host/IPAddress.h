@@ -0,0 +1,36 @@
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+// Host stand-in for the core's IPAddress: an IPv4 address kept in network
+// byte order, so the uint32_t conversion matches lwIP's s_addr
+#include <Arduino.h>
+#include <arpa/inet.h>
+
+class IPAddress {
+public:
+  IPAddress() {}
+  IPAddress(uint32_t address) : address(address) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    : address(htonl(((uint32_t)a << 24) | ((uint32_t)b << 16) | ((uint32_t)c << 8) | d)) {}
+
+  bool fromString(const char* text) {
+    struct in_addr parsed;
+    if (text == nullptr || inet_pton(AF_INET, text, &parsed) != 1) return false;
+    address = parsed.s_addr;
+    return true;
+  }
+
+  String toString() const {
+    char text[INET_ADDRSTRLEN];
+    struct in_addr value;
+    value.s_addr = address;
+    return String(inet_ntop(AF_INET, &value, text, sizeof(text)));
+  }
+
+  operator uint32_t() const { return address; }
+
+private:
+  uint32_t address = 0;
+};
+
+#endif
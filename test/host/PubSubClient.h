@@ -0,0 +1,165 @@
+#ifndef HOST_PUBSUBCLIENT_H
+#define HOST_PUBSUBCLIENT_H
+
+// Host stand-in for PubSubClient 2.8, as far as the connection pipeline
+// uses it: connect() writes CONNECT through the client in one write and
+// waits for the CONNACK, connected() follows the socket, and loop() hands
+// incoming PUBLISH payloads to the callback. No pings, no outgoing QoS.
+#include <Arduino.h>
+#include <Client.h>
+#include <functional>
+#include <vector>
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+#define MQTT_SOCKET_TIMEOUT 15
+
+class PubSubClient {
+public:
+  typedef std::function<void(char*, uint8_t*, unsigned int)> Callback;
+
+  explicit PubSubClient(Client& client) : client(&client) {}
+
+  PubSubClient& setKeepAlive(uint16_t seconds) {
+    keepalive = seconds;
+    return *this;
+  }
+
+  PubSubClient& setCallback(Callback callback) {
+    this->callback = callback;
+    return *this;
+  }
+
+  bool connect(const char* id) { return connect(id, nullptr, nullptr); }
+
+  bool connect(const char* id, const char* user, const char* pass) {
+    if (connected()) return true;
+    if (!client->connected()) {
+      client_state = MQTT_CONNECT_FAILED;
+      return false;
+    }
+
+    std::vector<uint8_t> body = {0, 4, 'M', 'Q', 'T', 'T', 4, 0x02, (uint8_t)(keepalive >> 8), (uint8_t)keepalive};
+    if (user != nullptr) body[7] |= 0xC0;
+    putString(body, id);
+    if (user != nullptr) {
+      putString(body, user);
+      putString(body, pass);
+    }
+    std::vector<uint8_t> packet = {0x10};
+    putLength(packet, body.size());
+    packet.insert(packet.end(), body.begin(), body.end());
+    client->write(packet.data(), packet.size());
+
+    uint8_t header;
+    std::vector<uint8_t> reply;
+    if (!readPacket(header, reply)) {
+      client_state = MQTT_CONNECTION_TIMEOUT;
+      client->stop();
+      return false;
+    }
+    if (header == 0x20 && reply.size() == 2 && reply[1] == 0) {
+      client_state = MQTT_CONNECTED;
+      return true;
+    }
+    client_state = reply.size() == 2 ? reply[1] : MQTT_CONNECT_FAILED;
+    client->stop();
+    return false;
+  }
+
+  bool connected() {
+    if (!client->connected()) {
+      if (client_state == MQTT_CONNECTED) {
+        client_state = MQTT_CONNECTION_LOST;
+        client->stop();
+      }
+      return false;
+    }
+    return client_state == MQTT_CONNECTED;
+  }
+
+  void disconnect() {
+    const uint8_t packet[2] = {0xE0, 0};
+    client->write(packet, sizeof(packet));
+    client->stop();
+    client_state = MQTT_DISCONNECTED;
+  }
+
+  bool loop() {
+    if (!connected()) return false;
+    while (client->available() > 0) {
+      uint8_t header;
+      std::vector<uint8_t> body;
+      if (!readPacket(header, body)) return false;
+      if ((header & 0xF0) != 0x30 || body.size() < 2) continue;
+
+      size_t topicLength = (body[0] << 8) | body[1];
+      size_t payload = 2 + topicLength + (((header >> 1) & 3) ? 2 : 0);
+      if (payload > body.size()) continue;
+      std::vector<char> topic(body.begin() + 2, body.begin() + 2 + topicLength);
+      topic.push_back('\0');
+      if (callback) callback(topic.data(), body.data() + payload, body.size() - payload);
+    }
+    return true;
+  }
+
+  int state() const { return client_state; }
+
+private:
+  static void putLength(std::vector<uint8_t>& packet, size_t length) {
+    do {
+      uint8_t digit = length % 128;
+      length /= 128;
+      packet.push_back(digit | (length > 0 ? 0x80 : 0));
+    } while (length > 0);
+  }
+
+  static void putString(std::vector<uint8_t>& packet, const char* text) {
+    size_t length = strlen(text);
+    packet.push_back(length >> 8);
+    packet.push_back(length & 0xFF);
+    packet.insert(packet.end(), text, text + length);
+  }
+
+  // Blocks like the library, up to the socket timeout per byte
+  bool readByte(uint8_t& b) {
+    unsigned long start = millis();
+    while (!client->available()) {
+      if (!client->connected() || millis() - start >= MQTT_SOCKET_TIMEOUT * 1000UL) return false;
+      delay(1);
+    }
+    int value = client->read();
+    if (value < 0) return false;
+    b = value;
+    return true;
+  }
+
+  bool readPacket(uint8_t& header, std::vector<uint8_t>& body) {
+    if (!readByte(header)) return false;
+    size_t length = 0;
+    uint8_t digit;
+    int shift = 0;
+    do {
+      if (shift > 21 || !readByte(digit)) return false;
+      length |= (size_t)(digit & 0x7F) << shift;
+      shift += 7;
+    } while (digit & 0x80);
+
+    body.resize(length);
+    for (size_t i = 0; i < length; i++) {
+      if (!readByte(body[i])) return false;
+    }
+    return true;
+  }
+
+  Client* client;
+  uint16_t keepalive = 15;
+  int client_state = MQTT_DISCONNECTED;
+  Callback callback;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef HOST_SPIFFS_H
+#define HOST_SPIFFS_H
+
+// In-memory stand-in for the SPIFFS filesystem. Files written with "w"
+// replace the old content when closed.
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+class File : public Stream {
+public:
+  File() {}
+  File(const std::string& path, bool writing, std::vector<uint8_t> content)
+    : path(path), writing(writing), data(new std::vector<uint8_t>(std::move(content))) {}
+
+  explicit operator bool() const { return data != nullptr; }
+  size_t size() const { return data ? data->size() : 0; }
+  size_t read(uint8_t* buffer, size_t length);
+  int read() override;
+  int available() override { return data ? (int)(data->size() - position) : 0; }
+  size_t write(const uint8_t* buffer, size_t length) override;
+  using Print::write;
+  void close();
+
+private:
+  std::string path;
+  bool writing = false;
+  size_t position = 0;
+  std::shared_ptr<std::vector<uint8_t>> data;
+};
+
+class SPIFFSFS {
+public:
+  bool begin(bool formatOnFail = false) { (void)formatOnFail; return true; }
+  bool exists(const char* path) const { return files.count(path) > 0; }
+  bool remove(const char* path) { return files.erase(path) > 0; }
+  File open(const char* path, const char* mode = "r");
+  void format() { files.clear(); }
+
+  std::map<std::string, std::vector<uint8_t>> files;
+};
+
+extern SPIFFSFS SPIFFS;
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+// Host stand-in for the WiFi library: the link is "connected" unless a test
+// says otherwise, and host names resolve through the system resolver.
+#include <Arduino.h>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+class WiFiClass {
+public:
+  wl_status_t status() const { return link_status; }
+  void setStatus(wl_status_t status) { link_status = status; }
+
+private:
+  wl_status_t link_status = WL_CONNECTED;
+};
+
+extern WiFiClass WiFi;
+
+#endif
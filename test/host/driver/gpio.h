@@ -0,0 +1,18 @@
+#ifndef HOST_DRIVER_GPIO_H
+#define HOST_DRIVER_GPIO_H
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+typedef int gpio_num_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_STATE 0x103
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num);
+
+// Host only: how often a pin has been reset
+int hostResetPinCount(int gpio);
+
+#endif
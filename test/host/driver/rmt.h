@@ -0,0 +1,64 @@
+#ifndef HOST_DRIVER_RMT_H
+#define HOST_DRIVER_RMT_H
+
+// Host stand-in for the legacy ESP-IDF RMT driver. It keeps track of which
+// channels are installed and captures the bytes written to each, so tests
+// can check that drivers are installed and released as channels change.
+#include <stdint.h>
+#include <stddef.h>
+#include "gpio.h"
+
+typedef enum {
+  RMT_CHANNEL_0,
+  RMT_CHANNEL_1,
+  RMT_CHANNEL_2,
+  RMT_CHANNEL_3,
+  RMT_CHANNEL_4,
+  RMT_CHANNEL_5,
+  RMT_CHANNEL_6,
+  RMT_CHANNEL_7,
+  RMT_CHANNEL_MAX
+} rmt_channel_t;
+
+typedef struct {
+  union {
+    struct {
+      uint32_t duration0 : 15;
+      uint32_t level0 : 1;
+      uint32_t duration1 : 15;
+      uint32_t level1 : 1;
+    };
+    uint32_t val;
+  };
+} rmt_item32_t;
+
+typedef struct {
+  int rmt_mode;
+  rmt_channel_t channel;
+  gpio_num_t gpio_num;
+  uint8_t clk_div;
+  uint8_t mem_block_num;
+} rmt_config_t;
+
+#define RMT_DEFAULT_CONFIG_TX(gpio, channel_id) {0, channel_id, gpio, 80, 1}
+
+typedef void (*sample_to_rmt_t)(const void* src, rmt_item32_t* dest, size_t src_size,
+                                size_t wanted_num, size_t* translated_size, size_t* item_num);
+
+esp_err_t rmt_config(const rmt_config_t* config);
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags);
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel);
+esp_err_t rmt_translator_init(rmt_channel_t channel, sample_to_rmt_t fn);
+esp_err_t rmt_write_sample(rmt_channel_t channel, const uint8_t* src, size_t src_size, bool wait_tx_done);
+esp_err_t rmt_wait_tx_done(rmt_channel_t channel, uint32_t wait_time);
+
+// Host only
+struct HostRMTChannel {
+  bool installed;
+  int gpio;
+  uint32_t writes;
+  size_t last_bytes;
+};
+const HostRMTChannel& hostRMTChannel(int channel);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef HOST_ESP_IDF_VERSION_H
+#define HOST_ESP_IDF_VERSION_H
+
+// The host build models Arduino core 2.x (ESP-IDF 4.4), so the parallel RMT
+// path compiles against the stand-in in driver/rmt.h
+#define ESP_IDF_VERSION_MAJOR 4
+#define ESP_IDF_VERSION_MINOR 4
+#define ESP_IDF_VERSION_PATCH 0
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+// Host FreeRTOS stand-in: tasks are std::threads, semaphores and queues are
+// built on std::mutex and std::condition_variable. One tick is 1 ms.
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef struct HostTask* TaskHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+typedef struct {
+  int owner;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+void hostEnterCritical(portMUX_TYPE* mux);
+void hostExitCritical(portMUX_TYPE* mux);
+#define portENTER_CRITICAL(mux) hostEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) hostExitCritical(mux)
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef HOST_LWIP_DNS_H
+#define HOST_LWIP_DNS_H
+
+// Host stand-in for lwIP's asynchronous resolver. Dotted-quad names and
+// "localhost" answer at once; anything else is looked up on a helper
+// thread and answered through the callback, like lwIP's tcpip thread.
+#include <stdint.h>
+
+typedef int8_t err_t;
+
+#define ERR_OK 0
+#define ERR_INPROGRESS -5
+#define ERR_ARG -16
+
+typedef struct {
+  uint32_t addr;  // Network byte order
+} ip_addr_t;
+
+#define ip_addr_get_ip4_u32(ipaddr) ((ipaddr)->addr)
+
+typedef void (*dns_found_callback)(const char* name, const ip_addr_t* ipaddr, void* callback_arg);
+
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callback_arg);
+
+// Host only: delay answers by ms (slow resolver), or pin a name to an address
+void hostDNSDelay(unsigned long ms);
+void hostDNSAnswer(const char* name, uint32_t addr);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_MBEDTLS_CTR_DRBG_H
+#define HOST_MBEDTLS_CTR_DRBG_H
+
+// Host stand-in: OpenSSL seeds itself, so the DRBG only forwards to it
+#include <stddef.h>
+
+typedef struct mbedtls_ctr_drbg_context {
+  int seeded;
+} mbedtls_ctr_drbg_context;
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context* ctx);
+void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context* ctx);
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context* ctx, int (*f_entropy)(void*, unsigned char*, size_t),
+                          void* p_entropy, const unsigned char* custom, size_t len);
+int mbedtls_ctr_drbg_random(void* p_rng, unsigned char* output, size_t output_len);
+
+#endif
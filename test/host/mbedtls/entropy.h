@@ -0,0 +1,15 @@
+#ifndef HOST_MBEDTLS_ENTROPY_H
+#define HOST_MBEDTLS_ENTROPY_H
+
+// Host stand-in: entropy comes from OpenSSL's generator
+#include <stddef.h>
+
+typedef struct mbedtls_entropy_context {
+  int sources;
+} mbedtls_entropy_context;
+
+void mbedtls_entropy_init(mbedtls_entropy_context* ctx);
+void mbedtls_entropy_free(mbedtls_entropy_context* ctx);
+int mbedtls_entropy_func(void* data, unsigned char* output, size_t len);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef HOST_MBEDTLS_NET_SOCKETS_H
+#define HOST_MBEDTLS_NET_SOCKETS_H
+
+// Host stand-in: the error codes the transport's socket callbacks return
+#include "ssl.h"
+
+#define MBEDTLS_ERR_NET_RECV_FAILED -0x004C
+#define MBEDTLS_ERR_NET_SEND_FAILED -0x004E
+#define MBEDTLS_ERR_NET_CONN_RESET -0x0050
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef HOST_MBEDTLS_SSL_H
+#define HOST_MBEDTLS_SSL_H
+
+// Host stand-in for the part of the mbedTLS 2.x SSL API the MQTT transport
+// uses, carried out by OpenSSL (host/HostTLS.cpp). The client speaks TLS 1.2
+// like the firmware's; sessions are real and can be saved, loaded and
+// resumed, so handshake times and heap compare full against resumed.
+#include <stddef.h>
+#include <stdint.h>
+
+#define MBEDTLS_SSL_IS_CLIENT 0
+#define MBEDTLS_SSL_TRANSPORT_STREAM 0
+#define MBEDTLS_SSL_PRESET_DEFAULT 0
+#define MBEDTLS_SSL_VERIFY_NONE 0
+#define MBEDTLS_SSL_VERIFY_REQUIRED 2
+#define MBEDTLS_SSL_SESSION_TICKETS_DISABLED 0
+#define MBEDTLS_SSL_SESSION_TICKETS_ENABLED 1
+
+#define MBEDTLS_ERR_SSL_BAD_INPUT_DATA -0x7100
+#define MBEDTLS_ERR_SSL_CONN_EOF -0x7280
+#define MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY -0x7880
+#define MBEDTLS_ERR_SSL_ALLOC_FAILED -0x7F00
+#define MBEDTLS_ERR_SSL_INTERNAL_ERROR -0x6C00
+#define MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL -0x6A00
+#define MBEDTLS_ERR_SSL_WANT_READ -0x6900
+#define MBEDTLS_ERR_SSL_WANT_WRITE -0x6880
+
+struct ssl_ctx_st;
+struct ssl_st;
+struct ssl_session_st;
+
+typedef int mbedtls_ssl_send_t(void* ctx, const unsigned char* buf, size_t len);
+typedef int mbedtls_ssl_recv_t(void* ctx, unsigned char* buf, size_t len);
+typedef int mbedtls_ssl_recv_timeout_t(void* ctx, unsigned char* buf, size_t len, uint32_t timeout);
+
+typedef struct mbedtls_ssl_config {
+  struct ssl_ctx_st* ctx;
+  int authmode;
+  int session_tickets;
+} mbedtls_ssl_config;
+
+typedef struct mbedtls_ssl_context {
+  struct ssl_st* ssl;
+  void* p_bio;
+  mbedtls_ssl_send_t* f_send;
+  mbedtls_ssl_recv_t* f_recv;
+  int bio_error;   // Last error from the send or receive callback
+} mbedtls_ssl_context;
+
+typedef struct mbedtls_ssl_session {
+  unsigned char master[48];
+  struct ssl_session_st* session;
+} mbedtls_ssl_session;
+
+void mbedtls_ssl_init(mbedtls_ssl_context* ssl);
+void mbedtls_ssl_free(mbedtls_ssl_context* ssl);
+void mbedtls_ssl_config_init(mbedtls_ssl_config* conf);
+void mbedtls_ssl_config_free(mbedtls_ssl_config* conf);
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config* conf, int endpoint, int transport, int preset);
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config* conf, int authmode);
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config* conf, int (*f_rng)(void*, unsigned char*, size_t), void* p_rng);
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config* conf, int use_tickets);
+int mbedtls_ssl_setup(mbedtls_ssl_context* ssl, const mbedtls_ssl_config* conf);
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context* ssl, const char* hostname);
+void mbedtls_ssl_set_bio(mbedtls_ssl_context* ssl, void* p_bio, mbedtls_ssl_send_t* f_send,
+                         mbedtls_ssl_recv_t* f_recv, mbedtls_ssl_recv_timeout_t* f_recv_timeout);
+int mbedtls_ssl_handshake(mbedtls_ssl_context* ssl);
+int mbedtls_ssl_read(mbedtls_ssl_context* ssl, unsigned char* buf, size_t len);
+int mbedtls_ssl_write(mbedtls_ssl_context* ssl, const unsigned char* buf, size_t len);
+size_t mbedtls_ssl_get_bytes_avail(const mbedtls_ssl_context* ssl);
+int mbedtls_ssl_close_notify(mbedtls_ssl_context* ssl);
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session* session);
+void mbedtls_ssl_session_free(mbedtls_ssl_session* session);
+int mbedtls_ssl_get_session(const mbedtls_ssl_context* ssl, mbedtls_ssl_session* session);
+int mbedtls_ssl_set_session(mbedtls_ssl_context* ssl, const mbedtls_ssl_session* session);
+int mbedtls_ssl_session_save(const mbedtls_ssl_session* session, unsigned char* buf, size_t buf_len, size_t* olen);
+int mbedtls_ssl_session_load(mbedtls_ssl_session* session, const unsigned char* buf, size_t len);
+
+#endif
@@ -0,0 +1,34 @@
+// Writes one PPM image per status effect for eyeballing changes:
+//   render_effects <out_dir> [led_count] [seconds]
+// Each image has a column per LED and a row per 20 ms frame.
+#include "EffectRenderer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <out_dir> [led_count] [seconds]\n", argv[0]);
+    return 2;
+  }
+  int leds = argc > 2 ? atoi(argv[2]) : 60;
+  int seconds = argc > 3 ? atoi(argv[3]) : 4;
+  if (leds <= 0 || seconds <= 0) return 2;
+
+  int failed = 0;
+  for (int s = 0; s < render_scenario_count; s++) {
+    RenderedFrames frames;
+    renderScenario(render_scenarios[s], leds, seconds * 1000UL, 20, frames);
+    std::string path = std::string(argv[1]) + "/" + render_scenarios[s].name + ".ppm";
+    int scale = leds < 200 ? 4 : 1;
+    if (writeFramesImage(path.c_str(), frames, scale)) {
+      printf("%s\n", path.c_str());
+    } else {
+      fprintf(stderr, "could not write %s\n", path.c_str());
+      failed++;
+    }
+  }
+  fflush(stdout);
+  _exit(failed == 0 ? 0 : 1);
+}
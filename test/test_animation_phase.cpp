@@ -0,0 +1,66 @@
+// Animation speed must not depend on frame rate: phases and whole effects
+// rendered at 10, 20 and 60 fps agree once the same time has passed.
+#include "TestHarness.h"
+#include "EffectRenderer.h"
+#include "../src/led/AnimationPhase.h"
+
+static unsigned long phase_clock_ms = 0;
+static unsigned long phaseClock() { return phase_clock_ms; }
+
+static const int PHASE_RATES[] = {10, 20, 60};
+
+// Phase after durationMs stepped at fps, starting from a fresh phase
+static uint32_t phaseAtRate(uint32_t ratePerMs, int direction, int fps, unsigned long durationMs) {
+  AnimationPhase phase;
+  unsigned long start = 5000000;
+  for (unsigned long frame = 0;; frame++) {
+    unsigned long elapsed = min(frame * 1000 / fps, durationMs);
+    phase_clock_ms = start + elapsed;
+    advancePhase(phase, ratePerMs, direction);
+    if (elapsed == durationMs) return phase.phase;
+  }
+}
+
+TEST(phase_agrees_across_frame_rates) {
+  setAnimationClock(phaseClock);
+  const uint32_t rates[] = {PHASE_RATE(0.4), PHASE_RATE_RAD(1.6), PHASE_RATE(1000.0 / 20 / 256.0)};
+  for (uint32_t rate : rates) {
+    for (int direction : {1, -1}) {
+      uint32_t expected = (uint32_t)(rate * 7321UL) * (uint32_t)direction;
+      for (int fps : PHASE_RATES) EXPECT_EQ(phaseAtRate(rate, direction, fps, 7321), expected);
+    }
+  }
+
+  // A stall longer than PHASE_MAX_STEP_MS pauses the phase instead of jumping
+  AnimationPhase phase;
+  phase_clock_ms = 1000;
+  advancePhase(phase, PHASE_RATE(1.0));
+  phase_clock_ms += PHASE_MAX_STEP_MS + 1;
+  EXPECT_EQ(advancePhase(phase, PHASE_RATE(1.0)), 0);
+
+  // A new clock restarts the phase
+  phase_clock_ms += 100;
+  EXPECT_TRUE(advancePhase(phase, PHASE_RATE(1.0)) != 0);
+  setAnimationClock(phaseClock);
+  EXPECT_EQ(advancePhase(phase, PHASE_RATE(1.0)), 0);
+  setAnimationClock(nullptr);
+}
+
+// Every effect ends on the same frame whatever rate it was rendered at.
+// 9250 ms spans several idle sparkles and keeps the finished state outside
+// its random sparkle window.
+TEST(effects_agree_across_frame_rates) {
+  const int leds = 60;
+  for (int s = 0; s < render_scenario_count; s++) {
+    std::vector<uint8_t> reference;
+    renderScenarioAtRate(render_scenarios[s], leds, PHASE_RATES[0], 9250, reference);
+    for (int fps : PHASE_RATES) {
+      std::vector<uint8_t> frame;
+      renderScenarioAtRate(render_scenarios[s], leds, fps, 9250, frame);
+      int worst = 0;
+      for (size_t b = 0; b < frame.size(); b++) worst = max(worst, abs((int)frame[b] - (int)reference[b]));
+      if (worst > 1) printf("  %s at %d fps: off by up to %d\n", render_scenarios[s].name, fps, worst);
+      EXPECT_TRUE(worst <= 1);
+    }
+  }
+}
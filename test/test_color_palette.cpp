@@ -0,0 +1,120 @@
+// OKLab palette tables: the stops land exactly at their positions and the
+// ends hold the outer colors, brightness scales the table, and a settings
+// change rebuilds it.
+#include "TestHarness.h"
+#include "../src/led/ColorPalette.h"
+
+static uint8_t palette_lut[PALETTE_SIZE * 3];
+
+static bool entryIs(const uint8_t* lut, int index, uint8_t r, uint8_t g, uint8_t b) {
+  const uint8_t* entry = lut + index * 3;
+  if (entry[0] == r && entry[1] == g && entry[2] == b) return true;
+  printf("  entry %d is %d,%d,%d, expected %d,%d,%d\n", index, entry[0], entry[1], entry[2], r, g, b);
+  return false;
+}
+
+TEST(palette_endpoints_hold_the_stop_colors) {
+  // Saturated primaries are the hardest case for the OKLab round trip
+  const PaletteStop primaries[] = {{0, 255, 0, 0}, {128, 0, 255, 0}, {255, 0, 0, 255}};
+  bakePalette(primaries, 3, 255, palette_lut);
+  EXPECT_TRUE(entryIs(palette_lut, 0, 255, 0, 0));
+  EXPECT_TRUE(entryIs(palette_lut, 128, 0, 255, 0));
+  EXPECT_TRUE(entryIs(palette_lut, 255, 0, 0, 255));
+
+  // Black to white: both ends exact, lightness rises monotonically and the
+  // middle is perceptually mid-grey rather than the sRGB average
+  const PaletteStop greys[] = {{0, 0, 0, 0}, {255, 255, 255, 255}};
+  bakePalette(greys, 2, 255, palette_lut);
+  EXPECT_TRUE(entryIs(palette_lut, 0, 0, 0, 0));
+  EXPECT_TRUE(entryIs(palette_lut, 255, 255, 255, 255));
+  int falling = 0;
+  for (int k = 1; k < PALETTE_SIZE; k++) falling += palette_lut[k * 3] < palette_lut[(k - 1) * 3];
+  EXPECT_EQ(falling, 0);
+  EXPECT_NEAR(palette_lut[128 * 3], 100, 6);
+  EXPECT_TRUE(palette_lut[128 * 3 + 1] == palette_lut[128 * 3] && palette_lut[128 * 3 + 2] == palette_lut[128 * 3]);
+
+  // Stops inside the range hold their color out to the ends
+  const PaletteStop inner[] = {{64, 10, 20, 30}, {192, 200, 100, 50}};
+  bakePalette(inner, 2, 255, palette_lut);
+  for (int k : {0, 32, 64}) EXPECT_TRUE(entryIs(palette_lut, k, 10, 20, 30));
+  for (int k : {192, 224, 255}) EXPECT_TRUE(entryIs(palette_lut, k, 200, 100, 50));
+
+  // Two stops at one position make a hard edge, with no division by zero
+  const PaletteStop edge[] = {{0, 255, 0, 0}, {100, 255, 0, 0}, {100, 0, 0, 255}, {255, 0, 0, 255}};
+  bakePalette(edge, 4, 255, palette_lut);
+  EXPECT_TRUE(entryIs(palette_lut, 100, 255, 0, 0));
+  EXPECT_TRUE(entryIs(palette_lut, 101, 0, 0, 255));
+
+  // A single color comes back unchanged everywhere
+  const PaletteStop flat[] = {{0, 75, 0, 130}, {255, 75, 0, 130}};
+  bakePalette(flat, 2, 255, palette_lut);
+  int changed = 0;
+  for (int k = 0; k < PALETTE_SIZE; k++) {
+    const uint8_t* entry = palette_lut + k * 3;
+    changed += abs(entry[0] - 75) > 1 || entry[1] > 1 || abs(entry[2] - 130) > 1;
+  }
+  EXPECT_EQ(changed, 0);
+
+  // No stops: an all-black table
+  memset(palette_lut, 0xAA, sizeof(palette_lut));
+  bakePalette(flat, 0, 255, palette_lut);
+  EXPECT_TRUE(entryIs(palette_lut, 0, 0, 0, 0));
+  EXPECT_TRUE(entryIs(palette_lut, 255, 0, 0, 0));
+}
+
+TEST(palette_brightness_scales_the_table) {
+  const PaletteStop stops[] = {{0, 255, 128, 0}, {255, 0, 64, 255}};
+  bakePalette(stops, 2, 128, palette_lut);
+  EXPECT_TRUE(entryIs(palette_lut, 0, 128, 64, 0));
+  EXPECT_TRUE(entryIs(palette_lut, 255, 0, 32, 128));
+  bakePalette(stops, 2, 0, palette_lut);
+  EXPECT_TRUE(entryIs(palette_lut, 0, 0, 0, 0));
+}
+
+TEST(state_palette_follows_settings) {
+  settings = LEDSettings();
+
+  // Default heating palette: state color at the start, 70% green at the end
+  settings.colors[5] = {255, 100, 0};
+  EXPECT_EQ(samplePalette(5, 0), 0xFF6400);
+  EXPECT_EQ(samplePalette(5, 255), 0xFF4600);
+
+  // Custom stops are sorted and replace the default
+  settings.palettes[1].stop_count = 2;
+  settings.palettes[1].stops[0] = {255, 0, 0, 255};
+  settings.palettes[1].stops[1] = {0, 255, 0, 0};
+  EXPECT_EQ(samplePalette(1, 0), 0xFF0000);
+  EXPECT_EQ(samplePalette(1, 255), 0x0000FF);
+
+  // A color, brightness or night mode change rebuilds the table
+  settings.colors[5] = {0, 0, 200};
+  EXPECT_EQ(samplePalette(5, 0), 0x0000C8);
+  settings.global_brightness = 51;
+  EXPECT_EQ(samplePalette(5, 0), 0x000028);
+  settings.night_mode_enabled = true;
+  settings.night_mode_brightness = 255;
+  EXPECT_EQ(samplePalette(5, 0), 0x0000C8);
+  settings = LEDSettings();
+}
+
+TEST(palette_benchmark) {
+  const PaletteStop stops[] = {{0, 255, 0, 0}, {85, 255, 200, 0}, {170, 0, 200, 255}, {255, 128, 0, 255}};
+  const int bakes = 200;
+  double start = benchNow();
+  for (int i = 0; i < bakes; i++) bakePalette(stops, 4, 255 - (i & 1), palette_lut);
+  double bake = (benchNow() - start) / bakes;
+
+  const int count = 1000;
+  const int frames = 5000;
+  static uint8_t rgb[count * 3];
+  volatile uint8_t sink = 0;
+  start = benchNow();
+  for (int frame = 0; frame < frames; frame++) {
+    for (int i = 0; i < count; i++) memcpy(rgb + i * 3, palette_lut + ((i * 256 / count + frame) & 255) * 3, 3);
+    sink = sink + rgb[frame % count];
+  }
+  double lookup = (benchNow() - start) / frames;
+
+  BENCH("palette bake (4 stops): %.1f us per table", bake * 1e6);
+  BENCH("palette lookup 1000 LEDs: %.2f ns/pixel", lookup * 1e9 / count);
+}
@@ -0,0 +1,204 @@
+// Effect expressions: compiler output, constant folding, the compile-time
+// stack and length limits, and the interpreter against plain C++.
+#include "TestHarness.h"
+#include "../src/led/ColorPalette.h"
+#include "../src/led/EffectVM.h"
+#include "../src/led/LEDAnimations.h"
+#include "../src/printer/PrinterState.h"
+
+static unsigned long vm_clock_ms = 0;
+static unsigned long vmClock() { return vm_clock_ms; }
+
+static bool compiles(const char* source, EffectProgram& program) {
+  EffectError error;
+  return compileEffect(source, program, error);
+}
+
+static EffectError compileError(const char* source) {
+  EffectProgram program;
+  EffectError error;
+  EXPECT_TRUE(!compileEffect(source, program, error));
+  return error;
+}
+
+TEST(vm_compiles_documented_examples) {
+  EffectProgram program;
+  EXPECT_TRUE(compiles("wave(x * 3 - t * 0.5) * (0.3 + 0.7 * p)", program));
+  EXPECT_TRUE(compiles("hsv(x + t * 0.1, 1, 1) * (x < p)", program));
+  EXPECT_TRUE(compiles("palette(fract(angle + t)) * radius", program));
+  EXPECT_TRUE(compiles("mix(noise(i), 1, clamp(nozzle / 250))", program));
+}
+
+TEST(vm_reports_errors_with_positions) {
+  EffectError error = compileError("x + foo(1)");
+  EXPECT_TRUE(strcmp(error.message, "Unknown function") == 0);
+  EXPECT_EQ(error.position, 4);
+
+  error = compileError("x * speed");
+  EXPECT_TRUE(strcmp(error.message, "Unknown variable") == 0);
+  EXPECT_EQ(error.position, 4);
+
+  error = compileError("min(x)");
+  EXPECT_TRUE(strcmp(error.message, "Wrong number of arguments") == 0);
+
+  error = compileError("(x + 1");
+  EXPECT_TRUE(strcmp(error.message, "Expected ')'") == 0);
+
+  error = compileError("x +");
+  EXPECT_TRUE(strcmp(error.message, "Unexpected end of expression") == 0);
+
+  error = compileError("x $ 2");
+  EXPECT_TRUE(strcmp(error.message, "Unexpected character") == 0);
+  EXPECT_EQ(error.position, 2);
+}
+
+TEST(vm_folds_constant_subexpressions) {
+  EffectProgram program;
+  EXPECT_TRUE(compiles("2 * 3 + 1", program));
+  EXPECT_EQ(program.code_length, 1);
+  EXPECT_EQ(program.code[0].op, OP_CONST);
+  EXPECT_NEAR(program.constants[program.code[0].arg], 7, 0);
+
+  EXPECT_TRUE(compiles("-(2 * 3) + 10 / 4", program));
+  EXPECT_EQ(program.code_length, 1);
+  EXPECT_NEAR(program.constants[program.code[0].arg], -3.5, 1e-6);
+
+  // Comparisons fold too; division by zero folds to 0 like the interpreter
+  EXPECT_TRUE(compiles("(1 < 2) + 5 / 0", program));
+  EXPECT_EQ(program.code_length, 1);
+  EXPECT_NEAR(program.constants[program.code[0].arg], 1, 0);
+
+  // Only the constant part of a mixed expression folds
+  EXPECT_TRUE(compiles("x * (2 + 3)", program));
+  EXPECT_EQ(program.code_length, 3);
+  EXPECT_EQ(program.code[0].op, OP_VAR);
+  EXPECT_EQ(program.code[1].op, OP_CONST);
+  EXPECT_NEAR(program.constants[program.code[1].arg], 5, 0);
+  EXPECT_EQ(program.code[2].op, OP_MUL);
+
+  // Left-to-right evaluation: x + 1 + 2 is (x + 1) + 2, nothing to fold
+  EXPECT_TRUE(compiles("x + 1 + 2", program));
+  EXPECT_EQ(program.code_length, 5);
+}
+
+TEST(vm_enforces_stack_and_length_limits) {
+  EffectProgram program;
+
+  // Right-nested sums keep every operand on the stack
+  char source[MAX_EFFECT_SOURCE];
+  auto nestedSum = [&](int depth) {
+    std::string text = "x";
+    for (int d = 1; d < depth; d++) text = "x+(" + text + ")";
+    strlcpy(source, text.c_str(), sizeof(source));
+  };
+
+  nestedSum(EFFECT_STACK_DEPTH);
+  EXPECT_TRUE(compiles(source, program));
+  EXPECT_EQ(program.stack_depth, EFFECT_STACK_DEPTH);
+
+  nestedSum(EFFECT_STACK_DEPTH + 1);
+  EffectError error = compileError(source);
+  EXPECT_TRUE(strcmp(error.message, "Expression too deep") == 0);
+
+  // Parenthesis nesting is limited even when the stack stays shallow
+  std::string parens = std::string(20, '(') + "x" + std::string(20, ')');
+  error = compileError(parens.c_str());
+  EXPECT_TRUE(strcmp(error.message, "Expression too deep") == 0);
+
+  // 49 variables and 48 additions are 97 instructions
+  std::string longSum = "x";
+  for (int k = 0; k < 48; k++) longSum += "+x";
+  error = compileError(longSum.c_str());
+  EXPECT_TRUE(strcmp(error.message, "Program too long") == 0);
+
+  std::string longSource(MAX_EFFECT_SOURCE, ' ');
+  longSource[0] = 'x';
+  error = compileError(longSource.c_str());
+  EXPECT_TRUE(strcmp(error.message, "Program too long") == 0);
+}
+
+TEST(vm_matches_scalar_reference) {
+  setAnimationClock(vmClock);
+  vm_clock_ms = 12345;
+  printer_state.status = "printing";
+  printer_state.progress = 40;
+
+  EffectProgram program;
+  EXPECT_TRUE(compiles("wave(x * 3 - t * 0.5) * (0.3 + 0.7 * p)", program));
+
+  const int count = 120;
+  uint8_t rgb[count * 3];
+  runEffect(program, 0xFF8040, nullptr, 255, rgb, count);
+
+  float t = 12.345f;
+  float p = 0.4f;
+  int worst = 0;
+  for (int i = 0; i < count; i++) {
+    float x = (float)i / count;
+    float phase = x * 3 - t * 0.5f;
+    float f = phase - floorf(phase);
+    float intensity = (1 - fabsf(2 * f - 1)) * (0.3f + 0.7f * p);
+    int expected[3] = {(int)(255 * intensity), (int)(128 * intensity), (int)(64 * intensity)};
+    for (int c = 0; c < 3; c++) worst = max(worst, abs(rgb[i * 3 + c] - expected[c]));
+  }
+  EXPECT_TRUE(worst <= 1);
+
+  // rgb() replaces the state color and scales with brightness
+  EXPECT_TRUE(compiles("rgb(1, 0, 0.5)", program));
+  runEffect(program, 0x00FF00, nullptr, 128, rgb, 2);
+  EXPECT_EQ(rgb[0], 128);
+  EXPECT_EQ(rgb[1], 0);
+  EXPECT_EQ(rgb[2], 64);
+  setAnimationClock(nullptr);
+}
+
+TEST(vm_non_finite_values_render_as_zero) {
+  setAnimationClock(vmClock);
+  const int count = 8;
+  uint8_t rgb[count * 3];
+  uint8_t palette[PALETTE_SIZE * 3];
+  memset(palette, 0x55, sizeof(palette));
+  palette[0] = 10;
+  palette[1] = 20;
+  palette[2] = 30;
+
+  // Pixel 0 has x = 0 and stays finite; from pixel 1 on these are inf
+  // (x * 1e30 * 1e30) or NaN (inf - inf), and count as 0
+  auto pixelsFrom1 = [&](const char* source, uint8_t r, uint8_t g, uint8_t b) {
+    EffectProgram program;
+    EXPECT_TRUE(compiles(source, program));
+    memset(rgb, 0xAA, sizeof(rgb));
+    runEffect(program, 0xFFFFFF, palette, 255, rgb, count);
+    int wrong = 0;
+    for (int i = 1; i < count; i++) {
+      if (rgb[i * 3] != r || rgb[i * 3 + 1] != g || rgb[i * 3 + 2] != b) wrong++;
+    }
+    EXPECT_EQ(wrong, 0);
+  };
+
+  pixelsFrom1("x * 1e30 * 1e30", 0, 0, 0);
+  pixelsFrom1("x * 1e30 * 1e30 - x * 1e30 * 1e30", 0, 0, 0);
+  pixelsFrom1("rgb(x * 1e30 * 1e30, 0, 1)", 0, 0, 255);
+  pixelsFrom1("hsv(x * 1e30 * 1e30 - x * 1e30 * 1e30, 1, 1)", 255, 0, 0);
+  pixelsFrom1("palette(x * 1e30 * 1e30 - x * 1e30 * 1e30)", 10, 20, 30);
+  pixelsFrom1("noise(x * 1e30 * 1e30)", 0, 0, 0);
+  setAnimationClock(nullptr);
+}
+
+TEST(vm_benchmark) {
+  setAnimationClock(vmClock);
+  EffectProgram program;
+  compiles("wave(x * 3 - t * 0.5) * (0.3 + 0.7 * p)", program);
+
+  const int count = 1000;
+  static uint8_t rgb[count * 3];
+  const int rounds = 200;
+  double start = benchNow();
+  for (int r = 0; r < rounds; r++) {
+    vm_clock_ms += 16;
+    runEffect(program, 0xFF8040, nullptr, 255, rgb, count);
+  }
+  double elapsed = benchNow() - start;
+  BENCH("effect VM %.1f ns/pixel (%d ops)", elapsed * 1e9 / (rounds * count), program.code_length);
+  setAnimationClock(nullptr);
+}
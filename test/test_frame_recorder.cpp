@@ -0,0 +1,168 @@
+// Flight recorder: every frame still in the ring decodes back to the frame
+// that was recorded, across keyframes, deltas and eviction, and no record
+// outgrows the encoder's worst case, including solid primary colors.
+#include "TestHarness.h"
+#include "../src/led/FrameRecorder.h"
+#include "../src/printer/PrinterState.h"
+#include <random>
+
+struct DecodedFrame {
+  uint8_t tag;
+  bool keyframe;
+  std::vector<uint8_t> rgb;
+};
+
+static uint32_t readU32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Decoder for the dump format in FrameRecorder.h. Like
+// tools/decode_frames.py it skips deltas whose keyframe was evicted.
+static bool decodeDump(const std::vector<uint8_t>& dump, std::vector<DecodedFrame>& frames, size_t& largestPayload) {
+  frames.clear();
+  largestPayload = 0;
+  if (dump.size() < 14 || memcmp(dump.data(), "MLFR", 4) != 0 || dump[4] != FRAME_RECORDER_VERSION) return false;
+  size_t p = 6;
+  for (int t = 0; t < dump[5]; t++) p += 1 + dump[p];
+  uint32_t count = readU32(&dump[p]);
+  uint32_t bytes = readU32(&dump[p + 4]);
+  p += 8;
+  if (p + bytes != dump.size()) return false;
+
+  std::vector<uint8_t> previous;
+  for (uint32_t f = 0; f < count; f++) {
+    if (p + 10 > dump.size()) return false;
+    DecodedFrame frame;
+    frame.tag = dump[p + 4];
+    frame.keyframe = dump[p + 5] & FRAME_RECORD_KEYFRAME;
+    int pixels = dump[p + 6] | (dump[p + 7] << 8);
+    size_t payload = dump[p + 8] | (dump[p + 9] << 8);
+    largestPayload = std::max(largestPayload, payload);
+    p += 10;
+
+    std::vector<uint8_t> delta;
+    size_t end = p + payload;
+    while (p < end) {
+      uint8_t control = dump[p++];
+      if (control < 128) {
+        delta.insert(delta.end(), dump.begin() + p, dump.begin() + p + control + 1);
+        p += control + 1;
+      } else {
+        delta.insert(delta.end(), control - 126, dump[p++]);
+      }
+    }
+    if (p != end || (int)delta.size() != pixels * 3) return false;
+    if (!frame.keyframe) {
+      if (previous.size() != delta.size()) continue;  // Before the first surviving keyframe
+      for (size_t i = 0; i < delta.size(); i++) delta[i] ^= previous[i];
+    }
+    frame.rgb = delta;
+    previous = delta;
+    frames.push_back(frame);
+  }
+  return p == dump.size();
+}
+
+static std::vector<uint8_t> dumpRecorder() {
+  std::vector<uint8_t> dump(frameRecorderDumpSize());
+  dump.resize(frameRecorderDump(dump.data(), dump.size()));
+  return dump;
+}
+
+static std::vector<uint8_t> solid(int count, uint8_t r, uint8_t g, uint8_t b) {
+  std::vector<uint8_t> rgb(count * 3);
+  for (int i = 0; i < count; i++) {
+    rgb[i * 3] = r;
+    rgb[i * 3 + 1] = g;
+    rgb[i * 3 + 2] = b;
+  }
+  return rgb;
+}
+
+// Record the frames and check the ring holds the newest of them intact
+static void roundTrip(const std::vector<std::vector<uint8_t>>& input, size_t capacity) {
+  frameRecorderBegin(capacity);
+  for (const std::vector<uint8_t>& frame : input) recordFrame(frame.data(), frame.size() / 3);
+
+  std::vector<DecodedFrame> decoded;
+  size_t largestPayload = 0;
+  EXPECT_TRUE(decodeDump(dumpRecorder(), decoded, largestPayload));
+  EXPECT_TRUE(!decoded.empty() && decoded.front().keyframe);
+  // At most one keyframe interval is lost to eviction
+  EXPECT_TRUE(decoded.size() + FRAME_RECORDER_KEYFRAME_INTERVAL > frame_recorder_stats.frames_held);
+
+  int mismatches = 0;
+  size_t offset = input.size() - decoded.size();
+  for (size_t i = 0; i < decoded.size(); i++) mismatches += decoded[i].rgb != input[offset + i];
+  EXPECT_EQ(mismatches, 0);
+
+  size_t largestFrame = 0;
+  for (const std::vector<uint8_t>& frame : input) largestFrame = std::max(largestFrame, frame.size());
+  EXPECT_TRUE(largestPayload <= largestFrame + largestFrame / 128 + 2);
+}
+
+TEST(recorded_frames_decode_to_the_input) {
+  printer_state.status = "printing";
+  std::mt19937 random(5);
+
+  // Solid primaries were the worst case: ff 00 00 repeating grew by 4/3
+  for (int count : {1, 2, 60, 300, 2000}) {
+    std::vector<std::vector<uint8_t>> frames;
+    for (auto color : {0xFF0000, 0x00FF00, 0x0000FF, 0xFFFFFF, 0x000000, 0xFF0000}) {
+      frames.push_back(solid(count, color >> 16, color >> 8, color));
+    }
+    roundTrip(frames, 65536);
+  }
+
+  // Noise, near-duplicate frames, pairs of equal bytes and 129/130-byte runs
+  std::vector<std::vector<uint8_t>> frames;
+  std::vector<uint8_t> frame(300 * 3);
+  for (int f = 0; f < 120; f++) {
+    switch (f % 5) {
+      case 0: for (uint8_t& b : frame) b = random(); break;
+      case 1: frame[random() % frame.size()] ^= 0x55; break;
+      case 2: for (size_t i = 0; i < frame.size(); i++) frame[i] = (i / 2) * 37; break;
+      case 3: for (size_t i = 0; i < frame.size(); i++) frame[i] = (i % 130 < 129) ? 9 : i; break;
+      default: for (size_t i = 0; i < frame.size(); i++) frame[i] = (i % 3 == 2) ? 0 : 200; break;
+    }
+    frames.push_back(frame);
+  }
+  roundTrip(frames, 49152);  // Evicts, but holds more than a keyframe interval
+  EXPECT_TRUE(frame_recorder_stats.frames_held < frames.size());
+}
+
+TEST(oversized_frames_are_dropped_not_written) {
+  printer_state.status = "idle";
+  frameRecorderBegin(1024);
+  std::vector<uint8_t> small = solid(10, 1, 2, 3);
+  std::vector<uint8_t> noise(600 * 3);
+  std::mt19937 random(9);
+  for (uint8_t& b : noise) b = random();
+
+  recordFrame(small.data(), 10);
+  recordFrame(noise.data(), 600);
+  EXPECT_EQ(frame_recorder_stats.frames_dropped, 1);
+  recordFrame(small.data(), 10);  // Keyframe again: the dropped frame is no base
+
+  std::vector<DecodedFrame> decoded;
+  size_t largestPayload = 0;
+  EXPECT_TRUE(decodeDump(dumpRecorder(), decoded, largestPayload));
+  EXPECT_EQ(decoded.size(), 2);
+  EXPECT_TRUE(decoded.size() == 2 && decoded[1].keyframe && decoded[1].rgb == small);
+}
+
+TEST(recorder_cost) {
+  printer_state.status = "printing";
+  frameRecorderBegin(FRAME_RECORDER_BYTES);
+  const int count = 1000;
+  const int frames = 2000;
+  std::vector<uint8_t> frame(count * 3);
+  double start = benchNow();
+  for (int f = 0; f < frames; f++) {
+    for (int i = 0; i < 10; i++) frame[(f * 31 + i * 97) % frame.size()] = f;  // A few changed pixels
+    recordFrame(frame.data(), count);
+  }
+  double elapsed = (benchNow() - start) / frames;
+  BENCH("record 1000 LEDs: %.2f ns/pixel, %u frames in %u bytes", elapsed * 1e9 / count,
+        frame_recorder_stats.frames_held, frame_recorder_stats.bytes_held);
+}
@@ -0,0 +1,141 @@
+// Frame clock on a simulated RTOS tick: the LED task loop of
+// frameSchedulerWait/EndFrame with vTaskDelayUntil replaced by a virtual
+// tick counter. Work that fits its slot keeps every interval at the period,
+// an overrun is counted once with the slots it spilled into, and the frames
+// after it stay on the original phase instead of bursting to catch up.
+#include "TestHarness.h"
+#include "../src/led/FrameScheduler.h"
+#include <random>
+#include <vector>
+
+static const uint32_t PERIOD_TICKS = LED_FRAME_PERIOD_MS;  // 1 ms ticks
+
+// vTaskDelayUntil on a virtual tick: block until previous + period, or
+// return at once if that has passed, and move previous on either way
+static void simDelayUntil(uint32_t& now, uint32_t& previous, uint32_t period) {
+  uint32_t next = previous + period;
+  if ((int32_t)(next - now) > 0) now = next;
+  previous = next;
+}
+
+struct SimRun {
+  std::vector<uint32_t> wakes;
+  uint32_t misses = 0;
+  uint32_t skipped = 0;
+};
+
+// The LED task loop: wait for the slot, do the frame's work, check the
+// deadline. skipSlots = false is a plain vTaskDelayUntil loop for contrast.
+static SimRun runFrames(const std::vector<uint32_t>& work, bool skipSlots = true) {
+  SimRun run;
+  uint32_t now = 1000;
+  FrameClock clock;
+  clock.period = PERIOD_TICKS;
+  clock.last_wake = now;
+
+  for (uint32_t ticks : work) {
+    uint32_t wake = clock.last_wake;
+    simDelayUntil(now, wake, clock.period);
+    clock.last_wake = wake;
+    run.wakes.push_back(now);
+
+    now += ticks;
+    if (!skipSlots) continue;
+    uint32_t missed = frameClockCheck(clock, now);
+    if (missed > 0) {
+      run.misses++;
+      run.skipped += missed;
+    }
+  }
+  return run;
+}
+
+// Variable work within the slot, with an overrun of 1.5 to 4 periods
+// every spikeEvery frames
+static std::vector<uint32_t> frameWork(int frames, int spikeEvery, std::vector<uint32_t>* spikes = nullptr) {
+  std::mt19937 random(7);
+  std::vector<uint32_t> work;
+  for (int i = 0; i < frames; i++) {
+    if (spikeEvery > 0 && i % spikeEvery == spikeEvery - 1) {
+      uint32_t spike = PERIOD_TICKS * 3 / 2 + random() % (PERIOD_TICKS * 5 / 2);
+      work.push_back(spike);
+      if (spikes != nullptr) spikes->push_back(spike);
+    } else {
+      work.push_back(1 + random() % (PERIOD_TICKS - 1));
+    }
+  }
+  return work;
+}
+
+TEST(frame_clock_keeps_the_period_when_work_fits) {
+  SimRun run = runFrames(frameWork(500, 0));
+  EXPECT_EQ(run.misses, 0);
+  EXPECT_EQ(run.skipped, 0);
+  int off = 0;
+  for (size_t i = 1; i < run.wakes.size(); i++) {
+    if (run.wakes[i] - run.wakes[i - 1] != PERIOD_TICKS) off++;
+  }
+  EXPECT_EQ(off, 0);
+}
+
+TEST(frame_clock_counts_overruns_and_the_slots_they_skip) {
+  std::vector<uint32_t> spikes;
+  SimRun run = runFrames(frameWork(500, 25, &spikes));
+
+  uint32_t expectedSkipped = 0;
+  for (uint32_t spike : spikes) expectedSkipped += spike / PERIOD_TICKS;
+  EXPECT_EQ(run.misses, spikes.size());
+  EXPECT_EQ(run.skipped, expectedSkipped);
+
+  // An exact multiple of the period still overran its own slot
+  FrameClock clock;
+  clock.period = PERIOD_TICKS;
+  clock.last_wake = 0;
+  EXPECT_EQ(frameClockCheck(clock, PERIOD_TICKS - 1), 0);
+  EXPECT_EQ(frameClockCheck(clock, PERIOD_TICKS), 1);
+  EXPECT_EQ(clock.last_wake, PERIOD_TICKS);
+}
+
+TEST(frame_clock_does_not_burst_after_a_skip) {
+  SimRun run = runFrames(frameWork(500, 25));
+  int early = 0, offPhase = 0;
+  for (size_t i = 1; i < run.wakes.size(); i++) {
+    if (run.wakes[i] - run.wakes[i - 1] < PERIOD_TICKS) early++;
+    if ((run.wakes[i] - run.wakes[0]) % PERIOD_TICKS != 0) offPhase++;
+  }
+  EXPECT_EQ(early, 0);
+  EXPECT_EQ(offPhase, 0);
+
+  // Without the skip, vTaskDelayUntil returns at once for every slot the
+  // overrun spilled into
+  SimRun plain = runFrames(frameWork(500, 25), false);
+  int bursts = 0;
+  for (size_t i = 1; i < plain.wakes.size(); i++) {
+    if (plain.wakes[i] - plain.wakes[i - 1] < PERIOD_TICKS) bursts++;
+  }
+  EXPECT_TRUE(bursts > 0);
+}
+
+// Wake-to-wake jitter against the nominal period, with overruns every
+// spikeEvery frames, for the skipping clock and a plain delay-until loop
+TEST(bench_frame_clock_interval_jitter) {
+  const int frames = 2000;
+  const int spacing[] = {0, 100, 25};
+
+  for (int spikeEvery : spacing) {
+    for (int skip = 1; skip >= 0; skip--) {
+      SimRun run = runFrames(frameWork(frames, spikeEvery), skip);
+      double sumSquares = 0;
+      int worst = 0, bursts = 0;
+      for (size_t i = 1; i < run.wakes.size(); i++) {
+        int deviation = (int)(run.wakes[i] - run.wakes[i - 1]) - (int)PERIOD_TICKS;
+        sumSquares += (double)deviation * deviation;
+        worst = max(worst, abs(deviation));
+        if (deviation < 0) bursts++;
+      }
+      BENCH("overrun every %3d frames, %-13s: jitter rms %.2f ms, worst %2d ms, %3d early wakes",
+            spikeEvery, skip ? "slot skipping" : "plain delay", sqrt(sumSquares / (run.wakes.size() - 1)),
+            worst, bursts);
+    }
+  }
+}
@@ -0,0 +1,108 @@
+// Golden frames for every status effect: each scenario is rendered on the
+// host clock and compared with test/golden/state_frames.txt. Run with
+// MAVENLED_UPDATE_GOLDEN=1 to rewrite the file after an intended change.
+#include "TestHarness.h"
+#include "EffectRenderer.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <string>
+
+static const int GOLDEN_LEDS = 60;
+static const unsigned long GOLDEN_DURATION_MS = 3000;
+static const unsigned long GOLDEN_STEP_MS = 20;
+static const unsigned long GOLDEN_SAMPLE_MS = 500;
+static const int GOLDEN_TOLERANCE = 2;  // Per channel, allows float rounding drift
+
+static std::string hexFrame(const std::vector<uint8_t>& frame) {
+  static const char digits[] = "0123456789abcdef";
+  std::string hex;
+  for (uint8_t byte : frame) {
+    hex += digits[byte >> 4];
+    hex += digits[byte & 15];
+  }
+  return hex;
+}
+
+static std::vector<uint8_t> parseHex(const std::string& hex) {
+  std::vector<uint8_t> bytes;
+  for (size_t i = 0; i + 1 < hex.size(); i += 2) bytes.push_back(strtoul(hex.substr(i, 2).c_str(), nullptr, 16));
+  return bytes;
+}
+
+// "name time_ms" -> frame
+static std::map<std::string, std::vector<uint8_t>> loadGolden() {
+  std::map<std::string, std::vector<uint8_t>> golden;
+  FILE* file = fopen(MAVENLED_GOLDEN_FILE, "r");
+  if (file == nullptr) return golden;
+  char name[64];
+  unsigned long time = 0;
+  char hex[GOLDEN_LEDS * 6 + 1];
+  while (fscanf(file, "%63s %lu %360s", name, &time, hex) == 3) {
+    golden[std::string(name) + " " + std::to_string(time)] = parseHex(hex);
+  }
+  fclose(file);
+  return golden;
+}
+
+TEST(state_effects_match_golden_frames) {
+  bool update = getenv("MAVENLED_UPDATE_GOLDEN") != nullptr;
+  std::map<std::string, std::vector<uint8_t>> golden = loadGolden();
+  FILE* out = update ? fopen(MAVENLED_GOLDEN_FILE, "w") : nullptr;
+  if (update) EXPECT_TRUE(out != nullptr);
+  if (!update) EXPECT_TRUE(!golden.empty());
+
+  for (int s = 0; s < render_scenario_count; s++) {
+    const RenderScenario& scenario = render_scenarios[s];
+    RenderedFrames frames;
+    renderScenario(scenario, GOLDEN_LEDS, GOLDEN_DURATION_MS, GOLDEN_STEP_MS, frames);
+
+    int mismatches = 0;
+    for (size_t i = 0; i < frames.frames.size(); i++) {
+      unsigned long time = frames.times_ms[i];
+      if (time % GOLDEN_SAMPLE_MS != 0) continue;
+      if (out != nullptr) {
+        fprintf(out, "%s %lu %s\n", scenario.name, time, hexFrame(frames.frames[i]).c_str());
+        continue;
+      }
+
+      auto expected = golden.find(std::string(scenario.name) + " " + std::to_string(time));
+      if (expected == golden.end() || expected->second.size() != frames.frames[i].size()) {
+        printf("  %s @ %lu ms: no golden frame\n", scenario.name, time);
+        mismatches++;
+        continue;
+      }
+      int worst = 0;
+      for (size_t b = 0; b < frames.frames[i].size(); b++) {
+        worst = std::max(worst, abs((int)frames.frames[i][b] - (int)expected->second[b]));
+      }
+      if (worst > GOLDEN_TOLERANCE) {
+        printf("  %s @ %lu ms: off by up to %d\n", scenario.name, time, worst);
+        mismatches++;
+      }
+    }
+    EXPECT_EQ(mismatches, 0);
+  }
+  if (out != nullptr) fclose(out);
+}
+
+// The same scenario rendered twice gives the same frames
+TEST(rendering_is_deterministic) {
+  for (int s = 0; s < render_scenario_count; s++) {
+    RenderedFrames first, second;
+    renderScenario(render_scenarios[s], GOLDEN_LEDS, 1000, GOLDEN_STEP_MS, first);
+    renderScenario(render_scenarios[s], GOLDEN_LEDS, 1000, GOLDEN_STEP_MS, second);
+    if (first.frames != second.frames) printf("  %s differs between runs\n", render_scenarios[s].name);
+    EXPECT_TRUE(first.frames == second.frames);
+  }
+}
+
+TEST(effect_render_cost) {
+  const int leds = 1000;
+  for (int s = 0; s < render_scenario_count; s++) {
+    double ns = benchmarkScenario(render_scenarios[s], leds, 500);
+    BENCH("%-18s %6.2f ns/pixel at %d LEDs", render_scenarios[s].name, ns, leds);
+  }
+}
+
+TEST_MAIN()
@@ -0,0 +1,146 @@
+// Layer mode: which pixels show done, current and remaining layers, that
+// the incremental repaint on a layer change matches a full repaint, and
+// what a frame costs against the progress bar.
+#include "TestHarness.h"
+#include "../src/config/Settings.h"
+#include "../src/led/LEDAnimations.h"
+#include "../src/led/LEDLayout.h"
+#include "../src/printer/PrinterState.h"
+
+static unsigned long layer_clock_ms = 0;
+static unsigned long layerClock() { return layer_clock_ms; }
+
+static void setupLayers(int leds, int direction) {
+  setAnimationClock(layerClock);
+  settings = LEDSettings();
+  settings.led_count = leds;
+  settings.print_mode = PRINT_MODE_LAYERS;
+  settings.printing_direction = direction;
+  strip.updateLength(leds);
+  layoutBegin(leds);
+  printer_state = PrinterState();
+  printer_state.status = "printing";
+  layer_clock_ms = 7000000;
+}
+
+static bool pixelIs(int index, uint8_t r, uint8_t g, uint8_t b) {
+  const uint8_t* p = strip.getPixels() + index * 3;
+  return p[0] == r && p[1] == g && p[2] == b;
+}
+
+TEST(layers_split_the_strip) {
+  for (int direction : {1, -1}) {
+    setupLayers(60, direction);
+    printer_state.current_layer = 4;  // 1-based: layers 1-3 are done
+    printer_state.total_layers = 10;
+    showLayerProgress();
+
+    const uint8_t* firstCurrent = strip.getPixels() + ((direction > 0) ? 18 : 41) * 3;
+    int wrong = 0;
+    for (int p = 0; p < 60; p++) {
+      int i = (direction > 0) ? p : 59 - p;
+      const uint8_t* pixel = strip.getPixels() + i * 3;
+      if (p < 18) {
+        wrong += !pixelIs(i, 75, 0, 130);         // Done: the printing color
+      } else if (p < 24) {
+        // Current: one level pulsing between 25% and 100% of it
+        wrong += pixel[0] < 75 / 4 || pixel[0] > 75 || pixel[1] != 0 || pixel[2] < 130 / 4;
+        wrong += memcmp(pixel, firstCurrent, 3) != 0;
+      } else {
+        wrong += !pixelIs(i, 75 >> 3, 0, 130 >> 3);  // Remaining: 1/8
+      }
+    }
+    EXPECT_EQ(wrong, 0);
+  }
+
+  // More layers than pixels: each pixel is a bucket of layers
+  setupLayers(60, 1);
+  printer_state.current_layer = 501;
+  printer_state.total_layers = 1000;
+  showLayerProgress();
+  EXPECT_TRUE(pixelIs(29, 75, 0, 130));
+  EXPECT_TRUE(!pixelIs(30, 75, 0, 130) && !pixelIs(30, 9, 0, 16));
+  EXPECT_TRUE(pixelIs(31, 9, 0, 16));
+
+  // Out-of-range layers clamp to the ends
+  printer_state.current_layer = 5000;
+  showLayerProgress();
+  EXPECT_TRUE(pixelIs(58, 75, 0, 130));
+  printer_state.current_layer = 0;
+  showLayerProgress();
+  EXPECT_TRUE(pixelIs(1, 9, 0, 16));
+  setAnimationClock(nullptr);
+}
+
+TEST(incremental_repaint_matches_full_repaint) {
+  const int leds = 97;  // Not a multiple of any layer count below
+  int mismatches = 0;
+  for (int total : {7, 97, 300}) {
+    setupLayers(leds, 1);
+    printer_state.total_layers = total;
+    std::vector<int> order;
+    for (int layer = 1; layer <= total; layer++) order.push_back(layer);
+    order.push_back(2);  // A restart jumps backwards
+
+    for (int layer : order) {
+      printer_state.current_layer = layer;
+      showLayerProgress();
+      std::vector<uint8_t> incremental(strip.getPixels(), strip.getPixels() + leds * 3);
+
+      // A direction flip there and back forces two full repaints
+      settings.printing_direction = -1;
+      showLayerProgress();
+      settings.printing_direction = 1;
+      showLayerProgress();
+      mismatches += memcmp(incremental.data(), strip.getPixels(), leds * 3) != 0;
+    }
+  }
+  EXPECT_EQ(mismatches, 0);
+  setAnimationClock(nullptr);
+}
+
+TEST(layer_frame_cost) {
+  const int leds = 1000;
+  const int frames = 2000;
+  setupLayers(leds, 1);
+  printer_state.total_layers = 500;
+  printer_state.current_layer = 200;
+  printer_state.progress = 40;
+  showLayerProgress();
+
+  double start = benchNow();
+  for (int frame = 0; frame < frames; frame++) {
+    layer_clock_ms += 20;
+    showLayerProgress();
+  }
+  double steady = (benchNow() - start) / frames;
+
+  start = benchNow();
+  for (int frame = 0; frame < frames; frame++) {
+    layer_clock_ms += 20;
+    printer_state.current_layer = 1 + frame % 500;
+    showLayerProgress();
+  }
+  double changing = (benchNow() - start) / frames;
+
+  start = benchNow();
+  for (int frame = 0; frame < frames; frame++) {
+    layer_clock_ms += 20;
+    settings.printing_direction = (frame & 1) ? 1 : -1;
+    showLayerProgress();
+  }
+  double full = (benchNow() - start) / frames;
+
+  settings.printing_direction = 1;
+  showPrintingProgress();
+  start = benchNow();
+  for (int frame = 0; frame < frames; frame++) {
+    layer_clock_ms += 20;
+    showPrintingProgress();
+  }
+  double bar = (benchNow() - start) / frames;
+
+  BENCH("layers 1000 LEDs: steady %.2f, new layer %.2f, full repaint %.2f ns/pixel; progress bar %.2f ns/pixel",
+        steady * 1e9 / leds, changing * 1e9 / leds, full * 1e9 / leds, bar * 1e9 / leds);
+  setAnimationClock(nullptr);
+}
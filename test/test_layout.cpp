@@ -0,0 +1,173 @@
+// Layout tables: serpentine matrices, reversed rings and custom maps gather
+// the canvas into the right wiring order with the right coordinates, the
+// JSON map scanner, and what the remap costs at 2000 LEDs.
+#include "TestHarness.h"
+#include "../src/config/Settings.h"
+#include "../src/led/LEDLayout.h"
+#include <string>
+
+// Canvas pixel i is (i, i >> 8, 0) so the wiring order can be read back
+static std::vector<int> wiringOrder(int count) {
+  std::vector<uint8_t> canvas(count * 3), wire(count * 3);
+  for (int i = 0; i < count; i++) {
+    canvas[i * 3] = i & 255;
+    canvas[i * 3 + 1] = i >> 8;
+  }
+  layoutRemap(wire.data(), canvas.data(), count);
+  std::vector<int> order(count);
+  for (int i = 0; i < count; i++) order[i] = wire[i * 3] | (wire[i * 3 + 1] << 8);
+  return order;
+}
+
+static void useLayout(const LayoutSettings& layout, int count) {
+  settings = LEDSettings();
+  settings.led_count = count;
+  settings.layout = layout;
+  layoutBegin(count);
+}
+
+TEST(serpentine_matrix_reverses_odd_rows) {
+  LayoutSettings layout;
+  layout.type = LAYOUT_MATRIX;
+  layout.width = 4;
+  layout.height = 3;
+  layout.serpentine = true;
+  useLayout(layout, 12);
+  EXPECT_TRUE(!layoutIsIdentity());
+  std::vector<int> expected = {0, 1, 2, 3, 7, 6, 5, 4, 8, 9, 10, 11};
+  EXPECT_TRUE(wiringOrder(12) == expected);
+
+  // Corners in layout space
+  const LayoutCoord* coords = layoutCoords();
+  EXPECT_TRUE(coords[0].x == 0 && coords[0].y == 0);
+  EXPECT_TRUE(coords[3].x == 255 && coords[3].y == 0);
+  EXPECT_TRUE(coords[11].x == 255 && coords[11].y == 255);
+  EXPECT_EQ(coords[0].radius, 255);
+
+  // LEDs past the matrix pass straight through
+  useLayout(layout, 14);
+  expected.push_back(12);
+  expected.push_back(13);
+  EXPECT_TRUE(wiringOrder(14) == expected);
+
+  // Progressive wiring needs no gather at all
+  layout.serpentine = false;
+  useLayout(layout, 12);
+  EXPECT_TRUE(layoutIsIdentity());
+}
+
+TEST(reversed_rings_keep_pixel_zero_at_the_top) {
+  LayoutSettings layout;
+  layout.type = LAYOUT_RING;
+  layout.ring_count = 2;
+  layout.ring_sizes[0] = 12;
+  layout.ring_sizes[1] = 8;
+  layout.reverse = false;
+  useLayout(layout, 20);
+  EXPECT_TRUE(layoutIsIdentity());
+
+  const LayoutCoord* coords = layoutCoords();
+  EXPECT_TRUE(coords[0].angle == 0 && coords[0].y == 0);             // Top of the outer ring
+  EXPECT_TRUE(coords[3].angle == 64 && coords[3].x == 255);          // A quarter turn clockwise
+  EXPECT_TRUE(coords[12].angle == 0 && coords[12].radius == 128);    // Inner ring at half radius
+  EXPECT_NEAR(coords[12].y, 64, 1);
+
+  layout.reverse = true;
+  useLayout(layout, 20);
+  std::vector<int> expected = {0, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 12, 19, 18, 17, 16, 15, 14, 13};
+  EXPECT_TRUE(wiringOrder(20) == expected);
+}
+
+TEST(custom_map_sets_coordinates) {
+  const uint8_t xy[] = {0, 0, 255, 0, 255, 255, 0, 255, 128, 128};
+  EXPECT_TRUE(setLayoutMap(xy, 5));
+  LayoutSettings layout;
+  layout.type = LAYOUT_CUSTOM;
+  useLayout(layout, 7);
+
+  const LayoutCoord* coords = layoutCoords();
+  EXPECT_TRUE(coords[1].x == 255 && coords[1].y == 0);
+  EXPECT_EQ(coords[1].angle, 32);                        // Top right corner: 1/8 turn
+  EXPECT_TRUE(coords[4].radius <= 1);                    // Center (127.5 is between pixels)
+  EXPECT_TRUE(coords[5].y == 0 && coords[6].x == 255);   // Past the map: a line
+  EXPECT_TRUE(layoutIsIdentity());                       // Wired in canvas order
+  setLayoutMap(nullptr, 0);
+}
+
+static LayoutMapParse parseMap(const std::string& json, std::vector<uint8_t>& xy, int maxCount = MAX_LED_COUNT) {
+  xy.assign(maxCount * 2, 0xEE);
+  int count = 0;
+  LayoutMapParse result = parseLayoutMapJson(json.data(), json.size(), xy.data(), maxCount, count);
+  xy.resize(count * 2);
+  return result;
+}
+
+TEST(map_json_is_scanned_without_a_document) {
+  std::vector<uint8_t> xy;
+  EXPECT_EQ(parseMap("{\"type\":3,\"map\":[[1,2],[3,4]]}", xy), LAYOUT_MAP_PARSED);
+  EXPECT_TRUE(xy == std::vector<uint8_t>({1, 2, 3, 4}));
+  EXPECT_EQ(parseMap(" { \"map\" : [ [ 10 , 20 ] ,\n[300,-5], [7.9, 1e2] ] , \"type\": 3 } ", xy), LAYOUT_MAP_PARSED);
+  EXPECT_TRUE(xy == std::vector<uint8_t>({10, 20, 255, 0, 7, 1}));
+  EXPECT_EQ(parseMap("{\"map\":[]}", xy), LAYOUT_MAP_PARSED);
+  EXPECT_EQ(xy.size(), 0);
+
+  // Only a top-level key counts
+  EXPECT_EQ(parseMap("{\"type\":3}", xy), LAYOUT_MAP_ABSENT);
+  EXPECT_EQ(parseMap("{\"name\":\"map\",\"x\":{\"map\":[[1,2]]}}", xy), LAYOUT_MAP_ABSENT);
+  EXPECT_EQ(parseMap("{\"a\\\"map\":1,\"map\":[[5,6]]}", xy), LAYOUT_MAP_PARSED);
+  EXPECT_TRUE(xy == std::vector<uint8_t>({5, 6}));
+
+  for (const char* bad : {"{\"map\":5}", "{\"map\":[[1]]}", "{\"map\":[[1,2,3]]}", "{\"map\":[[1,2],]}",
+                          "{\"map\":[[1,2]", "{\"map\":[[\"1\",2]]}", "{\"map\":[1,2]}"}) {
+    EXPECT_EQ(parseMap(bad, xy), LAYOUT_MAP_INVALID);
+  }
+  EXPECT_EQ(parseMap("{\"map\":[[1,2],[3,4],[5,6]]}", xy, 2), LAYOUT_MAP_TOO_LARGE);
+
+  // A full-size map: ~20 KB of text into 4 KB of pairs
+  std::string json = "{\"type\":3,\"map\":[";
+  for (int i = 0; i < MAX_LED_COUNT; i++) {
+    json += (i ? ",[" : "[") + std::to_string(i % 256) + "," + std::to_string(i / 8) + "]";
+  }
+  json += "]}";
+  double start = benchNow();
+  EXPECT_EQ(parseMap(json, xy), LAYOUT_MAP_PARSED);
+  double elapsed = benchNow() - start;
+  EXPECT_EQ(xy.size(), MAX_LED_COUNT * 2);
+  EXPECT_TRUE(xy[1999 * 2] == 1999 % 256 && xy[1999 * 2 + 1] == 249);
+  json += " ";
+  EXPECT_EQ(parseMap(json + "{", xy), LAYOUT_MAP_PARSED);  // Trailing text past the map is not its concern
+  BENCH("%d-LED map: %zu bytes of JSON scanned in %.0f us", MAX_LED_COUNT, json.size(), elapsed * 1e6);
+}
+
+TEST(remap_cost) {
+  const int count = MAX_LED_COUNT;
+  const int frames = 2000;
+  std::vector<uint8_t> canvas(count * 3, 7), wire(count * 3);
+  volatile uint8_t sink = 0;
+
+  auto measure = [&](const LayoutSettings& layout) {
+    useLayout(layout, count);
+    double start = benchNow();
+    for (int frame = 0; frame < frames; frame++) {
+      layoutRemap(wire.data(), canvas.data(), count);
+      sink = sink + wire[frame % count];
+    }
+    return (benchNow() - start) * 1e9 / ((double)frames * count);
+  };
+
+  LayoutSettings linear;
+  LayoutSettings matrix;
+  matrix.type = LAYOUT_MATRIX;
+  matrix.width = 40;
+  matrix.height = 50;
+  LayoutSettings rings;
+  rings.type = LAYOUT_RING;
+  rings.ring_count = 4;
+  for (int i = 0; i < 4; i++) rings.ring_sizes[i] = 500;
+  rings.reverse = true;
+
+  double identity = measure(linear);
+  double serpentine = measure(matrix);
+  double ring = measure(rings);
+  BENCH("remap %d LEDs: identity %.2f, serpentine %.2f, reversed rings %.2f ns/pixel", count, identity, serpentine, ring);
+}
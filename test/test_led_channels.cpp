@@ -0,0 +1,102 @@
+// Channel changes at run time: drivers that are no longer selected must
+// release their RMT channel and pin, whether the channel count shrinks or
+// a custom driver replaces the default.
+#include "TestHarness.h"
+#include "host/FakeLEDDriver.h"
+#include "../src/led/LEDOutput.h"
+#include <driver/gpio.h>
+#include <driver/rmt.h>
+
+static const int CHANNEL_PINS[MAX_LED_CHANNELS] = {16, 17, 18, 19};
+
+static void configureChannels(int channelCount, LEDChannelSettings* channels) {
+  for (int i = 0; i < channelCount; i++) {
+    channels[i].pin = CHANNEL_PINS[i];
+    channels[i].count = 30;
+    channels[i].offset = i * 30;
+  }
+}
+
+static void applyChannels(int channelCount) {
+  LEDChannelSettings channels[MAX_LED_CHANNELS];
+  configureChannels(channelCount, channels);
+  ledOutputReinitialize(channels, channelCount, channelCount * 30);
+}
+
+static int installedRMTChannels() {
+  int installed = 0;
+  for (int i = 0; i < MAX_LED_CHANNELS; i++) {
+    if (hostRMTChannel(i).installed) installed++;
+  }
+  return installed;
+}
+
+TEST(parallel_channels_use_rmt) {
+  applyChannels(4);
+  EXPECT_EQ(getLEDChannelCount(), 4);
+  EXPECT_EQ(installedRMTChannels(), 4);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(hostRMTChannel(i).gpio, CHANNEL_PINS[i]);
+    EXPECT_TRUE(strcmp(getLEDChannelDriver(i)->name(), "rmt") == 0);
+  }
+}
+
+TEST(back_to_one_channel_releases_every_rmt_channel) {
+  applyChannels(4);
+  int resets[MAX_LED_CHANNELS];
+  for (int i = 0; i < MAX_LED_CHANNELS; i++) resets[i] = hostResetPinCount(CHANNEL_PINS[i]);
+
+  applyChannels(1);
+  EXPECT_EQ(getLEDChannelCount(), 1);
+  EXPECT_TRUE(strcmp(getLEDChannelDriver(0)->name(), "neopixel") == 0);
+  EXPECT_EQ(installedRMTChannels(), 0);
+  for (int i = 0; i < MAX_LED_CHANNELS; i++) {
+    EXPECT_EQ(hostResetPinCount(CHANNEL_PINS[i]), resets[i] + 1);
+  }
+}
+
+TEST(fewer_channels_release_the_dropped_ones) {
+  applyChannels(4);
+  applyChannels(2);
+  EXPECT_TRUE(hostRMTChannel(0).installed);
+  EXPECT_TRUE(hostRMTChannel(1).installed);
+  EXPECT_TRUE(!hostRMTChannel(2).installed);
+  EXPECT_TRUE(!hostRMTChannel(3).installed);
+
+  // And they come back when the count grows again
+  applyChannels(3);
+  EXPECT_EQ(installedRMTChannels(), 3);
+}
+
+TEST(custom_driver_ends_when_its_channel_goes_away) {
+  FakeLEDDriver fake;
+  applyChannels(3);
+  setLEDChannelDriver(2, &fake);
+  EXPECT_TRUE(fake.active);
+  EXPECT_TRUE(!hostRMTChannel(2).installed);  // Replaced RMT driver was released
+
+  applyChannels(2);
+  EXPECT_EQ(fake.ends, 1);
+  EXPECT_TRUE(!fake.active);
+
+  // Back in range it starts again; clearing it restores the RMT default
+  applyChannels(3);
+  EXPECT_TRUE(fake.active);
+  setLEDChannelDriver(2, nullptr);
+  EXPECT_EQ(fake.ends, 2);
+  EXPECT_TRUE(hostRMTChannel(2).installed);
+}
+
+TEST(reselected_driver_is_restarted_not_ended) {
+  FakeLEDDriver fake;
+  applyChannels(2);
+  setLEDChannelDriver(0, &fake);
+  int begins = fake.begins;
+
+  applyChannels(2);
+  EXPECT_EQ(fake.ends, 0);
+  EXPECT_EQ(fake.begins, begins + 1);
+  setLEDChannelDriver(0, nullptr);
+}
+
+TEST_MAIN()
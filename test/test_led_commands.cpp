@@ -0,0 +1,176 @@
+// LED command bus under concurrency: several producers submit batches while
+// a stand-in LED task applies them between frames. A frame never sees half
+// a batch, a batch reported as applied really was, and a batch the LED task
+// did not get to in time is withdrawn rather than applied later.
+#include "TestHarness.h"
+#include "../src/config/Settings.h"
+#include "../src/led/LEDCommands.h"
+#include "../src/printer/PrinterState.h"
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+typedef std::remove_reference<decltype(settings.colors[0])>::type LEDColor;
+
+static const int PRODUCERS = 4;
+
+static std::atomic<bool> led_task_paused(false);
+static std::atomic<uint32_t> led_frames(0);
+static std::atomic<uint32_t> torn_frames(0);
+
+// Producer k writes colors[k] and colors[k + 4] in one batch, so the pair
+// differs only if a frame saw part of a batch
+static void checkFrame() {
+  for (int k = 0; k < PRODUCERS; k++) {
+    const LEDColor& a = settings.colors[k];
+    const LEDColor& b = settings.colors[k + PRODUCERS];
+    if (a.r != b.r || a.g != b.g || a.b != b.b) torn_frames++;
+  }
+}
+
+// Applies commands at the start of each frame with the state mutex held,
+// like LEDTaskCode; the frame itself is a 2 ms render
+static void LEDTaskCode(void* parameters) {
+  for (;;) {
+    if (!led_task_paused) {
+      xSemaphoreTake(printerStateMutex, portMAX_DELAY);
+      applyLEDCommands();
+      checkFrame();
+      xSemaphoreGive(printerStateMutex);
+      led_frames++;
+    }
+    vTaskDelay(2);
+  }
+}
+
+static void startLEDTask() {
+  static bool started = false;
+  if (started) return;
+  started = true;
+
+  for (int i = 0; i < 8; i++) settings.colors[i] = {0, 0, 0};
+  ledCommandsBegin();
+  xTaskCreatePinnedToCore(LEDTaskCode, "LEDTask", 4096, NULL, 2, NULL, 1);
+}
+
+static bool waitFrames(uint32_t frames) {
+  uint32_t target = led_frames + frames;
+  unsigned long start = millis();
+  while (led_frames < target) {
+    if (millis() - start > 1000) return false;
+    delay(1);
+  }
+  return true;
+}
+
+static LEDColor readColor(int index) {
+  xSemaphoreTake(printerStateMutex, portMAX_DELAY);
+  LEDColor color = settings.colors[index];
+  xSemaphoreGive(printerStateMutex);
+  return color;
+}
+
+static bool submitPair(int producer, uint8_t value) {
+  LEDCommandBatch batch;
+  batch.addColor(producer, value, value / 2, 255 - value);
+  batch.add(LED_CMD_BRIGHTNESS, 1 + value % 255);
+  batch.addColor(producer + PRODUCERS, value, value / 2, 255 - value);
+  return submitLEDCommands(batch);
+}
+
+TEST(concurrent_batches_apply_whole) {
+  startLEDTask();
+  const int batches = 300;
+  std::atomic<int> not_applied(0);
+  uint32_t appliedBefore = led_command_stats.batches_applied;
+
+  std::vector<std::thread> producers;
+  for (int k = 0; k < PRODUCERS; k++) {
+    producers.emplace_back([k, &not_applied]() {
+      for (int i = 1; i <= batches; i++) {
+        uint8_t value = (uint8_t)(i * 7 + k);
+        if (!submitPair(k, value)) {
+          not_applied++;
+          continue;
+        }
+        // Only this producer writes colors[k]: once submit returns, the
+        // LED task has applied it
+        LEDColor color = readColor(k);
+        if (color.r != value || color.g != value / 2 || color.b != 255 - value) not_applied++;
+      }
+    });
+  }
+  for (std::thread& producer : producers) producer.join();
+
+  EXPECT_EQ(not_applied.load(), 0);
+  EXPECT_EQ(torn_frames.load(), 0);
+  EXPECT_EQ(led_command_stats.batches_applied - appliedBefore, PRODUCERS * batches);
+  BENCH("%d producers x %d batches: %u frames, at most %u commands in one frame",
+        PRODUCERS, batches, led_frames.load(), led_command_stats.max_commands_per_frame);
+}
+
+TEST(batch_not_applied_in_time_is_withdrawn) {
+  startLEDTask();
+  waitFrames(2);
+  LEDColor before = readColor(0);
+  uint32_t timeouts = led_command_stats.apply_timeouts;
+
+  // A stalled LED task: submit must report failure, not a change it never made
+  led_task_paused = true;
+  delay(10);
+  unsigned long start = millis();
+  bool accepted = submitPair(0, 77);
+  unsigned long waited = millis() - start;
+  EXPECT_TRUE(!accepted);
+  EXPECT_TRUE(waited >= LED_COMMAND_APPLY_TIMEOUT_MS);
+  EXPECT_EQ(led_command_stats.apply_timeouts, timeouts + 1);
+
+  // Once the task runs again the withdrawn batch must not show up
+  led_task_paused = false;
+  EXPECT_TRUE(waitFrames(5));
+  LEDColor after = readColor(0);
+  EXPECT_EQ(after.r, before.r);
+  EXPECT_EQ(readColor(PRODUCERS).r, before.r);
+  EXPECT_TRUE(submitPair(0, 78));
+  EXPECT_EQ(readColor(0).r, 78);
+}
+
+TEST(withdrawal_keeps_other_batches) {
+  startLEDTask();
+  waitFrames(2);
+
+  // Producer 1 submits while the task stalls and gives up; producer 2
+  // submits just before the task resumes and must still be applied
+  led_task_paused = true;
+  delay(10);
+  std::atomic<bool> first(true);
+  std::thread stalled([&first]() { first = submitPair(1, 91); });
+  delay(LED_COMMAND_APPLY_TIMEOUT_MS - 100);
+  std::thread resumed([]() { EXPECT_TRUE(submitPair(2, 92)); });
+  delay(150);
+  stalled.join();
+  led_task_paused = false;
+  resumed.join();
+
+  EXPECT_TRUE(!first);
+  EXPECT_TRUE(readColor(1).r != 91);
+  EXPECT_EQ(readColor(2).r, 92);
+  EXPECT_EQ(readColor(2 + PRODUCERS).r, 92);
+  EXPECT_EQ(torn_frames.load(), 0);
+}
+
+TEST(effect_slot_assignment_goes_through_the_bus) {
+  startLEDTask();
+  LEDCommandBatch batch;
+  batch.add(LED_CMD_EFFECT_SLOT, 3, 5);
+  batch.add(LED_CMD_EFFECT_SLOT, -7, 6);
+  EXPECT_TRUE(submitLEDCommands(batch));
+
+  xSemaphoreTake(printerStateMutex, portMAX_DELAY);
+  EXPECT_EQ(settings.effect_slots[5], 3);
+  EXPECT_EQ(settings.effect_slots[6], -1);
+  xSemaphoreGive(printerStateMutex);
+}
+
+TEST_MAIN()
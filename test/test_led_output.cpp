@@ -0,0 +1,124 @@
+// Double-buffered output: frames must reach the driver intact while the LED
+// task renders the next one, and frames presented faster than the strip
+// can take them are coalesced so only the newest is sent.
+#include "TestHarness.h"
+#include "host/FakeLEDDriver.h"
+#include "../src/led/LEDAnimations.h"
+#include "../src/led/LEDOutput.h"
+
+static const int STRIP_LEDS = 300;  // 9 ms on the wire
+static FakeLEDDriver driver;
+
+static void startOutput() {
+  static bool started = false;
+  if (started) return;
+  started = true;
+
+  settings.led_count = STRIP_LEDS;
+  settings.led_channel_count = 1;
+  syncLEDChannels();
+  strip.updateLength(STRIP_LEDS);
+  setLEDChannelDriver(0, &driver);
+  ledOutputBegin(settings.led_channels, 1, STRIP_LEDS);
+}
+
+// Every byte of frame `tag` is (index + tag), so a frame mixing two tags is a tear
+static void renderCanvas(uint8_t tag) {
+  uint8_t* pixels = strip.getPixels();
+  for (int i = 0; i < STRIP_LEDS * 3; i++) pixels[i] = (uint8_t)(i + tag);
+}
+
+static int frameTag(const std::vector<uint8_t>& frame) {
+  for (size_t i = 1; i < frame.size(); i++) {
+    if ((uint8_t)(frame[i] - i) != (uint8_t)(frame[0])) return -1;
+  }
+  return frame[0];
+}
+
+static bool waitIdle(unsigned long timeoutMs = 1000) {
+  unsigned long start = millis();
+  while (ledOutputBusy()) {
+    if (millis() - start > timeoutMs) return false;
+    delay(1);
+  }
+  return true;
+}
+
+TEST(frames_reach_the_driver_intact) {
+  startOutput();
+  waitIdle();
+  size_t before = driver.transmittedFrames().size();
+
+  // Render faster than the strip refreshes, with uneven spacing
+  for (int frame = 0; frame < 60; frame++) {
+    renderCanvas(frame);
+    presentFrame();
+    delayMicroseconds((frame % 4) * 3000);
+  }
+  EXPECT_TRUE(waitIdle());
+
+  std::vector<std::vector<uint8_t>> frames = driver.transmittedFrames();
+  EXPECT_EQ(driver.tears, 0);
+  EXPECT_TRUE(frames.size() > before);
+  int previousTag = -1;
+  for (size_t i = before; i < frames.size(); i++) {
+    int tag = frameTag(frames[i]);
+    EXPECT_TRUE(tag >= 0);
+    EXPECT_TRUE(tag > previousTag);  // Never out of order or repeated
+    previousTag = tag;
+  }
+  EXPECT_EQ(previousTag, 59);
+}
+
+TEST(frames_presented_while_pending_are_coalesced) {
+  startOutput();
+  waitIdle();
+  uint32_t presented = led_output_stats.frames_presented;
+  uint32_t transmitted = led_output_stats.frames_transmitted;
+  uint32_t coalesced = led_output_stats.frames_coalesced;
+
+  // First frame goes on the wire; the rest pile up behind it
+  for (int frame = 100; frame < 105; frame++) {
+    renderCanvas(frame);
+    presentFrame();
+  }
+  EXPECT_TRUE(waitIdle());
+
+  uint32_t newPresented = led_output_stats.frames_presented - presented;
+  uint32_t newTransmitted = led_output_stats.frames_transmitted - transmitted;
+  uint32_t newCoalesced = led_output_stats.frames_coalesced - coalesced;
+  EXPECT_EQ(newPresented, 5);
+  EXPECT_TRUE(newCoalesced >= 3);
+  EXPECT_EQ(newTransmitted + newCoalesced, newPresented);
+  EXPECT_EQ(frameTag(driver.transmittedFrames().back()), 104);
+}
+
+TEST(busy_until_the_pending_frame_is_sent) {
+  startOutput();
+  EXPECT_TRUE(waitIdle());
+  EXPECT_TRUE(!ledOutputBusy());
+
+  renderCanvas(7);
+  presentFrame();
+  EXPECT_TRUE(ledOutputBusy());
+  EXPECT_TRUE(waitIdle());
+  EXPECT_EQ(frameTag(driver.transmittedFrames().back()), 7);
+}
+
+TEST(present_does_not_wait_for_the_wire) {
+  startOutput();
+  waitIdle();
+
+  // Handing off a frame costs a copy, not a 9 ms transmission
+  unsigned long worst = 0;
+  for (int frame = 0; frame < 20; frame++) {
+    renderCanvas(frame);
+    presentFrame();
+    worst = max(worst, led_output_stats.last_present_us);
+  }
+  waitIdle();
+  EXPECT_TRUE(worst < 9000);
+  BENCH("present %lu us worst, transmit %lu us", worst, led_output_stats.last_transmit_us);
+}
+
+TEST_MAIN()
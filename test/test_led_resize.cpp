@@ -0,0 +1,189 @@
+// Live strip reconfiguration under a running render loop: one thread
+// renders and presents frames like the LED task while another resizes the
+// strip, switches channels and layouts, growing and shrinking. Built with
+// AddressSanitizer, so a frame that writes past a buffer sized for another
+// length aborts the test. Reports how long each reconfiguration took.
+#include "TestHarness.h"
+#include "host/FakeLEDDriver.h"
+#include "../src/led/LEDAnimations.h"
+#include "../src/led/LEDLayout.h"
+#include "../src/led/LEDOutput.h"
+#include "../src/led/LEDTransition.h"
+#include "../src/printer/PrinterState.h"
+#include <atomic>
+#include <thread>
+
+static FakeLEDDriver driver(1);
+
+static std::atomic<bool> led_task_running(false);
+static std::atomic<uint32_t> led_frames(0);
+static std::atomic<uint32_t> lights_animations(0);
+
+static unsigned long render_clock_ms = 0;
+static unsigned long renderClock() { return render_clock_ms; }
+
+// Every status with its own effect, the lights animation in between
+static const char* STATUSES[] = {
+  "heating", "cooling", "printing", "downloading", "paused", "error", "finished", "idle", "unknown",
+};
+static const int STATUS_COUNT = sizeof(STATUSES) / sizeof(STATUSES[0]);
+
+// One LED task frame. The animation clock moves 50 ms a frame so every
+// frame renders, and the status changes every few frames so transitions
+// run across resizes.
+static void renderFrame(uint32_t frame) {
+  xSemaphoreTake(printerStateMutex, portMAX_DELAY);
+  render_clock_ms += ANIMATION_INTERVAL;
+
+  if (frame % 6 == 0) {
+    const char* status = STATUSES[(frame / 6) % STATUS_COUNT];
+    printer_state.is_connected = strcmp(status, "unknown") != 0;
+    printer_state.status = status;
+    printer_state.progress = frame % 101;
+    printer_state.download_progress = frame % 101;
+    printer_status_version++;
+  }
+
+  // Lights off and on again from a captured frame
+  if (frame % 50 == 0 && !lights_turning_on && !lights_turning_off) {
+    captureCurrentFrame();
+    settings.lights_off_override = true;
+    lights_turning_on = true;
+    lights_animation_start = animationMillis();
+    lights_animations++;
+  }
+
+  updateLEDDisplay();
+  xSemaphoreGive(printerStateMutex);
+}
+
+static void LEDTaskCode(void* parameters) {
+  for (uint32_t frame = 0; ; frame++) {
+    if (led_task_running) {
+      renderFrame(frame);
+      led_frames++;
+    }
+    vTaskDelay(1);
+  }
+}
+
+static void startLEDTask() {
+  static bool started = false;
+  if (started) return;
+  started = true;
+
+  setAnimationClock(renderClock);
+  settings = LEDSettings();
+  settings.led_count = 60;
+  settings.transition_mode = TRANSITION_FADE;
+  settings.transition_ms = 200;
+  syncLEDChannels();
+  strip.updateLength(settings.led_count);
+  transitionBegin(settings.led_count);
+  layoutBegin(settings.led_count);
+  setLEDChannelDriver(0, &driver);
+  ledOutputBegin(settings.led_channels, settings.led_channel_count, settings.led_count);
+  xTaskCreatePinnedToCore(LEDTaskCode, "LEDTask", 10000, NULL, 2, NULL, 1);
+}
+
+static bool waitFrames(uint32_t frames) {
+  uint32_t target = led_frames + frames;
+  unsigned long start = millis();
+  while (led_frames < target) {
+    if (millis() - start > 2000) return false;
+    delay(1);
+  }
+  return true;
+}
+
+static LEDStripSettings singleStrip(int count) {
+  LEDStripSettings config = currentStripSettings();
+  config.led_channel_count = 1;
+  config.led_count = count;
+  config.layout = LayoutSettings();
+  return config;
+}
+
+static LEDStripSettings channelStrips(int channelCount, int perChannel) {
+  LEDStripSettings config = currentStripSettings();
+  config.led_channel_count = channelCount;
+  for (int i = 0; i < channelCount; i++) {
+    config.led_channels[i].pin = 16 + i;
+    config.led_channels[i].count = perChannel;
+    config.led_channels[i].offset = i * perChannel;
+  }
+  config.layout = LayoutSettings();
+  return config;
+}
+
+static LEDStripSettings matrixStrip(int width, int height) {
+  LEDStripSettings config = singleStrip(width * height);
+  config.layout.type = LAYOUT_MATRIX;
+  config.layout.width = width;
+  config.layout.height = height;
+  return config;
+}
+
+static LEDStripSettings ringStrip(int outer, int inner) {
+  LEDStripSettings config = singleStrip(outer + inner);
+  config.layout.type = LAYOUT_RING;
+  config.layout.ring_count = 2;
+  config.layout.ring_sizes[0] = outer;
+  config.layout.ring_sizes[1] = inner;
+  config.layout.reverse = true;
+  return config;
+}
+
+TEST(resize_under_a_running_render_loop) {
+  startLEDTask();
+  led_task_running = true;
+  EXPECT_TRUE(waitFrames(10));
+
+  const LEDStripSettings shapes[] = {
+    singleStrip(300), singleStrip(12), singleStrip(MAX_LED_COUNT), singleStrip(1),
+    matrixStrip(16, 16), singleStrip(90), ringStrip(24, 12), singleStrip(600),
+    channelStrips(3, 100), singleStrip(30), channelStrips(2, 400), matrixStrip(8, 4),
+  };
+  const int shapeCount = sizeof(shapes) / sizeof(shapes[0]);
+  const int rounds = 8;
+
+  unsigned long fastest = ~0UL, slowest = 0, total = 0;
+  int reconfigures = 0, mismatched = 0;
+  uint32_t lights = lights_animations;
+
+  // Resize from this thread while the LED task keeps rendering
+  std::thread resizer([&]() {
+    for (int round = 0; round < rounds; round++) {
+      for (int i = 0; i < shapeCount; i++) {
+        const LEDStripSettings& shape = shapes[(i * 5 + round) % shapeCount];
+        if (!reinitializeLEDStrip(shape)) mismatched++;
+
+        xSemaphoreTake(printerStateMutex, portMAX_DELAY);
+        int expected = shape.led_channel_count > 1
+          ? shape.led_channels[shape.led_channel_count - 1].offset + shape.led_channels[shape.led_channel_count - 1].count
+          : shape.led_count;
+        if (settings.led_count != expected || (int)strip.numPixels() != expected) mismatched++;
+        if (settings.layout.type != shape.layout.type) mismatched++;
+        xSemaphoreGive(printerStateMutex);
+
+        fastest = min(fastest, last_reconfigure_us);
+        slowest = max(slowest, last_reconfigure_us);
+        total += last_reconfigure_us;
+        reconfigures++;
+        waitFrames(3);
+      }
+    }
+  });
+  resizer.join();
+  EXPECT_TRUE(waitFrames(10));
+  led_task_running = false;
+
+  EXPECT_EQ(reconfigures, rounds * shapeCount);
+  EXPECT_EQ(mismatched, 0);
+  EXPECT_TRUE(lights_animations > lights);
+  EXPECT_EQ(driver.tears, 0);
+  BENCH("%d reconfigurations over %u frames: min %lu us, mean %lu us, max %lu us",
+        reconfigures, led_frames.load(), fastest, total / reconfigures, slowest);
+}
+
+TEST_MAIN()
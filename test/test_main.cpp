@@ -0,0 +1,4 @@
+// Entry point for the unit test binary; the cases register themselves
+#include "TestHarness.h"
+
+TEST_MAIN()
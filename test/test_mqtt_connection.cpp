@@ -0,0 +1,192 @@
+// MQTT connection pipeline against a stand-in broker on loopback: every
+// step from DNS to SUBACK runs without the service call waiting on the
+// broker, PUBLISH packets ahead of the SUBACK are read past, refusals fail
+// the right step, a lookup from an abandoned attempt does not answer the
+// next one, and what a connect costs in latency and in time on the task.
+#include "TestHarness.h"
+#include "TestBroker.h"
+#include "../src/network/MQTTConnection.h"
+#include <lwip/dns.h>
+#include <arpa/inet.h>
+
+static TestBroker& broker() {
+  static TestBroker* instance = new TestBroker();
+  return *instance;
+}
+
+static MQTTEndpoint test_endpoint;
+
+static bool configureTestEndpoint(MQTTEndpoint& endpoint) {
+  endpoint = test_endpoint;
+  return true;
+}
+
+static MQTTTransport transport(false);
+static PubSubClient client(transport);
+static MQTTConnection connection("test", &client, &transport, configureTestEndpoint);
+
+static std::vector<unsigned int> received_payloads;
+
+// Stop whatever the last case left running and point at the broker
+static void startWith(const BrokerScript& script, const char* host = "127.0.0.1") {
+  mqttConnectionStop(connection);
+  broker().setScript(script);
+  test_endpoint = MQTTEndpoint();
+  test_endpoint.host = host;
+  test_endpoint.port = broker().port();
+  test_endpoint.client_id = "mavenled-test";
+  test_endpoint.username = "bblp";
+  test_endpoint.password = "12345678";
+  test_endpoint.topic = "device/01P00A000000000/report";
+  received_payloads.clear();
+  client.setCallback([](char* topic, uint8_t* payload, unsigned int length) {
+    received_payloads.push_back(length);
+  });
+  mqttConnectionStart(connection);
+}
+
+// The network task loop: service every 5 ms, return the first event
+static MQTTConnectEvent nextEvent(unsigned long timeoutMs = 3000) {
+  unsigned long start = millis();
+  while (millis() - start < timeoutMs) {
+    MQTTConnectEvent event = mqttConnectionService(connection);
+    if (connection.step == MQTT_STEP_CONNECTED) client.loop();
+    if (event != MQTT_EVENT_NONE) return event;
+    delay(5);
+  }
+  return MQTT_EVENT_NONE;
+}
+
+// Keep the connected client reading for a while
+static void runConnected(unsigned long ms) {
+  unsigned long start = millis();
+  while (millis() - start < ms) {
+    mqttConnectionService(connection);
+    client.loop();
+    delay(5);
+  }
+}
+
+TEST(mqtt_connects_through_every_step) {
+  BrokerScript script;
+  script.reply_delay_ms = 40;
+  startWith(script);
+  uint32_t connects = connection.stats.connects;
+
+  EXPECT_EQ(nextEvent(), MQTT_EVENT_CONNECTED);
+  EXPECT_EQ(connection.step, MQTT_STEP_CONNECTED);
+  EXPECT_TRUE(client.connected());
+  EXPECT_EQ(connection.stats.connects, connects + 1);
+  EXPECT_TRUE(broker().client_id() == "mavenled-test");
+  EXPECT_TRUE(broker().username() == "bblp");
+  EXPECT_TRUE(broker().topic() == "device/01P00A000000000/report");
+
+  // Both broker replies were waited out by the pipeline, not inside a call
+  EXPECT_TRUE(connection.stats.step_ms[MQTT_STEP_CONNECT] >= 40);
+  EXPECT_TRUE(connection.stats.step_ms[MQTT_STEP_SUBSCRIBE] >= 40);
+  EXPECT_TRUE(connection.stats.last_connect_ms >= 80);
+  EXPECT_TRUE(connection.stats.max_service_us < 20000);
+}
+
+TEST(mqtt_publishes_ahead_of_suback_are_skipped) {
+  // One, two and three byte remaining lengths, then one message after
+  BrokerScript script;
+  script.publish_before_suback = {16, 300, 20000};
+  script.publish_after_suback = {50};
+  startWith(script);
+  uint32_t skipped = connection.stats.publishes_skipped;
+
+  EXPECT_EQ(nextEvent(), MQTT_EVENT_CONNECTED);
+  EXPECT_EQ(connection.stats.publishes_skipped, skipped + 3);
+
+  // The stream is still in step: the client reads the next message whole
+  runConnected(100);
+  EXPECT_EQ(received_payloads.size(), 1);
+  if (!received_payloads.empty()) EXPECT_EQ(received_payloads[0], 50);
+  EXPECT_TRUE(client.connected());
+}
+
+TEST(mqtt_refusals_fail_their_step) {
+  BrokerScript refuseConnect;
+  refuseConnect.connack_code = 5;  // Not authorised
+  startWith(refuseConnect);
+  EXPECT_EQ(nextEvent(), MQTT_EVENT_FAILED);
+  EXPECT_EQ(connection.stats.failed_step, MQTT_STEP_CONNECT);
+  EXPECT_TRUE(strcmp(connection.stats.last_error, "CONNECT refused") == 0);
+  EXPECT_EQ(connection.stats.error_code, 5);
+  EXPECT_EQ(connection.step, MQTT_STEP_BACKOFF);
+
+  BrokerScript refuseSubscribe;
+  refuseSubscribe.suback_code = 0x80;
+  startWith(refuseSubscribe);
+  EXPECT_EQ(nextEvent(), MQTT_EVENT_FAILED);
+  EXPECT_EQ(connection.stats.failed_step, MQTT_STEP_SUBSCRIBE);
+  EXPECT_TRUE(strcmp(connection.stats.last_error, "SUBSCRIBE refused") == 0);
+
+  BrokerScript wrongId;
+  wrongId.suback_packet_id = 7;
+  startWith(wrongId);
+  EXPECT_EQ(nextEvent(), MQTT_EVENT_FAILED);
+  EXPECT_EQ(connection.stats.failed_step, MQTT_STEP_SUBSCRIBE);
+  EXPECT_TRUE(strcmp(connection.stats.last_error, "bad SUBACK") == 0);
+}
+
+TEST(mqtt_stale_lookup_does_not_answer_the_next_attempt) {
+  // The first attempt's name resolves to an address nothing listens on,
+  // and answers while the second attempt's lookup is still in flight
+  hostDNSAnswer("old-broker.test", htonl(0x7F000002));
+  hostDNSAnswer("broker.test", htonl(INADDR_LOOPBACK));
+  hostDNSDelay(50);
+  startWith(BrokerScript(), "old-broker.test");
+  hostDNSDelay(250);
+  startWith(BrokerScript(), "broker.test");
+  uint32_t accepted = broker().accepted;
+
+  EXPECT_EQ(nextEvent(), MQTT_EVENT_CONNECTED);
+  EXPECT_TRUE(connection.stats.step_ms[MQTT_STEP_DNS] >= 200);
+  EXPECT_EQ(connection.stats.failures, 0);
+  EXPECT_EQ(broker().accepted, accepted + 1);
+  hostDNSDelay(0);
+}
+
+TEST(mqtt_dropped_connection_reconnects_at_once) {
+  startWith(BrokerScript());
+  EXPECT_EQ(nextEvent(), MQTT_EVENT_CONNECTED);
+  uint32_t disconnects = connection.stats.disconnects;
+
+  broker().dropClients();
+  EXPECT_EQ(nextEvent(), MQTT_EVENT_LOST);
+  EXPECT_EQ(connection.stats.disconnects, disconnects + 1);
+  unsigned long lost = millis();
+  EXPECT_EQ(nextEvent(), MQTT_EVENT_CONNECTED);
+  EXPECT_TRUE(millis() - lost < MQTT_BACKOFF_MIN_MS / 2);
+  EXPECT_EQ(connection.stats.failures, 0);
+}
+
+// Connect latency against the broker's reply delay, and the longest any
+// one service call held the network task. A blocking connect would hold
+// it for the whole connect.
+TEST(bench_mqtt_connect_latency_and_blocked_time) {
+  const unsigned long delays[] = {0, 20, 100};
+  const int connects = 10;
+
+  for (unsigned long replyDelay : delays) {
+    BrokerScript script;
+    script.reply_delay_ms = replyDelay;
+    unsigned long total = 0, worst = 0, blocked = 0;
+    for (int i = 0; i < connects; i++) {
+      startWith(script);
+      connection.stats.max_service_us = 0;
+      EXPECT_EQ(nextEvent(), MQTT_EVENT_CONNECTED);
+      total += connection.stats.last_connect_ms;
+      worst = max(worst, connection.stats.last_connect_ms);
+      blocked = max(blocked, connection.stats.max_service_us);
+    }
+    EXPECT_TRUE(blocked < 20000);
+    BENCH("broker delay %3lu ms: connect %3lu ms (worst %3lu ms), longest service call %lu us",
+          replyDelay, total / connects, worst, blocked);
+  }
+  mqttConnectionStop(connection);
+}
+
+TEST_MAIN()
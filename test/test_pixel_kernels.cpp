@@ -0,0 +1,146 @@
+// Word-at-a-time pixel kernels: identical to plain per-byte loops for every
+// length, alignment and weight, including in place, and their cost against
+// those loops and against per-pixel packed-color math at 1000 LEDs.
+#include "TestHarness.h"
+#include "../src/led/PixelKernels.h"
+#include <random>
+
+// The ESP32 has no SIMD, so keep the host from vectorizing the byte loops;
+// otherwise the benchmark compares SSE against SWAR instead of per-byte
+// against SWAR
+#if defined(__GNUC__) && !defined(__clang__)
+#define SCALAR_ONLY __attribute__((optimize("no-tree-vectorize")))
+#else
+#define SCALAR_ONLY
+#endif
+
+SCALAR_ONLY static void referenceLerp(uint8_t* dst, const uint8_t* from, const uint8_t* to, int length, uint16_t amount) {
+  for (int i = 0; i < length; i++) dst[i] = (from[i] * (256 - amount) + to[i] * amount) >> 8;
+}
+
+SCALAR_ONLY static void referenceScale(uint8_t* dst, const uint8_t* src, int length, uint16_t amount) {
+  for (int i = 0; i < length; i++) dst[i] = (src[i] * amount) >> 8;
+}
+
+SCALAR_ONLY static uint32_t referenceSum(const uint8_t* src, int length) {
+  uint32_t total = 0;
+  for (int i = 0; i < length; i++) total += src[i];
+  return total;
+}
+
+// How the effects blended before the kernels: one packed color at a time
+SCALAR_ONLY static void packedLerp(uint8_t* dst, const uint8_t* from, const uint8_t* to, int count, uint16_t amount) {
+  for (int i = 0; i < count; i++) {
+    uint32_t a = ((uint32_t)from[i * 3] << 16) | (from[i * 3 + 1] << 8) | from[i * 3 + 2];
+    uint32_t b = ((uint32_t)to[i * 3] << 16) | (to[i * 3 + 1] << 8) | to[i * 3 + 2];
+    uint8_t r = (((a >> 16) & 0xFF) * (256 - amount) + ((b >> 16) & 0xFF) * amount) >> 8;
+    uint8_t g = (((a >> 8) & 0xFF) * (256 - amount) + ((b >> 8) & 0xFF) * amount) >> 8;
+    uint8_t bl = ((a & 0xFF) * (256 - amount) + (b & 0xFF) * amount) >> 8;
+    dst[i * 3] = r;
+    dst[i * 3 + 1] = g;
+    dst[i * 3 + 2] = bl;
+  }
+}
+
+static std::mt19937 kernel_random(7);
+
+static void fillRandom(uint8_t* buffer, int length) {
+  for (int i = 0; i < length; i++) buffer[i] = kernel_random();
+}
+
+TEST(kernels_match_scalar_reference) {
+  static uint8_t from[256], to[256], expected[256], actual[256];
+  const uint16_t amounts[] = {0, 1, 127, 128, 129, 255, 256};
+  int mismatches = 0;
+
+  // Every length up to a few words, at every alignment
+  for (int offset = 0; offset < 4; offset++) {
+    for (int length = 0; length <= 40; length++) {
+      for (uint16_t amount : amounts) {
+        fillRandom(from, sizeof(from));
+        fillRandom(to, sizeof(to));
+        referenceLerp(expected, from + offset, to + offset, length, amount);
+        lerpBytes(actual, from + offset, to + offset, length, amount);
+        mismatches += memcmp(expected, actual, length) != 0;
+
+        referenceScale(expected, from + offset, length, amount);
+        scaleBytes(actual, from + offset, length, amount);
+        mismatches += memcmp(expected, actual, length) != 0;
+
+        // In place, as the transition and power limiter use them
+        referenceLerp(expected, from + offset, to + offset, length, amount);
+        lerpBytes(from + offset, from + offset, to + offset, length, amount);
+        mismatches += memcmp(expected, from + offset, length) != 0;
+      }
+      mismatches += sumBytes(to + offset, length) != referenceSum(to + offset, length);
+    }
+  }
+  EXPECT_EQ(mismatches, 0);
+
+  // Extremes: full white stays full at 256 and lanes never carry
+  memset(from, 255, sizeof(from));
+  memset(to, 0, sizeof(to));
+  lerpBytes(actual, to, from, sizeof(actual), 256);
+  EXPECT_EQ(referenceSum(actual, sizeof(actual)), 255 * 256);
+  scaleBytes(actual, from, sizeof(actual), 256);
+  EXPECT_EQ(referenceSum(actual, sizeof(actual)), 255 * 256);
+  scaleBytes(actual, from, sizeof(actual), 255);
+  EXPECT_EQ(actual[0], 254);
+  EXPECT_EQ(actual[255], 254);
+}
+
+TEST(sum_flushes_lanes_on_long_runs) {
+  // 2000 white LEDs: well past the 128 words a 16-bit lane can hold
+  static uint8_t white[2000 * 3 + 3];
+  memset(white, 255, sizeof(white));
+  for (int length : {511, 512, 513, 1024, 6000, 6003}) {
+    EXPECT_EQ(sumBytes(white, length), 255u * length);
+  }
+}
+
+TEST(fill_writes_every_pixel) {
+  static uint8_t rgb[1001 * 3];
+  for (int count : {0, 1, 2, 3, 7, 64, 1000}) {
+    memset(rgb, 0xAA, sizeof(rgb));
+    fillRGB(rgb, count, 0x123456);
+    int wrong = 0;
+    for (int i = 0; i < count; i++) {
+      wrong += rgb[i * 3] != 0x12 || rgb[i * 3 + 1] != 0x34 || rgb[i * 3 + 2] != 0x56;
+    }
+    EXPECT_EQ(wrong, 0);
+    EXPECT_EQ(rgb[count * 3], 0xAA);  // Nothing past the end
+  }
+}
+
+TEST(kernel_benchmark) {
+  const int count = 1000;
+  const int length = count * 3;
+  const int rounds = 20000;
+  static uint8_t from[length], to[length], dst[length];
+  fillRandom(from, length);
+  fillRandom(to, length);
+  volatile uint32_t sink = 0;
+
+  auto measure = [&](auto&& body) {
+    double start = benchNow();
+    for (int round = 0; round < rounds; round++) {
+      body((uint16_t)(round & 255));
+      sink = sink + dst[round % length];
+    }
+    return (benchNow() - start) * 1e9 / ((double)rounds * count);
+  };
+
+  double packed = measure([&](uint16_t amount) { packedLerp(dst, from, to, count, amount); });
+  double byteLerp = measure([&](uint16_t amount) { referenceLerp(dst, from, to, length, amount); });
+  double wordLerp = measure([&](uint16_t amount) { lerpBytes(dst, from, to, length, amount); });
+  double byteScale = measure([&](uint16_t amount) { referenceScale(dst, from, length, amount); });
+  double wordScale = measure([&](uint16_t amount) { scaleBytes(dst, from, length, amount); });
+  double byteSum = measure([&](uint16_t amount) { sink = sink + referenceSum(from, length); });
+  double wordSum = measure([&](uint16_t amount) { sink = sink + sumBytes(from, length); });
+  double fill = measure([&](uint16_t amount) { fillRGB(dst, count, 0x102030 + amount); });
+
+  BENCH("lerp  1000 LEDs: packed color %.2f, byte loop %.2f, kernel %.2f ns/pixel", packed, byteLerp, wordLerp);
+  BENCH("scale 1000 LEDs: byte loop %.2f, kernel %.2f ns/pixel", byteScale, wordScale);
+  BENCH("sum   1000 LEDs: byte loop %.2f, kernel %.2f ns/pixel", byteSum, wordSum);
+  BENCH("fill  1000 LEDs: kernel %.2f ns/pixel", fill);
+}
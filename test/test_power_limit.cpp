@@ -0,0 +1,149 @@
+// Power limiter: the per-frame current estimate against a per-LED model,
+// limited frames on the wire staying inside the budget, gradual release,
+// and what the estimate and limit add to presenting a frame.
+#include "TestHarness.h"
+#include "host/FakeLEDDriver.h"
+#include "../src/led/LEDAnimations.h"
+#include "../src/led/LEDOutput.h"
+#include "../src/led/PixelKernels.h"
+#include <random>
+
+static const int STRIP_LEDS = 1000;
+static FakeLEDDriver driver(1);
+
+static void startOutput() {
+  static bool started = false;
+  if (started) return;
+  started = true;
+
+  settings.led_count = STRIP_LEDS;
+  settings.led_channel_count = 1;
+  syncLEDChannels();
+  strip.updateLength(STRIP_LEDS);
+  setLEDChannelDriver(0, &driver);
+  ledOutputBegin(settings.led_channels, 1, STRIP_LEDS);
+}
+
+static bool waitIdle(unsigned long timeoutMs = 1000) {
+  unsigned long start = millis();
+  while (ledOutputBusy()) {
+    if (millis() - start > timeoutMs) return false;
+    delay(1);
+  }
+  return true;
+}
+
+// Per-LED model: 1 mA quiescent plus led_channel_ma per fully lit channel
+static double referenceMA(const uint8_t* rgb, int count) {
+  double total = 0;
+  for (int i = 0; i < count; i++) {
+    total += 1.0;
+    for (int c = 0; c < 3; c++) total += rgb[i * 3 + c] / 255.0 * settings.led_channel_ma;
+  }
+  return total;
+}
+
+static void presentAndWait() {
+  presentFrame();
+  waitIdle();
+}
+
+TEST(estimate_matches_per_led_model) {
+  startOutput();
+  settings.power_limit_ma = 0;
+  uint8_t* canvas = strip.getPixels();
+  std::mt19937 random(3);
+
+  for (int pattern = 0; pattern < 6; pattern++) {
+    for (int i = 0; i < STRIP_LEDS * 3; i++) {
+      switch (pattern) {
+        case 0: canvas[i] = 0; break;
+        case 1: canvas[i] = 255; break;
+        case 2: canvas[i] = (i % 3 == 0) ? 255 : 0; break;  // Solid red
+        case 3: canvas[i] = random(); break;
+        case 4: canvas[i] = random() & 7; break;            // Barely lit
+        default: canvas[i] = (i / 3) * 255 / STRIP_LEDS; break;
+      }
+    }
+    presentAndWait();
+    double expected = referenceMA(canvas, STRIP_LEDS);
+    EXPECT_NEAR(led_output_stats.estimated_ma, expected, 1.0);
+    EXPECT_EQ(led_output_stats.power_scale, 256);
+    EXPECT_TRUE(memcmp(driver.transmittedFrames().back().data(), canvas, STRIP_LEDS * 3) == 0);
+  }
+}
+
+TEST(limited_frames_stay_within_budget) {
+  startOutput();
+  uint8_t* canvas = strip.getPixels();
+  const int budget = 5000;
+
+  // Full white is 61 A at 1000 LEDs
+  settings.power_limit_ma = 0;
+  memset(canvas, 0, STRIP_LEDS * 3);
+  presentAndWait();
+  uint32_t events = led_output_stats.power_limit_events;
+
+  settings.power_limit_ma = budget;
+  memset(canvas, 255, STRIP_LEDS * 3);
+  for (int frame = 0; frame < 5; frame++) {
+    presentAndWait();
+    if (frame == 0) BENCH("white at %d mA budget: scale %u, %u mA estimated, %u mA sent",
+                          budget, led_output_stats.power_scale, led_output_stats.estimated_ma, led_output_stats.output_ma);
+    double sent = referenceMA(driver.transmittedFrames().back().data(), STRIP_LEDS);
+    EXPECT_TRUE(sent <= budget);
+    // Dimmed only as far as needed: each channel loses under one step to
+    // the truncating scale, which at scale 17 is 5% of this frame
+    EXPECT_TRUE(sent >= budget * 0.94);
+    EXPECT_NEAR(led_output_stats.output_ma, sent, 1.0);
+  }
+  EXPECT_EQ(led_output_stats.power_limit_events - events, 1);
+  EXPECT_TRUE(canvas[0] == 255);  // The canvas itself is never dimmed
+
+  // Back under budget the scale recovers over several frames, not at once
+  memset(canvas, 10, STRIP_LEDS * 3);
+  presentAndWait();
+  uint16_t first = led_output_stats.power_scale;
+  EXPECT_TRUE(first < 256);
+  int frames = 1;
+  while (led_output_stats.power_scale < 256 && frames < 200) {
+    presentAndWait();
+    frames++;
+  }
+  EXPECT_EQ(led_output_stats.power_scale, 256);
+  EXPECT_TRUE(frames > 5);
+  BENCH("limiter released from scale %u over %d frames", first, frames);
+  settings.power_limit_ma = 0;
+}
+
+TEST(power_limit_cost) {
+  startOutput();
+  uint8_t* canvas = strip.getPixels();
+  memset(canvas, 255, STRIP_LEDS * 3);
+  const int frames = 2000;
+
+  // Frames coalesce while the output task sends; only the hand-off is timed
+  auto measure = [&](int budget) {
+    settings.power_limit_ma = budget;
+    waitIdle();
+    double start = benchNow();
+    for (int frame = 0; frame < frames; frame++) presentFrame();
+    double elapsed = benchNow() - start;
+    waitIdle();
+    return elapsed * 1e9 / ((double)frames * STRIP_LEDS);
+  };
+  double off = measure(0);
+  double limited = measure(5000);
+  settings.power_limit_ma = 0;
+
+  // The estimate alone: one pass of sumBytes over the frame
+  volatile uint32_t sink = 0;
+  double start = benchNow();
+  for (int frame = 0; frame < frames; frame++) sink = sink + sumBytes(canvas, STRIP_LEDS * 3);
+  double estimate = (benchNow() - start) * 1e9 / ((double)frames * STRIP_LEDS);
+
+  BENCH("present 1000 LEDs: %.2f ns/pixel unlimited, %.2f ns/pixel limiting; estimate %.2f ns/pixel",
+        off, limited, estimate);
+}
+
+TEST_MAIN()
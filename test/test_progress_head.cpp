@@ -0,0 +1,50 @@
+// The moving progress head stays on the strip for the whole sweep in both
+// directions, including a full bar where the sweep covers every pixel.
+#include "TestHarness.h"
+#include "../src/config/Settings.h"
+#include "../src/led/LEDAnimations.h"
+#include "../src/led/LEDLayout.h"
+#include "../src/printer/PrinterState.h"
+
+static unsigned long head_clock_ms = 0;
+static unsigned long headClock() { return head_clock_ms; }
+
+// Milliseconds in the sweep where the head is missing. The printing color
+// has no green, so any green on the strip is the white head.
+static int headMissingMs(int direction, int progress) {
+  const int leds = 60;
+  setAnimationClock(headClock);
+  settings = LEDSettings();
+  settings.led_count = leds;
+  settings.printing_direction = direction;
+  strip.updateLength(leds);
+  layoutBegin(leds);
+  printer_state = PrinterState();
+  printer_state.progress = progress;
+  last_print_progress = 0;
+  printing_head_cycle_start = 0;
+
+  head_clock_ms = 3000000;
+  int litPixels = progress * leds / 100;
+  int headSpeed = constrain(80 - litPixels, 30, 80);
+  int missing = 0;
+  for (int t = 0; t < litPixels * headSpeed; t++) {
+    head_clock_ms = 3000000 + t;
+    showPrintingProgress();
+    bool lit = false;
+    for (int i = 0; i < leds; i++) lit |= (strip.getPixels()[i * 3 + 1] > 0);
+    if (!lit) missing++;
+  }
+  setAnimationClock(nullptr);
+  return missing;
+}
+
+TEST(progress_head_stays_on_the_strip) {
+  for (int direction : {1, -1}) {
+    for (int progress : {50, 100}) {
+      int missing = headMissingMs(direction, progress);
+      if (missing > 0) printf("  direction %d, %d%%: head missing for %d ms\n", direction, progress, missing);
+      EXPECT_EQ(missing, 0);
+    }
+  }
+}
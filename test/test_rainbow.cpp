@@ -0,0 +1,80 @@
+// Rainbow from the cached palette: identical to the per-pixel wheel()
+// rendering it replaced, for both directions and any brightness, and the
+// cost of each at 1000 LEDs.
+#include "TestHarness.h"
+#include "../src/led/LEDAnimations.h"
+#include "../src/config/Settings.h"
+
+// The per-pixel rendering renderRainbow() replaced
+static void referenceRainbow(uint8_t* rgb, int count, int offset) {
+  int direction = settings.rainbow_direction;
+  uint8_t brightness = settings.night_mode_enabled ? settings.night_mode_brightness : settings.global_brightness;
+  for (int i = 0; i < count; i++) {
+    int pos = (i * direction + offset * direction) & 255;
+    if (pos < 0) pos += 256;
+
+    uint32_t wheelColor = wheel(pos);
+    if (brightness != 255) {
+      uint8_t r = ((wheelColor >> 16) & 0xFF) * brightness / 255;
+      uint8_t g = ((wheelColor >> 8) & 0xFF) * brightness / 255;
+      uint8_t b = (wheelColor & 0xFF) * brightness / 255;
+      wheelColor = strip.Color(r, g, b);
+    }
+    rgb[i * 3] = wheelColor >> 16;
+    rgb[i * 3 + 1] = wheelColor >> 8;
+    rgb[i * 3 + 2] = wheelColor;
+  }
+}
+
+TEST(rainbow_matches_per_pixel_wheel) {
+  const int count = 1000;  // Several palette windows
+  static uint8_t expected[count * 3];
+  static uint8_t actual[count * 3];
+  const int brightnesses[] = {255, 128, 25, 1};
+
+  int mismatches = 0;
+  for (int direction : {1, -1}) {
+    settings.rainbow_direction = direction;
+    for (int brightness : brightnesses) {
+      settings.global_brightness = brightness;
+      for (int offset = 0; offset < 256; offset += 7) {
+        referenceRainbow(expected, count, offset);
+        renderRainbow(actual, count, offset);
+        if (memcmp(expected, actual, sizeof(actual)) != 0) mismatches++;
+      }
+    }
+  }
+  EXPECT_EQ(mismatches, 0);
+
+  // Night mode brightness takes over
+  settings.rainbow_direction = 1;
+  settings.global_brightness = 255;
+  settings.night_mode_enabled = true;
+  settings.night_mode_brightness = 25;
+  referenceRainbow(expected, count, 42);
+  renderRainbow(actual, count, 42);
+  EXPECT_TRUE(memcmp(expected, actual, sizeof(actual)) == 0);
+  settings.night_mode_enabled = false;
+}
+
+TEST(rainbow_benchmark) {
+  const int count = 1000;
+  static uint8_t rgb[count * 3];
+  const int frames = 2000;
+  settings.rainbow_direction = 1;
+  settings.global_brightness = 200;
+
+  double start = benchNow();
+  for (int frame = 0; frame < frames; frame++) referenceRainbow(rgb, count, frame);
+  double reference = (benchNow() - start) / frames;
+
+  start = benchNow();
+  for (int frame = 0; frame < frames; frame++) renderRainbow(rgb, count, frame);
+  double cached = (benchNow() - start) / frames;
+
+  // The rainbow steps every RAINBOW_INTERVAL (20 ms)
+  BENCH("rainbow 1000 LEDs: per-pixel %.1f ns/pixel, cached %.2f ns/pixel (%.0fx)",
+        reference * 1e9 / count, cached * 1e9 / count, reference / cached);
+  BENCH("rainbow 1000 LEDs: %.0f fps max, %.3f%% CPU at 50 fps (per-pixel: %.0f fps, %.2f%%)",
+        1 / cached, cached * 50 * 100, 1 / reference, reference * 50 * 100);
+}
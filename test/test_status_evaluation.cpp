@@ -0,0 +1,182 @@
+// Status evaluation on events: the finish, error and idle timers fire at
+// their deadline and not a tick before, the state machine does not run
+// while nothing changes, and what moving it off the LED task saves in
+// state mutex hold time per frame.
+#include "TestHarness.h"
+#include "../src/config/Settings.h"
+#include "../src/diagnostics/Profiler.h"
+#include "../src/led/LEDAnimations.h"
+#include "../src/printer/PrinterState.h"
+
+static const unsigned long STATE_TIMEOUT_MS = 120000;
+
+static uint32_t evaluations() {
+  return profileZoneHistogram(PROFILE_STATUS_EVALUATION).count;
+}
+
+// Fresh state on the pinned clock; the network task loop runs every 10 ms
+static void startStatus(unsigned long now) {
+  hostSetMillis(now);
+  settings = LEDSettings();
+  printer_state = PrinterState();
+  printer_state.is_connected = true;
+  serviceStatusEvaluation();  // Settle anything a previous case left behind
+}
+
+static void ingest(const char* rawStatus) {
+  printer_state.raw_gcode_state = rawStatus;
+  requestStatusEvaluation();
+  serviceStatusEvaluation();
+}
+
+// Run the network task loop for ms of virtual time
+static void runNetworkTask(unsigned long ms) {
+  for (unsigned long elapsed = 0; elapsed < ms; elapsed += 10) {
+    hostAdvanceMillis(10);
+    serviceStatusEvaluation();
+  }
+}
+
+TEST(status_finish_falls_back_at_its_deadline) {
+  startStatus(1000000);
+  ingest("FINISH");
+  EXPECT_TRUE(printer_state.status == "finished");
+  uint32_t before = evaluations();
+
+  // Nothing runs the state machine until the two minutes are up
+  hostAdvanceMillis(STATE_TIMEOUT_MS - 1);
+  serviceStatusEvaluation();
+  EXPECT_EQ(evaluations(), before);
+  EXPECT_TRUE(printer_state.status == "finished");
+
+  hostAdvanceMillis(1);
+  serviceStatusEvaluation();
+  EXPECT_EQ(evaluations(), before + 1);
+  EXPECT_TRUE(printer_state.status == "idle");
+  EXPECT_TRUE(settings.state_timeout_reached);
+}
+
+TEST(status_error_falls_back_at_its_deadline) {
+  startStatus(2000000);
+  ingest("FAILED");
+  EXPECT_TRUE(printer_state.status == "error");
+
+  runNetworkTask(STATE_TIMEOUT_MS - 10);
+  EXPECT_TRUE(printer_state.status == "error");
+  runNetworkTask(10);
+  EXPECT_TRUE(printer_state.status == "idle");
+}
+
+TEST(status_idle_auto_off_at_its_deadline) {
+  startStatus(3000000);
+  settings.idle_timeout_enabled = true;
+  settings.idle_timeout_minutes = 1;
+  ingest("IDLE");
+  EXPECT_TRUE(printer_state.status == "idle");
+  uint32_t before = evaluations();
+
+  runNetworkTask(60000 - 10);
+  EXPECT_TRUE(printer_state.status == "idle");
+  EXPECT_EQ(evaluations(), before);
+  runNetworkTask(10);
+  EXPECT_TRUE(printer_state.status == "auto_off");
+  EXPECT_EQ(evaluations(), before + 1);
+
+  // Further idle reports keep it off; a print wakes it
+  ingest("IDLE");
+  EXPECT_TRUE(printer_state.status == "auto_off");
+  ingest("RUNNING");
+  EXPECT_TRUE(printer_state.status == "printing");
+}
+
+TEST(status_deadline_is_dropped_when_the_state_moves_on) {
+  startStatus(4000000);
+  ingest("FINISH");
+  runNetworkTask(30000);
+  ingest("RUNNING");
+  EXPECT_TRUE(printer_state.status == "printing");
+
+  // The finish timer no longer applies, so its deadline passes unnoticed
+  uint32_t before = evaluations();
+  runNetworkTask(STATE_TIMEOUT_MS);
+  EXPECT_EQ(evaluations(), before);
+  EXPECT_TRUE(printer_state.status == "printing");
+  EXPECT_TRUE(!settings.state_timeout_reached);
+}
+
+TEST(status_earliest_timer_wins) {
+  startStatus(5000000);
+  settings.idle_timeout_enabled = true;
+  settings.idle_timeout_minutes = 10;
+  ingest("IDLE");
+
+  // Idle auto-off is armed for ten minutes; a failure arms two minutes
+  runNetworkTask(1000);
+  printer_state.has_error = true;
+  ingest("FAILED");
+  EXPECT_TRUE(printer_state.status == "error");
+  runNetworkTask(STATE_TIMEOUT_MS);
+  EXPECT_TRUE(printer_state.status == "idle");
+}
+
+TEST(status_not_evaluated_while_nothing_changes) {
+  startStatus(6000000);
+  ingest("RUNNING");
+  uint32_t before = evaluations();
+
+  // Ten minutes of printing without a message: no timers, no evaluations
+  runNetworkTask(600000);
+  EXPECT_EQ(evaluations(), before);
+
+  // A direct status write is picked up on the next pass
+  printer_state.status = "unknown";
+  markPrinterStatusChanged();
+  runNetworkTask(10);
+  EXPECT_EQ(evaluations(), before + 1);
+  EXPECT_TRUE(printer_state.status == "printing");
+}
+
+// State mutex hold per LED frame. Before, the LED task ran the state
+// machine under the mutex every frame; now it only renders, and the
+// network task evaluates on events.
+TEST(bench_state_mutex_hold_per_frame) {
+  const int frames = 20000;
+  const char* states[] = {"RUNNING", "IDLE", "FINISH"};
+  setAnimationClock(nullptr);
+
+  for (const char* state : states) {
+    startStatus(7000000);
+    settings.led_count = 300;
+    syncLEDChannels();
+    strip.updateLength(300);
+    printer_state.progress = 40;
+    ingest(state);
+
+    // Time the two parts of the old hold separately; the render is the
+    // whole of the new one
+    double evaluateUs = 0, renderUs = 0;
+    for (int frame = 0; frame < frames; frame++) {
+      hostAdvanceMillis(10);
+      xSemaphoreTake(printerStateMutex, portMAX_DELAY);
+      double start = benchNow();
+      determinePrinterStatus();
+      double rendered = benchNow();
+      updateLEDDisplay();
+      double end = benchNow();
+      xSemaphoreGive(printerStateMutex);
+      evaluateUs += rendered - start;
+      renderUs += end - rendered;
+    }
+    evaluateUs = evaluateUs * 1e6 / frames;
+    renderUs = renderUs * 1e6 / frames;
+    double beforeUs = evaluateUs + renderUs;
+    BENCH("%-7s 300 LEDs: mutex held %.2f us/frame before, %.2f us/frame after (%.0f%% less)",
+          state, beforeUs, renderUs, 100.0 * evaluateUs / beforeUs);
+  }
+
+  // Network side: one evaluation per event instead of 100 per second
+  const TimingHistogram& evaluation = profileZoneHistogram(PROFILE_STATUS_EVALUATION);
+  BENCH("state machine on the network task: %u runs, mean %u us, max %u us",
+        evaluation.count, histogramMean(evaluation), evaluation.max_us);
+  hostReleaseClock();
+}
@@ -0,0 +1,137 @@
+// Timing histogram: every value lands in the bucket whose range holds it,
+// buckets stay within 12.5% wide, and percentiles read back within one
+// bucket of the exact order statistic without ever reporting below it.
+#include "TestHarness.h"
+#include "../src/diagnostics/TimingHistogram.h"
+#include <algorithm>
+#include <random>
+
+// Index of the only non-empty bucket after recording one value
+static int bucketOf(uint32_t us) {
+  TimingHistogram histogram;
+  histogramRecord(histogram, us);
+  for (int i = 0; i < TIMING_HISTOGRAM_BUCKETS; i++) {
+    if (histogram.buckets[i] != 0) return i;
+  }
+  return -1;
+}
+
+static uint32_t exactPercentile(std::vector<uint32_t> values, int percent) {
+  std::sort(values.begin(), values.end());
+  size_t rank = (values.size() * percent + 99) / 100;
+  return values[std::max(rank, (size_t)1) - 1];
+}
+
+TEST(histogram_small_values_are_exact) {
+  for (uint32_t us = 0; us < TIMING_HISTOGRAM_SUB_BUCKETS; us++) {
+    EXPECT_EQ(bucketOf(us), us);
+    EXPECT_EQ(histogramBucketLow(us), us);
+  }
+  EXPECT_EQ(histogramBucketLow(TIMING_HISTOGRAM_SUB_BUCKETS), TIMING_HISTOGRAM_SUB_BUCKETS);
+}
+
+TEST(histogram_bucket_edges) {
+  for (int i = 1; i < TIMING_HISTOGRAM_BUCKETS; i++) {
+    uint32_t low = histogramBucketLow(i);
+    uint32_t previous = histogramBucketLow(i - 1);
+    EXPECT_TRUE(low > previous);
+    EXPECT_EQ(bucketOf(low), i);
+    EXPECT_EQ(bucketOf(low - 1), i - 1);
+
+    // Log-linear: no bucket is wider than an eighth of its lower edge
+    if (previous >= TIMING_HISTOGRAM_SUB_BUCKETS) EXPECT_TRUE((low - previous) * 8 <= previous);
+  }
+
+  // The last bucket reaches about a second, then takes everything larger
+  uint32_t last = histogramBucketLow(TIMING_HISTOGRAM_BUCKETS - 1);
+  EXPECT_TRUE(last > 1000000);
+  EXPECT_EQ(bucketOf(last * 4), TIMING_HISTOGRAM_BUCKETS - 1);
+  EXPECT_EQ(bucketOf(0xFFFFFFFF), TIMING_HISTOGRAM_BUCKETS - 1);
+}
+
+TEST(histogram_tracks_count_min_max_mean) {
+  TimingHistogram histogram;
+  EXPECT_EQ(histogramMean(histogram), 0);
+  EXPECT_EQ(histogramPercentile(histogram, 50), 0);
+
+  const uint32_t values[] = {120, 5, 9000, 40};
+  for (uint32_t us : values) histogramRecord(histogram, us);
+  EXPECT_EQ(histogram.count, 4);
+  EXPECT_EQ(histogram.min_us, 5);
+  EXPECT_EQ(histogram.max_us, 9000);
+  EXPECT_EQ(histogramMean(histogram), (120 + 5 + 9000 + 40) / 4);
+
+  histogramReset(histogram);
+  EXPECT_EQ(histogram.count, 0);
+  EXPECT_EQ(histogram.max_us, 0);
+  histogramRecord(histogram, 70);
+  EXPECT_EQ(histogram.min_us, 70);
+}
+
+TEST(histogram_percentiles_of_known_distributions) {
+  // One value: every percentile is that value, capped at the maximum
+  TimingHistogram single;
+  histogramRecord(single, 1000);
+  EXPECT_EQ(histogramPercentile(single, 0), 1000);
+  EXPECT_EQ(histogramPercentile(single, 50), 1000);
+  EXPECT_EQ(histogramPercentile(single, 100), 1000);
+
+  // 1..1000 us: percentile p sits at 10 * p, read back at its bucket's top edge
+  TimingHistogram uniform;
+  for (uint32_t us = 1; us <= 1000; us++) histogramRecord(uniform, us);
+  const int percents[] = {1, 10, 50, 90, 99};
+  for (int percent : percents) {
+    uint32_t exact = percent * 10;
+    uint32_t reported = histogramPercentile(uniform, percent);
+    EXPECT_TRUE(reported >= exact);
+    EXPECT_TRUE(reported <= exact + exact / 8);
+  }
+  EXPECT_EQ(histogramPercentile(uniform, 100), 1000);
+
+  // A 10 ms frame interval with a few 30 ms stalls: p99 must show the stall
+  TimingHistogram interval;
+  for (int frame = 0; frame < 1000; frame++) histogramRecord(interval, (frame % 50 == 0) ? 30000 : 10000);
+  EXPECT_TRUE(histogramPercentile(interval, 50) >= 10000 && histogramPercentile(interval, 50) < 11250);
+  EXPECT_TRUE(histogramPercentile(interval, 99) >= 30000);
+}
+
+TEST(histogram_percentiles_within_one_bucket_of_exact) {
+  std::mt19937 random(11);
+  std::lognormal_distribution<double> latency(7.0, 1.2);  // Median about 1.1 ms
+  TimingHistogram histogram;
+  std::vector<uint32_t> values;
+  for (int i = 0; i < 20000; i++) {
+    uint32_t us = (uint32_t)std::min(latency(random), 4e6);
+    values.push_back(us);
+    histogramRecord(histogram, us);
+  }
+
+  for (int percent = 1; percent <= 100; percent++) {
+    uint32_t exact = exactPercentile(values, percent);
+    uint32_t reported = histogramPercentile(histogram, percent);
+    if (reported < exact || reported > exact + exact / 8) {
+      printf("  p%d: exact %u, reported %u\n", percent, exact, reported);
+      testFailures()++;
+    }
+  }
+}
+
+TEST(bench_histogram_record) {
+  const int samples = 1 << 22;
+  std::vector<uint32_t> values(4096);
+  std::mt19937 random(5);
+  for (uint32_t& us : values) us = random() % 50000;
+
+  TimingHistogram histogram;
+  double start = benchNow();
+  for (int i = 0; i < samples; i++) histogramRecord(histogram, values[i & 4095]);
+  double record = (benchNow() - start) * 1e9 / samples;
+
+  volatile uint32_t sink = 0;
+  start = benchNow();
+  for (int i = 0; i < 1000; i++) sink = sink + histogramPercentile(histogram, 99);
+  double percentile = (benchNow() - start) * 1e9 / 1000;
+
+  EXPECT_EQ(histogram.count, samples);
+  BENCH("histogramRecord %.2f ns/sample, histogramPercentile %.0f ns", record, percentile);
+}
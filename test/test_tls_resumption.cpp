@@ -0,0 +1,166 @@
+// TLS session resumption through the MQTT pipeline against a TLS broker on
+// loopback: the first connect does a full handshake and caches the session,
+// reconnects and restarts resume it, a broker that forgot it gets a full
+// handshake and a fresh session, and the session is only offered to the
+// host it came from. Reports what resuming saves in handshake time, time
+// on the network task and heap.
+#include "TestHarness.h"
+#include "TestBroker.h"
+#include "../src/network/MQTTConnection.h"
+#include <lwip/dns.h>
+#include <arpa/inet.h>
+
+// Forked before the test threads start; see TestBroker.h
+static TLSTestBroker& broker() {
+  static TLSTestBroker* instance = new TLSTestBroker();
+  return *instance;
+}
+
+static const char* broker_host = "printer.test";
+
+static bool configureTestEndpoint(MQTTEndpoint& endpoint) {
+  endpoint = MQTTEndpoint();
+  endpoint.host = broker_host;
+  endpoint.port = broker().port();
+  endpoint.client_id = "mavenled-test";
+  endpoint.username = "bblp";
+  endpoint.password = "12345678";
+  endpoint.topic = "device/01P00A000000000/report";
+  return true;
+}
+
+static MQTTTransport transport(true);
+static PubSubClient client(transport);
+static MQTTConnection connection("test", &client, &transport, configureTestEndpoint);
+
+struct ConnectResult {
+  MQTTConnectEvent event = MQTT_EVENT_NONE;
+  double task_us = 0;  // Spent inside service calls
+};
+
+// Run one connect on the network task loop, timing every service call
+static ConnectResult connectOnce(MQTTConnection& target) {
+  ConnectResult result;
+  mqttConnectionStart(target);
+  unsigned long start = millis();
+  while (millis() - start < 5000) {
+    double before = benchNow();
+    MQTTConnectEvent event = mqttConnectionService(target);
+    result.task_us += (benchNow() - before) * 1e6;
+    if (event != MQTT_EVENT_NONE) {
+      result.event = event;
+      break;
+    }
+    delay(1);
+  }
+  mqttConnectionStop(target);
+  return result;
+}
+
+TEST(tls_first_connect_is_a_full_handshake) {
+  hostDNSAnswer("printer.test", htonl(INADDR_LOOPBACK));
+  hostDNSAnswer("other.test", htonl(INADDR_LOOPBACK));
+  broker();
+  transport.clearSession();
+  EXPECT_TRUE(!transport.hasCachedSession("printer.test"));
+  uint32_t handshakes = transport.tls_stats.handshakes;
+
+  EXPECT_EQ(connectOnce(connection).event, MQTT_EVENT_CONNECTED);
+  EXPECT_EQ(transport.tls_stats.handshakes, handshakes + 1);
+  EXPECT_TRUE(!transport.tls_stats.last_resumed);
+  EXPECT_TRUE(transport.tls_stats.last_heap_peak > 0);
+  EXPECT_TRUE(transport.hasCachedSession("printer.test"));
+  EXPECT_EQ(broker().resumed(), 0);
+}
+
+TEST(tls_reconnect_resumes_the_session) {
+  uint32_t resumed = transport.tls_stats.resumed;
+  int brokerResumed = broker().resumed();
+
+  EXPECT_EQ(connectOnce(connection).event, MQTT_EVENT_CONNECTED);
+  EXPECT_TRUE(transport.tls_stats.last_resumed);
+  EXPECT_EQ(transport.tls_stats.resumed, resumed + 1);
+  EXPECT_EQ(broker().resumed(), brokerResumed + 1);
+
+  // And again: the ticket from the resumed handshake is cached in turn
+  EXPECT_EQ(connectOnce(connection).event, MQTT_EVENT_CONNECTED);
+  EXPECT_TRUE(transport.tls_stats.last_resumed);
+  EXPECT_EQ(broker().resumed(), brokerResumed + 2);
+}
+
+TEST(tls_session_survives_a_restart) {
+  // A new transport starts with an empty RAM cache, like after a reboot,
+  // and picks the session up from the RTC copy
+  MQTTTransport restarted(true);
+  PubSubClient restartedClient(restarted);
+  MQTTConnection restartedConnection("restarted", &restartedClient, &restarted, configureTestEndpoint);
+  EXPECT_TRUE(restarted.hasCachedSession("printer.test"));
+
+  EXPECT_EQ(connectOnce(restartedConnection).event, MQTT_EVENT_CONNECTED);
+  EXPECT_TRUE(restarted.tls_stats.last_resumed);
+  EXPECT_EQ(restarted.tls_stats.resumed, 1);
+}
+
+TEST(tls_broker_that_forgot_the_session_gets_a_full_handshake) {
+  broker().forgetSessions();
+  uint32_t declined = transport.tls_stats.resume_declined;
+
+  EXPECT_EQ(connectOnce(connection).event, MQTT_EVENT_CONNECTED);
+  EXPECT_TRUE(!transport.tls_stats.last_resumed);
+  EXPECT_EQ(transport.tls_stats.resume_declined, declined + 1);
+
+  // The new session replaces the stale one
+  EXPECT_EQ(connectOnce(connection).event, MQTT_EVENT_CONNECTED);
+  EXPECT_TRUE(transport.tls_stats.last_resumed);
+}
+
+TEST(tls_session_only_offered_to_its_host) {
+  EXPECT_TRUE(!transport.hasCachedSession("other.test"));
+  uint32_t declined = transport.tls_stats.resume_declined;
+  int brokerResumed = broker().resumed();
+
+  broker_host = "other.test";
+  EXPECT_EQ(connectOnce(connection).event, MQTT_EVENT_CONNECTED);
+  broker_host = "printer.test";
+  EXPECT_TRUE(!transport.tls_stats.last_resumed);
+  EXPECT_EQ(transport.tls_stats.resume_declined, declined);
+  EXPECT_EQ(broker().resumed(), brokerResumed);
+  EXPECT_TRUE(transport.hasCachedSession("other.test"));
+}
+
+TEST(bench_tls_full_against_resumed_handshake) {
+  const int connects = 20;
+  const char* kinds[] = {"full", "resumed"};
+  double taskUs[2] = {0, 0};
+
+  for (int resumed = 0; resumed < 2; resumed++) {
+    // Prime the cache for the resumed runs
+    if (resumed) connectOnce(connection);
+
+    unsigned long handshakeMs = 0, worstMs = 0;
+    uint64_t heap = 0;
+    uint32_t worstHeap = 0;
+    int resumedCount = 0;
+    for (int i = 0; i < connects; i++) {
+      if (!resumed) transport.clearSession();
+      ConnectResult result = connectOnce(connection);
+      EXPECT_EQ(result.event, MQTT_EVENT_CONNECTED);
+      const TLSStats& tls = transport.tls_stats;
+      if (tls.last_resumed) resumedCount++;
+      handshakeMs += tls.last_handshake_ms;
+      worstMs = max(worstMs, tls.last_handshake_ms);
+      heap += tls.last_heap_peak;
+      worstHeap = max(worstHeap, tls.last_heap_peak);
+      taskUs[resumed] += result.task_us;
+    }
+    EXPECT_EQ(resumedCount, resumed ? connects : 0);
+    EXPECT_TRUE(worstHeap > 0);
+    taskUs[resumed] /= connects;
+    BENCH("%-7s handshake %.1f ms (worst %lu ms), %.0f us on the task per connect, heap peak %llu bytes (worst %u)",
+          kinds[resumed], (double)handshakeMs / connects, worstMs, taskUs[resumed],
+          (unsigned long long)(heap / connects), worstHeap);
+  }
+  EXPECT_TRUE(taskUs[1] < taskUs[0]);
+}
+
+TEST_MAIN()
@@ -0,0 +1,98 @@
+// State change transitions: crossfade and wipe output, and a full state
+// change rendered through updateLEDDisplay() without a heap allocation.
+#include "TestHarness.h"
+#include "host/AllocationCounter.h"
+#include "../src/led/LEDAnimations.h"
+#include "../src/led/LEDLayout.h"
+#include "../src/led/LEDTransition.h"
+#include "../src/printer/PrinterState.h"
+
+static unsigned long transition_clock_ms = 0;
+static unsigned long transitionClock() { return transition_clock_ms; }
+
+TEST(transition_crossfades_and_wipes) {
+  setAnimationClock(transitionClock);
+  const int count = 100;
+  uint8_t outgoing[count * 3];
+  uint8_t frame[count * 3];
+  memset(outgoing, 200, sizeof(outgoing));
+  transitionBegin(count);
+
+  transition_clock_ms = 1000;
+  transitionStart(TRANSITION_FADE, 800);
+  transition_clock_ms += 400;  // Halfway
+  transitionCaptureOutgoing(outgoing, count);
+  memset(frame, 0, sizeof(frame));
+  transitionApply(frame, count);
+  EXPECT_NEAR(frame[0], 100, 1);
+  EXPECT_NEAR(frame[count * 3 - 1], 100, 1);
+
+  transitionStart(TRANSITION_WIPE, 800);
+  transition_clock_ms += 400;
+  transitionCaptureOutgoing(outgoing, count);
+  memset(frame, 0, sizeof(frame));
+  transitionApply(frame, count);
+  EXPECT_EQ(frame[0], 0);                // Incoming behind the edge
+  EXPECT_EQ(frame[49 * 3], 0);
+  EXPECT_EQ(frame[51 * 3], 200);         // Outgoing ahead of it
+  EXPECT_EQ(frame[count * 3 - 1], 200);
+
+  // Past the duration the incoming frame is left alone and the transition ends
+  transition_clock_ms += 400;
+  memset(frame, 0, sizeof(frame));
+  transitionApply(frame, count);
+  EXPECT_EQ(frame[count * 3 - 1], 0);
+  EXPECT_TRUE(!transitionActive());
+
+  // A cut never starts
+  transitionStart(TRANSITION_CUT, 800);
+  EXPECT_TRUE(!transitionActive());
+  setAnimationClock(nullptr);
+}
+
+static void renderFrames(int frames) {
+  for (int i = 0; i < frames; i++) {
+    transition_clock_ms += 20;
+    updateLEDDisplay();
+  }
+}
+
+static void setStatus(const char* status) {
+  printer_state.status = status;
+  printer_status_version++;
+}
+
+TEST(state_change_does_not_allocate) {
+  setAnimationClock(transitionClock);
+  const int count = 300;
+  settings.led_count = count;
+  settings.transition_ms = 800;
+  strip.updateLength(count);
+  transitionBegin(count);
+  layoutBegin(count);
+
+  printer_state.is_connected = true;
+  printer_state.progress = 35;
+  const char* states[] = {"idle", "printing", "paused", "error", "finished", "downloading"};
+
+  // First pass sizes every buffer the effects use
+  for (const char* state : states) {
+    setStatus(state);
+    renderFrames(60);
+  }
+
+  for (int mode : {TRANSITION_FADE, TRANSITION_WIPE}) {
+    settings.transition_mode = mode;
+    for (const char* state : states) {
+      setStatus(state);
+      allocationCountStart();
+      renderFrames(60);  // 1.2 s: the whole transition and then some
+      size_t allocations = allocationCountStop();
+      if (allocations != 0) printf("  %s (mode %d): %zu allocations\n", state, mode, allocations);
+      EXPECT_EQ(allocations, 0);
+    }
+  }
+
+  setStatus("unknown");
+  setAnimationClock(nullptr);
+}
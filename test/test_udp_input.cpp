@@ -0,0 +1,321 @@
+// Realtime input over loopback: DDP and E1.31 packets parsed into the
+// frame buffer, malformed packets rejected, the fallback timeout, and a
+// 60 fps stream of 1000 LED frames measured for drops and latency.
+#include "TestHarness.h"
+#include "../src/config/Settings.h"
+#include "../src/network/UDPInput.h"
+#include "../src/network/UDPOutput.h"
+#include <lwip/sockets.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static const int STRIP_LEDS = 1000;
+static const int FRAME_BYTES = STRIP_LEDS * 3;
+
+static int sender = -1;
+
+static void putBE16(uint8_t* p, uint16_t value) {
+  p[0] = value >> 8;
+  p[1] = value & 0xFF;
+}
+
+static void putBE32(uint8_t* p, uint32_t value) {
+  putBE16(p, value >> 16);
+  putBE16(p + 2, value & 0xFFFF);
+}
+
+static void sendTo(uint16_t port, const std::vector<uint8_t>& packet) {
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sendto(sender, packet.data(), packet.size(), 0, (struct sockaddr*)&address, sizeof(address));
+}
+
+static std::vector<uint8_t> ddpPacket(uint8_t flags, uint32_t offset, const uint8_t* data, size_t length) {
+  std::vector<uint8_t> packet(10 + length);
+  packet[0] = flags;
+  packet[1] = 1;
+  packet[2] = 0x0B;
+  packet[3] = 1;
+  putBE32(&packet[4], offset);
+  putBE16(&packet[8], length);
+  memcpy(&packet[10], data, length);
+  return packet;
+}
+
+// Whole frame as DDP: 1440 byte packets, PUSH on the last
+static void sendDDPFrame(const uint8_t* rgb) {
+  for (int offset = 0; offset < FRAME_BYTES; offset += 1440) {
+    int length = min(1440, FRAME_BYTES - offset);
+    bool last = offset + length >= FRAME_BYTES;
+    sendTo(DDP_PORT, ddpPacket(last ? 0x41 : 0x40, offset, rgb + offset, length));
+  }
+}
+
+static std::vector<uint8_t> e131Packet(int universe, const uint8_t* data, int slots, uint8_t startCode = 0) {
+  std::vector<uint8_t> packet(126 + slots, 0);
+  putBE16(&packet[0], 0x0010);
+  memcpy(&packet[4], "ASC-E1.17\0\0\0", 12);
+  putBE16(&packet[16], 0x7000 | (packet.size() - 16));
+  putBE32(&packet[18], 0x00000004);
+  putBE16(&packet[38], 0x7000 | (packet.size() - 38));
+  putBE32(&packet[40], 0x00000002);
+  putBE16(&packet[113], universe);
+  putBE16(&packet[115], 0x7000 | (packet.size() - 115));
+  packet[117] = 0x02;
+  packet[118] = 0xA1;
+  putBE16(&packet[121], 1);
+  putBE16(&packet[123], slots + 1);
+  packet[125] = startCode;
+  memcpy(&packet[126], data, slots);
+  return packet;
+}
+
+static void sendE131Frame(const uint8_t* rgb, int firstUniverse) {
+  for (int offset = 0, universe = firstUniverse; offset < FRAME_BYTES; offset += 510, universe++) {
+    sendTo(E131_PORT, e131Packet(universe, rgb + offset, min(510, FRAME_BYTES - offset)));
+  }
+}
+
+static std::vector<uint8_t> testFrame(uint8_t seed) {
+  std::vector<uint8_t> rgb(FRAME_BYTES);
+  for (int i = 0; i < FRAME_BYTES; i++) rgb[i] = (uint8_t)(i * 13 + seed);
+  return rgb;
+}
+
+static bool waitForFrame(uint32_t framesBefore, unsigned long timeoutMs = 500) {
+  unsigned long start = millis();
+  while (udp_input_stats.frames == framesBefore) {
+    if (millis() - start > timeoutMs) return false;
+    delay(1);
+  }
+  return true;
+}
+
+// Packets already counted as received, so a rejection shows up in bad_packets
+static bool waitForPackets(uint32_t target, unsigned long timeoutMs = 500) {
+  unsigned long start = millis();
+  while (udp_input_stats.packets < target) {
+    if (millis() - start > timeoutMs) return false;
+    delay(1);
+  }
+  return true;
+}
+
+static std::vector<uint8_t> copyFrame() {
+  std::vector<uint8_t> rgb(FRAME_BYTES, 0);
+  realtimeCopyFrame(rgb.data(), STRIP_LEDS);
+  return rgb;
+}
+
+// Start the receive task once; it listens on the fixed protocol ports
+static void startInput() {
+  static bool started = false;
+  if (started) return;
+  started = true;
+
+  sender = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  int size = 1 << 20;
+  setsockopt(sender, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+  settings.led_count = STRIP_LEDS;
+  udpInputConfigure(true, 2500, 1);
+  udpInputBegin();
+
+  // The task opens its sockets on its first pass
+  std::vector<uint8_t> rgb = testFrame(0);
+  for (int attempt = 0; attempt < 50 && udp_input_stats.frames == 0; attempt++) {
+    sendDDPFrame(rgb.data());
+    delay(20);
+  }
+  copyFrame();
+}
+
+TEST(ddp_frame_lands_in_the_framebuffer) {
+  startInput();
+  std::vector<uint8_t> rgb = testFrame(1);
+  uint32_t frames = udp_input_stats.frames;
+  sendDDPFrame(rgb.data());
+
+  EXPECT_TRUE(waitForFrame(frames));
+  EXPECT_TRUE(realtimeFramePending());
+  EXPECT_TRUE(copyFrame() == rgb);
+  EXPECT_TRUE(!realtimeFramePending());
+  EXPECT_TRUE(realtimeInputActive());
+  EXPECT_TRUE(strcmp(udp_input_stats.last_protocol, "ddp") == 0);
+}
+
+TEST(ddp_frame_waits_for_push) {
+  startInput();
+  std::vector<uint8_t> rgb = testFrame(2);
+  uint32_t frames = udp_input_stats.frames;
+  uint32_t packets = udp_input_stats.packets;
+
+  // Pixel data without PUSH is held back, then an empty PUSH shows it
+  for (int offset = 0; offset < FRAME_BYTES; offset += 1440) {
+    sendTo(DDP_PORT, ddpPacket(0x40, offset, rgb.data() + offset, min(1440, FRAME_BYTES - offset)));
+  }
+  EXPECT_TRUE(waitForPackets(packets + 3));
+  EXPECT_EQ(udp_input_stats.frames, frames);
+
+  sendTo(DDP_PORT, ddpPacket(0x41, 0, nullptr, 0));
+  EXPECT_TRUE(waitForFrame(frames));
+  EXPECT_TRUE(copyFrame() == rgb);
+}
+
+TEST(ddp_partial_updates_carry_the_rest_forward) {
+  startInput();
+  std::vector<uint8_t> rgb = testFrame(3);
+  uint32_t frames = udp_input_stats.frames;
+  sendDDPFrame(rgb.data());
+  EXPECT_TRUE(waitForFrame(frames));
+  copyFrame();
+
+  // Only LEDs 100-109 change
+  uint8_t white[30];
+  memset(white, 0xFF, sizeof(white));
+  memset(&rgb[300], 0xFF, sizeof(white));
+  frames = udp_input_stats.frames;
+  sendTo(DDP_PORT, ddpPacket(0x41, 300, white, sizeof(white)));
+  EXPECT_TRUE(waitForFrame(frames));
+  EXPECT_TRUE(copyFrame() == rgb);
+}
+
+TEST(ddp_timecode_header_and_offsets_past_the_strip) {
+  startInput();
+  std::vector<uint8_t> rgb = testFrame(4);
+  uint32_t frames = udp_input_stats.frames;
+  sendDDPFrame(rgb.data());
+  EXPECT_TRUE(waitForFrame(frames));
+  copyFrame();
+
+  // A timecode adds four bytes to the header; the data spills past the last LED
+  uint8_t tail[12] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+  std::vector<uint8_t> packet = ddpPacket(0x51, FRAME_BYTES - 6, tail, sizeof(tail));
+  packet.insert(packet.begin() + 10, {0, 0, 0, 0});
+  frames = udp_input_stats.frames;
+  sendTo(DDP_PORT, packet);
+  EXPECT_TRUE(waitForFrame(frames));
+
+  memcpy(&rgb[FRAME_BYTES - 6], tail, 6);
+  EXPECT_TRUE(copyFrame() == rgb);
+}
+
+TEST(malformed_packets_are_rejected) {
+  startInput();
+  uint32_t frames = udp_input_stats.frames;
+  uint32_t packets = udp_input_stats.packets;
+  uint32_t bad = udp_input_stats.bad_packets;
+  uint8_t data[30] = {};
+
+  sendTo(DDP_PORT, {0x41, 1, 0x0B});                         // Shorter than the header
+  sendTo(DDP_PORT, ddpPacket(0x81, 0, data, sizeof(data)));  // Wrong version
+  std::vector<uint8_t> truncated = ddpPacket(0x41, 0, data, sizeof(data));
+  putBE16(&truncated[8], 200);                               // Claims more than it carries
+  sendTo(DDP_PORT, truncated);
+
+  std::vector<uint8_t> notE131 = e131Packet(1, data, sizeof(data));
+  memcpy(&notE131[4], "ASC-E1.18", 9);
+  sendTo(E131_PORT, notE131);
+  std::vector<uint8_t> shortE131 = e131Packet(1, data, sizeof(data));
+  putBE16(&shortE131[123], 200);
+  sendTo(E131_PORT, shortE131);
+  sendTo(E131_PORT, std::vector<uint8_t>(60, 0));
+
+  EXPECT_TRUE(waitForPackets(packets + 6));
+  EXPECT_EQ(udp_input_stats.bad_packets, bad + 6);
+  EXPECT_EQ(udp_input_stats.frames, frames);
+}
+
+TEST(e131_universes_map_from_the_first_universe) {
+  startInput();
+  udpInputConfigure(true, 2500, 5);
+  std::vector<uint8_t> rgb = testFrame(5);
+  uint32_t frames = udp_input_stats.frames;
+  uint32_t packets = udp_input_stats.packets;
+  uint32_t bad = udp_input_stats.bad_packets;
+
+  // Universes below ours and non-DMX start codes are someone else's
+  std::vector<uint8_t> noise(510, 0xAA);
+  sendTo(E131_PORT, e131Packet(4, noise.data(), 510));
+  sendTo(E131_PORT, e131Packet(5, noise.data(), 510, 0xDD));
+  EXPECT_TRUE(waitForPackets(packets + 2));
+
+  // 1000 LEDs span six universes; the frame completes on the sixth
+  sendE131Frame(rgb.data(), 5);
+  EXPECT_TRUE(waitForFrame(frames));
+  EXPECT_EQ(udp_input_stats.frames, frames + 1);
+  EXPECT_EQ(udp_input_stats.bad_packets, bad);
+  EXPECT_TRUE(copyFrame() == rgb);
+  EXPECT_TRUE(strcmp(udp_input_stats.last_protocol, "e131") == 0);
+  udpInputConfigure(true, 2500, 1);
+}
+
+TEST(input_times_out_back_to_the_status_effects) {
+  startInput();
+  udpInputConfigure(true, 150, 1);
+  std::vector<uint8_t> rgb = testFrame(6);
+  uint32_t frames = udp_input_stats.frames;
+  sendDDPFrame(rgb.data());
+  EXPECT_TRUE(waitForFrame(frames));
+  copyFrame();
+
+  EXPECT_TRUE(realtimeInputActive());
+  delay(200);
+  EXPECT_TRUE(!realtimeInputActive());
+  udpInputConfigure(true, 2500, 1);
+}
+
+// 1000 LED frames at 60 fps while the LED task copies at its own 100 Hz
+// pace: every frame must arrive, and the latency from the last packet to
+// the copy is reported.
+TEST(bench_60fps_stream_of_1000_leds) {
+  startInput();
+  const int frames = 180;
+  std::vector<uint8_t> rgb = testFrame(7);
+  std::vector<double> sentAt(frames, 0);
+  std::atomic<bool> done(false);
+
+  uint32_t framesBefore = udp_input_stats.frames;
+  uint32_t droppedBefore = udp_input_stats.frames_dropped;
+  udp_input_stats.max_latency_us = 0;
+
+  std::thread stream([&]() {
+    double start = benchNow();
+    for (int frame = 0; frame < frames; frame++) {
+      while (benchNow() - start < frame / 60.0) std::this_thread::sleep_for(std::chrono::microseconds(200));
+      putBE16(rgb.data(), frame);  // Frame number in the first LED
+      sentAt[frame] = benchNow();
+      sendDDPFrame(rgb.data());
+    }
+    done = true;
+  });
+
+  std::vector<uint8_t> copy(FRAME_BYTES);
+  int seen = 0;
+  double worstMs = 0, totalMs = 0;
+  while (!done || realtimeFramePending()) {
+    if (realtimeFramePending()) {
+      realtimeCopyFrame(copy.data(), STRIP_LEDS);
+      double ms = (benchNow() - sentAt[(copy[0] << 8) | copy[1]]) * 1000;
+      worstMs = std::max(worstMs, ms);
+      totalMs += ms;
+      seen++;
+    }
+    delay(10);
+  }
+  stream.join();
+  for (int wait = 0; wait < 200 && udp_input_stats.frames - framesBefore < (uint32_t)frames; wait++) delay(1);
+
+  uint32_t received = udp_input_stats.frames - framesBefore;
+  uint32_t dropped = udp_input_stats.frames_dropped - droppedBefore;
+  EXPECT_EQ(received, frames);
+  BENCH("60 fps x 1000 LEDs: %u/%d frames received, %u replaced before shown, %d shown",
+        received, frames, dropped, seen);
+  BENCH("send to copy %.2f ms mean, %.2f ms worst; complete to copy %lu us worst",
+        seen > 0 ? totalMs / seen : 0.0, worstMs, udp_input_stats.max_latency_us);
+}
+
+TEST_MAIN()
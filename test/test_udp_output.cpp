@@ -0,0 +1,231 @@
+// UDP output against a loopback receiver: DDP and E1.31 packet layout for a
+// 1000 LED frame, sending only once the network task has resolved the
+// target, stale lookups, and the cost of a frame on the sending task.
+#include "TestHarness.h"
+#include "../src/config/Settings.h"
+#include "../src/network/UDPOutput.h"
+#include <WiFi.h>
+#include <lwip/dns.h>
+#include <lwip/sockets.h>
+#include <poll.h>
+#include <vector>
+
+static const int STRIP_LEDS = 1000;
+
+// Loopback receiver bound to 127.0.0.1 on a free port
+struct Receiver {
+  int fd = -1;
+  uint16_t port = 0;
+
+  Receiver() {
+    fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    int size = 1 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (struct sockaddr*)&address, sizeof(address));
+    socklen_t length = sizeof(address);
+    getsockname(fd, (struct sockaddr*)&address, &length);
+    port = ntohs(address.sin_port);
+  }
+
+  // Next datagram, or empty if none arrives within timeoutMs
+  std::vector<uint8_t> next(int timeoutMs = 200) {
+    struct pollfd waiting = {fd, POLLIN, 0};
+    if (poll(&waiting, 1, timeoutMs) <= 0) return {};
+    std::vector<uint8_t> packet(65536);
+    int length = recv(fd, packet.data(), packet.size(), 0);
+    packet.resize(length > 0 ? length : 0);
+    return packet;
+  }
+
+  void drain() {
+    while (!next(0).empty()) {}
+  }
+};
+
+static Receiver& receiver() {
+  static Receiver instance;
+  return instance;
+}
+
+static uint16_t readBE16(const uint8_t* p) {
+  return (p[0] << 8) | p[1];
+}
+
+static uint32_t readBE32(const uint8_t* p) {
+  return ((uint32_t)readBE16(p) << 16) | readBE16(p + 2);
+}
+
+static std::vector<uint8_t> testFrame(uint8_t seed) {
+  std::vector<uint8_t> rgb(STRIP_LEDS * 3);
+  for (size_t i = 0; i < rgb.size(); i++) rgb[i] = (uint8_t)(i * 7 + seed);
+  return rgb;
+}
+
+// Point the output at the receiver and let the network task resolve it
+static void configure(int protocol, const char* host, int universe = 1) {
+  udpOutputConfigure(protocol, host, receiver().port, universe);
+  udpOutputService();
+  receiver().drain();
+}
+
+TEST(ddp_packets_carry_the_frame_in_order) {
+  configure(UDP_OUTPUT_DDP, "127.0.0.1");
+  std::vector<uint8_t> rgb = testFrame(1);
+  udpOutputFrame(rgb.data(), STRIP_LEDS, true);
+
+  // 3000 bytes: two full 1440 byte packets and a 120 byte tail
+  const size_t lengths[] = {1440, 1440, 120};
+  uint8_t sequence = 0;
+  size_t offset = 0;
+  for (int i = 0; i < 3; i++) {
+    std::vector<uint8_t> packet = receiver().next();
+    EXPECT_EQ(packet.size(), 10 + lengths[i]);
+    if (packet.size() != 10 + lengths[i]) return;
+
+    EXPECT_EQ(packet[0], i == 2 ? 0x41 : 0x40);  // Version 1, PUSH on the last packet
+    if (i == 0) sequence = packet[1];
+    EXPECT_EQ(packet[1], sequence);
+    EXPECT_TRUE(sequence >= 1 && sequence <= 15);
+    EXPECT_EQ(packet[2], 0x0B);  // RGB, 8 bits per channel
+    EXPECT_EQ(packet[3], 1);
+    EXPECT_EQ(readBE32(&packet[4]), offset);
+    EXPECT_EQ(readBE16(&packet[8]), lengths[i]);
+    EXPECT_TRUE(memcmp(&packet[10], rgb.data() + offset, lengths[i]) == 0);
+    offset += lengths[i];
+  }
+  EXPECT_TRUE(receiver().next(20).empty());
+  EXPECT_EQ(udp_output_stats.last_frame_bytes, 3000 + 3 * 10);
+}
+
+TEST(e131_packets_fill_consecutive_universes) {
+  configure(UDP_OUTPUT_E131, "127.0.0.1", 7);
+  std::vector<uint8_t> rgb = testFrame(2);
+  udpOutputFrame(rgb.data(), STRIP_LEDS, true);
+
+  // 170 pixels per universe: five full universes and 150 pixels
+  uint8_t sequence = 0;
+  for (int i = 0; i < 6; i++) {
+    int slots = (i < 5 ? 170 : 150) * 3;
+    std::vector<uint8_t> packet = receiver().next();
+    EXPECT_EQ(packet.size(), 126 + slots);
+    if ((int)packet.size() != 126 + slots) return;
+
+    EXPECT_TRUE(memcmp(&packet[4], "ASC-E1.17\0\0\0", 12) == 0);
+    EXPECT_EQ(readBE16(&packet[16]), 0x7000 | (packet.size() - 16));
+    EXPECT_EQ(readBE16(&packet[38]), 0x7000 | (packet.size() - 38));
+    EXPECT_EQ(readBE16(&packet[115]), 0x7000 | (packet.size() - 115));
+    if (i == 0) sequence = packet[111];
+    EXPECT_EQ(packet[111], sequence);
+    EXPECT_EQ(readBE16(&packet[113]), 7 + i);
+    EXPECT_EQ(readBE16(&packet[123]), slots + 1);
+    EXPECT_EQ(packet[125], 0);  // Start code
+    EXPECT_TRUE(memcmp(&packet[126], rgb.data() + i * 170 * 3, slots) == 0);
+  }
+  EXPECT_EQ(udp_output_stats.last_frame_bytes, 3000 + 6 * 126);
+}
+
+TEST(unchanged_frames_are_sent_as_keepalive_only) {
+  configure(UDP_OUTPUT_DDP, "127.0.0.1");
+  std::vector<uint8_t> rgb = testFrame(3);
+  udpOutputFrame(rgb.data(), STRIP_LEDS, true);
+  receiver().drain();
+
+  uint32_t skipped = udp_output_stats.frames_skipped;
+  udpOutputFrame(rgb.data(), STRIP_LEDS, false);
+  EXPECT_EQ(udp_output_stats.frames_skipped, skipped + 1);
+  EXPECT_TRUE(receiver().next(20).empty());
+}
+
+TEST(nothing_is_sent_until_the_host_resolves) {
+  hostDNSAnswer("output.test", htonl(INADDR_LOOPBACK));
+  hostDNSDelay(150);
+
+  udpOutputConfigure(UDP_OUTPUT_DDP, "output.test", receiver().port, 1);
+  receiver().drain();
+  uint32_t sent = udp_output_stats.frames_sent;
+  std::vector<uint8_t> rgb = testFrame(4);
+
+  // Neither the lookup nor the frames wait for the resolver
+  double start = benchNow();
+  udpOutputService();
+  double serviceMs = (benchNow() - start) * 1000;
+  start = benchNow();
+  udpOutputFrame(rgb.data(), STRIP_LEDS, true);
+  double frameMs = (benchNow() - start) * 1000;
+  EXPECT_TRUE(serviceMs < 20);
+  EXPECT_TRUE(frameMs < 20);
+  EXPECT_EQ(udp_output_stats.frames_sent, sent);
+  EXPECT_TRUE(receiver().next(20).empty());
+
+  // Once the answer is in, the next frame goes out
+  unsigned long waited = millis();
+  while (udp_output_stats.frames_sent == sent && millis() - waited < 2000) {
+    udpOutputService();
+    udpOutputFrame(rgb.data(), STRIP_LEDS, true);
+    delay(5);
+  }
+  EXPECT_EQ(udp_output_stats.frames_sent, sent + 1);
+  EXPECT_TRUE(millis() - waited >= 100);
+  EXPECT_EQ(receiver().next().size(), 10 + 1440);
+  BENCH("lookup in flight: service %.3f ms, frame %.3f ms; first frame after %lu ms",
+        serviceMs, frameMs, millis() - waited);
+  hostDNSDelay(0);
+}
+
+TEST(a_stale_lookup_does_not_replace_the_target) {
+  // 127.0.0.2 is loopback too, but the receiver only listens on 127.0.0.1
+  hostDNSAnswer("stale.test", htonl(0x7F000002));
+  hostDNSDelay(100);
+  udpOutputConfigure(UDP_OUTPUT_DDP, "stale.test", receiver().port, 1);
+  udpOutputService();
+
+  // The host changes while the lookup is in flight
+  configure(UDP_OUTPUT_DDP, "127.0.0.1");
+  delay(250);
+  udpOutputService();
+
+  std::vector<uint8_t> rgb = testFrame(5);
+  udpOutputFrame(rgb.data(), STRIP_LEDS, true);
+  EXPECT_EQ(receiver().next().size(), 10 + 1440);
+  hostDNSDelay(0);
+}
+
+TEST(output_waits_for_the_link) {
+  configure(UDP_OUTPUT_DDP, "127.0.0.1");
+  uint32_t sent = udp_output_stats.frames_sent;
+  std::vector<uint8_t> rgb = testFrame(6);
+
+  WiFi.setStatus(WL_DISCONNECTED);
+  udpOutputFrame(rgb.data(), STRIP_LEDS, true);
+  WiFi.setStatus(WL_CONNECTED);
+  EXPECT_EQ(udp_output_stats.frames_sent, sent);
+  EXPECT_TRUE(receiver().next(20).empty());
+}
+
+TEST(bench_frame_cost_at_1000_leds) {
+  const int frames = 2000;
+  std::vector<uint8_t> rgb = testFrame(7);
+  const int protocols[] = {UDP_OUTPUT_DDP, UDP_OUTPUT_E131};
+
+  for (int protocol : protocols) {
+    configure(protocol, "127.0.0.1");
+    uint32_t errors = udp_output_stats.send_errors;
+    double start = benchNow();
+    for (int frame = 0; frame < frames; frame++) {
+      udpOutputFrame(rgb.data(), STRIP_LEDS, true);
+      if (frame % 64 == 0) receiver().drain();
+    }
+    double perFrame = (benchNow() - start) / frames;
+    receiver().drain();
+
+    EXPECT_EQ(udp_output_stats.send_errors, errors);
+    BENCH("%s 1000 LEDs: %u bytes/frame, %.1f us/frame on the output task (%.0f fps)",
+          protocol == UDP_OUTPUT_DDP ? "DDP" : "E1.31", udp_output_stats.last_frame_bytes,
+          perFrame * 1e6, 1.0 / perFrame);
+  }
+}
+
+TEST_MAIN()
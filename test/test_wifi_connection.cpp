@@ -0,0 +1,284 @@
+// WiFi connection manager against a simulated radio: the backoff window
+// doubles to its cap with the wait drawn from its upper half, a rejected
+// attempt fails at once, the boot attempt falls back to the setup AP, a
+// dropped link retries straight away, and how long recovery takes after
+// outages of different lengths.
+#include "TestHarness.h"
+#include "../src/network/WiFiConnection.h"
+#include <random>
+#include <vector>
+
+// An access point that can vanish and come back. Association takes
+// associate_ms from the later of begin() and the AP coming back.
+struct SimulatedWiFi : public WiFiInterface {
+  unsigned long clock = 0;
+  bool ap_present = true;
+  unsigned long ap_since = 0;
+  bool rejects = false;                // Wrong password: attempts fail outright
+  unsigned long associate_ms = 3000;
+  bool associating = false;
+  bool up = false;
+  unsigned long begun_at = 0;
+  std::vector<unsigned long> begins;
+  uint32_t disconnects = 0;
+  uint32_t ap_starts = 0;
+
+  // Jitter source: lowest or highest draw, or seeded
+  enum { DRAW_LOW, DRAW_HIGH, DRAW_SEEDED } draw = DRAW_SEEDED;
+  std::mt19937 rng;
+
+  void begin() override {
+    begins.push_back(clock);
+    associating = true;
+    up = false;
+    begun_at = clock;
+  }
+
+  void disconnect() override {
+    disconnects++;
+    associating = false;
+    up = false;
+  }
+
+  WiFiLinkState linkState() override {
+    if (!ap_present) up = false;
+    if (associating && rejects) return WIFI_LINK_FAILED;
+    unsigned long from = begun_at > ap_since ? begun_at : ap_since;
+    if (associating && ap_present && clock - from >= associate_ms) {
+      associating = false;
+      up = true;
+    }
+    return up ? WIFI_LINK_UP : WIFI_LINK_DOWN;
+  }
+
+  void startAccessPoint() override { ap_starts++; }
+  unsigned long now() override { return clock; }
+
+  uint32_t random(uint32_t bound) override {
+    if (draw == DRAW_LOW) return 0;
+    if (draw == DRAW_HIGH) return bound - 1;
+    return rng() % bound;
+  }
+
+  void setAccessPoint(bool present) {
+    ap_present = present;
+    if (present) ap_since = clock;
+  }
+};
+
+// The network task loop: one service call every 10 ms
+static WiFiConnectionEvent run(WiFiConnection& connection, SimulatedWiFi& wifi, unsigned long ms,
+                               WiFiConnectionEvent until = WIFI_EVENT_NONE) {
+  for (unsigned long elapsed = 0; elapsed < ms; elapsed += 10) {
+    wifi.clock += 10;
+    WiFiConnectionEvent event = wifiConnectionService(connection);
+    if (until != WIFI_EVENT_NONE && event == until) return event;
+  }
+  return WIFI_EVENT_NONE;
+}
+
+static void connectFirst(WiFiConnection& connection, SimulatedWiFi& wifi) {
+  wifiConnectionBegin(connection, &wifi, true);
+  run(connection, wifi, 10000, WIFI_EVENT_CONNECTED);
+}
+
+TEST(wifi_backoff_doubles_to_the_cap) {
+  const unsigned long lowest[] = {500, 1000, 2000, 4000, 8000, 16000, 30000, 30000, 30000};
+  const unsigned long highest[] = {1000, 2000, 4000, 8000, 16000, 32000, 60000, 60000, 60000};
+
+  for (int high = 0; high < 2; high++) {
+    const unsigned long* expected = high ? highest : lowest;
+    SimulatedWiFi wifi;
+    wifi.draw = high ? SimulatedWiFi::DRAW_HIGH : SimulatedWiFi::DRAW_LOW;
+    wifi.setAccessPoint(false);
+    WiFiConnection connection;
+    wifiConnectionBegin(connection, &wifi, false);
+
+    for (int failure = 0; failure < 9; failure++) {
+      EXPECT_EQ(run(connection, wifi, WIFI_CONNECT_TIMEOUT_MS + 10, WIFI_EVENT_ATTEMPT_FAILED),
+                WIFI_EVENT_ATTEMPT_FAILED);
+      EXPECT_EQ(connection.stats.failures, failure + 1);
+      EXPECT_EQ(connection.stats.backoff_ms, expected[failure]);
+      EXPECT_TRUE(connection.state == WIFI_STATE_BACKOFF);
+      run(connection, wifi, connection.stats.backoff_ms);
+    }
+
+    // Each retry starts a full timeout plus that round's backoff after the last
+    EXPECT_EQ(wifi.begins.size(), 10);
+    for (int i = 1; i < 10; i++) {
+      EXPECT_EQ(wifi.begins[i] - wifi.begins[i - 1], WIFI_CONNECT_TIMEOUT_MS + expected[i - 1]);
+    }
+    EXPECT_EQ(wifi.disconnects, 9);
+    EXPECT_EQ(wifi.ap_starts, 0);
+  }
+}
+
+TEST(wifi_backoff_jitter_stays_in_the_upper_half) {
+  SimulatedWiFi wifi;
+  wifi.rng.seed(3);
+  wifi.setAccessPoint(false);
+  WiFiConnection connection;
+  wifiConnectionBegin(connection, &wifi, false);
+
+  unsigned long window = WIFI_BACKOFF_MIN_MS;
+  bool spread = false;
+  for (int failure = 0; failure < 12; failure++) {
+    run(connection, wifi, WIFI_CONNECT_TIMEOUT_MS + 10, WIFI_EVENT_ATTEMPT_FAILED);
+    unsigned long backoff = connection.stats.backoff_ms;
+    EXPECT_TRUE(backoff >= window / 2 && backoff <= window);
+    if (backoff != window / 2 && backoff != window) spread = true;
+    run(connection, wifi, backoff);
+    window = window * 2 > WIFI_BACKOFF_MAX_MS ? WIFI_BACKOFF_MAX_MS : window * 2;
+  }
+  EXPECT_TRUE(spread);
+
+  // Two devices losing the same AP do not retry in lockstep
+  SimulatedWiFi other;
+  other.rng.seed(4);
+  other.setAccessPoint(false);
+  WiFiConnection second;
+  wifiConnectionBegin(second, &other, false);
+  run(second, other, wifi.clock);
+  size_t common = wifi.begins.size() < other.begins.size() ? wifi.begins.size() : other.begins.size();
+  int matching = 0;
+  for (size_t i = 1; i < common; i++) {
+    if (wifi.begins[i] == other.begins[i]) matching++;
+  }
+  EXPECT_TRUE(matching < 2);
+}
+
+TEST(wifi_rejected_attempt_fails_without_waiting_for_the_timeout) {
+  SimulatedWiFi wifi;
+  wifi.draw = SimulatedWiFi::DRAW_LOW;
+  wifi.rejects = true;
+  WiFiConnection connection;
+  wifiConnectionBegin(connection, &wifi, false);
+
+  EXPECT_EQ(run(connection, wifi, 100, WIFI_EVENT_ATTEMPT_FAILED), WIFI_EVENT_ATTEMPT_FAILED);
+  EXPECT_EQ(wifi.clock, 10);
+  EXPECT_EQ(connection.stats.backoff_ms, WIFI_BACKOFF_MIN_MS / 2);
+}
+
+TEST(wifi_boot_attempt_falls_back_to_the_access_point) {
+  SimulatedWiFi wifi;
+  wifi.setAccessPoint(false);
+  WiFiConnection connection;
+  wifiConnectionBegin(connection, &wifi, true);
+
+  // Not before the timeout, then once
+  run(connection, wifi, WIFI_CONNECT_TIMEOUT_MS - 10);
+  EXPECT_TRUE(connection.state == WIFI_STATE_CONNECTING);
+  EXPECT_EQ(wifi.ap_starts, 0);
+  EXPECT_EQ(run(connection, wifi, 10, WIFI_EVENT_AP_STARTED), WIFI_EVENT_AP_STARTED);
+  EXPECT_TRUE(connection.state == WIFI_STATE_AP);
+  EXPECT_EQ(wifi.ap_starts, 1);
+  EXPECT_EQ(wifi.disconnects, 1);
+
+  // The portal stays up: no more station attempts, even if the network returns
+  wifi.setAccessPoint(true);
+  run(connection, wifi, 300000);
+  EXPECT_TRUE(connection.state == WIFI_STATE_AP);
+  EXPECT_EQ(wifi.begins.size(), 1);
+  EXPECT_EQ(wifi.ap_starts, 1);
+
+  // A wrong password on boot reaches the portal at once
+  SimulatedWiFi rejected;
+  rejected.rejects = true;
+  WiFiConnection other;
+  wifiConnectionBegin(other, &rejected, true);
+  EXPECT_EQ(run(other, rejected, 100, WIFI_EVENT_AP_STARTED), WIFI_EVENT_AP_STARTED);
+  EXPECT_EQ(rejected.ap_starts, 1);
+}
+
+TEST(wifi_no_access_point_once_connected) {
+  SimulatedWiFi wifi;
+  WiFiConnection connection;
+  connectFirst(connection, wifi);
+  EXPECT_TRUE(connection.state == WIFI_STATE_CONNECTED);
+
+  // A long outage after a good boot backs off instead of opening the portal
+  wifi.setAccessPoint(false);
+  run(connection, wifi, 120000);
+  EXPECT_EQ(wifi.ap_starts, 0);
+  EXPECT_TRUE(connection.stats.failures > 0);
+  EXPECT_TRUE(connection.state != WIFI_STATE_AP);
+}
+
+TEST(wifi_dropped_link_retries_at_once) {
+  SimulatedWiFi wifi;
+  WiFiConnection connection;
+  connectFirst(connection, wifi);
+  EXPECT_EQ(connection.stats.last_attempt_ms, wifi.associate_ms);
+  size_t begins = wifi.begins.size();
+
+  wifi.setAccessPoint(false);
+  EXPECT_EQ(run(connection, wifi, 10, WIFI_EVENT_LOST), WIFI_EVENT_LOST);
+  EXPECT_EQ(wifi.begins.size(), begins + 1);
+  EXPECT_EQ(connection.stats.disconnects, 1);
+  EXPECT_EQ(connection.stats.backoff_ms, 0);
+
+  // Back after five seconds: associated three seconds later, no backoff in between
+  run(connection, wifi, 5000);
+  wifi.setAccessPoint(true);
+  EXPECT_EQ(run(connection, wifi, 10000, WIFI_EVENT_CONNECTED), WIFI_EVENT_CONNECTED);
+  EXPECT_EQ(connection.stats.last_recovery_ms, 5000 + wifi.associate_ms);
+  EXPECT_EQ(connection.stats.failures, 0);
+  EXPECT_EQ(wifi.begins.size(), begins + 1);
+}
+
+TEST(wifi_success_resets_the_backoff) {
+  SimulatedWiFi wifi;
+  wifi.draw = SimulatedWiFi::DRAW_HIGH;
+  WiFiConnection connection;
+  connectFirst(connection, wifi);
+
+  // Fail up to the cap, recover, then fail again: starts from the bottom
+  wifi.setAccessPoint(false);
+  run(connection, wifi, 400000);
+  EXPECT_EQ(connection.stats.backoff_ms, WIFI_BACKOFF_MAX_MS);
+  wifi.setAccessPoint(true);
+  run(connection, wifi, 200000, WIFI_EVENT_CONNECTED);
+  EXPECT_TRUE(connection.state == WIFI_STATE_CONNECTED);
+  EXPECT_EQ(connection.stats.failures, 0);
+
+  wifi.setAccessPoint(false);
+  run(connection, wifi, WIFI_CONNECT_TIMEOUT_MS + 20, WIFI_EVENT_ATTEMPT_FAILED);
+  EXPECT_EQ(connection.stats.backoff_ms, WIFI_BACKOFF_MIN_MS);
+}
+
+// Time from the AP coming back to the link being up, over outages of
+// different lengths and many jitter seeds. Short outages are caught by the
+// immediate retry; long ones wait out whatever backoff they are in.
+TEST(bench_wifi_recovery_after_outage) {
+  const unsigned long outages[] = {1000, 10000, 30000, 120000, 600000};
+  const int seeds = 200;
+
+  for (unsigned long outage : outages) {
+    unsigned long total = 0, worst = 0;
+    uint32_t attempts = 0;
+    for (int seed = 0; seed < seeds; seed++) {
+      SimulatedWiFi wifi;
+      wifi.rng.seed(seed);
+      WiFiConnection connection;
+      connectFirst(connection, wifi);
+      // Outages start at different points of the loop
+      run(connection, wifi, (seed % 50) * 10);
+
+      uint32_t before = connection.stats.attempts;
+      wifi.setAccessPoint(false);
+      run(connection, wifi, outage);
+      wifi.setAccessPoint(true);
+      unsigned long back = wifi.clock;
+      run(connection, wifi, 200000, WIFI_EVENT_CONNECTED);
+
+      unsigned long recovery = wifi.clock - back;
+      EXPECT_TRUE(connection.state == WIFI_STATE_CONNECTED);
+      EXPECT_TRUE(recovery <= WIFI_CONNECT_TIMEOUT_MS + WIFI_BACKOFF_MAX_MS + wifi.associate_ms);
+      total += recovery;
+      if (recovery > worst) worst = recovery;
+      attempts += connection.stats.attempts - before;
+    }
+    BENCH("outage %6lu ms: back up %5lu ms after the AP (worst %5lu ms), %.1f attempts",
+          outage, total / seeds, worst, (double)attempts / seeds);
+  }
+}
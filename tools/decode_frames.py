@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""Replay a MavenLED flight recorder dump (GET /api/frames/dump).
+
+Prints one line per frame (time, printer status, frame type, average color)
+and can write the frames as a PPM image, one row per frame, for a quick
+look at what the strip showed.
+
+    curl -o frames.mlfr http://mavenled.local/api/frames/dump
+    python3 tools/decode_frames.py frames.mlfr --ppm frames.ppm
+"""
+
+import argparse
+import struct
+import sys
+
+KEYFRAME = 0x01
+
+
+def read_dump(data):
+    if data[:4] != b"MLFR":
+        raise ValueError("not a frame recorder dump")
+    version, tag_count = data[4], data[5]
+    if version != 1:
+        raise ValueError("unsupported dump version %d" % version)
+
+    pos = 6
+    tags = []
+    for _ in range(tag_count):
+        length = data[pos]
+        tags.append(data[pos + 1:pos + 1 + length].decode("utf-8", "replace"))
+        pos += 1 + length
+
+    frame_count, record_bytes = struct.unpack_from("<II", data, pos)
+    pos += 8
+    return tags, frame_count, data[pos:pos + record_bytes]
+
+
+def decode_payload(payload, length):
+    out = bytearray()
+    i = 0
+    while i < len(payload):
+        control = payload[i]
+        if control < 128:
+            out += payload[i + 1:i + 2 + control]
+            i += 2 + control
+        else:
+            out += bytes([payload[i + 1]]) * (control - 126)
+            i += 2
+    if len(out) != length:
+        raise ValueError("payload decodes to %d bytes, expected %d" % (len(out), length))
+    return out
+
+
+def replay(records):
+    """Yield (time_ms, tag, keyframe, rgb) for every decodable frame."""
+    pos = 0
+    frame = None
+    while pos + 10 <= len(records):
+        time_ms, tag, flags, count, payload_length = struct.unpack_from("<IBBHH", records, pos)
+        payload = records[pos + 10:pos + 10 + payload_length]
+        pos += 10 + payload_length
+
+        delta = decode_payload(payload, count * 3)
+        keyframe = bool(flags & KEYFRAME)
+        if keyframe:
+            frame = delta
+        elif frame is None or len(frame) != len(delta):
+            # Frames before the first surviving keyframe cannot be rebuilt
+            continue
+        else:
+            frame = bytearray(a ^ b for a, b in zip(frame, delta))
+        yield time_ms, tag, keyframe, bytes(frame)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("dump")
+    parser.add_argument("--ppm", help="write frames as a PPM image, one row per frame")
+    args = parser.parse_args()
+
+    with open(args.dump, "rb") as f:
+        tags, frame_count, records = read_dump(f.read())
+
+    frames = list(replay(records))
+    print("%d frames recorded, %d replayable, %d bytes" % (frame_count, len(frames), len(records)))
+    if not frames:
+        return 0
+
+    start = frames[0][0]
+    for time_ms, tag, keyframe, rgb in frames:
+        pixels = len(rgb) // 3
+        average = [sum(rgb[c::3]) // max(pixels, 1) for c in range(3)]
+        status = tags[tag] if tag < len(tags) else "?"
+        print("%8d ms  %-18s %s  avg #%02x%02x%02x" % (
+            time_ms - start, status, "K" if keyframe else " ", *average))
+
+    if args.ppm:
+        width = max(len(rgb) // 3 for _, _, _, rgb in frames)
+        with open(args.ppm, "wb") as f:
+            f.write(b"P6 %d %d 255\n" % (width, len(frames)))
+            for _, _, _, rgb in frames:
+                f.write(rgb.ljust(width * 3, b"\0"))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())